@@ -0,0 +1,111 @@
+// Time per frame of updateAnimators() (clip sampling, cross-fades and skinning palettes) for a crowd of characters,
+// at every SIMD level the CPU supports, plus sampling and palette building on their own.
+// Usage: animation_bench [characters] [frames]
+
+#include "animation.h"
+#include "simd.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace ae;
+
+namespace {
+	constexpr uint32 Joints = 61;
+	constexpr uint32 Frames = 61; // 2 s at 30 Hz
+
+	using Clock = std::chrono::steady_clock;
+
+	double elapsed(Clock::time_point start, double count, double unit) {
+		return std::chrono::duration<double>(Clock::now() - start).count() * unit / count;
+	}
+
+	/// Every joint swings around its own axis with a phase of its own, sign flips included.
+	AnimationClip makeClip(const std::vector<Quaternion>& base, float twist) {
+		std::vector<Pose> frames(Frames);
+		for (uint32 i = 0; i < Frames; i++) {
+			frames[i].resize(Joints);
+			for (uint32 j = 0; j < Joints; j++) {
+				Quaternion r = base[j] * Quaternion::axisAngle(Vector3(0.0f, 0.0f, 1.0f), std::sin(float(i) * 0.1f + float(j)) * 1.5f);
+				r = r * Quaternion::axisAngle(Vector3(1.0f, 0.0f, 0.0f), twist);
+				frames[i].rotations[j] = i % 3 == 0 ? r * -1.0f : r;
+				frames[i].translations[j] = Vector3(std::sin(float(i) * 0.05f + float(j)), float(j) * 0.1f, 0.5f);
+			}
+		}
+		AnimationClip clip;
+		clip.build(frames, 30.0f);
+		return clip;
+	}
+}
+
+int main(int argc, char** argv) {
+	const uint32 characters = argc > 1 ? uint32(std::atoi(argv[1])) : 1000u;
+	const uint32 frames = argc > 2 ? uint32(std::atoi(argv[2])) : 200u;
+
+	std::mt19937 rng(1);
+	std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+	auto randomRotation = [&]() { return Quaternion(u(rng), u(rng), u(rng), u(rng)).normalized(); };
+
+	Skeleton skeleton;
+	skeleton.addJoint("root", Skeleton::NoParent, Vector3(0.0f, 1.0f, 0.0f));
+	for (uint32 j = 1; j < Joints; j++) {
+		skeleton.addJoint("joint" + std::to_string(j), int32(rng() % j), Vector3(u(rng), u(rng), u(rng)) * 0.3f, randomRotation());
+	}
+
+	std::vector<Quaternion> base(Joints);
+	for (auto& q : base) q = randomRotation();
+	const AnimationClip walk = makeClip(base, 0.0f), run = makeClip(base, 0.7f);
+
+	EntityWorld world;
+	std::vector<Entity*> entities;
+	world.create(characters, entities);
+	for (size_t i = 0; i < entities.size(); i++) {
+		auto* animator = entities[i]->createComponent<AnimatorComponent>();
+		animator->skeleton(&skeleton);
+		animator->play(&walk);
+		animator->advance(float(i % 60) / 30.0f); // Spread the characters over the clip
+	}
+
+	std::printf("%u characters x %u joints, %u frames, %zu bytes per clip\n", characters, Joints, frames, walk.memoryUsage());
+	std::printf("ms per frame of updateAnimators(), playing / cross-fading\n");
+	for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::SSE41, SimdLevel::AVX2, SimdLevel::AVX512 }) {
+		if (level > simd::detect()) break;
+		simd::level(level);
+
+		double ms[2];
+		for (int fade = 0; fade < 2; fade++) {
+			// The fade is long enough to last through the timed frames.
+			if (fade) {
+				world.each([&](Entity*, AnimatorComponent* animator) { animator->play(&run, 100.0f); });
+			}
+			for (int i = 0; i < 5; i++) updateAnimators(&world, 1.0f / 60.0f);
+
+			const auto start = Clock::now();
+			for (uint32 i = 0; i < frames; i++) updateAnimators(&world, 1.0f / 60.0f);
+			ms[fade] = elapsed(start, frames, 1e3);
+		}
+		world.each([&](Entity*, AnimatorComponent* animator) { animator->play(&walk); });
+
+		// One character at a time, so neither part hides behind the threads.
+		const uint32 iterations = frames * 100;
+		Pose pose;
+		std::vector<Affine3x4> model(Joints), palette(Joints);
+		auto start = Clock::now();
+		for (uint32 i = 0; i < iterations; i++) walk.sample(float(i) * 0.001f, true, pose);
+		const double sampleUs = elapsed(start, iterations, 1e6);
+		start = Clock::now();
+		for (uint32 i = 0; i < iterations; i++) skeleton.computeMatrices(pose, model.data(), palette.data());
+		const double paletteUs = elapsed(start, iterations, 1e6);
+
+		std::printf(
+			"  %-7s %7.3f / %7.3f   sample %.3f us, palette %.3f us per character\n",
+			simd::name(level).c_str(), ms[0], ms[1], sampleUs, paletteUs
+		);
+	}
+	return 0;
+}
@@ -0,0 +1,99 @@
+// Accuracy of FastMath against double precision libm, and its throughput against PreciseMath.
+// Usage: fast_math_bench [samples]
+
+#include "vec_math.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace ae;
+
+namespace {
+	struct Error {
+		double worst{ 0.0 };
+		float at{ 0.0f };
+
+		void add(double e, float x) {
+			if (e > worst) {
+				worst = e;
+				at = x;
+			}
+		}
+	};
+
+	double relative(double value, double reference) {
+		return std::abs(value - reference) / std::max(std::abs(reference), 1e-30);
+	}
+
+	template <typename F>
+	double nsPerCall(const std::vector<float>& in, F fn) {
+		volatile float sink = 0.0f;
+		float acc = 0.0f;
+		const auto start = std::chrono::steady_clock::now();
+		for (int rep = 0; rep < 8; rep++) {
+			for (float x : in) acc += fn(x);
+		}
+		const auto end = std::chrono::steady_clock::now();
+		sink = acc;
+		(void) sink;
+		return std::chrono::duration<double, std::nano>(end - start).count() / (8.0 * in.size());
+	}
+}
+
+int main(int argc, char** argv) {
+	const uint32_t samples = argc > 1 ? uint32_t(std::atoi(argv[1])) : 4000000u;
+	auto sweep = [&](float lo, float hi, auto fn) {
+		for (uint32_t i = 0; i <= samples; i++) fn(lo + (hi - lo) * float(double(i) / samples));
+	};
+
+	Error rsqrtE, sqrtE, sinE, tanE, atan2E, acosE, farE;
+	sweep(1e-6f, 1e6f, [&](float x) {
+		rsqrtE.add(relative(FastMath::rsqrt(x), 1.0 / std::sqrt(double(x))), x);
+		sqrtE.add(relative(FastMath::sqrt(x), std::sqrt(double(x))), x);
+	});
+	sweep(-consts::TwoPi, consts::TwoPi, [&](float x) {
+		sinE.add(std::abs(FastMath::sin(x) - std::sin(double(x))), x);
+		sinE.add(std::abs(FastMath::cos(x) - std::cos(double(x))), x);
+	});
+	sweep(-1.5f, 1.5f, [&](float x) { tanE.add(relative(FastMath::tan(x), std::tan(double(x))), x); });
+	sweep(-consts::Pi, consts::Pi, [&](float a) {
+		const float y = std::sin(a), x = std::cos(a);
+		atan2E.add(std::abs(FastMath::atan2(y, x) - std::atan2(double(y), double(x))), a);
+	});
+	// Close to +-Pi, where a float result is only 2.4e-7 apart.
+	sweep(-1e-3f, 1e-3f, [&](float y) { atan2E.add(std::abs(FastMath::atan2(y, -1.0f) - std::atan2(double(y), -1.0)), y); });
+	sweep(-1.0f, 1.0f, [&](float x) { acosE.add(std::abs(FastMath::acos(x) - std::acos(double(x))), x); });
+	// Range reduction far out, and no overflow for huge arguments.
+	sweep(-1e4f, 1e4f, [&](float x) { farE.add(std::abs(FastMath::sin(x) - std::sin(double(x))), x); });
+	const float huge = FastMath::sin(1e12f) + FastMath::sin(-3e38f);
+
+	std::printf("max error over %u samples per function\n", samples);
+	std::printf("  rsqrt  rel %.3g (x=%g)\n", rsqrtE.worst, rsqrtE.at);
+	std::printf("  sqrt   rel %.3g (x=%g)\n", sqrtE.worst, sqrtE.at);
+	std::printf("  sin/cos abs %.3g on [-2pi, 2pi] (x=%g)\n", sinE.worst, sinE.at);
+	std::printf("  sin    abs %.3g on [-1e4, 1e4] (x=%g)\n", farE.worst, farE.at);
+	std::printf("  tan    rel %.3g on [-1.5, 1.5] (x=%g)\n", tanE.worst, tanE.at);
+	std::printf("  atan2  abs %.3g (at %g)\n", atan2E.worst, atan2E.at);
+	std::printf("  acos   abs %.3g (x=%g)\n", acosE.worst, acosE.at);
+	std::printf("  sin(1e12) + sin(-3e38) = %g\n", huge);
+
+	std::vector<float> in(1 << 20);
+	for (size_t i = 0; i < in.size(); i++) in[i] = -3.0f + 6.0f * float(i) / in.size();
+	std::vector<float> unit(in.size());
+	for (size_t i = 0; i < in.size(); i++) unit[i] = in[i] / 3.0f;
+
+	std::printf("ns per call, Precise / Fast\n");
+	auto row = [&](const char* name, const std::vector<float>& values, auto precise, auto fast) {
+		const double p = nsPerCall(values, precise), f = nsPerCall(values, fast);
+		std::printf("  %-6s %6.2f / %6.2f  (%.2fx)\n", name, p, f, p / f);
+	};
+	row("rsqrt", in, [](float x) { return PreciseMath::rsqrt(std::abs(x) + 1.0f); }, [](float x) { return FastMath::rsqrt(std::abs(x) + 1.0f); });
+	row("sqrt", in, [](float x) { return PreciseMath::sqrt(std::abs(x)); }, [](float x) { return FastMath::sqrt(std::abs(x)); });
+	row("sin", in, [](float x) { return PreciseMath::sin(x); }, [](float x) { return FastMath::sin(x); });
+	row("tan", in, [](float x) { return PreciseMath::tan(x * 0.5f); }, [](float x) { return FastMath::tan(x * 0.5f); });
+	row("atan2", in, [](float x) { return PreciseMath::atan2(x, 1.5f - x); }, [](float x) { return FastMath::atan2(x, 1.5f - x); });
+	row("acos", unit, [](float x) { return PreciseMath::acos(x); }, [](float x) { return FastMath::acos(x); });
+	return 0;
+}
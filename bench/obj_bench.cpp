@@ -0,0 +1,83 @@
+// Parse throughput of obj::parse() in MB/s, single-threaded and on every core, for an OBJ file or, without one, a
+// generated mesh large enough to be split into chunks.
+// Usage: obj_bench [file.obj] [repetitions] [threads]
+
+#include "obj_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+using namespace ae;
+
+namespace {
+	using Clock = std::chrono::steady_clock;
+
+	/// A grid of n x n quads with positions, texture coordinates and normals, about 49 MB for n = 600.
+	std::string makeGrid(uint32 n) {
+		std::string text;
+		char line[96];
+		for (uint32 y = 0; y <= n; y++) {
+			for (uint32 x = 0; x <= n; x++) {
+				const float u = float(x) / float(n), v = float(y) / float(n);
+				std::snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", u * 10.0f - 5.0f, u * v, v * 10.0f - 5.0f);
+				text += line;
+				std::snprintf(line, sizeof(line), "vt %.6f %.6f\nvn 0 1 0\n", u, v);
+				text += line;
+			}
+		}
+		for (uint32 y = 0; y < n; y++) {
+			for (uint32 x = 0; x < n; x++) {
+				const uint32 a = y * (n + 1) + x + 1, b = a + 1, c = a + n + 2, d = a + n + 1;
+				std::snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c, d, d, d);
+				text += line;
+			}
+		}
+		return text;
+	}
+
+	/// Best of repetitions, in MB/s.
+	double throughput(const std::string& text, uint32 threads, uint32 repetitions, size_t& triangles) {
+		double best = 1e30;
+		for (uint32 i = 0; i < repetitions; i++) {
+			ObjData data;
+			const auto start = Clock::now();
+			obj::parse(text, data, threads);
+			best = std::min(best, std::chrono::duration<double>(Clock::now() - start).count());
+			triangles = data.corners.size() / 3;
+		}
+		return double(text.size()) / (1024.0 * 1024.0) / std::max(best, 1e-9);
+	}
+}
+
+int main(int argc, char** argv) {
+	const uint32 repetitions = argc > 2 ? uint32(std::atoi(argv[2])) : 10u;
+
+	std::string text;
+	if (argc > 1) {
+		std::ifstream file(argv[1], std::ios::binary);
+		if (!file) {
+			std::printf("Can't open %s\n", argv[1]);
+			return 1;
+		}
+		text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	} else {
+		text = makeGrid(600);
+	}
+
+	const uint32 cores = argc > 3 ? uint32(std::atoi(argv[3])) : std::max(std::thread::hardware_concurrency(), 1u);
+	size_t triangles = 0;
+	std::printf("%s, %.1f MB, best of %u\n", argc > 1 ? argv[1] : "600x600 grid", double(text.size()) / (1024.0 * 1024.0), repetitions);
+	const double single = throughput(text, 1, repetitions, triangles);
+	std::printf("  1 thread   %8.1f MB/s  (%zu triangles)\n", single, triangles);
+	if (cores > 1) {
+		const double all = throughput(text, cores, repetitions, triangles);
+		std::printf("  %u threads  %8.1f MB/s  %.1fx\n", cores, all, all / single);
+	}
+	return 0;
+}
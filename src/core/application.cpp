@@ -1,6 +1,7 @@
 #include "application.h"
 
 #include "log.h"
+#include "simd.h"
 
 #ifndef NDEBUG
 static void APIENTRY GLDebug(
@@ -109,6 +110,8 @@ namespace ae {
 		glCullFace(GL_BACK);
 		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
+		Log.info("Math kernels: " + simd::name(simd::level()));
+
 		mainLoop();
 	}
 
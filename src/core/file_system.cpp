@@ -2,6 +2,21 @@
 
 #include "log.h"
 
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#	define WIN32_LEAN_AND_MEAN
+#	define NOMINMAX
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
 namespace ae {
 	FileSystem FileSystem::s_instance{};
 
@@ -100,6 +115,96 @@ namespace ae {
 		return File(path.c_str(), mode);
 	}
 
+	std::string FileSystem::nativePath(const std::string& file) {
+		init(nullptr);
+		const char* dir = PHYSFS_getRealDir(file.c_str());
+		if (dir == nullptr) return "";
+
+		std::string path(dir);
+		if (!path.empty() && path.back() != '/' && path.back() != '\\') path += '/';
+		path += file;
+
+		// Archives report themselves as the real directory, there is no native file to speak of then.
+		PHYSFS_Stat stat;
+		if (!PHYSFS_stat(dir, &stat) || stat.filetype != PHYSFS_FILETYPE_DIRECTORY) {
+			return "";
+		}
+		return path;
+	}
+
+	bool FileSystem::writeNative(const std::string& nativePath, const void* data, uint64_t size) {
+		static std::atomic<uint32_t> s_writes{ 0 };
+#if defined(_WIN32)
+		const unsigned long process = GetCurrentProcessId();
+#else
+		const unsigned long process = static_cast<unsigned long>(getpid());
+#endif
+		const std::string temp = nativePath + ".tmp" + std::to_string(process) + "-" + std::to_string(s_writes++);
+		{
+			std::ofstream fp(temp, std::ios::binary | std::ios::trunc);
+			if (!fp || !fp.write(static_cast<const char*>(data), std::streamsize(size)) || !fp.flush()) {
+				fp.close();
+				std::remove(temp.c_str());
+				return false;
+			}
+		}
+
+#if defined(_WIN32)
+		const bool replaced = MoveFileExA(temp.c_str(), nativePath.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		const bool replaced = std::rename(temp.c_str(), nativePath.c_str()) == 0;
+#endif
+		if (!replaced) std::remove(temp.c_str());
+		return replaced;
+	}
+
+	FileSystem::MappedFile::MappedFile(const std::string& nativePath) {
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(nativePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+			CloseHandle(file);
+			return;
+		}
+
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping == nullptr) {
+			CloseHandle(file);
+			return;
+		}
+
+		m_file = file;
+		m_mapping = mapping;
+		m_size = uint64_t(size.QuadPart);
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+		const int fd = ::open(nativePath.c_str(), O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat st;
+		if (fstat(fd, &st) == 0 && st.st_size > 0) {
+			void* ptr = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED) {
+				m_data = static_cast<const uint8_t*>(ptr);
+				m_size = uint64_t(st.st_size);
+			}
+		}
+		::close(fd);
+#endif
+	}
+
+	FileSystem::MappedFile::~MappedFile() {
+#if defined(_WIN32)
+		if (m_data) UnmapViewOfFile(m_data);
+		if (m_mapping) CloseHandle(m_mapping);
+		if (m_file) CloseHandle(m_file);
+#else
+		if (m_data) munmap(const_cast<uint8_t*>(m_data), size_t(m_size));
+#endif
+	}
+
 	FileSystem::File::File(const char* path, FileMode mode) {
 		PHYSFS_Stat stats;
 		if (!PHYSFS_stat(path, &stats)) {
@@ -2,6 +2,7 @@
 #define FILE_SYSTEM_H
 
 #include "physfs.h"
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -59,6 +60,37 @@ namespace ae {
 
 		File open(const std::string& path, FileMode mode = FileMode::ModeRead);
 
+		/// Read-only memory mapping of a file on the native file system, bypassing PhysFS.
+		class MappedFile {
+		public:
+			MappedFile() = default;
+			explicit MappedFile(const std::string& nativePath);
+			~MappedFile();
+
+			MappedFile(const MappedFile&) = delete;
+			MappedFile& operator =(const MappedFile&) = delete;
+
+			bool valid() const { return m_data != nullptr; }
+			const uint8_t* data() const { return m_data; }
+			uint64_t size() const { return m_size; }
+
+		private:
+			const uint8_t* m_data{ nullptr };
+			uint64_t m_size{ 0 };
+#if defined(_WIN32)
+			void* m_file{ nullptr };
+			void* m_mapping{ nullptr };
+#endif
+		};
+
+		/// Native path of a file in the search path. Empty if it doesn't exist or lives inside an archive.
+		std::string nativePath(const std::string& file);
+
+		/// Writes a file on the native file system, bypassing PhysFS. The data goes to a temporary file of this call
+		/// first, which then replaces nativePath in one step: readers and other writers see the old file or the new
+		/// one, never part of either.
+		static bool writeNative(const std::string& nativePath, const void* data, uint64_t size);
+
 		static FileSystem& ston() { return s_instance; }
 
 	private:
@@ -3,6 +3,9 @@
 namespace ae {
 
 	void Entity::cleanup() {
+		parent(nullptr);
+		for (Entity* child : m_children) child->m_parent = nullptr;
+		m_children.clear();
 		m_components.clear();
 		m_position = Vector3(0.0f);
 		m_rotation = Quaternion();
@@ -20,15 +23,31 @@ namespace ae {
 		}
 	}
 
+	void Entity::parent(Entity* parent) {
+		if (m_parent) {
+			auto& siblings = m_parent->m_children;
+			siblings.erase(std::find(siblings.begin(), siblings.end(), this));
+		}
+		m_parent = parent;
+		if (m_parent) m_parent->m_children.push_back(this);
+	}
+
 	Matrix4 Entity::transform() const {
-		return Matrix4::translation(m_position) *
+		const Matrix4 local = Matrix4::translation(m_position) *
 				m_rotation.toMatrix4() *
 				Matrix4::scale(m_scale);
+		return m_parent ? m_parent->transform() * local : local;
+	}
+
+	Affine3x4 Entity::affineTransform() const {
+		const Affine3x4 local = Affine3x4::fromTRS(m_position, m_rotation, m_scale);
+		return m_parent ? m_parent->affineTransform() * local : local;
 	}
 
 	Matrix4 Entity::viewTransform() const {
-		return m_rotation.conjugated().toMatrix4() *
+		const Matrix4 local = m_rotation.conjugated().toMatrix4() *
 				Matrix4::translation(m_position * -1.0f);
+		return m_parent ? Matrix4(local) * m_parent->affineTransform().inverse().toMatrix4() : local;
 	}
 
 	Entity* EntityWorld::create(const std::string& templateName) {
@@ -44,7 +63,7 @@ namespace ae {
 			auto&& ent = std::make_unique<Entity>();
 			m_activePool.push_back(std::move(ent));
 		} else { // Reuse inactive
-			auto&& ent = std::move(m_inactivePool[0]);
+			std::unique_ptr<Entity> ent = std::move(m_inactivePool[0]);
 			m_inactivePool.erase(m_inactivePool.begin());
 			ent->cleanup();
 			m_activePool.push_back(std::move(ent));
@@ -52,6 +71,25 @@ namespace ae {
 		return m_activePool.back().get();
 	}
 
+	void EntityWorld::create(size_t count, std::vector<Entity*>& out) {
+		m_activePool.reserve(m_activePool.size() + count);
+		out.reserve(out.size() + count);
+
+		// Reused entities come off the back of the inactive pool, so a large batch doesn't shift it every time.
+		const size_t reused = std::min(count, m_inactivePool.size());
+		for (size_t i = 0; i < reused; i++) {
+			auto&& ent = std::move(m_inactivePool.back());
+			m_inactivePool.pop_back();
+			ent->cleanup();
+			m_activePool.push_back(std::move(ent));
+			out.push_back(m_activePool.back().get());
+		}
+		for (size_t i = reused; i < count; i++) {
+			m_activePool.push_back(std::make_unique<Entity>());
+			out.push_back(m_activePool.back().get());
+		}
+	}
+
 	void EntityWorld::registerTemplate(const std::string& templateName, const EntityTemplate& functor) {
 		m_templates.insert({ templateName, functor });
 	}
@@ -73,12 +111,21 @@ namespace ae {
 		auto&& it = m_activePool.begin();
 		while (it != m_activePool.end()) {
 			if ((*it)->m_dead) {
-				auto&& ent = std::move(*it);
+				std::unique_ptr<Entity> ent = std::move(*it);
 				for (auto&& [type, b] : ent->components()) {
 					if (!b->enabled()) continue;
 					b->onUpdate(*this, dt);
 				}
 				it = m_activePool.erase(it);
+
+				// Children go with their parent, they are destroyed on the next update.
+				for (Entity* child : ent->m_children) {
+					child->m_parent = nullptr;
+					child->destroy();
+				}
+				ent->m_children.clear();
+				ent->parent(nullptr);
+				ent->m_generation++;
 				m_inactivePool.push_back(std::move(ent));
 			} else ++it;
 		}
@@ -51,7 +51,13 @@ namespace ae {
 		const Quaternion& rotation() const { return m_rotation; }
 		void rotation(const Quaternion& rotation) { m_rotation = rotation; }
 
+		/// Position, rotation and scale are relative to the parent. The transforms below include the parents'.
+		Entity* parent() const { return m_parent; }
+		void parent(Entity* parent);
+		const std::vector<Entity*>& children() const { return m_children; }
+
 		Matrix4 transform() const;
+		Affine3x4 affineTransform() const;
 		Matrix4 viewTransform() const;
 
 		const std::unordered_map<Type, std::unique_ptr<Component>>& components() { return m_components; }
@@ -93,16 +99,35 @@ namespace ae {
 		float life() const { return m_life; }
 		void destroy(float timeout = 0.0f) { m_life = std::abs(timeout); }
 
+		/// Bumped whenever the world retires the entity to its pool for reuse, see EntityHandle.
+		uint32 generation() const { return m_generation; }
+
 	protected:
 		Vector3 m_position{}, m_scale{ 1.0f };
 		Quaternion m_rotation{};
 
+		Entity* m_parent{ nullptr };
+		std::vector<Entity*> m_children;
+
 		std::unordered_map<Type, std::unique_ptr<Component>> m_components;
 
 		float m_life{ -1.0f };
+		uint32 m_generation{ 0 };
 		bool m_init{ false }, m_dead{ false };
 	};
 
+	/// Reference to an entity that notices when the world recycles it. Entities stay allocated as long as their
+	/// world, so get() is safe to call after a destroy() and returns nullptr once the entity was retired.
+	struct EntityHandle {
+		Entity* entity{ nullptr };
+		uint32 generation{ 0 };
+
+		EntityHandle() = default;
+		explicit EntityHandle(Entity* ent) : entity(ent), generation(ent ? ent->generation() : 0) {}
+
+		Entity* get() const { return entity && entity->generation() == generation ? entity : nullptr; }
+	};
+
 	using EntityTemplate = std::function<void(Entity*)>;
 	class EntityWorld {
 	public:
@@ -111,6 +136,9 @@ namespace ae {
 		Entity* create(const std::string& templateName);
 		Entity* create();
 
+		/// count new entities at once, appended to out.
+		void create(size_t count, std::vector<Entity*>& out);
+
 		void registerTemplate(const std::string& templateName, const EntityTemplate& functor);
 
 		const std::vector<std::unique_ptr<Entity>>& entities() { return m_activePool; }
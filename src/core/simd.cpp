@@ -0,0 +1,106 @@
+#include "simd.h"
+
+#include <algorithm>
+#include <atomic>
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <cpuid.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace simd {
+		namespace {
+#if defined(AE_X86)
+			void cpuid(uint32 leaf, uint32 sub, uint32 regs[4]) {
+#	if defined(_MSC_VER)
+				int r[4];
+				__cpuidex(r, int(leaf), int(sub));
+				for (int i = 0; i < 4; i++) regs[i] = uint32(r[i]);
+#	else
+				__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#	endif
+			}
+
+			uint64 xgetbv() {
+#	if defined(_MSC_VER)
+				return _xgetbv(0);
+#	else
+				uint32 lo, hi;
+				__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+				return (uint64(hi) << 32) | lo;
+#	endif
+			}
+#endif
+
+			SimdLevel detectLevel() {
+#if defined(AE_X86)
+				uint32 r[4];
+				cpuid(0, 0, r);
+				const uint32 maxLeaf = r[0];
+
+				cpuid(1, 0, r);
+				const bool sse2 = (r[3] & (1u << 26)) != 0;
+				const bool sse41 = (r[2] & (1u << 19)) != 0;
+				const bool osxsave = (r[2] & (1u << 27)) != 0;
+				const bool avx = (r[2] & (1u << 28)) != 0;
+				const bool fma = (r[2] & (1u << 12)) != 0;
+				const bool f16c = (r[2] & (1u << 29)) != 0;
+
+				if (!sse2) return SimdLevel::Scalar;
+				if (!sse41) return SimdLevel::SSE2;
+
+				// The OS must save the YMM/ZMM registers on context switches too.
+				const uint64 xcr0 = osxsave ? xgetbv() : 0;
+				const bool ymm = (xcr0 & 0x06) == 0x06;
+				const bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+				bool avx2 = false, avx512 = false;
+				if (maxLeaf >= 7) {
+					cpuid(7, 0, r);
+					avx2 = (r[1] & (1u << 5)) != 0;
+					avx512 = (r[1] & (1u << 16)) != 0;
+				}
+
+				if (avx512 && avx2 && fma && f16c && zmm) return SimdLevel::AVX512;
+				if (avx2 && avx && fma && f16c && ymm) return SimdLevel::AVX2;
+				return SimdLevel::SSE41;
+#else
+				return SimdLevel::Scalar;
+#endif
+			}
+
+			std::atomic<SimdLevel>& activeLevel() {
+				static std::atomic<SimdLevel> lvl{ detect() };
+				return lvl;
+			}
+		}
+
+		SimdLevel detect() {
+			static const SimdLevel lvl = detectLevel();
+			return lvl;
+		}
+
+		SimdLevel level() {
+			return activeLevel().load(std::memory_order_relaxed);
+		}
+
+		void level(SimdLevel lvl) {
+			activeLevel().store(std::min(lvl, detect()), std::memory_order_relaxed);
+		}
+
+		std::string name(SimdLevel lvl) {
+			switch (lvl) {
+				case SimdLevel::Scalar: return "Scalar";
+				case SimdLevel::SSE2: return "SSE2";
+				case SimdLevel::SSE41: return "SSE4.1";
+				case SimdLevel::AVX2: return "AVX2";
+				case SimdLevel::AVX512: return "AVX-512";
+			}
+			return "Unknown";
+		}
+	}
+}
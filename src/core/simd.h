@@ -0,0 +1,43 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include "integer.hpp"
+
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define AE_X86
+#endif
+
+// Lets a single function use a wider instruction set than the rest of the binary.
+// MSVC doesn't need it, every intrinsic is always available there.
+#if defined(AE_X86) && (defined(__GNUC__) || defined(__clang__))
+#	define AE_TARGET(isa) __attribute__((target(isa)))
+#else
+#	define AE_TARGET(isa)
+#endif
+
+namespace ae {
+	enum class SimdLevel : uint8 {
+		Scalar = 0,
+		SSE2,
+		SSE41,
+		AVX2, // Implies FMA and F16C
+		AVX512
+	};
+
+	namespace simd {
+		/// Widest instruction set supported by both the CPU and the OS.
+		SimdLevel detect();
+
+		/// Instruction set currently used by the bulk math kernels.
+		SimdLevel level();
+
+		/// Forces the bulk math kernels to a narrower instruction set (clamped to detect()).
+		void level(SimdLevel lvl);
+
+		std::string name(SimdLevel lvl);
+	}
+}
+
+#endif // SIMD_H
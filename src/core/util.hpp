@@ -1,8 +1,12 @@
 #ifndef UTIL_HPP
 #define UTIL_HPP
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 namespace ae {
@@ -17,6 +21,50 @@ namespace ae {
 			return s;
 		}
 
+		/// Fast non-cryptographic 64 bit hash, for content keys.
+		inline uint64_t hash64(const void* data, size_t size, uint64_t seed = 0) {
+			const uint64_t m = 0x9E3779B97F4A7C15ull;
+			auto mix = [](uint64_t h) {
+				h ^= h >> 33; h *= 0xFF51AFD7ED558CCDull;
+				h ^= h >> 33; h *= 0xC4CEB9FE1A85EC53ull;
+				return h ^ (h >> 33);
+			};
+
+			const uint8_t* p = static_cast<const uint8_t*>(data);
+			uint64_t h = seed ^ (size * m);
+			size_t i = 0;
+			for (; i + 8 <= size; i += 8) {
+				uint64_t k;
+				std::memcpy(&k, p + i, sizeof(k));
+				h = (h ^ mix(k)) * m;
+			}
+
+			uint64_t tail = 0;
+			std::memcpy(&tail, p + i, size - i);
+			return mix(h ^ mix(tail ^ (size - i)));
+		}
+
+		/// Number of ranges parallelFor() should split count items into: one per core (or threads),
+		/// each at least minPerRange items long.
+		inline size_t parallelRanges(size_t count, size_t minPerRange, size_t threads = 0) {
+			if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+			return std::max<size_t>(std::min(threads, count / std::max<size_t>(minPerRange, 1)), 1);
+		}
+
+		/// Runs fn(begin, end, range) over `ranges` contiguous, evenly sized parts of [0, count), each on its
+		/// own thread. The last one runs on the calling thread.
+		template <typename F>
+		inline void parallelFor(size_t count, size_t ranges, F&& fn) {
+			ranges = std::max<size_t>(ranges, 1);
+			std::vector<std::thread> workers;
+			workers.reserve(ranges - 1);
+			for (size_t r = 0; r + 1 < ranges; r++) {
+				workers.emplace_back([&fn, count, ranges, r]() { fn(count * r / ranges, count * (r + 1) / ranges, r); });
+			}
+			fn(count * (ranges - 1) / ranges, count, ranges - 1);
+			for (auto& w : workers) w.join();
+		}
+
 		inline std::vector<std::string> split(const std::string& in, char delim) {
 			std::stringstream ss(in);
 			std::string item;
@@ -0,0 +1,1216 @@
+#include "vec_math.hpp"
+
+#include "simd.h"
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace {
+		// q v q* = (w^2 - u.u) v + 2 (u.v) u + 2 w (u x v), same as Quaternion::rotate.
+		struct RotateFactors {
+			float x, y, z, w, s;
+
+			explicit RotateFactors(const Quaternion& q)
+				: x(q.x), y(q.y), z(q.z), w(q.w),
+				  s(q.w * q.w - (q.x * q.x + q.y * q.y + q.z * q.z))
+			{}
+		};
+
+		// Scalar
+		void dotManyScalar(const Vector3* a, const Vector3* b, float* out, size_t count) {
+			for (size_t i = 0; i < count; i++) out[i] = a[i].x * b[i].x + a[i].y * b[i].y + a[i].z * b[i].z;
+		}
+
+		void crossManyScalar(const Vector3* a, const Vector3* b, Vector3* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const Vector3 u = a[i], v = b[i];
+				out[i] = Vector3(
+					u.y * v.z - u.z * v.y,
+					u.z * v.x - u.x * v.z,
+					u.x * v.y - u.y * v.x
+				);
+			}
+		}
+
+		void normalizeManyScalar(const Vector3* v, Vector3* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const Vector3 p = v[i];
+				out[i] = p / std::sqrt(p.x * p.x + p.y * p.y + p.z * p.z);
+			}
+		}
+
+		void rotateManyScalar(const Quaternion& q, const Vector3* v, Vector3* out, size_t count) {
+			const RotateFactors f{ q };
+			for (size_t i = 0; i < count; i++) {
+				const Vector3 p = v[i];
+				const float d = 2.0f * (f.x * p.x + f.y * p.y + f.z * p.z);
+				const float w2 = 2.0f * f.w;
+				out[i] = Vector3(
+					f.s * p.x + d * f.x + w2 * (f.y * p.z - f.z * p.y),
+					f.s * p.y + d * f.y + w2 * (f.z * p.x - f.x * p.z),
+					f.s * p.z + d * f.z + w2 * (f.x * p.y - f.y * p.x)
+				);
+			}
+		}
+
+		void mulManyScalar(const Quaternion* a, const Quaternion* b, Quaternion* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const Quaternion l = a[i], r = b[i];
+				out[i] = Quaternion(
+					l.x * r.w + l.w * r.x + l.y * r.z - l.z * r.y,
+					l.y * r.w + l.w * r.y + l.z * r.x - l.x * r.z,
+					l.z * r.w + l.w * r.z + l.x * r.y - l.y * r.x,
+					l.w * r.w - l.x * r.x - l.y * r.y - l.z * r.z
+				);
+			}
+		}
+
+		// nlerp factor that follows slerp's constant angular speed for |a.b| = d, within 7.8e-4 radians of rotation
+		// of it at worst (zeux.io, "Approximating slerp"). t is shared by all lanes, so only A and B vary per lane.
+		struct SlerpFactor {
+			float t, h2, c;
+
+			explicit SlerpFactor(float t) : t(t), h2((t - 0.5f) * (t - 0.5f)), c(t * (t - 0.5f) * (t - 1.0f)) {}
+
+			inline float operator ()(float d) const {
+				const float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+				const float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+				return t + c * (a * h2 + b);
+			}
+		};
+
+		void lerpManyScalar(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count, bool spherical) {
+			const SlerpFactor slerp{ t };
+			for (size_t i = 0; i < count; i++) {
+				const Quaternion l = a[i], r = b[i];
+				const float d = l.dot(r);
+				const float f = spherical ? slerp(std::abs(d)) : t;
+				const Quaternion q = l * (1.0f - f) + r * (d < 0.0f ? -f : f);
+				out[i] = q * (1.0f / std::sqrt(q.dot(q)));
+			}
+		}
+
+		void transformManyScalar(const Matrix4& m, const Vector3* v, Vector3* out, size_t count, float w) {
+			for (size_t i = 0; i < count; i++) {
+				const Vector3 p = v[i];
+				out[i] = Vector3(
+					m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z + m[0][3] * w,
+					m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z + m[1][3] * w,
+					m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z + m[2][3] * w
+				);
+			}
+		}
+
+		inline void mul4x4Scalar(const float* a, const float* b, float* out) {
+			float r[16];
+			for (size_t i = 0; i < 4; i++) {
+				for (size_t j = 0; j < 4; j++) {
+					r[i * 4 + j] =
+						a[i * 4 + 0] * b[0 * 4 + j] +
+						a[i * 4 + 1] * b[1 * 4 + j] +
+						a[i * 4 + 2] * b[2 * 4 + j] +
+						a[i * 4 + 3] * b[3 * 4 + j];
+				}
+			}
+			std::copy(r, r + 16, out);
+		}
+
+		void mulMatricesScalar(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4Scalar(a[i].data(), b[i].data(), out[i].data());
+		}
+
+		void mulMatricesScalar(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4Scalar(a.data(), b[i].data(), out[i].data());
+		}
+
+		void quatToMatrixManyScalar(const Quaternion* q, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) {
+				const float x = q[i].x, y = q[i].y, z = q[i].z, w = q[i].w;
+				out[i] = Matrix4({
+					1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y - w * z), 2.0f * (x * z + w * y), 0.0f,
+					2.0f * (x * y + w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z - w * x), 0.0f,
+					2.0f * (x * z - w * y), 2.0f * (y * z + w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f,
+					0.0f, 0.0f, 0.0f, 1.0f
+				});
+			}
+		}
+
+		void classifyManyScalar(const Frustum& f, const AABB* boxes, Containment* out, size_t count) {
+			for (size_t i = 0; i < count; i++) out[i] = f.classify(boxes[i]);
+		}
+
+		// Lane masks of the boxes fully outside / straddling any plane to a Containment.
+		inline void writeContainment(uint32_t outside, uint32_t partial, Containment* out, size_t n) {
+			for (size_t j = 0; j < n; j++) {
+				if (outside & (1u << j)) out[j] = Containment::Outside;
+				else if (partial & (1u << j)) out[j] = Containment::Intersecting;
+				else out[j] = Containment::Inside;
+			}
+		}
+
+#if defined(AE_X86)
+		// SSE2, 4 elements per iteration.
+		// Vector3 arrays are de-interleaved into x/y/z registers with shuffles, this is lane-local
+		// so the AVX2 and AVX-512 paths below use the exact same sequence on 2 and 4 lanes.
+		AE_TARGET("sse2") inline void load3_SSE2(const Vector3* p, __m128& x, __m128& y, __m128& z) {
+			const float* f = &p->x;
+			const __m128 m0 = _mm_loadu_ps(f + 0); // x0 y0 z0 x1
+			const __m128 m1 = _mm_loadu_ps(f + 4); // y1 z1 x2 y2
+			const __m128 m2 = _mm_loadu_ps(f + 8); // z2 x3 y3 z3
+			const __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			const __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		AE_TARGET("sse2") inline void store3_SSE2(Vector3* p, __m128 x, __m128 y, __m128 z) {
+			float* f = &p->x;
+			const __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_ps(f + 0, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(f + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+			_mm_storeu_ps(f + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+
+		AE_TARGET("sse2") void dotMany_SSE2(const Vector3* a, const Vector3* b, float* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 ax, ay, az, bx, by, bz;
+				load3_SSE2(a + i, ax, ay, az);
+				load3_SSE2(b + i, bx, by, bz);
+				__m128 d = _mm_mul_ps(ax, bx);
+				d = _mm_add_ps(d, _mm_mul_ps(ay, by));
+				d = _mm_add_ps(d, _mm_mul_ps(az, bz));
+				_mm_storeu_ps(out + i, d);
+			}
+			dotManyScalar(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("sse2") void crossMany_SSE2(const Vector3* a, const Vector3* b, Vector3* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 ax, ay, az, bx, by, bz;
+				load3_SSE2(a + i, ax, ay, az);
+				load3_SSE2(b + i, bx, by, bz);
+				store3_SSE2(out + i,
+					_mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)),
+					_mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)),
+					_mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx))
+				);
+			}
+			crossManyScalar(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("sse2") void normalizeMany_SSE2(const Vector3* v, Vector3* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 x, y, z;
+				load3_SSE2(v + i, x, y, z);
+				__m128 len = _mm_mul_ps(x, x);
+				len = _mm_add_ps(len, _mm_mul_ps(y, y));
+				len = _mm_add_ps(len, _mm_mul_ps(z, z));
+				len = _mm_sqrt_ps(len);
+				store3_SSE2(out + i, _mm_div_ps(x, len), _mm_div_ps(y, len), _mm_div_ps(z, len));
+			}
+			normalizeManyScalar(v + i, out + i, count - i);
+		}
+
+		AE_TARGET("sse2") void rotateMany_SSE2(const Quaternion& q, const Vector3* v, Vector3* out, size_t count) {
+			const RotateFactors f{ q };
+			const __m128 qx = _mm_set1_ps(f.x), qy = _mm_set1_ps(f.y), qz = _mm_set1_ps(f.z);
+			const __m128 s = _mm_set1_ps(f.s), w2 = _mm_set1_ps(2.0f * f.w), two = _mm_set1_ps(2.0f);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 x, y, z;
+				load3_SSE2(v + i, x, y, z);
+				__m128 d = _mm_mul_ps(qx, x);
+				d = _mm_add_ps(d, _mm_mul_ps(qy, y));
+				d = _mm_add_ps(d, _mm_mul_ps(qz, z));
+				d = _mm_mul_ps(d, two);
+
+				const __m128 cx = _mm_sub_ps(_mm_mul_ps(qy, z), _mm_mul_ps(qz, y));
+				const __m128 cy = _mm_sub_ps(_mm_mul_ps(qz, x), _mm_mul_ps(qx, z));
+				const __m128 cz = _mm_sub_ps(_mm_mul_ps(qx, y), _mm_mul_ps(qy, x));
+
+				store3_SSE2(out + i,
+					_mm_add_ps(_mm_add_ps(_mm_mul_ps(s, x), _mm_mul_ps(d, qx)), _mm_mul_ps(w2, cx)),
+					_mm_add_ps(_mm_add_ps(_mm_mul_ps(s, y), _mm_mul_ps(d, qy)), _mm_mul_ps(w2, cy)),
+					_mm_add_ps(_mm_add_ps(_mm_mul_ps(s, z), _mm_mul_ps(d, qz)), _mm_mul_ps(w2, cz))
+				);
+			}
+			rotateManyScalar(q, v + i, out + i, count - i);
+		}
+
+		AE_TARGET("sse2") void mulMany_SSE2(const Quaternion* a, const Quaternion* b, Quaternion* out, size_t count) {
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 ax = _mm_loadu_ps(&a[i + 0].x), ay = _mm_loadu_ps(&a[i + 1].x);
+				__m128 az = _mm_loadu_ps(&a[i + 2].x), aw = _mm_loadu_ps(&a[i + 3].x);
+				__m128 bx = _mm_loadu_ps(&b[i + 0].x), by = _mm_loadu_ps(&b[i + 1].x);
+				__m128 bz = _mm_loadu_ps(&b[i + 2].x), bw = _mm_loadu_ps(&b[i + 3].x);
+				_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+				_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+				__m128 rx = _mm_add_ps(_mm_mul_ps(ax, bw), _mm_mul_ps(aw, bx));
+				rx = _mm_add_ps(rx, _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)));
+				__m128 ry = _mm_add_ps(_mm_mul_ps(ay, bw), _mm_mul_ps(aw, by));
+				ry = _mm_add_ps(ry, _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)));
+				__m128 rz = _mm_add_ps(_mm_mul_ps(az, bw), _mm_mul_ps(aw, bz));
+				rz = _mm_add_ps(rz, _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)));
+				__m128 rw = _mm_sub_ps(_mm_mul_ps(aw, bw), _mm_mul_ps(ax, bx));
+				rw = _mm_sub_ps(rw, _mm_add_ps(_mm_mul_ps(ay, by), _mm_mul_ps(az, bz)));
+
+				_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+				_mm_storeu_ps(&out[i + 0].x, rx);
+				_mm_storeu_ps(&out[i + 1].x, ry);
+				_mm_storeu_ps(&out[i + 2].x, rz);
+				_mm_storeu_ps(&out[i + 3].x, rw);
+			}
+			mulManyScalar(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("sse2") void lerpMany_SSE2(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count, bool spherical) {
+			const SlerpFactor slerp{ t };
+			const __m128 one = _mm_set1_ps(1.0f), signBit = _mm_set1_ps(-0.0f);
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 ax = _mm_loadu_ps(&a[i + 0].x), ay = _mm_loadu_ps(&a[i + 1].x);
+				__m128 az = _mm_loadu_ps(&a[i + 2].x), aw = _mm_loadu_ps(&a[i + 3].x);
+				__m128 bx = _mm_loadu_ps(&b[i + 0].x), by = _mm_loadu_ps(&b[i + 1].x);
+				__m128 bz = _mm_loadu_ps(&b[i + 2].x), bw = _mm_loadu_ps(&b[i + 3].x);
+				_MM_TRANSPOSE4_PS(ax, ay, az, aw);
+				_MM_TRANSPOSE4_PS(bx, by, bz, bw);
+
+				__m128 d = _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by));
+				d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+				__m128 f = _mm_set1_ps(t);
+				if (spherical) {
+					const __m128 ad = _mm_andnot_ps(signBit, d);
+					__m128 ka = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(ad, _mm_set1_ps(1.43519f)));
+					ka = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(ad, ka));
+					ka = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(ad, ka));
+					__m128 kb = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(ad, _mm_set1_ps(0.215638f)));
+					kb = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(ad, kb));
+					const __m128 k = _mm_add_ps(_mm_mul_ps(ka, _mm_set1_ps(slerp.h2)), kb);
+					f = _mm_add_ps(f, _mm_mul_ps(_mm_set1_ps(slerp.c), k));
+				}
+				// Shortest arc: b is negated along with its weight where a.b < 0.
+				const __m128 wa = _mm_sub_ps(one, f), wb = _mm_xor_ps(f, _mm_and_ps(d, signBit));
+
+				__m128 rx = _mm_add_ps(_mm_mul_ps(ax, wa), _mm_mul_ps(bx, wb));
+				__m128 ry = _mm_add_ps(_mm_mul_ps(ay, wa), _mm_mul_ps(by, wb));
+				__m128 rz = _mm_add_ps(_mm_mul_ps(az, wa), _mm_mul_ps(bz, wb));
+				__m128 rw = _mm_add_ps(_mm_mul_ps(aw, wa), _mm_mul_ps(bw, wb));
+				__m128 len = _mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry));
+				len = _mm_sqrt_ps(_mm_add_ps(len, _mm_add_ps(_mm_mul_ps(rz, rz), _mm_mul_ps(rw, rw))));
+				rx = _mm_div_ps(rx, len);
+				ry = _mm_div_ps(ry, len);
+				rz = _mm_div_ps(rz, len);
+				rw = _mm_div_ps(rw, len);
+
+				_MM_TRANSPOSE4_PS(rx, ry, rz, rw);
+				_mm_storeu_ps(&out[i + 0].x, rx);
+				_mm_storeu_ps(&out[i + 1].x, ry);
+				_mm_storeu_ps(&out[i + 2].x, rz);
+				_mm_storeu_ps(&out[i + 3].x, rw);
+			}
+			lerpManyScalar(a + i, b + i, t, out + i, count - i, spherical);
+		}
+
+		AE_TARGET("sse2") void transformMany_SSE2(const Matrix4& m, const Vector3* v, Vector3* out, size_t count, float w) {
+			__m128 c[12];
+			for (size_t r = 0; r < 3; r++) {
+				c[r * 4 + 0] = _mm_set1_ps(m[r][0]);
+				c[r * 4 + 1] = _mm_set1_ps(m[r][1]);
+				c[r * 4 + 2] = _mm_set1_ps(m[r][2]);
+				c[r * 4 + 3] = _mm_set1_ps(m[r][3] * w);
+			}
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 x, y, z, o[3];
+				load3_SSE2(v + i, x, y, z);
+				for (size_t r = 0; r < 3; r++) {
+					o[r] = _mm_add_ps(_mm_mul_ps(c[r * 4 + 0], x), c[r * 4 + 3]);
+					o[r] = _mm_add_ps(o[r], _mm_mul_ps(c[r * 4 + 1], y));
+					o[r] = _mm_add_ps(o[r], _mm_mul_ps(c[r * 4 + 2], z));
+				}
+				store3_SSE2(out + i, o[0], o[1], o[2]);
+			}
+			transformManyScalar(m, v + i, out + i, count - i, w);
+		}
+
+		AE_TARGET("sse2") inline void mul4x4_SSE2(const float* a, const float* b, float* out) {
+			const __m128 b0 = _mm_loadu_ps(b + 0), b1 = _mm_loadu_ps(b + 4);
+			const __m128 b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+			__m128 r[4];
+			for (size_t i = 0; i < 4; i++) {
+				const __m128 row = _mm_loadu_ps(a + i * 4);
+				r[i] = _mm_mul_ps(_mm_shuffle_ps(row, row, 0x00), b0);
+				r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_shuffle_ps(row, row, 0x55), b1));
+				r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_shuffle_ps(row, row, 0xaa), b2));
+				r[i] = _mm_add_ps(r[i], _mm_mul_ps(_mm_shuffle_ps(row, row, 0xff), b3));
+			}
+			for (size_t i = 0; i < 4; i++) _mm_storeu_ps(out + i * 4, r[i]);
+		}
+
+		AE_TARGET("sse2") void mulMatrices_SSE2(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4_SSE2(a[i].data(), b[i].data(), out[i].data());
+		}
+
+		AE_TARGET("sse2") void mulMatrices_SSE2(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4_SSE2(a.data(), b[i].data(), out[i].data());
+		}
+
+		AE_TARGET("sse2") void quatToMatrixMany_SSE2(const Quaternion* q, Matrix4* out, size_t count) {
+			const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+			const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				__m128 x = _mm_loadu_ps(&q[i + 0].x), y = _mm_loadu_ps(&q[i + 1].x);
+				__m128 z = _mm_loadu_ps(&q[i + 2].x), w = _mm_loadu_ps(&q[i + 3].x);
+				_MM_TRANSPOSE4_PS(x, y, z, w);
+
+				const __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+				const __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+				const __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+				__m128 r0[4] = {
+					_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))),
+					_mm_mul_ps(two, _mm_sub_ps(xy, wz)),
+					_mm_mul_ps(two, _mm_add_ps(xz, wy)),
+					zero
+				};
+				__m128 r1[4] = {
+					_mm_mul_ps(two, _mm_add_ps(xy, wz)),
+					_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))),
+					_mm_mul_ps(two, _mm_sub_ps(yz, wx)),
+					zero
+				};
+				__m128 r2[4] = {
+					_mm_mul_ps(two, _mm_sub_ps(xz, wy)),
+					_mm_mul_ps(two, _mm_add_ps(yz, wx)),
+					_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))),
+					zero
+				};
+				_MM_TRANSPOSE4_PS(r0[0], r0[1], r0[2], r0[3]);
+				_MM_TRANSPOSE4_PS(r1[0], r1[1], r1[2], r1[3]);
+				_MM_TRANSPOSE4_PS(r2[0], r2[1], r2[2], r2[3]);
+
+				for (size_t k = 0; k < 4; k++) {
+					float* m = out[i + k].data();
+					_mm_storeu_ps(m + 0, r0[k]);
+					_mm_storeu_ps(m + 4, r1[k]);
+					_mm_storeu_ps(m + 8, r2[k]);
+					_mm_storeu_ps(m + 12, lastRow);
+				}
+			}
+			quatToMatrixManyScalar(q + i, out + i, count - i);
+		}
+
+		// Boxes are processed 4 at a time against one broadcast plane, so the plane loop
+		// exits as soon as every box in the group is known to be outside.
+		AE_TARGET("sse2") void classifyMany_SSE2(const Frustum& f, const AABB* boxes, Containment* out, size_t count) {
+			const __m128 half = _mm_set1_ps(0.5f);
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const AABB* b = boxes + i;
+				const __m128 minX = _mm_setr_ps(b[0].min.x, b[1].min.x, b[2].min.x, b[3].min.x);
+				const __m128 minY = _mm_setr_ps(b[0].min.y, b[1].min.y, b[2].min.y, b[3].min.y);
+				const __m128 minZ = _mm_setr_ps(b[0].min.z, b[1].min.z, b[2].min.z, b[3].min.z);
+				const __m128 maxX = _mm_setr_ps(b[0].max.x, b[1].max.x, b[2].max.x, b[3].max.x);
+				const __m128 maxY = _mm_setr_ps(b[0].max.y, b[1].max.y, b[2].max.y, b[3].max.y);
+				const __m128 maxZ = _mm_setr_ps(b[0].max.z, b[1].max.z, b[2].max.z, b[3].max.z);
+
+				const __m128 cx = _mm_mul_ps(_mm_add_ps(minX, maxX), half);
+				const __m128 cy = _mm_mul_ps(_mm_add_ps(minY, maxY), half);
+				const __m128 cz = _mm_mul_ps(_mm_add_ps(minZ, maxZ), half);
+				const __m128 ex = _mm_mul_ps(_mm_sub_ps(maxX, minX), half);
+				const __m128 ey = _mm_mul_ps(_mm_sub_ps(maxY, minY), half);
+				const __m128 ez = _mm_mul_ps(_mm_sub_ps(maxZ, minZ), half);
+
+				__m128 outside = _mm_setzero_ps(), partial = _mm_setzero_ps();
+				for (size_t k = 0; k < Frustum::SideCount; k++) {
+					const Plane& pl = f.plane(Frustum::Side(k));
+					const __m128 nx = _mm_set1_ps(pl.normal.x), ny = _mm_set1_ps(pl.normal.y), nz = _mm_set1_ps(pl.normal.z);
+
+					const __m128 d = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+						_mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(pl.distance))
+					);
+					const __m128 r = _mm_add_ps(
+						_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)),
+						_mm_mul_ps(_mm_and_ps(nz, absMask), ez)
+					);
+
+					outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+					partial = _mm_or_ps(partial, _mm_cmplt_ps(d, r));
+					if (_mm_movemask_ps(outside) == 0xF) break;
+				}
+				writeContainment(uint32_t(_mm_movemask_ps(outside)), uint32_t(_mm_movemask_ps(partial)), out + i, 4);
+			}
+			classifyManyScalar(f, boxes + i, out + i, count - i);
+		}
+
+		// AVX2 + FMA, 8 elements per iteration.
+		AE_TARGET("avx2,fma") inline void load3_AVX2(const Vector3* p, __m256& x, __m256& y, __m256& z) {
+			const float* f = &p->x;
+			__m256 m0 = _mm256_castps128_ps256(_mm_loadu_ps(f + 0));
+			__m256 m1 = _mm256_castps128_ps256(_mm_loadu_ps(f + 4));
+			__m256 m2 = _mm256_castps128_ps256(_mm_loadu_ps(f + 8));
+			m0 = _mm256_insertf128_ps(m0, _mm_loadu_ps(f + 12), 1);
+			m1 = _mm256_insertf128_ps(m1, _mm_loadu_ps(f + 16), 1);
+			m2 = _mm256_insertf128_ps(m2, _mm_loadu_ps(f + 20), 1);
+			const __m256 xy = _mm256_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			const __m256 yz = _mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			x = _mm256_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm256_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		AE_TARGET("avx2,fma") inline void store3_AVX2(Vector3* p, __m256 x, __m256 y, __m256 z) {
+			float* f = &p->x;
+			const __m256 xy = _mm256_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m256 yz = _mm256_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m256 zx = _mm256_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+			const __m256 r0 = _mm256_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m256 r1 = _mm256_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			const __m256 r2 = _mm256_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1));
+			_mm_storeu_ps(f + 0, _mm256_castps256_ps128(r0));
+			_mm_storeu_ps(f + 4, _mm256_castps256_ps128(r1));
+			_mm_storeu_ps(f + 8, _mm256_castps256_ps128(r2));
+			_mm_storeu_ps(f + 12, _mm256_extractf128_ps(r0, 1));
+			_mm_storeu_ps(f + 16, _mm256_extractf128_ps(r1, 1));
+			_mm_storeu_ps(f + 20, _mm256_extractf128_ps(r2, 1));
+		}
+
+		// Transposes each 128-bit lane on its own, like _MM_TRANSPOSE4_PS.
+		AE_TARGET("avx2,fma") inline void transpose4_AVX2(__m256& r0, __m256& r1, __m256& r2, __m256& r3) {
+			const __m256 t0 = _mm256_unpacklo_ps(r0, r1);
+			const __m256 t1 = _mm256_unpacklo_ps(r2, r3);
+			const __m256 t2 = _mm256_unpackhi_ps(r0, r1);
+			const __m256 t3 = _mm256_unpackhi_ps(r2, r3);
+			r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		// Quaternion i goes in the low lane and i + 4 in the high lane.
+		AE_TARGET("avx2,fma") inline __m256 loadQuat_AVX2(const Quaternion* q, size_t i) {
+			return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&q[i].x)), _mm_loadu_ps(&q[i + 4].x), 1);
+		}
+
+		AE_TARGET("avx2,fma") inline void storeQuat_AVX2(Quaternion* q, size_t i, __m256 v) {
+			_mm_storeu_ps(&q[i].x, _mm256_castps256_ps128(v));
+			_mm_storeu_ps(&q[i + 4].x, _mm256_extractf128_ps(v, 1));
+		}
+
+		AE_TARGET("avx2,fma") void dotMany_AVX2(const Vector3* a, const Vector3* b, float* out, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 ax, ay, az, bx, by, bz;
+				load3_AVX2(a + i, ax, ay, az);
+				load3_AVX2(b + i, bx, by, bz);
+				__m256 d = _mm256_mul_ps(ax, bx);
+				d = _mm256_fmadd_ps(ay, by, d);
+				d = _mm256_fmadd_ps(az, bz, d);
+				_mm256_storeu_ps(out + i, d);
+			}
+			dotManyScalar(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx2,fma") void crossMany_AVX2(const Vector3* a, const Vector3* b, Vector3* out, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 ax, ay, az, bx, by, bz;
+				load3_AVX2(a + i, ax, ay, az);
+				load3_AVX2(b + i, bx, by, bz);
+				store3_AVX2(out + i,
+					_mm256_fmsub_ps(ay, bz, _mm256_mul_ps(az, by)),
+					_mm256_fmsub_ps(az, bx, _mm256_mul_ps(ax, bz)),
+					_mm256_fmsub_ps(ax, by, _mm256_mul_ps(ay, bx))
+				);
+			}
+			crossManyScalar(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx2,fma") void normalizeMany_AVX2(const Vector3* v, Vector3* out, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x, y, z;
+				load3_AVX2(v + i, x, y, z);
+				__m256 len = _mm256_mul_ps(x, x);
+				len = _mm256_fmadd_ps(y, y, len);
+				len = _mm256_fmadd_ps(z, z, len);
+				len = _mm256_sqrt_ps(len);
+				store3_AVX2(out + i, _mm256_div_ps(x, len), _mm256_div_ps(y, len), _mm256_div_ps(z, len));
+			}
+			normalizeManyScalar(v + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx2,fma") void rotateMany_AVX2(const Quaternion& q, const Vector3* v, Vector3* out, size_t count) {
+			const RotateFactors f{ q };
+			const __m256 qx = _mm256_set1_ps(f.x), qy = _mm256_set1_ps(f.y), qz = _mm256_set1_ps(f.z);
+			const __m256 s = _mm256_set1_ps(f.s), w2 = _mm256_set1_ps(2.0f * f.w), two = _mm256_set1_ps(2.0f);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x, y, z;
+				load3_AVX2(v + i, x, y, z);
+				__m256 d = _mm256_mul_ps(qx, x);
+				d = _mm256_fmadd_ps(qy, y, d);
+				d = _mm256_fmadd_ps(qz, z, d);
+				d = _mm256_mul_ps(d, two);
+
+				const __m256 cx = _mm256_fmsub_ps(qy, z, _mm256_mul_ps(qz, y));
+				const __m256 cy = _mm256_fmsub_ps(qz, x, _mm256_mul_ps(qx, z));
+				const __m256 cz = _mm256_fmsub_ps(qx, y, _mm256_mul_ps(qy, x));
+
+				store3_AVX2(out + i,
+					_mm256_fmadd_ps(w2, cx, _mm256_fmadd_ps(d, qx, _mm256_mul_ps(s, x))),
+					_mm256_fmadd_ps(w2, cy, _mm256_fmadd_ps(d, qy, _mm256_mul_ps(s, y))),
+					_mm256_fmadd_ps(w2, cz, _mm256_fmadd_ps(d, qz, _mm256_mul_ps(s, z)))
+				);
+			}
+			rotateManyScalar(q, v + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx2,fma") void mulMany_AVX2(const Quaternion* a, const Quaternion* b, Quaternion* out, size_t count) {
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 ax = loadQuat_AVX2(a, i + 0), ay = loadQuat_AVX2(a, i + 1);
+				__m256 az = loadQuat_AVX2(a, i + 2), aw = loadQuat_AVX2(a, i + 3);
+				__m256 bx = loadQuat_AVX2(b, i + 0), by = loadQuat_AVX2(b, i + 1);
+				__m256 bz = loadQuat_AVX2(b, i + 2), bw = loadQuat_AVX2(b, i + 3);
+				transpose4_AVX2(ax, ay, az, aw);
+				transpose4_AVX2(bx, by, bz, bw);
+
+				__m256 rx = _mm256_fmadd_ps(ax, bw, _mm256_mul_ps(aw, bx));
+				rx = _mm256_add_ps(rx, _mm256_fmsub_ps(ay, bz, _mm256_mul_ps(az, by)));
+				__m256 ry = _mm256_fmadd_ps(ay, bw, _mm256_mul_ps(aw, by));
+				ry = _mm256_add_ps(ry, _mm256_fmsub_ps(az, bx, _mm256_mul_ps(ax, bz)));
+				__m256 rz = _mm256_fmadd_ps(az, bw, _mm256_mul_ps(aw, bz));
+				rz = _mm256_add_ps(rz, _mm256_fmsub_ps(ax, by, _mm256_mul_ps(ay, bx)));
+				__m256 rw = _mm256_fmsub_ps(aw, bw, _mm256_mul_ps(ax, bx));
+				rw = _mm256_sub_ps(rw, _mm256_fmadd_ps(ay, by, _mm256_mul_ps(az, bz)));
+
+				transpose4_AVX2(rx, ry, rz, rw);
+				storeQuat_AVX2(out, i + 0, rx);
+				storeQuat_AVX2(out, i + 1, ry);
+				storeQuat_AVX2(out, i + 2, rz);
+				storeQuat_AVX2(out, i + 3, rw);
+			}
+			mulManyScalar(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx2,fma") void transformMany_AVX2(const Matrix4& m, const Vector3* v, Vector3* out, size_t count, float w) {
+			__m256 c[12];
+			for (size_t r = 0; r < 3; r++) {
+				c[r * 4 + 0] = _mm256_set1_ps(m[r][0]);
+				c[r * 4 + 1] = _mm256_set1_ps(m[r][1]);
+				c[r * 4 + 2] = _mm256_set1_ps(m[r][2]);
+				c[r * 4 + 3] = _mm256_set1_ps(m[r][3] * w);
+			}
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x, y, z, o[3];
+				load3_AVX2(v + i, x, y, z);
+				for (size_t r = 0; r < 3; r++) {
+					o[r] = _mm256_fmadd_ps(c[r * 4 + 0], x, c[r * 4 + 3]);
+					o[r] = _mm256_fmadd_ps(c[r * 4 + 1], y, o[r]);
+					o[r] = _mm256_fmadd_ps(c[r * 4 + 2], z, o[r]);
+				}
+				store3_AVX2(out + i, o[0], o[1], o[2]);
+			}
+			transformMany_SSE2(m, v + i, out + i, count - i, w);
+		}
+
+		// Two output rows per register: each lane broadcasts one element of its row of a.
+		AE_TARGET("avx2,fma") inline void mul4x4_AVX2(const float* a, const float* b, float* out) {
+			const __m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 0));
+			const __m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 4));
+			const __m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 8));
+			const __m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(b + 12));
+			const __m256 a01 = _mm256_loadu_ps(a + 0), a23 = _mm256_loadu_ps(a + 8);
+
+			__m256 r01 = _mm256_mul_ps(_mm256_permute_ps(a01, 0x00), b0);
+			__m256 r23 = _mm256_mul_ps(_mm256_permute_ps(a23, 0x00), b0);
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0x55), b1, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0x55), b1, r23);
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0xaa), b2, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0xaa), b2, r23);
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(a01, 0xff), b3, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(a23, 0xff), b3, r23);
+
+			_mm256_storeu_ps(out + 0, r01);
+			_mm256_storeu_ps(out + 8, r23);
+		}
+
+		AE_TARGET("avx2,fma") void mulMatrices_AVX2(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4_AVX2(a[i].data(), b[i].data(), out[i].data());
+		}
+
+		AE_TARGET("avx2,fma") void mulMatrices_AVX2(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4_AVX2(a.data(), b[i].data(), out[i].data());
+		}
+
+		AE_TARGET("avx2,fma") void lerpMany_AVX2(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count, bool spherical) {
+			const SlerpFactor slerp{ t };
+			const __m256 one = _mm256_set1_ps(1.0f), signBit = _mm256_set1_ps(-0.0f);
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 ax = loadQuat_AVX2(a, i + 0), ay = loadQuat_AVX2(a, i + 1);
+				__m256 az = loadQuat_AVX2(a, i + 2), aw = loadQuat_AVX2(a, i + 3);
+				__m256 bx = loadQuat_AVX2(b, i + 0), by = loadQuat_AVX2(b, i + 1);
+				__m256 bz = loadQuat_AVX2(b, i + 2), bw = loadQuat_AVX2(b, i + 3);
+				transpose4_AVX2(ax, ay, az, aw);
+				transpose4_AVX2(bx, by, bz, bw);
+
+				__m256 d = _mm256_mul_ps(ax, bx);
+				d = _mm256_fmadd_ps(ay, by, d);
+				d = _mm256_fmadd_ps(az, bz, d);
+				d = _mm256_fmadd_ps(aw, bw, d);
+				__m256 f = _mm256_set1_ps(t);
+				if (spherical) {
+					const __m256 ad = _mm256_andnot_ps(signBit, d);
+					__m256 ka = _mm256_fnmadd_ps(ad, _mm256_set1_ps(1.43519f), _mm256_set1_ps(3.55645f));
+					ka = _mm256_fmadd_ps(ad, ka, _mm256_set1_ps(-3.2452f));
+					ka = _mm256_fmadd_ps(ad, ka, _mm256_set1_ps(1.0904f));
+					__m256 kb = _mm256_fmadd_ps(ad, _mm256_set1_ps(0.215638f), _mm256_set1_ps(-1.06021f));
+					kb = _mm256_fmadd_ps(ad, kb, _mm256_set1_ps(0.848013f));
+					f = _mm256_fmadd_ps(_mm256_set1_ps(slerp.c), _mm256_fmadd_ps(ka, _mm256_set1_ps(slerp.h2), kb), f);
+				}
+				const __m256 wa = _mm256_sub_ps(one, f), wb = _mm256_xor_ps(f, _mm256_and_ps(d, signBit));
+
+				__m256 rx = _mm256_fmadd_ps(bx, wb, _mm256_mul_ps(ax, wa));
+				__m256 ry = _mm256_fmadd_ps(by, wb, _mm256_mul_ps(ay, wa));
+				__m256 rz = _mm256_fmadd_ps(bz, wb, _mm256_mul_ps(az, wa));
+				__m256 rw = _mm256_fmadd_ps(bw, wb, _mm256_mul_ps(aw, wa));
+				__m256 len = _mm256_mul_ps(rx, rx);
+				len = _mm256_fmadd_ps(ry, ry, len);
+				len = _mm256_fmadd_ps(rz, rz, len);
+				len = _mm256_sqrt_ps(_mm256_fmadd_ps(rw, rw, len));
+				rx = _mm256_div_ps(rx, len);
+				ry = _mm256_div_ps(ry, len);
+				rz = _mm256_div_ps(rz, len);
+				rw = _mm256_div_ps(rw, len);
+
+				transpose4_AVX2(rx, ry, rz, rw);
+				storeQuat_AVX2(out, i + 0, rx);
+				storeQuat_AVX2(out, i + 1, ry);
+				storeQuat_AVX2(out, i + 2, rz);
+				storeQuat_AVX2(out, i + 3, rw);
+			}
+			lerpMany_SSE2(a + i, b + i, t, out + i, count - i, spherical);
+		}
+
+		AE_TARGET("avx2,fma") void quatToMatrixMany_AVX2(const Quaternion* q, Matrix4* out, size_t count) {
+			const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f), zero = _mm256_setzero_ps();
+			const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				__m256 x = loadQuat_AVX2(q, i + 0), y = loadQuat_AVX2(q, i + 1);
+				__m256 z = loadQuat_AVX2(q, i + 2), w = loadQuat_AVX2(q, i + 3);
+				transpose4_AVX2(x, y, z, w);
+
+				const __m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+				const __m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+				const __m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+				__m256 r0[4] = {
+					_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one),
+					_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)),
+					_mm256_mul_ps(two, _mm256_add_ps(xz, wy)),
+					zero
+				};
+				__m256 r1[4] = {
+					_mm256_mul_ps(two, _mm256_add_ps(xy, wz)),
+					_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one),
+					_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)),
+					zero
+				};
+				__m256 r2[4] = {
+					_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)),
+					_mm256_mul_ps(two, _mm256_add_ps(yz, wx)),
+					_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one),
+					zero
+				};
+				transpose4_AVX2(r0[0], r0[1], r0[2], r0[3]);
+				transpose4_AVX2(r1[0], r1[1], r1[2], r1[3]);
+				transpose4_AVX2(r2[0], r2[1], r2[2], r2[3]);
+
+				for (size_t k = 0; k < 4; k++) {
+					float* lo = out[i + k].data();
+					float* hi = out[i + k + 4].data();
+					_mm_storeu_ps(lo + 0, _mm256_castps256_ps128(r0[k]));
+					_mm_storeu_ps(lo + 4, _mm256_castps256_ps128(r1[k]));
+					_mm_storeu_ps(lo + 8, _mm256_castps256_ps128(r2[k]));
+					_mm_storeu_ps(lo + 12, lastRow);
+					_mm_storeu_ps(hi + 0, _mm256_extractf128_ps(r0[k], 1));
+					_mm_storeu_ps(hi + 4, _mm256_extractf128_ps(r1[k], 1));
+					_mm_storeu_ps(hi + 8, _mm256_extractf128_ps(r2[k], 1));
+					_mm_storeu_ps(hi + 12, lastRow);
+				}
+			}
+			quatToMatrixMany_SSE2(q + i, out + i, count - i);
+		}
+
+		// AABB is 6 packed floats, so the box fields are gathered with a stride of 6.
+		AE_TARGET("avx2,fma") void classifyMany_AVX2(const Frustum& f, const AABB* boxes, Containment* out, size_t count) {
+			const __m256 half = _mm256_set1_ps(0.5f);
+			const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+			const __m256i idx = _mm256_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				const float* b = &boxes[i].min.x;
+				const __m256 minX = _mm256_i32gather_ps(b + 0, idx, 4);
+				const __m256 minY = _mm256_i32gather_ps(b + 1, idx, 4);
+				const __m256 minZ = _mm256_i32gather_ps(b + 2, idx, 4);
+				const __m256 maxX = _mm256_i32gather_ps(b + 3, idx, 4);
+				const __m256 maxY = _mm256_i32gather_ps(b + 4, idx, 4);
+				const __m256 maxZ = _mm256_i32gather_ps(b + 5, idx, 4);
+
+				const __m256 cx = _mm256_mul_ps(_mm256_add_ps(minX, maxX), half);
+				const __m256 cy = _mm256_mul_ps(_mm256_add_ps(minY, maxY), half);
+				const __m256 cz = _mm256_mul_ps(_mm256_add_ps(minZ, maxZ), half);
+				const __m256 ex = _mm256_mul_ps(_mm256_sub_ps(maxX, minX), half);
+				const __m256 ey = _mm256_mul_ps(_mm256_sub_ps(maxY, minY), half);
+				const __m256 ez = _mm256_mul_ps(_mm256_sub_ps(maxZ, minZ), half);
+
+				__m256 outside = _mm256_setzero_ps(), partial = _mm256_setzero_ps();
+				for (size_t k = 0; k < Frustum::SideCount; k++) {
+					const Plane& pl = f.plane(Frustum::Side(k));
+					const __m256 nx = _mm256_set1_ps(pl.normal.x), ny = _mm256_set1_ps(pl.normal.y), nz = _mm256_set1_ps(pl.normal.z);
+
+					const __m256 d = _mm256_fmadd_ps(nx, cx, _mm256_fmadd_ps(ny, cy, _mm256_fmadd_ps(nz, cz, _mm256_set1_ps(pl.distance))));
+					const __m256 r = _mm256_fmadd_ps(_mm256_and_ps(nx, absMask), ex,
+						_mm256_fmadd_ps(_mm256_and_ps(ny, absMask), ey, _mm256_mul_ps(_mm256_and_ps(nz, absMask), ez)));
+
+					outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_LT_OQ));
+					partial = _mm256_or_ps(partial, _mm256_cmp_ps(d, r, _CMP_LT_OQ));
+					if (_mm256_movemask_ps(outside) == 0xFF) break;
+				}
+				writeContainment(uint32_t(_mm256_movemask_ps(outside)), uint32_t(_mm256_movemask_ps(partial)), out + i, 8);
+			}
+			classifyMany_SSE2(f, boxes + i, out + i, count - i);
+		}
+
+		// AVX-512F, 16 elements per iteration.
+		AE_TARGET("avx512f") inline __m512 load4x128_AVX512(const float* f, size_t stride) {
+			__m512 r = _mm512_castps128_ps512(_mm_loadu_ps(f));
+			r = _mm512_insertf32x4(r, _mm_loadu_ps(f + stride), 1);
+			r = _mm512_insertf32x4(r, _mm_loadu_ps(f + stride * 2), 2);
+			return _mm512_insertf32x4(r, _mm_loadu_ps(f + stride * 3), 3);
+		}
+
+		AE_TARGET("avx512f") inline void store4x128_AVX512(float* f, size_t stride, __m512 v) {
+			_mm_storeu_ps(f, _mm512_castps512_ps128(v));
+			_mm_storeu_ps(f + stride, _mm512_extractf32x4_ps(v, 1));
+			_mm_storeu_ps(f + stride * 2, _mm512_extractf32x4_ps(v, 2));
+			_mm_storeu_ps(f + stride * 3, _mm512_extractf32x4_ps(v, 3));
+		}
+
+		AE_TARGET("avx512f") inline void load3_AVX512(const Vector3* p, __m512& x, __m512& y, __m512& z) {
+			const float* f = &p->x;
+			const __m512 m0 = load4x128_AVX512(f + 0, 12);
+			const __m512 m1 = load4x128_AVX512(f + 4, 12);
+			const __m512 m2 = load4x128_AVX512(f + 8, 12);
+			const __m512 xy = _mm512_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			const __m512 yz = _mm512_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			x = _mm512_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm512_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm512_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		AE_TARGET("avx512f") inline void store3_AVX512(Vector3* p, __m512 x, __m512 y, __m512 z) {
+			float* f = &p->x;
+			const __m512 xy = _mm512_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m512 yz = _mm512_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m512 zx = _mm512_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+			store4x128_AVX512(f + 0, 12, _mm512_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+			store4x128_AVX512(f + 4, 12, _mm512_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+			store4x128_AVX512(f + 8, 12, _mm512_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+
+		AE_TARGET("avx512f") inline void transpose4_AVX512(__m512& r0, __m512& r1, __m512& r2, __m512& r3) {
+			const __m512 t0 = _mm512_unpacklo_ps(r0, r1);
+			const __m512 t1 = _mm512_unpacklo_ps(r2, r3);
+			const __m512 t2 = _mm512_unpackhi_ps(r0, r1);
+			const __m512 t3 = _mm512_unpackhi_ps(r2, r3);
+			r0 = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+			r1 = _mm512_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+			r2 = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+			r3 = _mm512_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+		}
+
+		AE_TARGET("avx512f") void dotMany_AVX512(const Vector3* a, const Vector3* b, float* out, size_t count) {
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 ax, ay, az, bx, by, bz;
+				load3_AVX512(a + i, ax, ay, az);
+				load3_AVX512(b + i, bx, by, bz);
+				__m512 d = _mm512_mul_ps(ax, bx);
+				d = _mm512_fmadd_ps(ay, by, d);
+				d = _mm512_fmadd_ps(az, bz, d);
+				_mm512_storeu_ps(out + i, d);
+			}
+			dotMany_AVX2(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx512f") void crossMany_AVX512(const Vector3* a, const Vector3* b, Vector3* out, size_t count) {
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 ax, ay, az, bx, by, bz;
+				load3_AVX512(a + i, ax, ay, az);
+				load3_AVX512(b + i, bx, by, bz);
+				store3_AVX512(out + i,
+					_mm512_fmsub_ps(ay, bz, _mm512_mul_ps(az, by)),
+					_mm512_fmsub_ps(az, bx, _mm512_mul_ps(ax, bz)),
+					_mm512_fmsub_ps(ax, by, _mm512_mul_ps(ay, bx))
+				);
+			}
+			crossMany_AVX2(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx512f") void normalizeMany_AVX512(const Vector3* v, Vector3* out, size_t count) {
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 x, y, z;
+				load3_AVX512(v + i, x, y, z);
+				__m512 len = _mm512_mul_ps(x, x);
+				len = _mm512_fmadd_ps(y, y, len);
+				len = _mm512_fmadd_ps(z, z, len);
+				len = _mm512_sqrt_ps(len);
+				store3_AVX512(out + i, _mm512_div_ps(x, len), _mm512_div_ps(y, len), _mm512_div_ps(z, len));
+			}
+			normalizeMany_AVX2(v + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx512f") void rotateMany_AVX512(const Quaternion& q, const Vector3* v, Vector3* out, size_t count) {
+			const RotateFactors f{ q };
+			const __m512 qx = _mm512_set1_ps(f.x), qy = _mm512_set1_ps(f.y), qz = _mm512_set1_ps(f.z);
+			const __m512 s = _mm512_set1_ps(f.s), w2 = _mm512_set1_ps(2.0f * f.w), two = _mm512_set1_ps(2.0f);
+
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 x, y, z;
+				load3_AVX512(v + i, x, y, z);
+				__m512 d = _mm512_mul_ps(qx, x);
+				d = _mm512_fmadd_ps(qy, y, d);
+				d = _mm512_fmadd_ps(qz, z, d);
+				d = _mm512_mul_ps(d, two);
+
+				const __m512 cx = _mm512_fmsub_ps(qy, z, _mm512_mul_ps(qz, y));
+				const __m512 cy = _mm512_fmsub_ps(qz, x, _mm512_mul_ps(qx, z));
+				const __m512 cz = _mm512_fmsub_ps(qx, y, _mm512_mul_ps(qy, x));
+
+				store3_AVX512(out + i,
+					_mm512_fmadd_ps(w2, cx, _mm512_fmadd_ps(d, qx, _mm512_mul_ps(s, x))),
+					_mm512_fmadd_ps(w2, cy, _mm512_fmadd_ps(d, qy, _mm512_mul_ps(s, y))),
+					_mm512_fmadd_ps(w2, cz, _mm512_fmadd_ps(d, qz, _mm512_mul_ps(s, z)))
+				);
+			}
+			rotateMany_AVX2(q, v + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx512f") void mulMany_AVX512(const Quaternion* a, const Quaternion* b, Quaternion* out, size_t count) {
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				// Quaternion i + k goes in lane 0, i + 4 + k in lane 1 and so on.
+				__m512 ax = load4x128_AVX512(&a[i + 0].x, 16), ay = load4x128_AVX512(&a[i + 1].x, 16);
+				__m512 az = load4x128_AVX512(&a[i + 2].x, 16), aw = load4x128_AVX512(&a[i + 3].x, 16);
+				__m512 bx = load4x128_AVX512(&b[i + 0].x, 16), by = load4x128_AVX512(&b[i + 1].x, 16);
+				__m512 bz = load4x128_AVX512(&b[i + 2].x, 16), bw = load4x128_AVX512(&b[i + 3].x, 16);
+				transpose4_AVX512(ax, ay, az, aw);
+				transpose4_AVX512(bx, by, bz, bw);
+
+				__m512 rx = _mm512_fmadd_ps(ax, bw, _mm512_mul_ps(aw, bx));
+				rx = _mm512_add_ps(rx, _mm512_fmsub_ps(ay, bz, _mm512_mul_ps(az, by)));
+				__m512 ry = _mm512_fmadd_ps(ay, bw, _mm512_mul_ps(aw, by));
+				ry = _mm512_add_ps(ry, _mm512_fmsub_ps(az, bx, _mm512_mul_ps(ax, bz)));
+				__m512 rz = _mm512_fmadd_ps(az, bw, _mm512_mul_ps(aw, bz));
+				rz = _mm512_add_ps(rz, _mm512_fmsub_ps(ax, by, _mm512_mul_ps(ay, bx)));
+				__m512 rw = _mm512_fmsub_ps(aw, bw, _mm512_mul_ps(ax, bx));
+				rw = _mm512_sub_ps(rw, _mm512_fmadd_ps(ay, by, _mm512_mul_ps(az, bz)));
+
+				transpose4_AVX512(rx, ry, rz, rw);
+				store4x128_AVX512(&out[i + 0].x, 16, rx);
+				store4x128_AVX512(&out[i + 1].x, 16, ry);
+				store4x128_AVX512(&out[i + 2].x, 16, rz);
+				store4x128_AVX512(&out[i + 3].x, 16, rw);
+			}
+			mulMany_AVX2(a + i, b + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx512f") void transformMany_AVX512(const Matrix4& m, const Vector3* v, Vector3* out, size_t count, float w) {
+			__m512 c[12];
+			for (size_t r = 0; r < 3; r++) {
+				c[r * 4 + 0] = _mm512_set1_ps(m[r][0]);
+				c[r * 4 + 1] = _mm512_set1_ps(m[r][1]);
+				c[r * 4 + 2] = _mm512_set1_ps(m[r][2]);
+				c[r * 4 + 3] = _mm512_set1_ps(m[r][3] * w);
+			}
+
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 x, y, z, o[3];
+				load3_AVX512(v + i, x, y, z);
+				for (size_t r = 0; r < 3; r++) {
+					o[r] = _mm512_fmadd_ps(c[r * 4 + 0], x, c[r * 4 + 3]);
+					o[r] = _mm512_fmadd_ps(c[r * 4 + 1], y, o[r]);
+					o[r] = _mm512_fmadd_ps(c[r * 4 + 2], z, o[r]);
+				}
+				store3_AVX512(out + i, o[0], o[1], o[2]);
+			}
+			transformMany_AVX2(m, v + i, out + i, count - i, w);
+		}
+
+		// The whole matrix in one register, each 128-bit lane is one output row.
+		AE_TARGET("avx512f") inline void mul4x4_AVX512(const float* a, const float* b, float* out) {
+			const __m512 b0 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 0));
+			const __m512 b1 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 4));
+			const __m512 b2 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 8));
+			const __m512 b3 = _mm512_broadcast_f32x4(_mm_loadu_ps(b + 12));
+			const __m512 ma = _mm512_loadu_ps(a);
+
+			__m512 r = _mm512_mul_ps(_mm512_permute_ps(ma, 0x00), b0);
+			r = _mm512_fmadd_ps(_mm512_permute_ps(ma, 0x55), b1, r);
+			r = _mm512_fmadd_ps(_mm512_permute_ps(ma, 0xaa), b2, r);
+			r = _mm512_fmadd_ps(_mm512_permute_ps(ma, 0xff), b3, r);
+			_mm512_storeu_ps(out, r);
+		}
+
+		AE_TARGET("avx512f") void mulMatrices_AVX512(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4_AVX512(a[i].data(), b[i].data(), out[i].data());
+		}
+
+		AE_TARGET("avx512f") void mulMatrices_AVX512(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+			for (size_t i = 0; i < count; i++) mul4x4_AVX512(a.data(), b[i].data(), out[i].data());
+		}
+
+		AE_TARGET("avx512f") void lerpMany_AVX512(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count, bool spherical) {
+			const SlerpFactor slerp{ t };
+			const __m512 one = _mm512_set1_ps(1.0f);
+			const __m512i signBit = _mm512_set1_epi32(int32_t(0x80000000u));
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 ax = load4x128_AVX512(&a[i + 0].x, 16), ay = load4x128_AVX512(&a[i + 1].x, 16);
+				__m512 az = load4x128_AVX512(&a[i + 2].x, 16), aw = load4x128_AVX512(&a[i + 3].x, 16);
+				__m512 bx = load4x128_AVX512(&b[i + 0].x, 16), by = load4x128_AVX512(&b[i + 1].x, 16);
+				__m512 bz = load4x128_AVX512(&b[i + 2].x, 16), bw = load4x128_AVX512(&b[i + 3].x, 16);
+				transpose4_AVX512(ax, ay, az, aw);
+				transpose4_AVX512(bx, by, bz, bw);
+
+				__m512 d = _mm512_mul_ps(ax, bx);
+				d = _mm512_fmadd_ps(ay, by, d);
+				d = _mm512_fmadd_ps(az, bz, d);
+				d = _mm512_fmadd_ps(aw, bw, d);
+				const __m512i dSign = _mm512_and_si512(_mm512_castps_si512(d), signBit);
+				__m512 f = _mm512_set1_ps(t);
+				if (spherical) {
+					const __m512 ad = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(d), dSign));
+					__m512 ka = _mm512_fnmadd_ps(ad, _mm512_set1_ps(1.43519f), _mm512_set1_ps(3.55645f));
+					ka = _mm512_fmadd_ps(ad, ka, _mm512_set1_ps(-3.2452f));
+					ka = _mm512_fmadd_ps(ad, ka, _mm512_set1_ps(1.0904f));
+					__m512 kb = _mm512_fmadd_ps(ad, _mm512_set1_ps(0.215638f), _mm512_set1_ps(-1.06021f));
+					kb = _mm512_fmadd_ps(ad, kb, _mm512_set1_ps(0.848013f));
+					f = _mm512_fmadd_ps(_mm512_set1_ps(slerp.c), _mm512_fmadd_ps(ka, _mm512_set1_ps(slerp.h2), kb), f);
+				}
+				const __m512 wa = _mm512_sub_ps(one, f);
+				const __m512 wb = _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(f), dSign));
+
+				__m512 rx = _mm512_fmadd_ps(bx, wb, _mm512_mul_ps(ax, wa));
+				__m512 ry = _mm512_fmadd_ps(by, wb, _mm512_mul_ps(ay, wa));
+				__m512 rz = _mm512_fmadd_ps(bz, wb, _mm512_mul_ps(az, wa));
+				__m512 rw = _mm512_fmadd_ps(bw, wb, _mm512_mul_ps(aw, wa));
+				__m512 len = _mm512_mul_ps(rx, rx);
+				len = _mm512_fmadd_ps(ry, ry, len);
+				len = _mm512_fmadd_ps(rz, rz, len);
+				len = _mm512_sqrt_ps(_mm512_fmadd_ps(rw, rw, len));
+				rx = _mm512_div_ps(rx, len);
+				ry = _mm512_div_ps(ry, len);
+				rz = _mm512_div_ps(rz, len);
+				rw = _mm512_div_ps(rw, len);
+
+				transpose4_AVX512(rx, ry, rz, rw);
+				store4x128_AVX512(&out[i + 0].x, 16, rx);
+				store4x128_AVX512(&out[i + 1].x, 16, ry);
+				store4x128_AVX512(&out[i + 2].x, 16, rz);
+				store4x128_AVX512(&out[i + 3].x, 16, rw);
+			}
+			lerpMany_AVX2(a + i, b + i, t, out + i, count - i, spherical);
+		}
+
+		AE_TARGET("avx512f") void quatToMatrixMany_AVX512(const Quaternion* q, Matrix4* out, size_t count) {
+			const __m512 one = _mm512_set1_ps(1.0f), two = _mm512_set1_ps(2.0f), zero = _mm512_setzero_ps();
+			const __m128 lastRow = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				__m512 x = load4x128_AVX512(&q[i + 0].x, 16), y = load4x128_AVX512(&q[i + 1].x, 16);
+				__m512 z = load4x128_AVX512(&q[i + 2].x, 16), w = load4x128_AVX512(&q[i + 3].x, 16);
+				transpose4_AVX512(x, y, z, w);
+
+				const __m512 xx = _mm512_mul_ps(x, x), yy = _mm512_mul_ps(y, y), zz = _mm512_mul_ps(z, z);
+				const __m512 xy = _mm512_mul_ps(x, y), xz = _mm512_mul_ps(x, z), yz = _mm512_mul_ps(y, z);
+				const __m512 wx = _mm512_mul_ps(w, x), wy = _mm512_mul_ps(w, y), wz = _mm512_mul_ps(w, z);
+
+				__m512 r0[4] = {
+					_mm512_fnmadd_ps(two, _mm512_add_ps(yy, zz), one),
+					_mm512_mul_ps(two, _mm512_sub_ps(xy, wz)),
+					_mm512_mul_ps(two, _mm512_add_ps(xz, wy)),
+					zero
+				};
+				__m512 r1[4] = {
+					_mm512_mul_ps(two, _mm512_add_ps(xy, wz)),
+					_mm512_fnmadd_ps(two, _mm512_add_ps(xx, zz), one),
+					_mm512_mul_ps(two, _mm512_sub_ps(yz, wx)),
+					zero
+				};
+				__m512 r2[4] = {
+					_mm512_mul_ps(two, _mm512_sub_ps(xz, wy)),
+					_mm512_mul_ps(two, _mm512_add_ps(yz, wx)),
+					_mm512_fnmadd_ps(two, _mm512_add_ps(xx, yy), one),
+					zero
+				};
+				transpose4_AVX512(r0[0], r0[1], r0[2], r0[3]);
+				transpose4_AVX512(r1[0], r1[1], r1[2], r1[3]);
+				transpose4_AVX512(r2[0], r2[1], r2[2], r2[3]);
+
+				// Register k, lane j holds a row of matrix i + k + 4 * j.
+				for (size_t k = 0; k < 4; k++) {
+					float* m = out[i + k].data();
+					store4x128_AVX512(m + 0, 64, r0[k]);
+					store4x128_AVX512(m + 4, 64, r1[k]);
+					store4x128_AVX512(m + 8, 64, r2[k]);
+					for (size_t j = 0; j < 4; j++) _mm_storeu_ps(m + 12 + j * 64, lastRow);
+				}
+			}
+			quatToMatrixMany_AVX2(q + i, out + i, count - i);
+		}
+
+		AE_TARGET("avx512f") void classifyMany_AVX512(const Frustum& f, const AABB* boxes, Containment* out, size_t count) {
+			const __m512 half = _mm512_set1_ps(0.5f);
+			const __m512i idx = _mm512_setr_epi32(0, 6, 12, 18, 24, 30, 36, 42, 48, 54, 60, 66, 72, 78, 84, 90);
+
+			size_t i = 0;
+			for (; i + 16 <= count; i += 16) {
+				const float* b = &boxes[i].min.x;
+				const __m512 minX = _mm512_i32gather_ps(idx, b + 0, 4);
+				const __m512 minY = _mm512_i32gather_ps(idx, b + 1, 4);
+				const __m512 minZ = _mm512_i32gather_ps(idx, b + 2, 4);
+				const __m512 maxX = _mm512_i32gather_ps(idx, b + 3, 4);
+				const __m512 maxY = _mm512_i32gather_ps(idx, b + 4, 4);
+				const __m512 maxZ = _mm512_i32gather_ps(idx, b + 5, 4);
+
+				const __m512 cx = _mm512_mul_ps(_mm512_add_ps(minX, maxX), half);
+				const __m512 cy = _mm512_mul_ps(_mm512_add_ps(minY, maxY), half);
+				const __m512 cz = _mm512_mul_ps(_mm512_add_ps(minZ, maxZ), half);
+				const __m512 ex = _mm512_mul_ps(_mm512_sub_ps(maxX, minX), half);
+				const __m512 ey = _mm512_mul_ps(_mm512_sub_ps(maxY, minY), half);
+				const __m512 ez = _mm512_mul_ps(_mm512_sub_ps(maxZ, minZ), half);
+
+				__mmask16 outside = 0, partial = 0;
+				for (size_t k = 0; k < Frustum::SideCount; k++) {
+					const Plane& pl = f.plane(Frustum::Side(k));
+					const __m512 nx = _mm512_set1_ps(pl.normal.x), ny = _mm512_set1_ps(pl.normal.y), nz = _mm512_set1_ps(pl.normal.z);
+
+					const __m512 d = _mm512_fmadd_ps(nx, cx, _mm512_fmadd_ps(ny, cy, _mm512_fmadd_ps(nz, cz, _mm512_set1_ps(pl.distance))));
+					const __m512 r = _mm512_fmadd_ps(_mm512_set1_ps(std::abs(pl.normal.x)), ex,
+						_mm512_fmadd_ps(_mm512_set1_ps(std::abs(pl.normal.y)), ey, _mm512_mul_ps(_mm512_set1_ps(std::abs(pl.normal.z)), ez)));
+
+					outside |= _mm512_cmp_ps_mask(_mm512_add_ps(d, r), _mm512_setzero_ps(), _CMP_LT_OQ);
+					partial |= _mm512_cmp_ps_mask(d, r, _CMP_LT_OQ);
+					if (outside == 0xFFFF) break;
+				}
+				writeContainment(outside, partial, out + i, 16);
+			}
+			classifyMany_AVX2(f, boxes + i, out + i, count - i);
+		}
+#endif
+	}
+
+	// SSE4.1 has nothing to offer to SoA kernels over SSE2, it shares its entries.
+#if defined(AE_X86)
+#	define AE_DISPATCH(fn, ...) \
+		switch (simd::level()) { \
+			case SimdLevel::AVX512: fn##_AVX512(__VA_ARGS__); return; \
+			case SimdLevel::AVX2: fn##_AVX2(__VA_ARGS__); return; \
+			case SimdLevel::SSE41: \
+			case SimdLevel::SSE2: fn##_SSE2(__VA_ARGS__); return; \
+			default: fn##Scalar(__VA_ARGS__); return; \
+		}
+#else
+#	define AE_DISPATCH(fn, ...) fn##Scalar(__VA_ARGS__)
+#endif
+
+	void dotMany(const Vector3* a, const Vector3* b, float* out, size_t count) {
+		AE_DISPATCH(dotMany, a, b, out, count);
+	}
+
+	void crossMany(const Vector3* a, const Vector3* b, Vector3* out, size_t count) {
+		AE_DISPATCH(crossMany, a, b, out, count);
+	}
+
+	void normalizeMany(const Vector3* v, Vector3* out, size_t count) {
+		AE_DISPATCH(normalizeMany, v, out, count);
+	}
+
+	void rotateMany(const Quaternion& q, const Vector3* v, Vector3* out, size_t count) {
+		AE_DISPATCH(rotateMany, q, v, out, count);
+	}
+
+	void mulMany(const Quaternion* a, const Quaternion* b, Quaternion* out, size_t count) {
+		AE_DISPATCH(mulMany, a, b, out, count);
+	}
+
+	void nlerpMany(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count) {
+		AE_DISPATCH(lerpMany, a, b, t, out, count, false);
+	}
+
+	void slerpMany(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count) {
+		AE_DISPATCH(lerpMany, a, b, t, out, count, true);
+	}
+
+	void transformPoints(const Matrix4& m, const Vector3* points, Vector3* out, size_t count) {
+		AE_DISPATCH(transformMany, m, points, out, count, 1.0f);
+	}
+
+	void transformVectors(const Matrix4& m, const Vector3* vectors, Vector3* out, size_t count) {
+		AE_DISPATCH(transformMany, m, vectors, out, count, 0.0f);
+	}
+
+	void mulMatrices(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count) {
+		AE_DISPATCH(mulMatrices, a, b, out, count);
+	}
+
+	void mulMatrices(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count) {
+		AE_DISPATCH(mulMatrices, a, b, out, count);
+	}
+
+	void quatToMatrixMany(const Quaternion* q, Matrix4* out, size_t count) {
+		AE_DISPATCH(quatToMatrixMany, q, out, count);
+	}
+
+	void classifyMany(const Frustum& frustum, const AABB* boxes, Containment* out, size_t count) {
+		AE_DISPATCH(classifyMany, frustum, boxes, out, count);
+	}
+
+#undef AE_DISPATCH
+}
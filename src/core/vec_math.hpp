@@ -6,19 +6,16 @@
 #include <array>
 #include <ostream>
 #include <algorithm>
+#include <cstring>
 
 #if defined(__SSE__) || (_M_IX86_FP > 0) || (_M_X64 > 0)
 	#define HAS_SSE
 #endif
 
 #if defined(HAS_SSE)
-#	if defined(_M_IX86_FP)
-#		if _M_IX86_FP >=2
-#			define HAS_SSE4_1
-#		endif
-#	elif defined(__SSE4_1__)
+#	if defined(__SSE4_1__) || defined(__AVX__)
 #		define HAS_SSE4_1
-#endif
+#	endif
 
 #if defined(_MSC_VER)
 #	include <intrin.h>
@@ -58,6 +55,163 @@ namespace mathutils {
 	}
 }
 
+#if defined(HAS_SSE)
+namespace intern {
+	inline __m128 load3_SSE(const float* v) {
+		return _mm_setr_ps(v[0], v[1], v[2], 0.0f);
+	}
+
+	inline void store3_SSE(float* out, __m128 v) {
+		alignas(16) float tmp[4];
+		_mm_store_ps(tmp, v);
+		out[0] = tmp[0]; out[1] = tmp[1]; out[2] = tmp[2];
+	}
+
+	/// Dot product of all four lanes, broadcast to every lane.
+	inline __m128 dot4_SSE(__m128 a, __m128 b) {
+#if defined(HAS_SSE4_1)
+		return _mm_dp_ps(a, b, 0xFF);
+#else
+		__m128 m = _mm_mul_ps(a, b);
+		m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+#endif
+	}
+
+	/// Cross product of the xyz lanes, w is zero if it was zero in both inputs.
+	inline __m128 cross3_SSE(__m128 a, __m128 b) {
+		const __m128 a_yzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+		const __m128 b_yzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+		const __m128 c = _mm_sub_ps(_mm_mul_ps(a, b_yzx), _mm_mul_ps(a_yzx, b));
+		return _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 0, 2, 1));
+	}
+
+	template <typename M>
+	inline __m128 normalize4_SSE(__m128 v) {
+		return _mm_mul_ps(v, M::rsqrt(dot4_SSE(v, v)));
+	}
+
+	/// Hamilton product of two (x, y, z, w) quaternions.
+	inline __m128 quatMul_SSE(__m128 a, __m128 b) {
+		const __m128 signW = _mm_setr_ps(1.0f, 1.0f, 1.0f, -1.0f);
+
+		const __m128 aw = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3));
+		const __m128 a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 2, 1, 0));
+		const __m128 b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 3, 3));
+		const __m128 a2 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 2, 1));
+		const __m128 b2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 0, 2));
+		const __m128 a3 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 1, 0, 2));
+		const __m128 b3 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 0, 2, 1));
+
+		__m128 r = _mm_mul_ps(aw, b);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(a1, b1), signW));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(a2, b2), signW));
+		return _mm_sub_ps(r, _mm_mul_ps(a3, b3));
+	}
+}
+#endif
+
+/// Math policy backed by the standard library, used unless a call site asks otherwise.
+struct PreciseMath {
+	static inline float sqrt(float x) { return std::sqrt(x); }
+	static inline float rsqrt(float x) { return 1.0f / std::sqrt(x); }
+	static inline float sin(float x) { return std::sin(x); }
+	static inline float cos(float x) { return std::cos(x); }
+	static inline float tan(float x) { return std::tan(x); }
+	static inline float atan2(float y, float x) { return std::atan2(y, x); }
+	static inline float acos(float x) { return std::acos(x); }
+
+#if defined(HAS_SSE)
+	static inline __m128 rsqrt(__m128 x) { return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(x)); }
+#endif
+};
+
+/// Approximate math policy, inlined and free of libm calls. Measured error bounds:
+///  - rsqrt, sqrt: relative error < 3e-7 (SSE), < 5e-6 (scalar fallback)
+///  - sin, cos: absolute error < 3e-7 on [-TwoPi, TwoPi], growing with |x| from the range reduction
+///  - tan: relative error < 3e-6 on [-1.5, 1.5]
+///  - atan2: absolute error < 5e-7 rad, most of it the float spacing of results near +-Pi
+///  - acos: absolute error < 6e-7 rad
+/// bench/fast_math_bench.cpp measures them. No special handling of inf/NaN; rsqrt(0) is inf, sqrt(0) is 0.
+struct FastMath {
+	static inline float rsqrt(float x) {
+#if defined(HAS_SSE)
+		return _mm_cvtss_f32(rsqrt(_mm_set_ss(x)));
+#else
+		// Magic-constant estimate, the two Newton steps bring it to ~22 bits.
+		uint32_t i;
+		std::memcpy(&i, &x, sizeof(i));
+		i = 0x5F375A86u - (i >> 1);
+		float y;
+		std::memcpy(&y, &i, sizeof(y));
+		y = y * (1.5f - 0.5f * x * y * y);
+		return y * (1.5f - 0.5f * x * y * y);
+#endif
+	}
+
+	static inline float sqrt(float x) {
+		return x > 0.0f ? x * rsqrt(x) : 0.0f;
+	}
+
+	static inline float sin(float x) {
+		// Reduce to [-Pi, Pi], then mirror into [-HalfPi, HalfPi]. Past 2^22 periods a float can't hold the phase
+		// any more, clamping there keeps the rounding below exact and the result finite.
+		x = std::min(std::max(x, -2.6e7f), 2.6e7f);
+		const float k = x * (0.5f * consts::InvPi);
+		x -= consts::TwoPi * ((k + 12582912.0f) - 12582912.0f); // Adding 1.5 * 2^23 rounds to the nearest integer
+		if (x > consts::HalfPi) x = consts::Pi - x;
+		else if (x < -consts::HalfPi) x = -consts::Pi - x;
+
+		// Odd degree 9 minimax polynomial.
+		const float x2 = x * x;
+		return x * (1.0f + x2 * (-1.6666657097e-1f + x2 * (8.3330172916e-3f + x2 * (-1.9806615201e-4f + x2 * 2.6000547679e-6f))));
+	}
+
+	static inline float cos(float x) { return sin(x + consts::HalfPi); }
+
+	static inline float tan(float x) { return sin(x) / cos(x); }
+
+	static inline float atan2(float y, float x) {
+		const float ax = std::abs(x), ay = std::abs(y);
+		const float mx = std::max(ax, ay);
+		if (mx == 0.0f) return 0.0f;
+
+		// atan on [0, 1], Abramowitz & Stegun 4.4.49.
+		const float t = std::min(ax, ay) / mx;
+		const float t2 = t * t;
+		float r = t * (0.9999993329f + t2 * (-0.3332985605f + t2 * (0.1994653599f + t2 * (-0.1390853351f +
+				t2 * (0.0964200441f + t2 * (-0.0559098861f + t2 * (0.0218612288f + t2 * -0.0040540580f)))))));
+
+		if (ay > ax) r = consts::HalfPi - r;
+		if (x < 0.0f) r = consts::Pi - r;
+		return y < 0.0f ? -r : r;
+	}
+
+	static inline float acos(float x) {
+		// Abramowitz & Stegun 4.4.46 on [0, 1], mirrored for negative inputs.
+		const float ax = std::min(std::abs(x), 1.0f);
+		const float r = sqrt(1.0f - ax) * (1.5707963050f + ax * (-0.2145988016f + ax * (0.0889789874f + ax * (-0.0501743046f +
+				ax * (0.0308918810f + ax * (-0.0170881256f + ax * (0.0066700901f + ax * -0.0012624911f)))))));
+		return x < 0.0f ? consts::Pi - r : r;
+	}
+
+#if defined(HAS_SSE)
+	/// rsqrtps estimate (12 bits) refined with one Newton-Raphson step.
+	static inline __m128 rsqrt(__m128 x) {
+		const __m128 y = _mm_rsqrt_ps(x);
+		const __m128 yyx = _mm_mul_ps(_mm_mul_ps(y, y), x);
+		return _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f), y), _mm_sub_ps(_mm_set1_ps(3.0f), yyx));
+	}
+#endif
+};
+
+/// Policy used by default by the templated math below, AE_FAST_MATH switches the whole build to FastMath.
+#if defined(AE_FAST_MATH)
+using DefaultMath = FastMath;
+#else
+using DefaultMath = PreciseMath;
+#endif
+
 class Vector2 {
 public:
 	inline Vector2() : x(0.0f), y(0.0f) {}
@@ -68,13 +222,14 @@ public:
 		return x * v.x + y * v.y;
 	}
 
+	template <typename M = DefaultMath>
 	inline float length() const {
-		return std::sqrt(this->dot(*this));
+		return M::sqrt(this->dot(*this));
 	}
 
+	template <typename M = DefaultMath>
 	inline Vector2 normalized() const {
-		float nlen = 1.0f / length();
-		return (*this) * nlen;
+		return (*this) * M::rsqrt(this->dot(*this));
 	}
 
 	inline Vector2 lerp(const Vector2& to, float factor) const {
@@ -126,24 +281,37 @@ public:
 	}
 
 	inline Vector3 cross(const Vector3& v) const {
+#if defined(HAS_SSE)
+		Vector3 ret{};
+		intern::store3_SSE(&ret.x, intern::cross3_SSE(intern::load3_SSE(&x), intern::load3_SSE(&v.x)));
+		return ret;
+#else
 		return Vector3(
 			y * v.z - z * v.y,
 			z * v.x - x * v.z,
 			x * v.y - y * v.x
 		);
+#endif
 	}
 
 	inline Vector3 lerp(const Vector3& to, float factor) const {
 		return (*this) * (1.0f - factor) + to * factor;
 	}
 
+	template <typename M = DefaultMath>
 	inline float length() const {
-		return std::sqrt(this->dot(*this));
+		return M::sqrt(this->dot(*this));
 	}
 
+	template <typename M = DefaultMath>
 	inline Vector3 normalized() const {
-		float nlen = 1.0f / length();
-		return (*this) * nlen;
+#if defined(HAS_SSE)
+		Vector3 ret{};
+		intern::store3_SSE(&ret.x, intern::normalize4_SSE<M>(intern::load3_SSE(&x)));
+		return ret;
+#else
+		return (*this) * M::rsqrt(this->dot(*this));
+#endif
 	}
 
 	inline Vector3 operator +(const Vector3& o) const {
@@ -189,16 +357,27 @@ public:
 	inline Vector3 toVector3() const { return Vector3(x, y, z); }
 
 	inline float dot(const Vector4& v) const {
+#if defined(HAS_SSE)
+		return _mm_cvtss_f32(intern::dot4_SSE(_mm_loadu_ps(&x), _mm_loadu_ps(&v.x)));
+#else
 		return x * v.x + y * v.y + z * v.z + w * v.w;
+#endif
 	}
 
+	template <typename M = DefaultMath>
 	inline float length() const {
-		return std::sqrt(this->dot(*this));
+		return M::sqrt(this->dot(*this));
 	}
 
+	template <typename M = DefaultMath>
 	inline Vector4 normalized() const {
-		float nlen = 1.0f / length();
-		return (*this) * nlen;
+#if defined(HAS_SSE)
+		Vector4 ret{};
+		_mm_storeu_ps(&ret.x, intern::normalize4_SSE<M>(_mm_loadu_ps(&x)));
+		return ret;
+#else
+		return (*this) * M::rsqrt(this->dot(*this));
+#endif
 	}
 
 	inline Vector4 lerp(const Vector4& to, float factor) const {
@@ -206,15 +385,33 @@ public:
 	}
 
 	inline Vector4 operator +(const Vector4& o) const {
+#if defined(HAS_SSE)
+		Vector4 ret{};
+		_mm_storeu_ps(&ret.x, _mm_add_ps(_mm_loadu_ps(&x), _mm_loadu_ps(&o.x)));
+		return ret;
+#else
 		return Vector4(x + o.x, y + o.y, z + o.z, w + o.w);
+#endif
 	}
 
 	inline Vector4 operator -(const Vector4& o) const {
+#if defined(HAS_SSE)
+		Vector4 ret{};
+		_mm_storeu_ps(&ret.x, _mm_sub_ps(_mm_loadu_ps(&x), _mm_loadu_ps(&o.x)));
+		return ret;
+#else
 		return Vector4(x - o.x, y - o.y, z - o.z, w - o.w);
+#endif
 	}
 
 	inline Vector4 operator *(const Vector4& o) const {
+#if defined(HAS_SSE)
+		Vector4 ret{};
+		_mm_storeu_ps(&ret.x, _mm_mul_ps(_mm_loadu_ps(&x), _mm_loadu_ps(&o.x)));
+		return ret;
+#else
 		return Vector4(x * o.x, y * o.y, z * o.z, w * o.w);
+#endif
 	}
 
 	inline Vector4 operator /(const Vector4& o) const {
@@ -267,6 +464,7 @@ public:
 	}
 
 	inline float* data() { return &m_rows[0][0]; }
+	inline const float* data() const { return &m_rows[0][0]; }
 
 	inline static Matrix4 identity() {
 		return Matrix4({
@@ -304,8 +502,9 @@ public:
 		});
 	}
 
+	template <typename M = DefaultMath>
 	inline static Matrix4 rotationX(float angle) {
-		const float s = std::sin(angle), c = std::cos(angle);
+		const float s = M::sin(angle), c = M::cos(angle);
 		return Matrix4({
 			1, 0, 0, 0,
 			0, c, -s, 0,
@@ -314,8 +513,9 @@ public:
 		});
 	}
 
+	template <typename M = DefaultMath>
 	inline static Matrix4 rotationY(float angle) {
-		const float s = std::sin(angle), c = std::cos(angle);
+		const float s = M::sin(angle), c = M::cos(angle);
 		return Matrix4({
 			c, 0, s, 0,
 			0, 1, 0, 0,
@@ -324,8 +524,9 @@ public:
 		});
 	}
 
+	template <typename M = DefaultMath>
 	inline static Matrix4 rotationZ(float angle) {
-		const float s = std::sin(angle), c = std::cos(angle);
+		const float s = M::sin(angle), c = M::cos(angle);
 		return Matrix4({
 			c, -s, 0, 0,
 			s, c, 0, 0,
@@ -367,9 +568,10 @@ public:
 		return r;
 	}
 
+	template <typename M = DefaultMath>
 	inline static Matrix4 angleAxis(float angle, const Vector3& axis) {
-		const float s = std::sin(angle),
-					c = std::cos(angle),
+		const float s = M::sin(angle),
+					c = M::cos(angle),
 					t = 1.0f - c;
 
 		Vector3 ax = axis.normalized();
@@ -394,8 +596,9 @@ public:
 		});
 	}
 
+	template <typename M = DefaultMath>
 	inline static Matrix4 perspective(float fov, float aspect, float near, float far) {
-		const float thf = std::tan(fov / 2.0f);
+		const float thf = M::tan(fov / 2.0f);
 		const float w = 1.0f / thf;
 		const float h = aspect / thf;
 		return Matrix4({
@@ -460,12 +663,63 @@ public:
 		return res;
 	}
 
-	inline Matrix4 inverse() {
+	/// General inverse. Returns the matrix unchanged if it is singular.
+	inline Matrix4 inverse() const {
 		Matrix4 res{};
-#if 0
-		// TODO: Implement SSE maybe?
+#if defined(HAS_SSE)
+		// Block-wise inverse over the four 2x2 sub-matrices
+		//     | A B |
+		// M = | C D |
+		const __m128 A = _mm_movelh_ps(s_rows[0], s_rows[1]);
+		const __m128 B = _mm_movehl_ps(s_rows[1], s_rows[0]);
+		const __m128 C = _mm_movelh_ps(s_rows[2], s_rows[3]);
+		const __m128 D = _mm_movehl_ps(s_rows[3], s_rows[2]);
+
+		// (|A|, |B|, |C|, |D|)
+		const __m128 detSub = _mm_sub_ps(
+			_mm_mul_ps(
+				_mm_shuffle_ps(s_rows[0], s_rows[2], _MM_SHUFFLE(2, 0, 2, 0)),
+				_mm_shuffle_ps(s_rows[1], s_rows[3], _MM_SHUFFLE(3, 1, 3, 1))
+			),
+			_mm_mul_ps(
+				_mm_shuffle_ps(s_rows[0], s_rows[2], _MM_SHUFFLE(3, 1, 3, 1)),
+				_mm_shuffle_ps(s_rows[1], s_rows[3], _MM_SHUFFLE(2, 0, 2, 0))
+			)
+		);
+		const __m128 detA = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0));
+		const __m128 detB = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1));
+		const __m128 detC = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2));
+		const __m128 detD = _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3));
+
+		const __m128 D_C = mat2AdjMul_SSE(D, C);
+		const __m128 A_B = mat2AdjMul_SSE(A, B);
+		__m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), mat2Mul_SSE(B, D_C));
+		__m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), mat2Mul_SSE(C, A_B));
+		__m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), mat2MulAdj_SSE(D, A_B));
+		__m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), mat2MulAdj_SSE(A, D_C));
+
+		// |M| = |A||D| + |B||C| - tr((A#B)(D#C))
+		__m128 tr = _mm_mul_ps(A_B, _mm_shuffle_ps(D_C, D_C, _MM_SHUFFLE(3, 1, 2, 0)));
+		tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+		tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+		const __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)), tr);
+
+		if (_mm_cvtss_f32(detM) == 0.0f)
+			return (*this);
+
+		const __m128 rDetM = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), detM);
+		X = _mm_mul_ps(X, rDetM);
+		Y = _mm_mul_ps(Y, rDetM);
+		Z = _mm_mul_ps(Z, rDetM);
+		W = _mm_mul_ps(W, rDetM);
+
+		// Adjugate of each block, shuffled back into rows
+		res.s_rows[0] = _mm_shuffle_ps(X, Y, _MM_SHUFFLE(1, 3, 1, 3));
+		res.s_rows[1] = _mm_shuffle_ps(X, Y, _MM_SHUFFLE(0, 2, 0, 2));
+		res.s_rows[2] = _mm_shuffle_ps(Z, W, _MM_SHUFFLE(1, 3, 1, 3));
+		res.s_rows[3] = _mm_shuffle_ps(Z, W, _MM_SHUFFLE(0, 2, 0, 2));
 #else
-		float* m = data();
+		const float* m = data();
 		float inv[16], det;
 
 		inv[0] = m[5] * m[10] * m[15] -
@@ -592,6 +846,24 @@ public:
 		return res;
 	}
 
+	/// Inverse of a matrix whose last row is (0, 0, 0, 1), e.g. any translation/rotation/scale.
+	inline Matrix4 inverseAffine() const;
+
+	/// Inverse of a rotation + translation matrix (orthonormal upper 3x3), e.g. a view transform.
+	inline Matrix4 inverseOrthonormal() const {
+		const Matrix4& m = (*this);
+		const Vector3 t{ m[0][3], m[1][3], m[2][3] };
+		const Vector3 r0{ m[0][0], m[1][0], m[2][0] };
+		const Vector3 r1{ m[0][1], m[1][1], m[2][1] };
+		const Vector3 r2{ m[0][2], m[1][2], m[2][2] };
+		return Matrix4({
+			r0.x, r0.y, r0.z, -r0.dot(t),
+			r1.x, r1.y, r1.z, -r1.dot(t),
+			r2.x, r2.y, r2.z, -r2.dot(t),
+			0.0f, 0.0f, 0.0f, 1.0f
+		});
+	}
+
 	Vector4& operator [](size_t i) { return m_rows[i]; }
 	const Vector4& operator [](size_t i) const { return m_rows[i]; }
 
@@ -612,6 +884,31 @@ private:
 		result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(a, a, 0xff), b.s_rows[3]));
 		return result;
 	}
+
+	// 2x2 row-major helpers for inverse(), A# is the adjugate of A.
+	// A * B
+	inline static __m128 mat2Mul_SSE(__m128 a, __m128 b) {
+		return _mm_add_ps(
+			_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2)))
+		);
+	}
+
+	// A# * B
+	inline static __m128 mat2AdjMul_SSE(__m128 a, __m128 b) {
+		return _mm_sub_ps(
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2)))
+		);
+	}
+
+	// A * B#
+	inline static __m128 mat2MulAdj_SSE(__m128 a, __m128 b) {
+		return _mm_sub_ps(
+			_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+			_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2)))
+		);
+	}
 #endif
 };
 
@@ -670,10 +967,11 @@ public:
 		w /= length;
 	}
 
+	template <typename M = DefaultMath>
 	inline static Quaternion axisAngle(const Vector3& axis, float angle) {
 		Quaternion q{};
-		const float hs = std::sin(angle / 2.0f),
-					hc = std::cos(angle / 2.0f);
+		const float hs = M::sin(angle / 2.0f),
+					hc = M::cos(angle / 2.0f);
 		q.x = hs * axis.x;
 		q.y = hs * axis.y;
 		q.z = hs * axis.z;
@@ -694,32 +992,55 @@ public:
 	}
 
 	inline float dot(const Quaternion& q) const {
+#if defined(HAS_SSE)
+		return _mm_cvtss_f32(intern::dot4_SSE(_mm_loadu_ps(&x), _mm_loadu_ps(&q.x)));
+#else
 		return x * q.x + y * q.y + z * q.z + w * q.w;
+#endif
 	}
 
+	template <typename M = DefaultMath>
 	inline float length() const {
-		return std::sqrt(this->dot(*this));
+		return M::sqrt(this->dot(*this));
 	}
 
+	template <typename M = DefaultMath>
 	inline Quaternion normalized() const {
-		float nlen = 1.0f / length();
-		return (*this) * nlen;
+#if defined(HAS_SSE)
+		Quaternion ret{};
+		_mm_storeu_ps(&ret.x, intern::normalize4_SSE<M>(_mm_loadu_ps(&x)));
+		return ret;
+#else
+		return (*this) * M::rsqrt(this->dot(*this));
+#endif
 	}
 
 	inline Quaternion operator *(const Quaternion& r) const {
+#if defined(HAS_SSE)
+		Quaternion ret{};
+		_mm_storeu_ps(&ret.x, intern::quatMul_SSE(_mm_loadu_ps(&x), _mm_loadu_ps(&r.x)));
+		return ret;
+#else
 		float w_ = w * r.w - x * r.x - y * r.y - z * r.z;
 		float x_ = x * r.w + w * r.x + y * r.z - z * r.y;
 		float y_ = y * r.w + w * r.y + z * r.x - x * r.z;
 		float z_ = z * r.w + w * r.z + x * r.y - y * r.x;
 		return Quaternion(x_, y_, z_, w_);
+#endif
 	}
 
 	inline Quaternion operator *(const Vector3& r) const {
+#if defined(HAS_SSE)
+		Quaternion ret{};
+		_mm_storeu_ps(&ret.x, intern::quatMul_SSE(_mm_loadu_ps(&x), intern::load3_SSE(&r.x)));
+		return ret;
+#else
 		float w_ = -x * r.x - y * r.y - z * r.z;
 		float x_ = w * r.x + y * r.z - z * r.y;
 		float y_ = w * r.y + z * r.x - x * r.z;
 		float z_ = w * r.z + x * r.y - y * r.x;
 		return Quaternion(x_, y_, z_, w_);
+#endif
 	}
 
 	inline Quaternion operator *(float r) const {
@@ -735,9 +1056,18 @@ public:
 	}
 
 	inline Vector3 rotate(const Vector3& v) const {
+#if defined(HAS_SSE)
+		const __m128 q = _mm_loadu_ps(&x);
+		const __m128 cq = _mm_xor_ps(q, _mm_setr_ps(-0.0f, -0.0f, -0.0f, 0.0f));
+		const __m128 r = intern::quatMul_SSE(intern::quatMul_SSE(q, intern::load3_SSE(&v.x)), cq);
+		Vector3 ret{};
+		intern::store3_SSE(&ret.x, r);
+		return ret;
+#else
 		const Quaternion cq = conjugated();
 		const Quaternion r = ((*this) * v) * cq;
 		return r.toVector3();
+#endif
 	}
 
 	inline Matrix4 toMatrix4() const {
@@ -748,14 +1078,16 @@ public:
 		return Matrix4::rotation(forward, up, right);
 	}
 
+	template <typename M = DefaultMath>
 	inline Quaternion nLerp(const Quaternion& to, float factor, bool shortest = true) {
 		Quaternion correctTo = to;
 		if (shortest && dot(to) < 0.0f) {
 			correctTo = Quaternion(-to.x, -to.y, -to.z, -to.w);
 		}
-		return (correctTo - (*this) * factor + (*this)).normalized();
+		return ((*this) + (correctTo - (*this)) * factor).template normalized<M>();
 	}
 
+	template <typename M = DefaultMath>
 	inline Quaternion sLerp(const Quaternion& to, float factor, bool shortest = true) {
 		const float FACTOR = 1e-3f;
 
@@ -768,14 +1100,14 @@ public:
 		}
 
 		if (std::abs(cos) >= 1.0f - FACTOR)
-			return nLerp(to, factor, shortest);
+			return nLerp<M>(to, factor, shortest);
 
-		const float sin = std::sqrt(1.0f - cos * cos);
-		const float angle = std::atan2(sin, cos);
+		const float sin = M::sqrt(1.0f - cos * cos);
+		const float angle = M::atan2(sin, cos);
 		const float invSin = 1.0f / sin;
 
-		const float srcFactor = std::sin((1.0f - factor) * angle) * invSin;
-		const float destFactor = std::sin(factor * angle) * invSin;
+		const float srcFactor = M::sin((1.0f - factor) * angle) * invSin;
+		const float destFactor = M::sin(factor * angle) * invSin;
 
 		return (*this) * srcFactor + correctTo * destFactor;
 	}
@@ -787,6 +1119,140 @@ inline std::ostream& operator<<(std::ostream& o, const Quaternion& v) {
 	return o << "Quaternion(" << v.x << ", " << v.y << ", " << v.z << ", " << v.w << ")";
 }
 
+/// The top three rows of an affine Matrix4 (the last row is implicitly 0, 0, 0, 1).
+/// 12 floats instead of 16 for model transforms, uploaded as a mat4x3.
+class Affine3x4 {
+public:
+	inline Affine3x4() {
+		m_rows[0] = Vector4(1.0f, 0.0f, 0.0f, 0.0f);
+		m_rows[1] = Vector4(0.0f, 1.0f, 0.0f, 0.0f);
+		m_rows[2] = Vector4(0.0f, 0.0f, 1.0f, 0.0f);
+	}
+
+	inline Affine3x4(const Vector4& r0, const Vector4& r1, const Vector4& r2) {
+		m_rows[0] = r0;
+		m_rows[1] = r1;
+		m_rows[2] = r2;
+	}
+
+	inline explicit Affine3x4(const Matrix4& m) {
+		m_rows[0] = m[0];
+		m_rows[1] = m[1];
+		m_rows[2] = m[2];
+	}
+
+	inline float* data() { return &m_rows[0][0]; }
+	inline const float* data() const { return &m_rows[0][0]; }
+
+	/// Same as Matrix4::translation(p) * r.toMatrix4() * Matrix4::scale(s), without the products.
+	inline static Affine3x4 fromTRS(const Vector3& p, const Quaternion& r, const Vector3& s) {
+		const float x = r.x, y = r.y, z = r.z, w = r.w;
+		return Affine3x4(
+			Vector4((1.0f - 2.0f * (y * y + z * z)) * s.x, 2.0f * (x * y - w * z) * s.y, 2.0f * (x * z + w * y) * s.z, p.x),
+			Vector4(2.0f * (x * y + w * z) * s.x, (1.0f - 2.0f * (x * x + z * z)) * s.y, 2.0f * (y * z - w * x) * s.z, p.y),
+			Vector4(2.0f * (x * z - w * y) * s.x, 2.0f * (y * z + w * x) * s.y, (1.0f - 2.0f * (x * x + y * y)) * s.z, p.z)
+		);
+	}
+
+	inline Matrix4 toMatrix4() const {
+		const Vector4* r = m_rows;
+		return Matrix4({
+			r[0].x, r[0].y, r[0].z, r[0].w,
+			r[1].x, r[1].y, r[1].z, r[1].w,
+			r[2].x, r[2].y, r[2].z, r[2].w,
+			0.0f, 0.0f, 0.0f, 1.0f
+		});
+	}
+
+	inline Vector3 transformPoint(const Vector3& v) const {
+		return Vector3(
+			m_rows[0].dot(Vector4(v, 1.0f)),
+			m_rows[1].dot(Vector4(v, 1.0f)),
+			m_rows[2].dot(Vector4(v, 1.0f))
+		);
+	}
+
+	inline Vector3 transformVector(const Vector3& v) const {
+		return Vector3(
+			m_rows[0].dot(Vector4(v, 0.0f)),
+			m_rows[1].dot(Vector4(v, 0.0f)),
+			m_rows[2].dot(Vector4(v, 0.0f))
+		);
+	}
+
+	inline Affine3x4 operator *(const Affine3x4& o) const {
+		Affine3x4 ret{};
+		for (size_t i = 0; i < 3; i++) {
+			const Vector4& r = m_rows[i];
+			ret.m_rows[i] = o.m_rows[0] * r.x + o.m_rows[1] * r.y + o.m_rows[2] * r.z + Vector4(0.0f, 0.0f, 0.0f, r.w);
+		}
+		return ret;
+	}
+
+	/// Inverse through the 3x3 adjugate. Returns the transform unchanged if it is singular.
+	inline Affine3x4 inverse() const {
+		const Vector3 c0{ m_rows[0].x, m_rows[1].x, m_rows[2].x };
+		const Vector3 c1{ m_rows[0].y, m_rows[1].y, m_rows[2].y };
+		const Vector3 c2{ m_rows[0].z, m_rows[1].z, m_rows[2].z };
+		const Vector3 t{ m_rows[0].w, m_rows[1].w, m_rows[2].w };
+
+		// Rows of the inverse are the cross products of the columns over the determinant.
+		const Vector3 r0 = c1.cross(c2);
+		const Vector3 r1 = c2.cross(c0);
+		const Vector3 r2 = c0.cross(c1);
+		const float det = c0.dot(r0);
+		if (det == 0.0f)
+			return (*this);
+
+		const float invDet = 1.0f / det;
+		const Vector3 i0 = r0 * invDet, i1 = r1 * invDet, i2 = r2 * invDet;
+		return Affine3x4(
+			Vector4(i0, -i0.dot(t)),
+			Vector4(i1, -i1.dot(t)),
+			Vector4(i2, -i2.dot(t))
+		);
+	}
+
+	/// Whether the 3x3 part keeps angles: a rotation, optionally mirrored, times a uniform scale. tolerance is
+	/// relative to the squared scale.
+	inline bool conformal(float tolerance = 1e-4f) const {
+		const Vector3 c0{ m_rows[0].x, m_rows[1].x, m_rows[2].x };
+		const Vector3 c1{ m_rows[0].y, m_rows[1].y, m_rows[2].y };
+		const Vector3 c2{ m_rows[0].z, m_rows[1].z, m_rows[2].z };
+		const float s = c0.dot(c0), eps = s * tolerance;
+		return std::abs(c1.dot(c1) - s) <= eps && std::abs(c2.dot(c2) - s) <= eps &&
+			std::abs(c0.dot(c1)) <= eps && std::abs(c0.dot(c2)) <= eps && std::abs(c1.dot(c2)) <= eps;
+	}
+
+	Vector4& operator [](size_t i) { return m_rows[i]; }
+	const Vector4& operator [](size_t i) const { return m_rows[i]; }
+
+private:
+	Vector4 m_rows[3];
+};
+
+inline std::ostream& operator<<(std::ostream& o, const Affine3x4& v) {
+	return o << "Affine3x4(\n" <<
+		"\t" << v[0] << "\n" <<
+		"\t" << v[1] << "\n" <<
+		"\t" << v[2] << "\n)";
+}
+
+inline Matrix4 Matrix4::inverseAffine() const {
+	return Affine3x4(*this).inverse().toMatrix4();
+}
+
+class Ray {
+public:
+	Vector3 origin{}, direction{ 0.0f, 0.0f, -1.0f };
+
+	Ray() = default;
+	Ray(const Vector3& origin, const Vector3& direction)
+		: origin(origin), direction(direction) {}
+
+	inline Vector3 at(float t) const { return origin + direction * t; }
+};
+
 class AABB {
 public:
 	Vector3 min{}, max{};
@@ -794,10 +1260,435 @@ public:
 	AABB() = default;
 	AABB(const Vector3& min, const Vector3& max)
 		: min(min), max(max) {}
-	
-	// TODO: Implement AABB things
+
+	/// An inverted box that any expand() call turns into a valid one.
+	inline static AABB empty() {
+		return AABB(Vector3(INFINITY), Vector3(-INFINITY));
+	}
+
+	inline static AABB fromPoints(const Vector3* points, size_t count) {
+		AABB ret = empty();
+		for (size_t i = 0; i < count; i++) ret.expand(points[i]);
+		return ret;
+	}
+
+	inline bool valid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+
+	inline Vector3 center() const { return (min + max) * 0.5f; }
+	inline Vector3 size() const { return max - min; }
+	inline Vector3 extents() const { return (max - min) * 0.5f; }
+
+	inline float surfaceArea() const {
+		const Vector3 s = size();
+		return 2.0f * (s.x * s.y + s.y * s.z + s.z * s.x);
+	}
+
+	inline void expand(const Vector3& p) {
+		min = Vector3(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+		max = Vector3(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+	}
+
+	inline void expand(const AABB& b) {
+		min = Vector3(std::min(min.x, b.min.x), std::min(min.y, b.min.y), std::min(min.z, b.min.z));
+		max = Vector3(std::max(max.x, b.max.x), std::max(max.y, b.max.y), std::max(max.z, b.max.z));
+	}
+
+	inline AABB merged(const AABB& b) const {
+		AABB ret = (*this);
+		ret.expand(b);
+		return ret;
+	}
+
+	inline bool contains(const Vector3& p) const {
+		return p.x >= min.x && p.y >= min.y && p.z >= min.z &&
+				p.x <= max.x && p.y <= max.y && p.z <= max.z;
+	}
+
+	inline bool contains(const AABB& b) const {
+		return contains(b.min) && contains(b.max);
+	}
+
+	inline bool intersects(const AABB& b) const {
+		return min.x <= b.max.x && max.x >= b.min.x &&
+				min.y <= b.max.y && max.y >= b.min.y &&
+				min.z <= b.max.z && max.z >= b.min.z;
+	}
+
+	/// Box enclosing the transformed box (Arvo), the result is never smaller than the original corners.
+	inline AABB transformed(const Matrix4& m) const {
+		const Vector3 c = center(), e = extents();
+		Vector3 nc, ne;
+		float* pc = &nc.x;
+		float* pe = &ne.x;
+		for (size_t i = 0; i < 3; i++) {
+			pc[i] = m[i][0] * c.x + m[i][1] * c.y + m[i][2] * c.z + m[i][3];
+			pe[i] = std::abs(m[i][0]) * e.x + std::abs(m[i][1]) * e.y + std::abs(m[i][2]) * e.z;
+		}
+		return AABB(nc - ne, nc + ne);
+	}
+
+	inline AABB transformed(const Affine3x4& m) const {
+		const Vector3 c = center(), e = extents();
+		Vector3 nc, ne;
+		float* pc = &nc.x;
+		float* pe = &ne.x;
+		for (size_t i = 0; i < 3; i++) {
+			pc[i] = m[i].x * c.x + m[i].y * c.y + m[i].z * c.z + m[i].w;
+			pe[i] = std::abs(m[i].x) * e.x + std::abs(m[i].y) * e.y + std::abs(m[i].z) * e.z;
+		}
+		return AABB(nc - ne, nc + ne);
+	}
+
+	/// Slab test. On a hit, tmin/tmax are the entry and exit distances along the ray (tmin may be negative if the origin is inside).
+	inline bool intersects(const Ray& ray, float& tmin, float& tmax) const {
+		const Vector3 inv = Vector3(1.0f) / ray.direction;
+		const Vector3 t0 = (min - ray.origin) * inv;
+		const Vector3 t1 = (max - ray.origin) * inv;
+		tmin = std::max(std::max(std::min(t0.x, t1.x), std::min(t0.y, t1.y)), std::min(t0.z, t1.z));
+		tmax = std::min(std::min(std::max(t0.x, t1.x), std::max(t0.y, t1.y)), std::max(t0.z, t1.z));
+		return tmax >= std::max(tmin, 0.0f);
+	}
+
+	inline bool intersects(const Ray& ray) const {
+		float tmin, tmax;
+		return intersects(ray, tmin, tmax);
+	}
 };
 
+inline std::ostream& operator<<(std::ostream& o, const AABB& v) {
+	return o << "AABB(" << v.min << ", " << v.max << ")";
+}
+
+class BoundingSphere {
+public:
+	Vector3 center{};
+	float radius{ 0.0f };
+
+	BoundingSphere() = default;
+	BoundingSphere(const Vector3& center, float radius)
+		: center(center), radius(radius) {}
+
+	inline static BoundingSphere fromAABB(const AABB& b) {
+		return BoundingSphere(b.center(), b.extents().length());
+	}
+
+	/// Ritter's approximate bounding sphere, at most ~5% larger than the optimal one.
+	inline static BoundingSphere fromPoints(const Vector3* points, size_t count) {
+		if (count == 0) return BoundingSphere();
+
+		auto farthest = [&](const Vector3& from) {
+			size_t best = 0;
+			float bestDist = -1.0f;
+			for (size_t i = 0; i < count; i++) {
+				const Vector3 d = points[i] - from;
+				const float dist = d.dot(d);
+				if (dist > bestDist) { bestDist = dist; best = i; }
+			}
+			return points[best];
+		};
+
+		const Vector3 a = farthest(points[0]);
+		const Vector3 b = farthest(a);
+		BoundingSphere ret((a + b) * 0.5f, (b - a).length() * 0.5f);
+		for (size_t i = 0; i < count; i++) ret.expand(points[i]);
+		return ret;
+	}
+
+	inline void expand(const Vector3& p) {
+		const Vector3 d = p - center;
+		const float dist = d.length();
+		if (dist <= radius) return;
+		const float newRadius = (radius + dist) * 0.5f;
+		center = center + d * ((newRadius - radius) / dist);
+		radius = newRadius;
+	}
+
+	inline BoundingSphere merged(const BoundingSphere& s) const {
+		const Vector3 d = s.center - center;
+		const float dist = d.length();
+		if (dist + s.radius <= radius) return (*this);
+		if (dist + radius <= s.radius) return s;
+
+		const float newRadius = (dist + radius + s.radius) * 0.5f;
+		return BoundingSphere(center + d * ((newRadius - radius) / dist), newRadius);
+	}
+
+	inline bool contains(const Vector3& p) const {
+		const Vector3 d = p - center;
+		return d.dot(d) <= radius * radius;
+	}
+
+	inline bool intersects(const BoundingSphere& s) const {
+		const Vector3 d = s.center - center;
+		const float r = radius + s.radius;
+		return d.dot(d) <= r * r;
+	}
+
+	inline bool intersects(const AABB& b) const {
+		const Vector3 p(
+			std::max(b.min.x, std::min(center.x, b.max.x)),
+			std::max(b.min.y, std::min(center.y, b.max.y)),
+			std::max(b.min.z, std::min(center.z, b.max.z))
+		);
+		return contains(p);
+	}
+
+	/// Nearest non-negative hit distance along the ray.
+	inline bool intersects(const Ray& ray, float& t) const {
+		const Vector3 oc = ray.origin - center;
+		const float a = ray.direction.dot(ray.direction);
+		const float b = oc.dot(ray.direction);
+		const float c = oc.dot(oc) - radius * radius;
+		const float disc = b * b - a * c;
+		if (disc < 0.0f) return false;
+
+		const float sq = std::sqrt(disc);
+		t = (-b - sq) / a;
+		if (t < 0.0f) t = (-b + sq) / a;
+		return t >= 0.0f;
+	}
+
+	/// Sphere enclosing the transformed sphere, scaled by the largest axis scale of m.
+	inline BoundingSphere transformed(const Matrix4& m) const {
+		const Vector3 c(
+			m[0][0] * center.x + m[0][1] * center.y + m[0][2] * center.z + m[0][3],
+			m[1][0] * center.x + m[1][1] * center.y + m[1][2] * center.z + m[1][3],
+			m[2][0] * center.x + m[2][1] * center.y + m[2][2] * center.z + m[2][3]
+		);
+		const float sx = Vector3(m[0][0], m[1][0], m[2][0]).dot(Vector3(m[0][0], m[1][0], m[2][0]));
+		const float sy = Vector3(m[0][1], m[1][1], m[2][1]).dot(Vector3(m[0][1], m[1][1], m[2][1]));
+		const float sz = Vector3(m[0][2], m[1][2], m[2][2]).dot(Vector3(m[0][2], m[1][2], m[2][2]));
+		return BoundingSphere(c, radius * std::sqrt(std::max(sx, std::max(sy, sz))));
+	}
+};
+
+inline std::ostream& operator<<(std::ostream& o, const BoundingSphere& v) {
+	return o << "BoundingSphere(" << v.center << ", " << v.radius << ")";
+}
+
+/// Points p with normal.dot(p) + distance >= 0 are on the positive (inner) side.
+class Plane {
+public:
+	Vector3 normal{ 0.0f, 1.0f, 0.0f };
+	float distance{ 0.0f };
+
+	Plane() = default;
+	Plane(const Vector3& normal, float distance)
+		: normal(normal), distance(distance) {}
+	explicit Plane(const Vector4& v)
+		: normal(v.toVector3()), distance(v.w) {}
+
+	inline Plane normalized() const {
+		const float inv = 1.0f / normal.length();
+		return Plane(normal * inv, distance * inv);
+	}
+
+	inline float signedDistance(const Vector3& p) const {
+		return normal.dot(p) + distance;
+	}
+};
+
+enum class Containment : uint8_t {
+	Outside = 0,
+	Intersecting,
+	Inside
+};
+
+class Frustum {
+public:
+	enum Side {
+		Left = 0,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+		SideCount
+	};
+
+	Frustum() = default;
+
+	/// Gribb/Hartmann plane extraction from a row-vector-on-the-right matrix (projection * view),
+	/// using OpenGL's -w <= z <= w clip volume. Normals point inwards.
+	inline static Frustum fromMatrix(const Matrix4& viewProj) {
+		const Matrix4& m = viewProj;
+		Frustum f{};
+		f.m_planes[Left] = Plane(m[3] + m[0]).normalized();
+		f.m_planes[Right] = Plane(m[3] - m[0]).normalized();
+		f.m_planes[Bottom] = Plane(m[3] + m[1]).normalized();
+		f.m_planes[Top] = Plane(m[3] - m[1]).normalized();
+		f.m_planes[Near] = Plane(m[3] + m[2]).normalized();
+		f.m_planes[Far] = Plane(m[3] - m[2]).normalized();
+		return f;
+	}
+
+	const Plane& plane(Side side) const { return m_planes[side]; }
+
+	inline bool contains(const Vector3& p) const {
+		for (const Plane& pl : m_planes) {
+			if (pl.signedDistance(p) < 0.0f) return false;
+		}
+		return true;
+	}
+
+	inline bool intersects(const BoundingSphere& s) const {
+		for (const Plane& pl : m_planes) {
+			if (pl.signedDistance(s.center) < -s.radius) return false;
+		}
+		return true;
+	}
+
+	inline Containment classify(const AABB& b) const {
+		const Vector3 c = b.center(), e = b.extents();
+		Containment ret = Containment::Inside;
+		for (const Plane& pl : m_planes) {
+			const float d = pl.signedDistance(c);
+			const float r = std::abs(pl.normal.x) * e.x + std::abs(pl.normal.y) * e.y + std::abs(pl.normal.z) * e.z;
+			if (d < -r) return Containment::Outside;
+			if (d < r) ret = Containment::Intersecting;
+		}
+		return ret;
+	}
+
+	inline bool intersects(const AABB& b) const {
+		return classify(b) != Containment::Outside;
+	}
+
+	/// Batched classify(), see classifyMany().
+	inline void classify(const AABB* boxes, Containment* out, size_t count) const;
+
+private:
+	Plane m_planes[SideCount];
+};
+
+/// Eight Vector3s stored as separate x/y/z arrays, so plain loops over the lanes vectorize.
+class Vector3x8 {
+public:
+	static constexpr size_t Width = 8;
+
+	inline Vector3x8() = default;
+	inline Vector3x8(const Vector3& v) {
+		for (size_t i = 0; i < Width; i++) set(i, v);
+	}
+
+	/// Loads up to Width vectors, missing lanes are zero.
+	inline static Vector3x8 load(const Vector3* v, size_t count = Width) {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < std::min(count, Width); i++) ret.set(i, v[i]);
+		return ret;
+	}
+
+	inline void store(Vector3* v, size_t count = Width) const {
+		for (size_t i = 0; i < std::min(count, Width); i++) v[i] = get(i);
+	}
+
+	inline Vector3 get(size_t i) const { return Vector3(x[i], y[i], z[i]); }
+	inline void set(size_t i, const Vector3& v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+
+	inline void dot(const Vector3x8& v, float out[Width]) const {
+		for (size_t i = 0; i < Width; i++) out[i] = x[i] * v.x[i] + y[i] * v.y[i] + z[i] * v.z[i];
+	}
+
+	inline Vector3x8 cross(const Vector3x8& v) const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			ret.x[i] = y[i] * v.z[i] - z[i] * v.y[i];
+			ret.y[i] = z[i] * v.x[i] - x[i] * v.z[i];
+			ret.z[i] = x[i] * v.y[i] - y[i] * v.x[i];
+		}
+		return ret;
+	}
+
+	inline Vector3x8 normalized() const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			const float len = std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+			ret.x[i] = x[i] / len;
+			ret.y[i] = y[i] / len;
+			ret.z[i] = z[i] / len;
+		}
+		return ret;
+	}
+
+	inline Vector3x8 operator +(const Vector3x8& o) const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			ret.x[i] = x[i] + o.x[i]; ret.y[i] = y[i] + o.y[i]; ret.z[i] = z[i] + o.z[i];
+		}
+		return ret;
+	}
+
+	inline Vector3x8 operator -(const Vector3x8& o) const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			ret.x[i] = x[i] - o.x[i]; ret.y[i] = y[i] - o.y[i]; ret.z[i] = z[i] - o.z[i];
+		}
+		return ret;
+	}
+
+	inline Vector3x8 operator *(const Vector3x8& o) const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			ret.x[i] = x[i] * o.x[i]; ret.y[i] = y[i] * o.y[i]; ret.z[i] = z[i] * o.z[i];
+		}
+		return ret;
+	}
+
+	inline Vector3x8 operator *(float o) const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			ret.x[i] = x[i] * o; ret.y[i] = y[i] * o; ret.z[i] = z[i] * o;
+		}
+		return ret;
+	}
+
+	/// Transforms the eight lanes as points (w = 1), like Matrix4 * Vector3.
+	inline Vector3x8 transformed(const Matrix4& m) const {
+		Vector3x8 ret{};
+		for (size_t i = 0; i < Width; i++) {
+			ret.x[i] = m[0][0] * x[i] + m[0][1] * y[i] + m[0][2] * z[i] + m[0][3];
+			ret.y[i] = m[1][0] * x[i] + m[1][1] * y[i] + m[1][2] * z[i] + m[1][3];
+			ret.z[i] = m[2][0] * x[i] + m[2][1] * y[i] + m[2][2] * z[i] + m[2][3];
+		}
+		return ret;
+	}
+
+	alignas(32) float x[Width]{};
+	alignas(32) float y[Width]{};
+	alignas(32) float z[Width]{};
+};
+
+// Bulk kernels over arrays, dispatched at runtime to the widest instruction set
+// the CPU supports (see simd.h). Input and output arrays may be the same.
+void dotMany(const Vector3* a, const Vector3* b, float* out, size_t count);
+void crossMany(const Vector3* a, const Vector3* b, Vector3* out, size_t count);
+void normalizeMany(const Vector3* v, Vector3* out, size_t count);
+void rotateMany(const Quaternion& q, const Vector3* v, Vector3* out, size_t count);
+void mulMany(const Quaternion* a, const Quaternion* b, Quaternion* out, size_t count);
+/// out[i] = a[i].nLerp(b[i], t), along the shortest arc.
+void nlerpMany(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count);
+/// out[i] ~ a[i].sLerp(b[i], t): nlerp with t corrected for constant angular speed, within 7.8e-4 radians of
+/// rotation of the exact slerp (worst case, at a.b = 0) at the cost of a few multiplies instead of its trigonometry.
+void slerpMany(const Quaternion* a, const Quaternion* b, float t, Quaternion* out, size_t count);
+
+/// out[i] = m * points[i], like Matrix4 * Vector3 (w = 1, no perspective divide).
+void transformPoints(const Matrix4& m, const Vector3* points, Vector3* out, size_t count);
+/// out[i] = m * vectors[i] with w = 0, translation is ignored.
+void transformVectors(const Matrix4& m, const Vector3* vectors, Vector3* out, size_t count);
+/// out[i] = a[i] * b[i]
+void mulMatrices(const Matrix4* a, const Matrix4* b, Matrix4* out, size_t count);
+/// out[i] = a * b[i], e.g. a view-projection times many model matrices.
+void mulMatrices(const Matrix4& a, const Matrix4* b, Matrix4* out, size_t count);
+/// out[i] = q[i].toMatrix4()
+void quatToMatrixMany(const Quaternion* q, Matrix4* out, size_t count);
+
+/// out[i] = frustum.classify(boxes[i]), with all six planes tested at once per box.
+void classifyMany(const Frustum& frustum, const AABB* boxes, Containment* out, size_t count);
+
+inline void Frustum::classify(const AABB* boxes, Containment* out, size_t count) const {
+	classifyMany(*this, boxes, out, count);
+}
+
 }
 
 #endif // VEC_MATH_HPP
\ No newline at end of file
@@ -27,6 +27,7 @@ public:
 		camera = world->create();
 		floor = world->create();
 
+		GeometryPool::ston().enabled(true);
 		bunnyModel = ResourceManager::ston().load<Mesh>("model", "bunny.obj");
 		floorModel = ResourceManager::ston().load<Mesh>("floor", "cube.obj");
 
@@ -0,0 +1,538 @@
+#include "animation.h"
+
+#include "log.h"
+#include "simd.h"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace {
+		constexpr float Snorm16 = 32767.0f;
+		constexpr float Unorm16 = 65535.0f;
+
+		// Keys of two frames are interpolated with t. Rotations aren't dequantized, normalizing after the nlerp
+		// takes care of the scale. Vector keys are min + key * step, with per joint ranges.
+		void sampleRotationsScalar(const int16* k0, const int16* k1, uint32 stride, float t, Quaternion* out, uint32 count) {
+			for (uint32 j = 0; j < count; j++) {
+				const Quaternion a(k0[j], k0[stride + j], k0[stride * 2 + j], k0[stride * 3 + j]);
+				const Quaternion b(k1[j], k1[stride + j], k1[stride * 2 + j], k1[stride * 3 + j]);
+				const Quaternion q = a * (1.0f - t) + b * (a.dot(b) < 0.0f ? -t : t);
+				out[j] = q * (1.0f / std::sqrt(q.dot(q)));
+			}
+		}
+
+		void sampleVectorsScalar(const uint16* k0, const uint16* k1, const float* range, uint32 stride, float t, Vector3* out, uint32 count) {
+			for (uint32 j = 0; j < count; j++) {
+				float v[3];
+				for (uint32 c = 0; c < 3; c++) {
+					const float a = k0[stride * c + j], b = k1[stride * c + j];
+					v[c] = range[stride * c + j] + (a + (b - a) * t) * range[stride * (3 + c) + j];
+				}
+				out[j] = Vector3(v[0], v[1], v[2]);
+			}
+		}
+
+#if defined(AE_X86)
+		// SSE2, 4 joints per iteration.
+		AE_TARGET("sse2") inline __m128 loadSnorm16_SSE2(const int16* p) {
+			const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+			return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+		}
+
+		AE_TARGET("sse2") inline __m128 loadUnorm16_SSE2(const uint16* p) {
+			const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+			return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+		}
+
+		AE_TARGET("sse2") inline void storeQuat_SSE2(Quaternion* q, __m128 x, __m128 y, __m128 z, __m128 w) {
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			_mm_storeu_ps(&q[0].x, x);
+			_mm_storeu_ps(&q[1].x, y);
+			_mm_storeu_ps(&q[2].x, z);
+			_mm_storeu_ps(&q[3].x, w);
+		}
+
+		AE_TARGET("sse2") inline void store3_SSE2(Vector3* p, __m128 x, __m128 y, __m128 z) {
+			float* f = &p->x;
+			const __m128 xy = _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 0, 2, 0));
+			const __m128 yz = _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 1, 3, 1));
+			const __m128 zx = _mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 1, 2, 0));
+			_mm_storeu_ps(f + 0, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(2, 0, 2, 0)));
+			_mm_storeu_ps(f + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0)));
+			_mm_storeu_ps(f + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 1, 3, 1)));
+		}
+
+		AE_TARGET("sse2") void sampleRotations_SSE2(const int16* k0, const int16* k1, uint32 stride, float t, Quaternion* out, uint32 count) {
+			const __m128 wa = _mm_set1_ps(1.0f - t), tb = _mm_set1_ps(t), signBit = _mm_set1_ps(-0.0f);
+			for (uint32 j = 0; j < count; j += 4) {
+				const __m128 ax = loadSnorm16_SSE2(k0 + j), ay = loadSnorm16_SSE2(k0 + stride + j);
+				const __m128 az = loadSnorm16_SSE2(k0 + stride * 2 + j), aw = loadSnorm16_SSE2(k0 + stride * 3 + j);
+				const __m128 bx = loadSnorm16_SSE2(k1 + j), by = loadSnorm16_SSE2(k1 + stride + j);
+				const __m128 bz = loadSnorm16_SSE2(k1 + stride * 2 + j), bw = loadSnorm16_SSE2(k1 + stride * 3 + j);
+
+				__m128 d = _mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by));
+				d = _mm_add_ps(d, _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+				const __m128 wb = _mm_xor_ps(tb, _mm_and_ps(d, signBit));
+
+				const __m128 x = _mm_add_ps(_mm_mul_ps(ax, wa), _mm_mul_ps(bx, wb));
+				const __m128 y = _mm_add_ps(_mm_mul_ps(ay, wa), _mm_mul_ps(by, wb));
+				const __m128 z = _mm_add_ps(_mm_mul_ps(az, wa), _mm_mul_ps(bz, wb));
+				const __m128 w = _mm_add_ps(_mm_mul_ps(aw, wa), _mm_mul_ps(bw, wb));
+				__m128 len = _mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+				len = _mm_sqrt_ps(_mm_add_ps(len, _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+				storeQuat_SSE2(out + j, _mm_div_ps(x, len), _mm_div_ps(y, len), _mm_div_ps(z, len), _mm_div_ps(w, len));
+			}
+		}
+
+		AE_TARGET("sse2") void sampleVectors_SSE2(const uint16* k0, const uint16* k1, const float* range, uint32 stride, float t, Vector3* out, uint32 count) {
+			const __m128 vt = _mm_set1_ps(t);
+			for (uint32 j = 0; j < count; j += 4) {
+				__m128 v[3];
+				for (uint32 c = 0; c < 3; c++) {
+					const __m128 a = loadUnorm16_SSE2(k0 + stride * c + j), b = loadUnorm16_SSE2(k1 + stride * c + j);
+					const __m128 key = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), vt));
+					const __m128 lo = _mm_loadu_ps(range + stride * c + j), step = _mm_loadu_ps(range + stride * (3 + c) + j);
+					v[c] = _mm_add_ps(lo, _mm_mul_ps(key, step));
+				}
+				store3_SSE2(out + j, v[0], v[1], v[2]);
+			}
+		}
+
+		AE_TARGET("sse2") inline void load3_SSE2(const Vector3* p, __m128& x, __m128& y, __m128& z) {
+			const float* f = &p->x;
+			const __m128 m0 = _mm_loadu_ps(f + 0); // x0 y0 z0 x1
+			const __m128 m1 = _mm_loadu_ps(f + 4); // y1 z1 x2 y2
+			const __m128 m2 = _mm_loadu_ps(f + 8); // z2 x3 y3 z3
+			const __m128 xy = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+			const __m128 yz = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+			x = _mm_shuffle_ps(m0, xy, _MM_SHUFFLE(2, 0, 3, 0));
+			y = _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 1, 2, 0));
+			z = _mm_shuffle_ps(yz, m2, _MM_SHUFFLE(3, 0, 3, 1));
+		}
+
+		/// Affine3x4::fromTRS() of 4 joints at once, stored to out[0..3].
+		AE_TARGET("sse2") void localMatrices_SSE2(const Pose& pose, uint32 j, Affine3x4* out) {
+			__m128 x = _mm_loadu_ps(&pose.rotations[j + 0].x), y = _mm_loadu_ps(&pose.rotations[j + 1].x);
+			__m128 z = _mm_loadu_ps(&pose.rotations[j + 2].x), w = _mm_loadu_ps(&pose.rotations[j + 3].x);
+			_MM_TRANSPOSE4_PS(x, y, z, w);
+			__m128 px, py, pz, sx, sy, sz;
+			load3_SSE2(&pose.translations[j], px, py, pz);
+			load3_SSE2(&pose.scales[j], sx, sy, sz);
+
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+			const __m128 xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+			const __m128 xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+			const __m128 wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+
+			__m128 r0[4] = {
+				_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx), _mm_mul_ps(_mm_sub_ps(xy, wz), sy),
+				_mm_mul_ps(_mm_add_ps(xz, wy), sz), px
+			};
+			__m128 r1[4] = {
+				_mm_mul_ps(_mm_add_ps(xy, wz), sx), _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy),
+				_mm_mul_ps(_mm_sub_ps(yz, wx), sz), py
+			};
+			__m128 r2[4] = {
+				_mm_mul_ps(_mm_sub_ps(xz, wy), sx), _mm_mul_ps(_mm_add_ps(yz, wx), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz), pz
+			};
+			_MM_TRANSPOSE4_PS(r0[0], r0[1], r0[2], r0[3]);
+			_MM_TRANSPOSE4_PS(r1[0], r1[1], r1[2], r1[3]);
+			_MM_TRANSPOSE4_PS(r2[0], r2[1], r2[2], r2[3]);
+			for (uint32 k = 0; k < 4; k++) {
+				_mm_storeu_ps(&out[k][0].x, r0[k]);
+				_mm_storeu_ps(&out[k][1].x, r1[k]);
+				_mm_storeu_ps(&out[k][2].x, r2[k]);
+			}
+		}
+
+		/// out = a * b, each row of out a combination of the rows of b. out may be a or b.
+		AE_TARGET("sse2") inline void mulAffine_SSE2(const Affine3x4& a, const Affine3x4& b, Affine3x4& out) {
+			const __m128 b0 = _mm_loadu_ps(&b[0].x), b1 = _mm_loadu_ps(&b[1].x), b2 = _mm_loadu_ps(&b[2].x);
+			const __m128 b3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+			const __m128 a0 = _mm_loadu_ps(&a[0].x), a1 = _mm_loadu_ps(&a[1].x), a2 = _mm_loadu_ps(&a[2].x);
+			auto row = [&](__m128 r) {
+				__m128 o = _mm_mul_ps(_mm_shuffle_ps(r, r, 0x00), b0);
+				o = _mm_add_ps(o, _mm_mul_ps(_mm_shuffle_ps(r, r, 0x55), b1));
+				o = _mm_add_ps(o, _mm_mul_ps(_mm_shuffle_ps(r, r, 0xAA), b2));
+				return _mm_add_ps(o, _mm_mul_ps(_mm_shuffle_ps(r, r, 0xFF), b3));
+			};
+			_mm_storeu_ps(&out[0].x, row(a0));
+			_mm_storeu_ps(&out[1].x, row(a1));
+			_mm_storeu_ps(&out[2].x, row(a2));
+		}
+
+		AE_TARGET("sse2") void computeMatrices_SSE2(
+			const Pose& pose, const int32* parents, const Affine3x4* inverseBinds, uint32 count,
+			Affine3x4* model, Affine3x4* palette
+		) {
+			// Local transforms go into model first, then each joint is rebased onto its already final parent.
+			uint32 j = 0;
+			for (; j + 4 <= count; j += 4) localMatrices_SSE2(pose, j, model + j);
+			for (; j < count; j++) model[j] = Affine3x4::fromTRS(pose.translations[j], pose.rotations[j], pose.scales[j]);
+
+			for (j = 0; j < count; j++) {
+				if (parents[j] != Skeleton::NoParent) mulAffine_SSE2(model[parents[j]], model[j], model[j]);
+				if (palette) mulAffine_SSE2(model[j], inverseBinds[j], palette[j]);
+			}
+		}
+
+		// AVX2, 8 joints per iteration. Stores go through the SSE2 helpers, one 128-bit half at a time.
+		AE_TARGET("avx2,fma") inline __m256 loadSnorm16_AVX2(const int16* p) {
+			return _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+		}
+
+		AE_TARGET("avx2,fma") inline __m256 loadUnorm16_AVX2(const uint16* p) {
+			return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))));
+		}
+
+		AE_TARGET("avx2,fma") void sampleRotations_AVX2(const int16* k0, const int16* k1, uint32 stride, float t, Quaternion* out, uint32 count) {
+			const __m256 wa = _mm256_set1_ps(1.0f - t), tb = _mm256_set1_ps(t), signBit = _mm256_set1_ps(-0.0f);
+			for (uint32 j = 0; j < count; j += 8) {
+				const __m256 ax = loadSnorm16_AVX2(k0 + j), ay = loadSnorm16_AVX2(k0 + stride + j);
+				const __m256 az = loadSnorm16_AVX2(k0 + stride * 2 + j), aw = loadSnorm16_AVX2(k0 + stride * 3 + j);
+				const __m256 bx = loadSnorm16_AVX2(k1 + j), by = loadSnorm16_AVX2(k1 + stride + j);
+				const __m256 bz = loadSnorm16_AVX2(k1 + stride * 2 + j), bw = loadSnorm16_AVX2(k1 + stride * 3 + j);
+
+				__m256 d = _mm256_mul_ps(ax, bx);
+				d = _mm256_fmadd_ps(ay, by, d);
+				d = _mm256_fmadd_ps(az, bz, d);
+				d = _mm256_fmadd_ps(aw, bw, d);
+				const __m256 wb = _mm256_xor_ps(tb, _mm256_and_ps(d, signBit));
+
+				__m256 x = _mm256_fmadd_ps(bx, wb, _mm256_mul_ps(ax, wa));
+				__m256 y = _mm256_fmadd_ps(by, wb, _mm256_mul_ps(ay, wa));
+				__m256 z = _mm256_fmadd_ps(bz, wb, _mm256_mul_ps(az, wa));
+				__m256 w = _mm256_fmadd_ps(bw, wb, _mm256_mul_ps(aw, wa));
+				__m256 len = _mm256_mul_ps(x, x);
+				len = _mm256_fmadd_ps(y, y, len);
+				len = _mm256_fmadd_ps(z, z, len);
+				len = _mm256_sqrt_ps(_mm256_fmadd_ps(w, w, len));
+				x = _mm256_div_ps(x, len);
+				y = _mm256_div_ps(y, len);
+				z = _mm256_div_ps(z, len);
+				w = _mm256_div_ps(w, len);
+
+				storeQuat_SSE2(out + j,
+					_mm256_castps256_ps128(x), _mm256_castps256_ps128(y),
+					_mm256_castps256_ps128(z), _mm256_castps256_ps128(w)
+				);
+				storeQuat_SSE2(out + j + 4,
+					_mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1),
+					_mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1)
+				);
+			}
+		}
+
+		AE_TARGET("avx2,fma") void sampleVectors_AVX2(const uint16* k0, const uint16* k1, const float* range, uint32 stride, float t, Vector3* out, uint32 count) {
+			const __m256 vt = _mm256_set1_ps(t);
+			for (uint32 j = 0; j < count; j += 8) {
+				__m256 v[3];
+				for (uint32 c = 0; c < 3; c++) {
+					const __m256 a = loadUnorm16_AVX2(k0 + stride * c + j), b = loadUnorm16_AVX2(k1 + stride * c + j);
+					const __m256 key = _mm256_fmadd_ps(_mm256_sub_ps(b, a), vt, a);
+					const __m256 lo = _mm256_loadu_ps(range + stride * c + j), step = _mm256_loadu_ps(range + stride * (3 + c) + j);
+					v[c] = _mm256_fmadd_ps(key, step, lo);
+				}
+				store3_SSE2(out + j, _mm256_castps256_ps128(v[0]), _mm256_castps256_ps128(v[1]), _mm256_castps256_ps128(v[2]));
+				store3_SSE2(out + j + 4, _mm256_extractf128_ps(v[0], 1), _mm256_extractf128_ps(v[1], 1), _mm256_extractf128_ps(v[2], 1));
+			}
+		}
+#endif
+
+		// count is a multiple of Pose::Lanes, so the SIMD paths have no tail.
+		void sampleRotations(const int16* k0, const int16* k1, uint32 stride, float t, Quaternion* out, uint32 count) {
+#if defined(AE_X86)
+			if (simd::level() >= SimdLevel::AVX2) return sampleRotations_AVX2(k0, k1, stride, t, out, count);
+			if (simd::level() >= SimdLevel::SSE2) return sampleRotations_SSE2(k0, k1, stride, t, out, count);
+#endif
+			sampleRotationsScalar(k0, k1, stride, t, out, count);
+		}
+
+		void sampleVectors(const uint16* k0, const uint16* k1, const float* range, uint32 stride, float t, Vector3* out, uint32 count) {
+#if defined(AE_X86)
+			if (simd::level() >= SimdLevel::AVX2) return sampleVectors_AVX2(k0, k1, range, stride, t, out, count);
+			if (simd::level() >= SimdLevel::SSE2) return sampleVectors_SSE2(k0, k1, range, stride, t, out, count);
+#endif
+			sampleVectorsScalar(k0, k1, range, stride, t, out, count);
+		}
+
+		/// Quantizes one Vector3 track per joint: fills range (min, then step) and the keys of every frame.
+		/// Padding joints decode to padding.
+		void quantizeVectors(
+			const std::vector<Pose>& frames, std::vector<Vector3> Pose::* track, uint32 joints, uint32 stride,
+			float padding, std::vector<float>& range, std::vector<uint16>& keys
+		) {
+			range.assign(stride * 6, 0.0f);
+			for (uint32 c = 0; c < 3; c++) std::fill_n(range.begin() + stride * c + joints, stride - joints, padding);
+			keys.assign(size_t(stride) * 3 * frames.size(), 0);
+			for (uint32 j = 0; j < joints; j++) {
+				for (uint32 c = 0; c < 3; c++) {
+					float lo = 1e30f, hi = -1e30f;
+					for (const Pose& f : frames) {
+						const float v = (&(f.*track)[j].x)[c];
+						lo = std::min(lo, v);
+						hi = std::max(hi, v);
+					}
+					const float step = (hi - lo) / Unorm16;
+					range[stride * c + j] = lo;
+					range[stride * (3 + c) + j] = step;
+					if (step == 0.0f) continue;
+
+					for (size_t i = 0; i < frames.size(); i++) {
+						const float v = (&(frames[i].*track)[j].x)[c];
+						keys[stride * (i * 3 + c) + j] = uint16(std::lround(std::min((v - lo) / step, Unorm16)));
+					}
+				}
+			}
+		}
+	}
+
+	void Pose::resize(uint32 joints) {
+		const uint32 padded = (joints + Lanes - 1) / Lanes * Lanes;
+		rotations.resize(padded, Quaternion());
+		translations.resize(padded, Vector3(0.0f));
+		scales.resize(padded, Vector3(1.0f));
+		for (uint32 j = joints; j < padded; j++) {
+			rotations[j] = Quaternion();
+			translations[j] = Vector3(0.0f);
+			scales[j] = Vector3(1.0f);
+		}
+		jointCount = joints;
+	}
+
+	void blendPoses(const Pose& a, const Pose& b, float weight, Pose& out) {
+		Log.assert(a.jointCount == b.jointCount, "Blended poses need the same joints.");
+		out.resize(a.jointCount);
+
+		// Poses can be far apart, unlike neighbouring keyframes, so rotations keep slerp's constant speed.
+		const size_t n = a.rotations.size();
+		slerpMany(a.rotations.data(), b.rotations.data(), weight, out.rotations.data(), n);
+		for (size_t j = 0; j < n; j++) {
+			out.translations[j] = a.translations[j].lerp(b.translations[j], weight);
+			out.scales[j] = a.scales[j].lerp(b.scales[j], weight);
+		}
+	}
+
+	uint32 Skeleton::addJoint(
+		const std::string& name, int32 parent, const Vector3& position, const Quaternion& rotation, const Vector3& scale
+	) {
+		const uint32 index = jointCount();
+		Log.assert(parent >= NoParent && parent < int32(index), "A joint's parent has to be added before it.");
+
+		m_names.push_back(name);
+		m_parents.push_back(parent);
+		m_bindPose.resize(index + 1);
+		m_bindPose.rotations[index] = rotation;
+		m_bindPose.translations[index] = position;
+		m_bindPose.scales[index] = scale;
+
+		const Affine3x4 local = Affine3x4::fromTRS(position, rotation, scale);
+		m_bindModel.push_back(parent == NoParent ? local : m_bindModel[parent] * local);
+		m_inverseBinds.push_back(m_bindModel.back().inverse());
+		return index;
+	}
+
+	int32 Skeleton::find(const std::string& name) const {
+		const auto it = std::find(m_names.begin(), m_names.end(), name);
+		return it == m_names.end() ? -1 : int32(it - m_names.begin());
+	}
+
+	void Skeleton::computeMatrices(const Pose& pose, Affine3x4* model, Affine3x4* palette) const {
+		Log.assert(pose.jointCount == jointCount(), "The pose doesn't belong to this skeleton.");
+
+#if defined(AE_X86)
+		if (simd::level() >= SimdLevel::SSE2) {
+			return computeMatrices_SSE2(pose, m_parents.data(), m_inverseBinds.data(), jointCount(), model, palette);
+		}
+#endif
+		// Parents precede their children, their model transform is always ready.
+		for (uint32 j = 0; j < jointCount(); j++) {
+			const Affine3x4 local = Affine3x4::fromTRS(pose.translations[j], pose.rotations[j], pose.scales[j]);
+			model[j] = m_parents[j] == NoParent ? local : model[m_parents[j]] * local;
+			if (palette) palette[j] = model[j] * m_inverseBinds[j];
+		}
+	}
+
+	void AnimationClip::build(const std::vector<Pose>& frames, float sampleRate) {
+		Log.assert(sampleRate > 0.0f, "The sample rate has to be positive.");
+		m_frames = uint32(frames.size());
+		m_joints = frames.empty() ? 0 : frames[0].jointCount;
+		m_stride = (m_joints + Pose::Lanes - 1) / Pose::Lanes * Pose::Lanes;
+		m_rate = sampleRate;
+		for (const Pose& f : frames) {
+			Log.assert(f.jointCount == m_joints, "Every frame of a clip needs the same joints.");
+		}
+
+		// Successive keys of a joint stay in the same hemisphere, so interpolating them rarely needs to flip one.
+		m_rotations.assign(size_t(m_stride) * 4 * m_frames, 0);
+		for (uint32 j = 0; j < m_stride; j++) {
+			Quaternion previous{};
+			for (uint32 i = 0; i < m_frames; i++) {
+				Quaternion q = j < m_joints ? frames[i].rotations[j].normalized() : Quaternion();
+				if (previous.dot(q) < 0.0f) q = q * -1.0f;
+				previous = q;
+
+				int16* keys = m_rotations.data() + size_t(m_stride) * 4 * i;
+				const float c[4] = { q.x, q.y, q.z, q.w };
+				for (uint32 k = 0; k < 4; k++) keys[m_stride * k + j] = int16(std::lround(c[k] * Snorm16));
+			}
+		}
+
+		quantizeVectors(frames, &Pose::translations, m_joints, m_stride, 0.0f, m_translationRange, m_translations);
+
+		bool scaled = false;
+		for (const Pose& f : frames) {
+			for (uint32 j = 0; j < m_joints; j++) {
+				const Vector3 d = f.scales[j] - Vector3(1.0f);
+				scaled |= std::abs(d.x) > 1e-5f || std::abs(d.y) > 1e-5f || std::abs(d.z) > 1e-5f;
+			}
+		}
+		if (scaled) {
+			quantizeVectors(frames, &Pose::scales, m_joints, m_stride, 1.0f, m_scaleRange, m_scales);
+		} else {
+			m_scaleRange.clear();
+			m_scales.clear();
+		}
+
+		Log.info(
+			"Animation: " + std::to_string(m_joints) + " joints, " + std::to_string(m_frames) + " frames, " +
+			std::to_string(memoryUsage() / 1024) + " KB (" +
+			std::to_string(size_t(m_joints) * m_frames * 40 / 1024) + " KB uncompressed)"
+		);
+	}
+
+	void AnimationClip::sample(float time, bool loop, Pose& out) const {
+		out.resize(m_joints);
+		if (m_frames == 0) return;
+
+		float f = time * m_rate;
+		const float last = float(m_frames - 1);
+		if (loop && last > 0.0f) {
+			f = std::fmod(f, last);
+			if (f < 0.0f) f += last;
+		} else {
+			f = std::min(std::max(f, 0.0f), last);
+		}
+		const uint32 i0 = std::min(uint32(f), m_frames - 1), i1 = std::min(i0 + 1, m_frames - 1);
+		const float t = f - float(i0);
+
+		sampleRotations(
+			m_rotations.data() + size_t(m_stride) * 4 * i0, m_rotations.data() + size_t(m_stride) * 4 * i1,
+			m_stride, t, out.rotations.data(), m_stride
+		);
+		sampleVectors(
+			m_translations.data() + size_t(m_stride) * 3 * i0, m_translations.data() + size_t(m_stride) * 3 * i1,
+			m_translationRange.data(), m_stride, t, out.translations.data(), m_stride
+		);
+		if (m_scales.empty()) {
+			std::fill(out.scales.begin(), out.scales.end(), Vector3(1.0f));
+		} else {
+			sampleVectors(
+				m_scales.data() + size_t(m_stride) * 3 * i0, m_scales.data() + size_t(m_stride) * 3 * i1,
+				m_scaleRange.data(), m_stride, t, out.scales.data(), m_stride
+			);
+		}
+	}
+
+	size_t AnimationClip::memoryUsage() const {
+		return m_rotations.size() * sizeof(int16) + (m_translations.size() + m_scales.size()) * sizeof(uint16) +
+			(m_translationRange.size() + m_scaleRange.size()) * sizeof(float);
+	}
+
+	void AnimatorComponent::skeleton(const Skeleton* skeleton) {
+		m_skeleton = skeleton;
+		m_clip = m_previous = nullptr;
+		if (m_skeleton == nullptr) {
+			m_palette.clear();
+			return;
+		}
+		m_pose = m_skeleton->bindPose();
+		m_model.resize(m_skeleton->jointCount());
+		m_palette.resize(m_skeleton->jointCount());
+		m_skeleton->computeMatrices(m_pose, m_model.data(), m_palette.data());
+		m_jointBounds = AABB::empty();
+		for (const Affine3x4& m : m_model) m_jointBounds.expand(Vector3(m[0].w, m[1].w, m[2].w));
+	}
+
+	AABB AnimatorComponent::bounds() const {
+		if (!m_jointBounds.valid()) return m_jointBounds;
+		return AABB(m_jointBounds.min - Vector3(m_boundsMargin), m_jointBounds.max + Vector3(m_boundsMargin));
+	}
+
+	void AnimatorComponent::play(const AnimationClip* clip, float fadeTime, bool loop) {
+		Log.assert(
+			clip == nullptr || m_skeleton == nullptr || clip->jointCount() == m_skeleton->jointCount(),
+			"The clip animates a different skeleton."
+		);
+		if (fadeTime > 0.0f && m_clip != nullptr) {
+			m_previous = m_clip;
+			m_previousTime = m_time;
+			m_previousLoop = m_loop;
+			m_fade = 0.0f;
+			m_fadeTime = fadeTime;
+		} else {
+			m_previous = nullptr;
+		}
+		m_clip = clip;
+		m_time = 0.0f;
+		m_loop = loop;
+	}
+
+	void AnimatorComponent::advance(float dt) {
+		if (m_skeleton == nullptr) return;
+
+		// Looping clips wrap the clock, so it doesn't lose precision over a long session.
+		auto step = [&](const AnimationClip* clip, float& time, bool loop) {
+			time += dt * m_speed;
+			if (loop && clip->duration() > 0.0f) time = std::fmod(time, clip->duration());
+		};
+
+		if (m_clip != nullptr) {
+			step(m_clip, m_time, m_loop);
+			m_clip->sample(m_time, m_loop, m_pose);
+		} else {
+			m_pose = m_skeleton->bindPose();
+		}
+
+		if (m_previous != nullptr) {
+			m_fade += dt;
+			if (m_fade >= m_fadeTime) {
+				m_previous = nullptr;
+			} else {
+				step(m_previous, m_previousTime, m_previousLoop);
+				m_previous->sample(m_previousTime, m_previousLoop, m_fadePose);
+				blendPoses(m_fadePose, m_pose, m_fade / m_fadeTime, m_pose);
+			}
+		}
+
+		m_model.resize(m_skeleton->jointCount());
+		m_palette.resize(m_skeleton->jointCount());
+		m_skeleton->computeMatrices(m_pose, m_model.data(), m_palette.data());
+
+		m_jointBounds = AABB::empty();
+		for (const Affine3x4& m : m_model) m_jointBounds.expand(Vector3(m[0].w, m[1].w, m[2].w));
+	}
+
+	void updateAnimators(EntityWorld* world, float dt) {
+		std::vector<AnimatorComponent*> animators;
+		world->each([&](Entity*, AnimatorComponent* anim) {
+			animators.push_back(anim);
+		});
+
+		util::parallelFor(animators.size(), util::parallelRanges(animators.size(), 16), [&](size_t begin, size_t end, size_t) {
+			for (size_t i = begin; i < end; i++) animators[i]->advance(dt);
+		});
+	}
+}
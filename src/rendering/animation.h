@@ -0,0 +1,145 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+#include "game_logic.h"
+
+#include <string>
+#include <vector>
+
+namespace ae {
+	/// Local transforms of a skeleton's joints, relative to their parents. The arrays are padded to a multiple of
+	/// Pose::Lanes joints so the SIMD kernels never need a scalar tail.
+	struct Pose {
+		static constexpr uint32 Lanes = 8;
+
+		std::vector<Quaternion> rotations;
+		std::vector<Vector3> translations, scales;
+		uint32 jointCount{ 0 };
+
+		/// Padding joints are identity transforms.
+		void resize(uint32 joints);
+	};
+
+	/// Interpolates every joint from a towards b by weight, rotations along the shortest arc. out may be a or b.
+	void blendPoses(const Pose& a, const Pose& b, float weight, Pose& out);
+
+	/// Joint hierarchy and bind pose. Parents always come before their children, which lets a single forward
+	/// pass over the joints turn local transforms into model space ones.
+	class Skeleton {
+	public:
+		static constexpr int32 NoParent = -1;
+
+		/// Appends a joint, parent has to be added already. The bind pose is relative to the parent, the inverse
+		/// bind matrix is derived from it until set with inverseBind(). Returns the joint index.
+		uint32 addJoint(
+			const std::string& name, int32 parent, const Vector3& position = Vector3(0.0f),
+			const Quaternion& rotation = Quaternion(), const Vector3& scale = Vector3(1.0f)
+		);
+
+		/// Model space to joint space in the bind pose, e.g. taken from a file instead of the bind pose.
+		const Affine3x4& inverseBind(uint32 joint) const { return m_inverseBinds[joint]; }
+		void inverseBind(uint32 joint, const Affine3x4& m) { m_inverseBinds[joint] = m; }
+
+		uint32 jointCount() const { return uint32(m_parents.size()); }
+		int32 parent(uint32 joint) const { return m_parents[joint]; }
+		const std::string& name(uint32 joint) const { return m_names[joint]; }
+
+		/// Index of the joint called name, -1 if there is none.
+		int32 find(const std::string& name) const;
+
+		const Pose& bindPose() const { return m_bindPose; }
+
+		/// Model space transforms of pose into model and skinning matrices (model * inverse bind) into palette,
+		/// jointCount() of each. palette may be nullptr.
+		void computeMatrices(const Pose& pose, Affine3x4* model, Affine3x4* palette) const;
+
+	private:
+		std::vector<std::string> m_names;
+		std::vector<int32> m_parents;
+		std::vector<Affine3x4> m_bindModel, m_inverseBinds;
+		Pose m_bindPose{};
+	};
+
+	/// Keyframes of every joint resampled at a fixed rate and quantized. Each frame is a set of SoA arrays:
+	/// rotations as four snorm16 arrays (x, y, z, w), translations and scales as three unorm16 arrays within the
+	/// range each joint covers over the clip. 20 bytes per joint and frame, 14 without scale, instead of 40.
+	class AnimationClip {
+	public:
+		/// Compresses frames, poses of the same joints taken every 1 / sampleRate seconds.
+		void build(const std::vector<Pose>& frames, float sampleRate);
+
+		/// The pose at time seconds, wrapped when looping, clamped to the clip otherwise.
+		/// Interpolates between the two nearest frames, out is resized to the joints of the clip.
+		void sample(float time, bool loop, Pose& out) const;
+
+		float duration() const { return m_frames > 1 ? float(m_frames - 1) / m_rate : 0.0f; }
+		uint32 frameCount() const { return m_frames; }
+		uint32 jointCount() const { return m_joints; }
+		float sampleRate() const { return m_rate; }
+
+		/// Bytes of keyframe data.
+		size_t memoryUsage() const;
+
+	private:
+		uint32 m_joints{ 0 }, m_stride{ 0 }, m_frames{ 0 }; // m_stride is m_joints padded to Pose::Lanes
+		float m_rate{ 30.0f };
+
+		std::vector<int16> m_rotations; // 4 * m_stride per frame
+		std::vector<uint16> m_translations, m_scales; // 3 * m_stride per frame, no scales if all of them are 1
+
+		/// Per joint minimum (3 * m_stride) then quantization step (3 * m_stride) of each component.
+		std::vector<float> m_translationRange, m_scaleRange;
+	};
+
+	/// Plays an AnimationClip on a Skeleton and keeps the skinning matrices the renderer uploads for the
+	/// entity's mesh, see Mesh::skin(). Animators are advanced by updateAnimators().
+	class AnimatorComponent : public Component {
+		friend class Renderer;
+	public:
+		const Skeleton* skeleton() const { return m_skeleton; }
+		void skeleton(const Skeleton* skeleton);
+
+		/// Starts clip from the beginning, cross-fading from the current one over fadeTime seconds.
+		void play(const AnimationClip* clip, float fadeTime = 0.0f, bool loop = true);
+
+		const AnimationClip* clip() const { return m_clip; }
+		float time() const { return m_time; }
+
+		/// Playback rate, 1 is real time.
+		float speed() const { return m_speed; }
+		void speed(float v) { m_speed = v; }
+
+		/// Advances the clips by dt seconds and recomputes the palette.
+		void advance(float dt);
+
+		/// Skinning matrices of the last advance(), one per joint.
+		const std::vector<Affine3x4>& palette() const { return m_palette; }
+
+		/// Model space bounds of the joints in the last advance(), grown by boundsMargin().
+		AABB bounds() const;
+
+		/// How far the skin reaches past the joints, in model units. The renderer culls skinned meshes with
+		/// their bind pose bounds merged with bounds().
+		float boundsMargin() const { return m_boundsMargin; }
+		void boundsMargin(float v) { m_boundsMargin = v; }
+
+	private:
+		const Skeleton* m_skeleton{ nullptr };
+		const AnimationClip *m_clip{ nullptr }, *m_previous{ nullptr };
+		float m_time{ 0.0f }, m_previousTime{ 0.0f }, m_speed{ 1.0f };
+		float m_fade{ 0.0f }, m_fadeTime{ 0.0f }, m_boundsMargin{ 0.1f };
+		bool m_loop{ true }, m_previousLoop{ true };
+
+		Pose m_pose{}, m_fadePose{};
+		std::vector<Affine3x4> m_model, m_palette;
+		AABB m_jointBounds{ AABB::empty() };
+		uint32 m_paletteOffset{ 0 }; // In joints, within the renderer's palette buffer
+	};
+
+	/// Advances every AnimatorComponent of world, spread over the cores.
+	void updateAnimators(EntityWorld* world, float dt);
+}
+
+#endif // ANIMATION_H
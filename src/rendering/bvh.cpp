@@ -0,0 +1,548 @@
+#include "bvh.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace {
+		constexpr uint32 BinCount = 16;
+
+		// Deeper than this the builder splits at the median, which bounds the traversal stacks.
+		constexpr uint32 MaxSahDepth = 48;
+
+		inline float axis(const Vector3& v, uint32 a) { return (&v.x)[a]; }
+
+		/// Binary tree the SAH build produces before it is collapsed into 4-wide nodes.
+		struct BuildNode {
+			AABB bounds;
+			uint32 left{ 0 }, right{ 0 };
+			uint32 first{ 0 }, count{ 0 }; // Leaf when count > 0
+		};
+
+		struct Builder {
+			const AABB* boxes;
+			std::vector<Vector3> centers;
+			std::vector<uint32> order;
+			std::vector<BuildNode> nodes;
+
+			uint32 split(uint32 first, uint32 count, uint32 depth) {
+				const uint32 index = uint32(nodes.size());
+				nodes.emplace_back();
+
+				AABB bounds = AABB::empty(), centerBounds = AABB::empty();
+				for (uint32 i = first; i < first + count; i++) {
+					bounds.expand(boxes[order[i]]);
+					centerBounds.expand(centers[order[i]]);
+				}
+				nodes[index].bounds = bounds;
+				if (count <= bvh::Width) {
+					nodes[index].first = first;
+					nodes[index].count = count;
+					return index;
+				}
+
+				struct Bin {
+					AABB bounds = AABB::empty();
+					uint32 count = 0;
+				};
+
+				uint32 bestAxis = 3, bestBin = 0;
+				float bestCost = INFINITY;
+				const Vector3 extent = centerBounds.size();
+				for (uint32 a = 0; a < 3 && depth < MaxSahDepth; a++) {
+					if (axis(extent, a) <= 0.0f) continue;
+
+					Bin bins[BinCount];
+					const float scale = float(BinCount) / axis(extent, a);
+					for (uint32 i = first; i < first + count; i++) {
+						const uint32 b = std::min(uint32((axis(centers[order[i]], a) - axis(centerBounds.min, a)) * scale), BinCount - 1);
+						bins[b].bounds.expand(boxes[order[i]]);
+						bins[b].count++;
+					}
+
+					// Cost of splitting after bin i: area times count on both sides.
+					float leftCost[BinCount - 1];
+					AABB acc = AABB::empty();
+					uint32 n = 0;
+					for (uint32 i = 0; i + 1 < BinCount; i++) {
+						acc.expand(bins[i].bounds);
+						n += bins[i].count;
+						leftCost[i] = n == 0 ? INFINITY : acc.surfaceArea() * float(n);
+					}
+					acc = AABB::empty();
+					n = 0;
+					for (uint32 i = BinCount - 1; i > 0; i--) {
+						acc.expand(bins[i].bounds);
+						n += bins[i].count;
+						const float cost = n == 0 ? INFINITY : leftCost[i - 1] + acc.surfaceArea() * float(n);
+						if (cost < bestCost) {
+							bestCost = cost;
+							bestAxis = a;
+							bestBin = i - 1;
+						}
+					}
+				}
+
+				uint32 mid = first + count / 2;
+				if (bestAxis < 3) {
+					const float scale = float(BinCount) / axis(extent, bestAxis);
+					const float origin = axis(centerBounds.min, bestAxis);
+					const auto it = std::partition(order.begin() + first, order.begin() + first + count, [&](uint32 i) {
+						return std::min(uint32((axis(centers[i], bestAxis) - origin) * scale), BinCount - 1) <= bestBin;
+					});
+					mid = uint32(it - order.begin());
+				} else {
+					// All centers in one spot or too deep, any even split is as good as another.
+					const uint32 a = axis(extent, 0) >= axis(extent, 1) && axis(extent, 0) >= axis(extent, 2) ? 0 : (axis(extent, 1) >= axis(extent, 2) ? 1 : 2);
+					std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count, [&](uint32 l, uint32 r) {
+						return axis(centers[l], a) < axis(centers[r], a);
+					});
+				}
+
+				const uint32 left = split(first, mid - first, depth + 1);
+				const uint32 right = split(mid, first + count - mid, depth + 1);
+				nodes[index].left = left;
+				nodes[index].right = right;
+				return index;
+			}
+
+			/// Pulls grandchildren up until a node has Width children, largest boxes first.
+			uint32 collapse(uint32 binary, std::vector<bvh::Node>& out, std::vector<uint32>& items) const {
+				uint32 kids[bvh::Width], n = 0;
+				if (nodes[binary].count > 0) {
+					kids[n++] = binary;
+				} else {
+					kids[n++] = nodes[binary].left;
+					kids[n++] = nodes[binary].right;
+					while (n < bvh::Width) {
+						int32 widest = -1;
+						float area = -1.0f;
+						for (uint32 i = 0; i < n; i++) {
+							if (nodes[kids[i]].count == 0 && nodes[kids[i]].bounds.surfaceArea() > area) {
+								widest = int32(i);
+								area = nodes[kids[i]].bounds.surfaceArea();
+							}
+						}
+						if (widest < 0) break;
+						const BuildNode& w = nodes[kids[widest]];
+						kids[widest] = w.left;
+						kids[n++] = w.right;
+					}
+				}
+
+				const uint32 index = uint32(out.size());
+				out.emplace_back();
+				for (uint32 i = 0; i < bvh::Width; i++) {
+					if (i >= n) {
+						out[index].child[i] = bvh::Empty;
+						out[index].bounds(i, AABB(Vector3(0.0f), Vector3(0.0f)));
+						continue;
+					}
+
+					const BuildNode& k = nodes[kids[i]];
+					out[index].bounds(i, k.bounds);
+					if (k.count > 0) {
+						const uint32 leaf = uint32(items.size() / bvh::Width);
+						items.insert(items.end(), order.begin() + k.first, order.begin() + k.first + k.count);
+						items.resize(items.size() + bvh::Width - k.count, bvh::Empty);
+						out[index].child[i] = bvh::LeafBit | leaf;
+					} else {
+						const uint32 child = collapse(kids[i], out, items);
+						out[index].child[i] = child;
+					}
+				}
+				return index;
+			}
+		};
+
+		uint32 intersectNodeScalar(const bvh::Node& node, const bvh::RayData& ray, float tmax, float radius, float tnear[bvh::Width]) {
+			uint32 mask = 0;
+			const Vector3& o = ray.origin;
+			const Vector3& inv = ray.invDirection;
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				const float x0 = (node.minX[i] - radius - o.x) * inv.x, x1 = (node.maxX[i] + radius - o.x) * inv.x;
+				const float y0 = (node.minY[i] - radius - o.y) * inv.y, y1 = (node.maxY[i] + radius - o.y) * inv.y;
+				const float z0 = (node.minZ[i] - radius - o.z) * inv.z, z1 = (node.maxZ[i] + radius - o.z) * inv.z;
+				const float t0 = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+				const float t1 = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), tmax));
+				tnear[i] = t0;
+				if (t0 <= t1) mask |= 1u << i;
+			}
+			return mask;
+		}
+
+		uint32 intersectTrianglesScalar(
+			const bvh::TrianglePacket& p, const bvh::RayData& ray, float tmax, float t[bvh::Width], float u[bvh::Width], float v[bvh::Width]
+		) {
+			uint32 mask = 0;
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				const Vector3 v0(p.v0[0][i], p.v0[1][i], p.v0[2][i]);
+				const Vector3 e1(p.e1[0][i], p.e1[1][i], p.e1[2][i]);
+				const Vector3 e2(p.e2[0][i], p.e2[1][i], p.e2[2][i]);
+
+				// Moller-Trumbore, without back face culling.
+				const Vector3 pv = ray.direction.cross(e2);
+				const float det = e1.dot(pv);
+				if (det == 0.0f) continue;
+				const float invDet = 1.0f / det;
+				const Vector3 tv = ray.origin - v0;
+				u[i] = tv.dot(pv) * invDet;
+				const Vector3 qv = tv.cross(e1);
+				v[i] = ray.direction.dot(qv) * invDet;
+				t[i] = e2.dot(qv) * invDet;
+				if (u[i] >= 0.0f && v[i] >= 0.0f && u[i] + v[i] <= 1.0f && t[i] >= 0.0f && t[i] <= tmax) mask |= 1u << i;
+			}
+			return mask;
+		}
+
+#if defined(AE_X86)
+		AE_TARGET("sse2") uint32 intersectNode_SSE2(const bvh::Node& node, const bvh::RayData& ray, float tmax, float radius, float tnear[bvh::Width]) {
+			const __m128 r = _mm_set1_ps(radius);
+			const __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+			const __m128 ix = _mm_set1_ps(ray.invDirection.x), iy = _mm_set1_ps(ray.invDirection.y), iz = _mm_set1_ps(ray.invDirection.z);
+
+			const __m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), r), ox), ix);
+			const __m128 x1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(node.maxX), r), ox), ix);
+			const __m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), r), oy), iy);
+			const __m128 y1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(node.maxY), r), oy), iy);
+			const __m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), r), oz), iz);
+			const __m128 z1 = _mm_mul_ps(_mm_sub_ps(_mm_add_ps(_mm_loadu_ps(node.maxZ), r), oz), iz);
+
+			const __m128 t0 = _mm_max_ps(
+				_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps())
+			);
+			const __m128 t1 = _mm_min_ps(
+				_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(tmax))
+			);
+			_mm_storeu_ps(tnear, t0);
+			return uint32(_mm_movemask_ps(_mm_cmple_ps(t0, t1)));
+		}
+
+		AE_TARGET("sse2") inline void cross_SSE2(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz, __m128& x, __m128& y, __m128& z) {
+			x = _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by));
+			y = _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz));
+			z = _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx));
+		}
+
+		AE_TARGET("sse2") inline __m128 dot_SSE2(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz) {
+			return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+		}
+
+		AE_TARGET("sse2") uint32 intersectTriangles_SSE2(
+			const bvh::TrianglePacket& p, const bvh::RayData& ray, float tmax, float t[bvh::Width], float u[bvh::Width], float v[bvh::Width]
+		) {
+			const __m128 dx = _mm_set1_ps(ray.direction.x), dy = _mm_set1_ps(ray.direction.y), dz = _mm_set1_ps(ray.direction.z);
+			const __m128 e1x = _mm_loadu_ps(p.e1[0]), e1y = _mm_loadu_ps(p.e1[1]), e1z = _mm_loadu_ps(p.e1[2]);
+			const __m128 e2x = _mm_loadu_ps(p.e2[0]), e2y = _mm_loadu_ps(p.e2[1]), e2z = _mm_loadu_ps(p.e2[2]);
+
+			__m128 px, py, pz;
+			cross_SSE2(dx, dy, dz, e2x, e2y, e2z, px, py, pz);
+			const __m128 det = dot_SSE2(e1x, e1y, e1z, px, py, pz);
+			const __m128 invDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+
+			const __m128 tx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_loadu_ps(p.v0[0]));
+			const __m128 ty = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_loadu_ps(p.v0[1]));
+			const __m128 tz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_loadu_ps(p.v0[2]));
+			const __m128 uu = _mm_mul_ps(dot_SSE2(tx, ty, tz, px, py, pz), invDet);
+
+			__m128 qx, qy, qz;
+			cross_SSE2(tx, ty, tz, e1x, e1y, e1z, qx, qy, qz);
+			const __m128 vv = _mm_mul_ps(dot_SSE2(dx, dy, dz, qx, qy, qz), invDet);
+			const __m128 tt = _mm_mul_ps(dot_SSE2(e2x, e2y, e2z, qx, qy, qz), invDet);
+
+			// NaNs from a zero determinant fail every comparison.
+			const __m128 zero = _mm_setzero_ps();
+			__m128 hit = _mm_cmpneq_ps(det, zero);
+			hit = _mm_and_ps(hit, _mm_cmpge_ps(uu, zero));
+			hit = _mm_and_ps(hit, _mm_cmpge_ps(vv, zero));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(uu, vv), _mm_set1_ps(1.0f)));
+			hit = _mm_and_ps(hit, _mm_cmpge_ps(tt, zero));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(tt, _mm_set1_ps(tmax)));
+
+			_mm_storeu_ps(t, tt);
+			_mm_storeu_ps(u, uu);
+			_mm_storeu_ps(v, vv);
+			return uint32(_mm_movemask_ps(hit));
+		}
+#endif
+
+		/// Closest point to p on triangle abc (Ericson, Real-Time Collision Detection 5.1.5).
+		Vector3 closestPoint(const Vector3& p, const Vector3& a, const Vector3& b, const Vector3& c) {
+			const Vector3 ab = b - a, ac = c - a, ap = p - a;
+			const float d1 = ab.dot(ap), d2 = ac.dot(ap);
+			if (d1 <= 0.0f && d2 <= 0.0f) return a;
+
+			const Vector3 bp = p - b;
+			const float d3 = ab.dot(bp), d4 = ac.dot(bp);
+			if (d3 >= 0.0f && d4 <= d3) return b;
+
+			const float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) return a + ab * (d1 / (d1 - d3));
+
+			const Vector3 cp = p - c;
+			const float d5 = ab.dot(cp), d6 = ac.dot(cp);
+			if (d6 >= 0.0f && d5 <= d6) return c;
+
+			const float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) return a + ac * (d2 / (d2 - d6));
+
+			const float va = d3 * d6 - d5 * d4;
+			if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+			const float denom = 1.0f / (va + vb + vc);
+			return a + ab * (vb * denom) + ac * (vc * denom);
+		}
+
+		/// Entry distance of a ray into a sphere it starts outside of.
+		bool raySphere(const Vector3& o, const Vector3& d, const Vector3& center, float radius, float tmax, float& t) {
+			const Vector3 m = o - center;
+			const float a = d.dot(d), b = m.dot(d), c = m.dot(m) - radius * radius;
+			if (b > 0.0f) return false;
+			const float disc = b * b - a * c;
+			if (disc < 0.0f) return false;
+			const float tt = (-b - std::sqrt(disc)) / a;
+			if (tt < 0.0f || tt > tmax) return false;
+			t = tt;
+			return true;
+		}
+
+		/// Entry distance of a ray into the side of the cylinder around segment pq (Ericson 5.3.7).
+		bool rayCylinder(const Vector3& o, const Vector3& d, const Vector3& p, const Vector3& q, float radius, float tmax, float& t) {
+			const Vector3 e = q - p, m = o - p;
+			const float dd = e.dot(e), md = m.dot(e), nd = d.dot(e), nn = d.dot(d), mn = m.dot(d);
+			const float a = dd * nn - nd * nd;
+			if (a <= 1e-12f * dd * nn) return false; // Parallel, the end spheres catch it
+
+			const float k = m.dot(m) - radius * radius, c = dd * k - md * md, b = dd * mn - nd * md;
+			const float disc = b * b - a * c;
+			if (disc < 0.0f) return false;
+			const float tt = (-b - std::sqrt(disc)) / a;
+			if (tt < 0.0f || tt > tmax) return false;
+
+			const float s = md + tt * nd;
+			if (s < 0.0f || s > dd) return false;
+			t = tt;
+			return true;
+		}
+
+		/// First contact of a moving sphere with triangle abc: the face, then its edges and corners.
+		bool sweepTriangle(const Vector3& o, const Vector3& d, float radius, const Vector3& a, const Vector3& b, const Vector3& c, float tmax, float& t) {
+			const Vector3 q = closestPoint(o, a, b, c);
+			if ((o - q).dot(o - q) <= radius * radius) {
+				t = 0.0f;
+				return true;
+			}
+
+			Vector3 n = (b - a).cross(c - a);
+			const float len = n.length();
+			if (len > 0.0f) {
+				n = n / len;
+				float dist = (o - a).dot(n), rate = n.dot(d);
+				if (dist < 0.0f) {
+					dist = -dist;
+					rate = -rate;
+					n = n * -1.0f;
+				}
+
+				// Nothing can touch before the sphere reaches the plane, so a contact inside the face comes first.
+				if (dist > radius && rate < 0.0f) {
+					const float tt = (radius - dist) / rate;
+					if (tt > tmax) return false;
+
+					const Vector3 p = o + d * tt - n * radius;
+					const Vector3 v0 = b - a, v1 = c - a, v2 = p - a;
+					const float d00 = v0.dot(v0), d01 = v0.dot(v1), d11 = v1.dot(v1), d20 = v2.dot(v0), d21 = v2.dot(v1);
+					const float den = d00 * d11 - d01 * d01;
+					const float bv = (d11 * d20 - d01 * d21) / den, bw = (d00 * d21 - d01 * d20) / den;
+					if (bv >= 0.0f && bw >= 0.0f && bv + bw <= 1.0f) {
+						t = tt;
+						return true;
+					}
+				}
+			}
+
+			bool hit = false;
+			float best = tmax, tt;
+			const Vector3* corners[3] = { &a, &b, &c };
+			for (uint32 i = 0; i < 3; i++) {
+				if (raySphere(o, d, *corners[i], radius, best, tt)) {
+					best = tt;
+					hit = true;
+				}
+				if (rayCylinder(o, d, *corners[i], *corners[(i + 1) % 3], radius, best, tt)) {
+					best = tt;
+					hit = true;
+				}
+			}
+			t = best;
+			return hit;
+		}
+	}
+
+	namespace bvh {
+		AABB Node::bounds(uint32 slot) const {
+			return AABB(Vector3(minX[slot], minY[slot], minZ[slot]), Vector3(maxX[slot], maxY[slot], maxZ[slot]));
+		}
+
+		void Node::bounds(uint32 slot, const AABB& b) {
+			minX[slot] = b.min.x; minY[slot] = b.min.y; minZ[slot] = b.min.z;
+			maxX[slot] = b.max.x; maxY[slot] = b.max.y; maxZ[slot] = b.max.z;
+		}
+
+		RayData::RayData(const Ray& ray)
+			: origin(ray.origin), direction(ray.direction), invDirection(Vector3(1.0f) / ray.direction) {}
+
+		void build(const AABB* boxes, size_t count, std::vector<Node>& nodes, std::vector<uint32>& items) {
+			nodes.clear();
+			items.clear();
+			if (count == 0) return;
+
+			Builder b{};
+			b.boxes = boxes;
+			b.centers.resize(count);
+			b.order.resize(count);
+			for (size_t i = 0; i < count; i++) {
+				b.centers[i] = boxes[i].center();
+				b.order[i] = uint32(i);
+			}
+			b.nodes.reserve(count / 2 + 1);
+			b.split(0, uint32(count), 0);
+
+			nodes.reserve(b.nodes.size() / 3 + 1);
+			items.reserve(count + count / 2);
+			b.collapse(0, nodes, items);
+		}
+
+		float cost(const std::vector<Node>& nodes) {
+			if (nodes.empty()) return 0.0f;
+
+			AABB root = AABB::empty();
+			for (uint32 i = 0; i < Width; i++) {
+				if (nodes[0].child[i] != Empty) root.expand(nodes[0].bounds(i));
+			}
+			float sum = 0.0f;
+			for (const Node& node : nodes) {
+				for (uint32 i = 0; i < Width; i++) {
+					if (node.child[i] != Empty) sum += node.bounds(i).surfaceArea();
+				}
+			}
+			const float area = root.surfaceArea();
+			return area > 0.0f ? sum / area : 0.0f;
+		}
+
+		uint32 intersectNode(const Node& node, const RayData& ray, float tmax, float radius, float tnear[Width]) {
+#if defined(AE_X86)
+			if (simd::level() >= SimdLevel::SSE2) return intersectNode_SSE2(node, ray, tmax, radius, tnear);
+#endif
+			return intersectNodeScalar(node, ray, tmax, radius, tnear);
+		}
+
+		uint32 intersectTriangles(const TrianglePacket& packet, const RayData& ray, float tmax, float t[Width], float u[Width], float v[Width]) {
+#if defined(AE_X86)
+			if (simd::level() >= SimdLevel::SSE2) return intersectTriangles_SSE2(packet, ray, tmax, t, u, v);
+#endif
+			return intersectTrianglesScalar(packet, ray, tmax, t, u, v);
+		}
+	}
+
+	void MeshBVH::build(const Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount) {
+		m_triangleCount = indexCount / 3;
+		std::vector<AABB> boxes(m_triangleCount);
+		m_bounds = AABB::empty();
+		for (size_t t = 0; t < m_triangleCount; t++) {
+			AABB& b = boxes[t];
+			b = AABB::empty();
+			for (uint32 k = 0; k < 3; k++) {
+				const uint32 i = indices[t * 3 + k];
+				if (i < vertexCount) b.expand(vertices[i].position);
+			}
+			m_bounds.expand(b);
+		}
+
+		std::vector<uint32> items;
+		bvh::build(boxes.data(), boxes.size(), m_nodes, items);
+
+		m_packets.assign(items.size() / bvh::Width, bvh::TrianglePacket{});
+		for (size_t leaf = 0; leaf < m_packets.size(); leaf++) {
+			bvh::TrianglePacket& p = m_packets[leaf];
+			for (uint32 lane = 0; lane < bvh::Width; lane++) {
+				const uint32 t = items[leaf * bvh::Width + lane];
+				p.triangle[lane] = t;
+				if (t == bvh::Empty) continue;
+
+				auto corner = [&](uint32 k) {
+					const uint32 i = indices[t * 3 + k];
+					return i < vertexCount ? vertices[i].position : Vector3(0.0f);
+				};
+				const Vector3 v0 = corner(0), e1 = corner(1) - v0, e2 = corner(2) - v0;
+				for (uint32 c = 0; c < 3; c++) {
+					p.v0[c][lane] = axis(v0, c);
+					p.e1[c][lane] = axis(e1, c);
+					p.e2[c][lane] = axis(e2, c);
+				}
+			}
+		}
+	}
+
+	bool MeshBVH::raycast(const Ray& ray, float maxT, Hit& hit) const {
+		const bvh::RayData r(ray);
+		bool found = false;
+		bvh::traverse(m_nodes, r, maxT, 0.0f, [&](uint32 leaf, float best) {
+			const bvh::TrianglePacket& p = m_packets[leaf];
+			float t[bvh::Width], u[bvh::Width], v[bvh::Width];
+			const uint32 mask = bvh::intersectTriangles(p, r, best, t, u, v);
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				if (!(mask & (1u << i)) || t[i] > best) continue;
+				best = t[i];
+				found = true;
+				hit.t = t[i];
+				hit.triangle = p.triangle[i];
+				hit.normal = Vector3(p.e1[0][i], p.e1[1][i], p.e1[2][i]).cross(Vector3(p.e2[0][i], p.e2[1][i], p.e2[2][i]));
+			}
+			return best;
+		});
+		return found;
+	}
+
+	bool MeshBVH::sweepSphere(const Ray& ray, float radius, float maxT, Hit& hit) const {
+		bool found = false;
+		bvh::traverse(m_nodes, bvh::RayData(ray), maxT, radius, [&](uint32 leaf, float best) {
+			const bvh::TrianglePacket& p = m_packets[leaf];
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				if (p.triangle[i] == bvh::Empty) continue;
+
+				const Vector3 a(p.v0[0][i], p.v0[1][i], p.v0[2][i]);
+				const Vector3 b = a + Vector3(p.e1[0][i], p.e1[1][i], p.e1[2][i]);
+				const Vector3 c = a + Vector3(p.e2[0][i], p.e2[1][i], p.e2[2][i]);
+				float t;
+				if (!sweepTriangle(ray.origin, ray.direction, radius, a, b, c, best, t)) continue;
+
+				best = t;
+				found = true;
+				hit.t = t;
+				hit.triangle = p.triangle[i];
+
+				// Contact normal, the face normal when the center touches the triangle itself.
+				const Vector3 center = ray.at(t);
+				hit.normal = center - closestPoint(center, a, b, c);
+				if (hit.normal.dot(hit.normal) == 0.0f) hit.normal = (b - a).cross(c - a);
+			}
+			return best;
+		});
+		return found;
+	}
+
+	size_t MeshBVH::memoryUsage() const {
+		return m_nodes.size() * sizeof(bvh::Node) + m_packets.size() * sizeof(bvh::TrianglePacket);
+	}
+}
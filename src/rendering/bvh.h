@@ -0,0 +1,161 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+#include "vertex.h"
+
+#include <vector>
+
+namespace ae {
+	namespace bvh {
+		/// Children per node and boxes per leaf.
+		constexpr uint32 Width = 4;
+		constexpr uint32 LeafBit = 0x80000000u;
+		constexpr uint32 Empty = ~0u;
+
+		/// Four child boxes as structure of arrays, so a single SIMD test covers all of them. A child is a node
+		/// index, LeafBit | leaf index or Empty. Parents always come before their children.
+		struct Node {
+			float minX[Width], minY[Width], minZ[Width];
+			float maxX[Width], maxY[Width], maxZ[Width];
+			uint32 child[Width];
+
+			AABB bounds(uint32 slot) const;
+			void bounds(uint32 slot, const AABB& b);
+		};
+
+		/// Binned SAH build over boxes. Leaf i holds items[i * Width ...], box indices padded with Empty.
+		/// Node 0 is the root, nodes is left empty when count is 0.
+		void build(const AABB* boxes, size_t count, std::vector<Node>& nodes, std::vector<uint32>& items);
+
+		/// Traversal stack depth, enough for any tree build() makes.
+		constexpr size_t StackSize = 256;
+
+		/// Recomputes every node box from the leaf boxes, for primitives that moved but kept their topology.
+		/// leafBounds(leaf) returns the box around the items of a leaf. Returns the root box.
+		template <typename LeafBounds>
+		AABB refit(std::vector<Node>& nodes, LeafBounds leafBounds);
+
+		/// Sum of the child box areas relative to the root's, the expected traversal cost up to a constant.
+		float cost(const std::vector<Node>& nodes);
+
+		/// A ray prepared for the kernels. Distances are in multiples of direction.
+		struct RayData {
+			Vector3 origin, direction, invDirection;
+
+			explicit RayData(const Ray& ray);
+		};
+
+		/// Bit i set when the ray passes through child box i, grown by radius, within [0, tmax].
+		/// tnear[i] is the entry distance of the hit ones. Empty children aren't masked out.
+		uint32 intersectNode(const Node& node, const RayData& ray, float tmax, float radius, float tnear[Width]);
+
+		/// Calls visit(leaf, tmax) for every leaf whose box the ray, grown by radius, passes through within tmax,
+		/// nearest box first. visit returns the tmax to go on with, so closest hit queries can shrink it.
+		template <typename Visit>
+		void traverse(const std::vector<Node>& nodes, const RayData& ray, float tmax, float radius, Visit visit);
+
+		/// Four triangles as a corner and two edges each. Missing ones have zero edges and never hit.
+		struct TrianglePacket {
+			float v0[3][Width], e1[3][Width], e2[3][Width];
+			uint32 triangle[Width];
+		};
+
+		/// Bit i set when the ray hits triangle i, either side, within [0, tmax]. t, u and v are filled for those.
+		uint32 intersectTriangles(const TrianglePacket& packet, const RayData& ray, float tmax, float t[Width], float u[Width], float v[Width]);
+	}
+
+	/// BVH over the triangles of one mesh, in object space. Queries are const and can run on any thread.
+	class MeshBVH {
+	public:
+		struct Hit {
+			float t;
+			uint32 triangle; // Index of the triangle's first index / 3
+			Vector3 normal; // Not normalized, facing the side the triangle is wound counterclockwise from
+		};
+
+		void build(const Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount);
+
+		/// Closest hit within maxT, t in multiples of ray.direction.
+		bool raycast(const Ray& ray, float maxT, Hit& hit) const;
+
+		/// First contact of a sphere of radius moving from ray.origin along ray.direction. Starting in contact
+		/// gives t = 0, the normal points from the triangle towards the sphere.
+		bool sweepSphere(const Ray& ray, float radius, float maxT, Hit& hit) const;
+
+		bool empty() const { return m_nodes.empty(); }
+		const AABB& bounds() const { return m_bounds; }
+		size_t triangleCount() const { return m_triangleCount; }
+		size_t memoryUsage() const;
+
+	private:
+		std::vector<bvh::Node> m_nodes;
+		std::vector<bvh::TrianglePacket> m_packets; // One per leaf
+		AABB m_bounds{};
+		size_t m_triangleCount{ 0 };
+	};
+
+	template <typename LeafBounds>
+	AABB bvh::refit(std::vector<Node>& nodes, LeafBounds leafBounds) {
+		AABB root = AABB::empty();
+		for (size_t n = nodes.size(); n-- > 0;) {
+			Node& node = nodes[n];
+			for (uint32 i = 0; i < Width; i++) {
+				const uint32 c = node.child[i];
+				if (c == Empty) continue;
+
+				AABB b = AABB::empty();
+				if (c & LeafBit) {
+					b = leafBounds(c & ~LeafBit);
+				} else {
+					for (uint32 j = 0; j < Width; j++) {
+						if (nodes[c].child[j] != Empty) b.expand(nodes[c].bounds(j));
+					}
+				}
+				node.bounds(i, b);
+				if (n == 0) root.expand(b);
+			}
+		}
+		return root;
+	}
+
+	template <typename Visit>
+	void bvh::traverse(const std::vector<Node>& nodes, const RayData& ray, float tmax, float radius, Visit visit) {
+		if (nodes.empty()) return;
+
+		struct Entry {
+			uint32 child;
+			float t;
+		};
+		Entry stack[StackSize];
+		size_t size = 0;
+		stack[size++] = { 0, 0.0f };
+
+		while (size > 0) {
+			const Entry e = stack[--size];
+			if (e.t > tmax) continue;
+			if (e.child & LeafBit) {
+				tmax = visit(e.child & ~LeafBit, tmax);
+				continue;
+			}
+
+			const Node& node = nodes[e.child];
+			float tnear[Width];
+			const uint32 mask = intersectNode(node, ray, tmax, radius, tnear);
+
+			// Sorted far to near, so the nearest child is popped first.
+			Entry hits[Width];
+			uint32 n = 0;
+			for (uint32 i = 0; i < Width; i++) {
+				if (!(mask & (1u << i)) || node.child[i] == Empty) continue;
+				uint32 j = n++;
+				for (; j > 0 && hits[j - 1].t < tnear[i]; j--) hits[j] = hits[j - 1];
+				hits[j] = { node.child[i], tnear[i] };
+			}
+			for (uint32 i = 0; i < n; i++) stack[size++] = hits[i];
+		}
+	}
+}
+
+#endif // BVH_H
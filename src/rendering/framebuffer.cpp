@@ -1,5 +1,6 @@
 #include "framebuffer.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace ae {
@@ -23,15 +24,17 @@ namespace ae {
 		glGenFramebuffers(1, &m_id);
 	}
 
-	void FrameBuffer::color(TextureTarget type, TextureFormat format, uint32 mip, uint32 layer) {
+	void FrameBuffer::color(TextureTarget type, TextureFormat format, uint32 mip, uint32 layer, bool mipmaps) {
 		glBindFramebuffer(GL_FRAMEBUFFER, m_id);
 
+		// Immutable storage, with every mip level when mipmaps is set. generateMipmaps() fills them on request.
 		std::unique_ptr<Texture> tex = std::make_unique<Texture>();
-		tex->setSize(m_width, m_height);
+		tex->target(type);
+		const bool layered = type == TextureTarget::Texture3D || type == TextureTarget::Texture2DArray;
+		tex->setSize(m_width, m_height, layered ? std::max(m_depth, 1u) : 0);
 		tex->bind();
 		tex->wrap(TextureWrap::Clamp, TextureWrap::Clamp);
-		tex->filter(TextureFilter::LinearMipLinear, TextureFilter::Linear);
-		tex->setData(nullptr, format);
+		tex->filter(mipmaps ? TextureFilter::LinearMipLinear : TextureFilter::Linear, TextureFilter::Linear);
 
 		if (type == TextureTarget::CubeMap) {
 			tex->setCubeMapData(nullptr, format, CubeMapSide::CubeMapNX);
@@ -48,6 +51,7 @@ namespace ae {
 		sca.format = format;
 		sca.target = type;
 		sca.mip = mip;
+		sca.mipmaps = mipmaps;
 		m_savedColorAttachments.push_back(sca);
 
 		std::vector<GLenum> db;
@@ -78,6 +82,15 @@ namespace ae {
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
+	void FrameBuffer::generateMipmaps() {
+		for (size_t i = 0; i < m_colorAttachments.size(); i++) {
+			if (!m_savedColorAttachments[i].mipmaps) continue;
+			m_colorAttachments[i]->bind();
+			glGenerateMipmap(GLenum(m_savedColorAttachments[i].target));
+			m_colorAttachments[i]->unbind();
+		}
+	}
+
 	void FrameBuffer::depth() {
 		if (m_depthAttachment) {
 			return;
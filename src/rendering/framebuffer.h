@@ -35,12 +35,17 @@ namespace ae {
 		void create(uint32 width, uint32 height, uint32 depth = 1);
 		void free();
 
+		/// Adds a color attachment. Its mips are only allocated with mipmaps, and only filled by generateMipmaps().
 		void color(
 			TextureTarget type, TextureFormat format,
 			uint32 mip = 0,
-			uint32 layer = 0
+			uint32 layer = 0,
+			bool mipmaps = false
 		);
 
+		/// Filters the mips of the color attachments that have them from what was rendered to level 0.
+		void generateMipmaps();
+
 		void depth();
 		void stencil();
 
@@ -82,6 +87,7 @@ namespace ae {
 			TextureFormat format;
 			TextureTarget target;
 			uint32 mip;
+			bool mipmaps;
 		};
 
 		uint32 m_id{ 0 }, m_rboID{ 0 };
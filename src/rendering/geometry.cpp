@@ -0,0 +1,359 @@
+#include "geometry.h"
+
+#include "simd.h"
+#include "util.hpp"
+
+#include <cstddef>
+#include <limits>
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace {
+		constexpr size_t MinTrianglesPerThread = 1 << 15;
+		constexpr size_t MinVerticesPerThread = 1 << 15;
+
+		// Centroid partial sums cover fixed blocks, not threads, so the rounding doesn't change with the thread count.
+		constexpr size_t CentroidBlock = 1 << 14;
+		constexpr size_t NormalizeBlock = 64;
+		constexpr size_t ScatterBlock = 1024;
+
+		constexpr size_t VertexFloats = sizeof(Vertex) / sizeof(float);
+		constexpr size_t PositionOffset = offsetof(Vertex, position) / sizeof(float);
+		constexpr size_t TexCoordOffset = offsetof(Vertex, texCoord) / sizeof(float);
+
+		/// Per-triangle vectors, structure of arrays.
+		struct FaceVectors {
+			std::vector<float> x, y, z;
+			explicit FaceVectors(size_t count) : x(count), y(count), z(count) {}
+		};
+
+		// None of the kernels use FMA, every level has to round exactly like the scalar code.
+
+		void faceNormalsScalar(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			for (size_t t = begin; t < end; t++) {
+				const Vector3& p0 = v[idx[t * 3]].position;
+				const Vector3 e0 = v[idx[t * 3 + 1]].position - p0;
+				const Vector3 e1 = v[idx[t * 3 + 2]].position - p0;
+				out.x[t] = e0.y * e1.z - e0.z * e1.y;
+				out.y[t] = e0.z * e1.x - e0.x * e1.z;
+				out.z[t] = e0.x * e1.y - e0.y * e1.x;
+			}
+		}
+
+		void faceTangentsScalar(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			for (size_t t = begin; t < end; t++) {
+				const Vertex& a = v[idx[t * 3]];
+				const Vertex& b = v[idx[t * 3 + 1]];
+				const Vertex& c = v[idx[t * 3 + 2]];
+
+				const Vector3 e0 = b.position - a.position;
+				const Vector3 e1 = c.position - a.position;
+				const Vector2 dt1 = b.texCoord - a.texCoord;
+				const Vector2 dt2 = c.texCoord - a.texCoord;
+
+				const float dividend = dt1.x * dt2.y - dt2.x * dt1.y;
+				const float f = dividend == 0.0f ? 0.0f : 1.0f / dividend;
+				out.x[t] = f * (dt2.y * e0.x - dt1.y * e1.x);
+				out.y[t] = f * (dt2.y * e0.y - dt1.y * e1.y);
+				out.z[t] = f * (dt2.y * e0.z - dt1.y * e1.z);
+			}
+		}
+
+		void faceBitangentsScalar(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			for (size_t t = begin; t < end; t++) {
+				const Vertex& a = v[idx[t * 3]];
+				const Vertex& b = v[idx[t * 3 + 1]];
+				const Vertex& c = v[idx[t * 3 + 2]];
+
+				const Vector3 e0 = b.position - a.position;
+				const Vector3 e1 = c.position - a.position;
+				const Vector2 dt1 = b.texCoord - a.texCoord;
+				const Vector2 dt2 = c.texCoord - a.texCoord;
+
+				const float dividend = dt1.x * dt2.y - dt2.x * dt1.y;
+				const float f = dividend == 0.0f ? 0.0f : 1.0f / dividend;
+				out.x[t] = f * (dt1.x * e1.x - dt2.x * e0.x);
+				out.y[t] = f * (dt1.x * e1.y - dt2.x * e0.y);
+				out.z[t] = f * (dt1.x * e1.z - dt2.x * e0.z);
+			}
+		}
+
+		AABB boundsScalar(const Vertex* v, const uint32* idx, size_t begin, size_t end) {
+			AABB b = AABB::empty();
+			for (size_t i = begin; i < end; i++) b.expand(v[idx[i]].position);
+			return b;
+		}
+
+		void transformPositionsScalar(Vertex* v, size_t begin, size_t end, float scale, const Vector3& offset) {
+			for (size_t i = begin; i < end; i++) v[i].position = v[i].position * scale + offset;
+		}
+
+#if defined(AE_X86)
+		/// Component c of corner k of the four triangles starting at t.
+		AE_TARGET("sse2") inline __m128 corner_SSE2(const float* f, const uint32* idx, size_t t, size_t k, size_t c) {
+			return _mm_setr_ps(
+				f[idx[t * 3 + k] * VertexFloats + c], f[idx[t * 3 + 3 + k] * VertexFloats + c],
+				f[idx[t * 3 + 6 + k] * VertexFloats + c], f[idx[t * 3 + 9 + k] * VertexFloats + c]
+			);
+		}
+
+		AE_TARGET("sse2") void faceNormals_SSE2(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			const float* f = reinterpret_cast<const float*>(v) + PositionOffset;
+			size_t t = begin;
+			for (; t + 4 <= end; t += 4) {
+				const __m128 x0 = corner_SSE2(f, idx, t, 0, 0), y0 = corner_SSE2(f, idx, t, 0, 1), z0 = corner_SSE2(f, idx, t, 0, 2);
+				const __m128 e0x = _mm_sub_ps(corner_SSE2(f, idx, t, 1, 0), x0);
+				const __m128 e0y = _mm_sub_ps(corner_SSE2(f, idx, t, 1, 1), y0);
+				const __m128 e0z = _mm_sub_ps(corner_SSE2(f, idx, t, 1, 2), z0);
+				const __m128 e1x = _mm_sub_ps(corner_SSE2(f, idx, t, 2, 0), x0);
+				const __m128 e1y = _mm_sub_ps(corner_SSE2(f, idx, t, 2, 1), y0);
+				const __m128 e1z = _mm_sub_ps(corner_SSE2(f, idx, t, 2, 2), z0);
+
+				_mm_storeu_ps(&out.x[t], _mm_sub_ps(_mm_mul_ps(e0y, e1z), _mm_mul_ps(e0z, e1y)));
+				_mm_storeu_ps(&out.y[t], _mm_sub_ps(_mm_mul_ps(e0z, e1x), _mm_mul_ps(e0x, e1z)));
+				_mm_storeu_ps(&out.z[t], _mm_sub_ps(_mm_mul_ps(e0x, e1y), _mm_mul_ps(e0y, e1x)));
+			}
+			faceNormalsScalar(v, idx, t, end, out);
+		}
+
+		AE_TARGET("sse2") void faceTangents_SSE2(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			const float* f = reinterpret_cast<const float*>(v);
+			const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+			size_t t = begin;
+			for (; t + 4 <= end; t += 4) {
+				__m128 e[2][3], dt[2][2];
+				const __m128 p0[3] = {
+					corner_SSE2(f, idx, t, 0, PositionOffset), corner_SSE2(f, idx, t, 0, PositionOffset + 1),
+					corner_SSE2(f, idx, t, 0, PositionOffset + 2)
+				};
+				const __m128 uv0[2] = { corner_SSE2(f, idx, t, 0, TexCoordOffset), corner_SSE2(f, idx, t, 0, TexCoordOffset + 1) };
+				for (size_t k = 0; k < 2; k++) {
+					for (size_t c = 0; c < 3; c++) e[k][c] = _mm_sub_ps(corner_SSE2(f, idx, t, k + 1, PositionOffset + c), p0[c]);
+					for (size_t c = 0; c < 2; c++) dt[k][c] = _mm_sub_ps(corner_SSE2(f, idx, t, k + 1, TexCoordOffset + c), uv0[c]);
+				}
+
+				const __m128 dividend = _mm_sub_ps(_mm_mul_ps(dt[0][0], dt[1][1]), _mm_mul_ps(dt[1][0], dt[0][1]));
+				const __m128 fac = _mm_andnot_ps(_mm_cmpeq_ps(dividend, zero), _mm_div_ps(one, dividend));
+
+				float* dst[3] = { &out.x[t], &out.y[t], &out.z[t] };
+				for (size_t c = 0; c < 3; c++) {
+					const __m128 d = _mm_sub_ps(_mm_mul_ps(dt[1][1], e[0][c]), _mm_mul_ps(dt[0][1], e[1][c]));
+					_mm_storeu_ps(dst[c], _mm_mul_ps(fac, d));
+				}
+			}
+			faceTangentsScalar(v, idx, t, end, out);
+		}
+
+		AE_TARGET("sse2") AABB bounds_SSE2(const Vertex* v, const uint32* idx, size_t begin, size_t end) {
+			// Reads one float past the position, which is still inside the vertex.
+			__m128 lo = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128 hi = _mm_set1_ps(-std::numeric_limits<float>::max());
+			for (size_t i = begin; i < end; i++) {
+				const __m128 p = _mm_loadu_ps(&v[idx[i]].position.x);
+				lo = _mm_min_ps(lo, p);
+				hi = _mm_max_ps(hi, p);
+			}
+
+			alignas(16) float l[4], h[4];
+			_mm_store_ps(l, lo);
+			_mm_store_ps(h, hi);
+			return begin == end ? AABB::empty() : AABB(Vector3(l[0], l[1], l[2]), Vector3(h[0], h[1], h[2]));
+		}
+
+		AE_TARGET("sse2") void transformPositions_SSE2(Vertex* v, size_t begin, size_t end, float scale, const Vector3& offset) {
+			// The fourth lane is normal.x, it is written back unchanged.
+			const __m128 s = _mm_set1_ps(scale), o = _mm_setr_ps(offset.x, offset.y, offset.z, 0.0f);
+			const __m128 keep = _mm_castsi128_ps(_mm_setr_epi32(0, 0, 0, -1));
+			for (size_t i = begin; i < end; i++) {
+				float* p = &v[i].position.x;
+				const __m128 in = _mm_loadu_ps(p);
+				const __m128 r = _mm_add_ps(_mm_mul_ps(in, s), o);
+				_mm_storeu_ps(p, _mm_or_ps(_mm_and_ps(keep, in), _mm_andnot_ps(keep, r)));
+			}
+		}
+#endif
+
+		// Every kernel reads whole 44 byte vertices one at a time, SSE2 is as wide as they get. AVX2 gathers were
+		// measured slower than the SSE2 loads.
+#if defined(AE_X86)
+#	define AE_DISPATCH_SSE2(fn, ...) \
+		if (simd::level() >= SimdLevel::SSE2) return fn##_SSE2(__VA_ARGS__); \
+		return fn##Scalar(__VA_ARGS__)
+#else
+#	define AE_DISPATCH_SSE2(fn, ...) return fn##Scalar(__VA_ARGS__)
+#endif
+
+		void faceNormals(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			AE_DISPATCH_SSE2(faceNormals, v, idx, begin, end, out);
+		}
+
+		void faceTangents(const Vertex* v, const uint32* idx, size_t begin, size_t end, FaceVectors& out) {
+			AE_DISPATCH_SSE2(faceTangents, v, idx, begin, end, out);
+		}
+
+		AABB boundsRange(const Vertex* v, const uint32* idx, size_t begin, size_t end) {
+			AE_DISPATCH_SSE2(bounds, v, idx, begin, end);
+		}
+
+		void transformRange(Vertex* v, size_t begin, size_t end, float scale, const Vector3& offset) {
+			AE_DISPATCH_SSE2(transformPositions, v, begin, end, scale, offset);
+		}
+
+#undef AE_DISPATCH_SSE2
+
+		/// Adds the face vectors to member of every vertex they touch, in triangle order, and normalizes.
+		template <typename Kernel>
+		void accumulate(
+			Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount,
+			Vector3 Vertex::* member, Kernel kernel
+		) {
+			const size_t triCount = indexCount / 3;
+			if (vertexCount == 0) return;
+
+			const size_t ranges = util::parallelRanges(triCount, MinTrianglesPerThread);
+			std::vector<Vector3> sums(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++) sums[v] = vertices[v].*member;
+
+			if (ranges == 1) {
+				// A single thread scatters directly, the vertex->triangle lists below only pay off in parallel.
+				FaceVectors faces(ScatterBlock);
+				for (size_t begin = 0; begin < triCount; begin += ScatterBlock) {
+					const uint32* block = indices + begin * 3;
+					const size_t count = std::min(ScatterBlock, triCount - begin);
+					kernel(vertices, block, 0, count, faces);
+					for (size_t t = 0; t < count; t++) {
+						const Vector3 n(faces.x[t], faces.y[t], faces.z[t]);
+						for (size_t k = 0; k < 3; k++) {
+							Vector3& s = sums[block[t * 3 + k]];
+							s = s + n;
+						}
+					}
+				}
+			} else {
+				// Each thread counts the corners of its triangles per vertex.
+				FaceVectors faces(triCount);
+				std::vector<uint32> cursor(ranges * vertexCount, 0);
+				util::parallelFor(triCount, ranges, [&](size_t begin, size_t end, size_t r) {
+					kernel(vertices, indices, begin, end, faces);
+					uint32* counts = cursor.data() + r * vertexCount;
+					for (size_t i = begin * 3; i < end * 3; i++) counts[indices[i]]++;
+				});
+
+				// Reduction: vertex v's list holds range 0's triangles, then range 1's and so on, i.e. triangle order.
+				std::vector<uint32> first(vertexCount + 1);
+				uint32 offset = 0;
+				for (size_t v = 0; v < vertexCount; v++) {
+					first[v] = offset;
+					for (size_t r = 0; r < ranges; r++) {
+						const uint32 n = cursor[r * vertexCount + v];
+						cursor[r * vertexCount + v] = offset;
+						offset += n;
+					}
+				}
+				first[vertexCount] = offset;
+
+				std::vector<uint32> triangles(offset);
+				util::parallelFor(triCount, ranges, [&](size_t begin, size_t end, size_t r) {
+					uint32* next = cursor.data() + r * vertexCount;
+					for (size_t i = begin * 3; i < end * 3; i++) triangles[next[indices[i]]++] = uint32(i / 3);
+				});
+
+				util::parallelFor(vertexCount, util::parallelRanges(vertexCount, MinVerticesPerThread), [&](size_t begin, size_t end, size_t) {
+					for (size_t v = begin; v < end; v++) {
+						Vector3 s = sums[v];
+						for (uint32 j = first[v]; j < first[v + 1]; j++) {
+							const uint32 t = triangles[j];
+							s = s + Vector3(faces.x[t], faces.y[t], faces.z[t]);
+						}
+						sums[v] = s;
+					}
+				});
+			}
+
+			// Ranges start on whole blocks so normalizeMany() splits its SIMD body and scalar tail the same way
+			// for any thread count.
+			const size_t blocks = (vertexCount + NormalizeBlock - 1) / NormalizeBlock;
+			util::parallelFor(blocks, util::parallelRanges(vertexCount, MinVerticesPerThread), [&](size_t b0, size_t b1, size_t) {
+				const size_t begin = b0 * NormalizeBlock, end = std::min(b1 * NormalizeBlock, vertexCount);
+				normalizeMany(sums.data() + begin, sums.data() + begin, end - begin);
+				for (size_t v = begin; v < end; v++) vertices[v].*member = sums[v];
+			});
+		}
+	}
+
+	namespace geometry {
+		void accumulateNormals(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount) {
+			accumulate(vertices, vertexCount, indices, indexCount, &Vertex::normal, faceNormals);
+		}
+
+		void accumulateTangents(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount) {
+			accumulate(vertices, vertexCount, indices, indexCount, &Vertex::tangent, faceTangents);
+		}
+
+		void tangentSigns(const Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount, float* out) {
+			// Only the direction of the summed bitangents matters, accumulate them into the tangents of a copy.
+			std::vector<Vertex> copy(vertices, vertices + vertexCount);
+			for (Vertex& v : copy) v.tangent = Vector3(0.0f);
+			accumulate(copy.data(), vertexCount, indices, indexCount, &Vertex::tangent, faceBitangentsScalar);
+
+			for (size_t v = 0; v < vertexCount; v++) {
+				const Vector3 b = vertices[v].normal.cross(vertices[v].tangent);
+				out[v] = b.dot(copy[v].tangent) < 0.0f ? -1.0f : 1.0f;
+			}
+		}
+
+		AABB bounds(const Vertex* vertices, const uint32* indices, size_t indexCount) {
+			// Min and max are exact, merging the ranges in any order gives the same box.
+			const size_t ranges = util::parallelRanges(indexCount, MinVerticesPerThread);
+			std::vector<AABB> partial(ranges, AABB::empty());
+			util::parallelFor(indexCount, ranges, [&](size_t begin, size_t end, size_t r) {
+				partial[r] = boundsRange(vertices, indices, begin, end);
+			});
+
+			AABB ret = AABB::empty();
+			for (const AABB& b : partial) ret.expand(b);
+			return ret;
+		}
+
+		Vector3 centroid(const Vertex* vertices, size_t count) {
+			if (count == 0) return Vector3(0.0f);
+
+			const size_t blocks = (count + CentroidBlock - 1) / CentroidBlock;
+			std::vector<double> sums(blocks * 3, 0.0);
+			util::parallelFor(blocks, util::parallelRanges(count, MinVerticesPerThread), [&](size_t begin, size_t end, size_t) {
+				for (size_t b = begin; b < end; b++) {
+					double x = 0.0, y = 0.0, z = 0.0;
+					for (size_t i = b * CentroidBlock; i < std::min(count, (b + 1) * CentroidBlock); i++) {
+						x += vertices[i].position.x;
+						y += vertices[i].position.y;
+						z += vertices[i].position.z;
+					}
+					sums[b * 3] = x;
+					sums[b * 3 + 1] = y;
+					sums[b * 3 + 2] = z;
+				}
+			});
+
+			double x = 0.0, y = 0.0, z = 0.0;
+			for (size_t b = 0; b < blocks; b++) {
+				x += sums[b * 3];
+				y += sums[b * 3 + 1];
+				z += sums[b * 3 + 2];
+			}
+			return Vector3(float(x / double(count)), float(y / double(count)), float(z / double(count)));
+		}
+
+		void transformPositions(Vertex* vertices, size_t count, float scale, const Vector3& offset) {
+			util::parallelFor(count, util::parallelRanges(count, MinVerticesPerThread), [&](size_t begin, size_t end, size_t) {
+				transformRange(vertices, begin, end, scale, offset);
+			});
+		}
+	}
+}
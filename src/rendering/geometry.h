@@ -0,0 +1,33 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+#include "vertex.h"
+
+namespace ae {
+	/// Bulk mesh processing, split over threads and SIMD lanes. The results don't depend on either:
+	/// every vertex sums its triangles in triangle order, exactly like a serial loop.
+	namespace geometry {
+		/// Adds the area weighted face normal of every triangle to its vertices' normals, then normalizes them.
+		void accumulateNormals(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount);
+
+		/// Adds the UV-space tangent of every triangle to its vertices' tangents, then normalizes them.
+		void accumulateTangents(Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount);
+
+		/// Bitangent sign of every vertex into out: +1 where the UV-space bitangent of its triangles points along
+		/// cross(normal, tangent), -1 where the UVs are mirrored. Vertices without UV area get +1.
+		void tangentSigns(const Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount, float* out);
+
+		/// Bounds of the vertices referenced by indices.
+		AABB bounds(const Vertex* vertices, const uint32* indices, size_t indexCount);
+
+		/// Mean vertex position.
+		Vector3 centroid(const Vertex* vertices, size_t count);
+
+		/// position = position * scale + offset
+		void transformPositions(Vertex* vertices, size_t count, float scale, const Vector3& offset);
+	}
+}
+
+#endif // GEOMETRY_H
@@ -0,0 +1,254 @@
+#include "geometry_pool.h"
+
+#include "mesh.h"
+#include "log.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace ae {
+	namespace {
+		constexpr uint32 IndexAlignment = 4;
+
+		inline uint32 indexWords(uint32 bytes) { return (bytes + IndexAlignment - 1) / IndexAlignment; }
+
+		/// Copies a run of consecutive ranges at once, both buffers stay bound to the copy targets.
+		struct CopyRuns {
+			uint64 src{ 0 }, dst{ 0 }, size{ 0 };
+
+			void add(uint64 from, uint64 to, uint64 bytes) {
+				if (bytes == 0) return;
+				if (size != 0 && from == src + size && to == dst + size) {
+					size += bytes;
+					return;
+				}
+				flush();
+				src = from;
+				dst = to;
+				size = bytes;
+			}
+
+			void flush() {
+				if (size != 0) glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, GLintptr(src), GLintptr(dst), GLsizeiptr(size));
+				size = 0;
+			}
+		};
+
+		std::string describe(VertexFormat format, const GeometryPool::Stats& s) {
+			auto kb = [](uint64 bytes) { return std::to_string(bytes / 1024); };
+			return std::string(format == VertexFormat::Packed ? "Packed" : "Float") + " geometry pool: " +
+				std::to_string(s.allocations) + " meshes, vertices " + kb(s.vertexBytes) + "/" + kb(s.vertexCapacity) +
+				" KB, indices " + kb(s.indexBytes) + "/" + kb(s.indexCapacity) + " KB, " + std::to_string(s.freeRanges) +
+				" free ranges, fragmentation " + std::to_string(int(s.fragmentation * 100.0f)) + "%";
+		}
+	}
+
+	void RangeAllocator::reset(uint32 capacity, uint32 used) {
+		m_byOffset.clear();
+		m_bySize.clear();
+		m_capacity = capacity;
+		m_used = used;
+		if (used < capacity) insert(used, capacity - used);
+	}
+
+	uint32 RangeAllocator::allocate(uint32 size) {
+		if (size == 0) return 0;
+
+		const auto best = m_bySize.lower_bound(size);
+		if (best == m_bySize.end()) return Invalid;
+
+		const uint32 offset = best->second, available = best->first;
+		erase(m_byOffset.find(offset));
+		if (available > size) insert(offset + size, available - size);
+		m_used += size;
+		return offset;
+	}
+
+	void RangeAllocator::free(uint32 offset, uint32 size) {
+		if (size == 0) return;
+		m_used -= size;
+
+		auto next = m_byOffset.lower_bound(offset);
+		if (next != m_byOffset.begin()) {
+			const auto prev = std::prev(next);
+			if (prev->first + prev->second == offset) {
+				offset = prev->first;
+				size += prev->second;
+				erase(prev);
+			}
+		}
+		if (next != m_byOffset.end() && offset + size == next->first) {
+			size += next->second;
+			erase(next);
+		}
+		insert(offset, size);
+	}
+
+	float RangeAllocator::fragmentation() const {
+		const uint32 total = m_capacity - m_used;
+		return total == 0 ? 0.0f : 1.0f - float(largestFree()) / float(total);
+	}
+
+	void RangeAllocator::insert(uint32 offset, uint32 size) {
+		m_byOffset.emplace(offset, size);
+		m_bySize.emplace(size, offset);
+	}
+
+	void RangeAllocator::erase(std::map<uint32, uint32>::iterator it) {
+		auto range = m_bySize.equal_range(it->second);
+		for (auto s = range.first; s != range.second; ++s) {
+			if (s->second == it->first) {
+				m_bySize.erase(s);
+				break;
+			}
+		}
+		m_byOffset.erase(it);
+	}
+
+	GeometryPool GeometryPool::s_instance{};
+
+	void GeometryPool::allocate(
+		Allocation& out, VertexFormat format,
+		const void* vertexData, uint32 vertexCount, const void* indexData, uint32 indexBytes
+	) {
+		release(out);
+
+		Arena& a = m_arenas[uint32(format)];
+		const uint32 stride = vertexLayout(format).stride;
+		const uint32 words = indexWords(indexBytes);
+		if (a.vao == 0) compact(format, std::max(InitialVertices, vertexCount), std::max(InitialIndexBytes / IndexAlignment, words));
+
+		uint32 v = a.vertices.allocate(vertexCount), i = a.indices.allocate(words);
+		if (v == RangeAllocator::Invalid || i == RangeAllocator::Invalid) {
+			if (v != RangeAllocator::Invalid) a.vertices.free(v, vertexCount);
+			if (i != RangeAllocator::Invalid) a.indices.free(i, words);
+
+			// Compacting is enough when the free space is only split up, the buffers double otherwise.
+			uint64 vertexCapacity = a.vertices.capacity(), indexCapacity = a.indices.capacity();
+			while (a.vertices.used() + uint64(vertexCount) > vertexCapacity) vertexCapacity *= 2;
+			while (a.indices.used() + uint64(words) > indexCapacity) indexCapacity *= 2;
+			Log.assert(vertexCapacity <= UINT32_MAX && indexCapacity <= UINT32_MAX, "Geometry pool is full.");
+
+			compact(format, uint32(vertexCapacity), uint32(indexCapacity));
+			Log.info(describe(format, stats(format)));
+
+			v = a.vertices.allocate(vertexCount);
+			i = a.indices.allocate(words);
+		}
+
+		out.format = format;
+		out.vertexOffset = v;
+		out.vertexCount = vertexCount;
+		out.indexOffset = i * IndexAlignment;
+		out.indexBytes = indexBytes;
+		out.slot = uint32(a.live.size());
+		a.live.push_back(&out);
+
+		glBindBuffer(GL_COPY_WRITE_BUFFER, a.vbo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(v) * stride, GLsizeiptr(vertexCount) * stride, vertexData);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, a.ebo);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(out.indexOffset), GLsizeiptr(indexBytes), indexData);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	void GeometryPool::release(Allocation& alloc) {
+		if (!alloc.valid()) return;
+
+		Arena& a = m_arenas[uint32(alloc.format)];
+		a.vertices.free(alloc.vertexOffset, alloc.vertexCount);
+		a.indices.free(alloc.indexOffset / IndexAlignment, indexWords(alloc.indexBytes));
+
+		a.live[alloc.slot] = a.live.back();
+		a.live[alloc.slot]->slot = alloc.slot;
+		a.live.pop_back();
+		alloc = Allocation{};
+	}
+
+	void GeometryPool::defragment(VertexFormat format) {
+		Arena& a = m_arenas[uint32(format)];
+		if (a.vao == 0 || (a.vertices.fragmentation() == 0.0f && a.indices.fragmentation() == 0.0f)) return;
+
+		const Stats before = stats(format);
+		compact(format, a.vertices.capacity(), a.indices.capacity());
+		Log.info(
+			"Defragmented, " + std::to_string(before.freeRanges) + " free ranges before. " + describe(format, stats(format))
+		);
+	}
+
+	void GeometryPool::defragment() {
+		for (uint32 f = 0; f < FormatCount; f++) defragment(VertexFormat(f));
+	}
+
+	GeometryPool::Stats GeometryPool::stats(VertexFormat format) const {
+		const Arena& a = m_arenas[uint32(format)];
+		const uint32 stride = vertexLayout(format).stride;
+
+		Stats s{};
+		s.allocations = uint32(a.live.size());
+		s.vertexBytes = uint64(a.vertices.used()) * stride;
+		s.vertexCapacity = uint64(a.vertices.capacity()) * stride;
+		s.indexBytes = uint64(a.indices.used()) * IndexAlignment;
+		s.indexCapacity = uint64(a.indices.capacity()) * IndexAlignment;
+		s.freeRanges = a.vertices.freeRanges() + a.indices.freeRanges();
+		s.fragmentation = std::max(a.vertices.fragmentation(), a.indices.fragmentation());
+		return s;
+	}
+
+	void GeometryPool::compact(VertexFormat format, uint32 vertexCapacity, uint32 indexCapacity) {
+		Arena& a = m_arenas[uint32(format)];
+		const VertexLayout layout = vertexLayout(format);
+
+		GLuint vbo = 0, ebo = 0;
+		glGenBuffers(1, &vbo);
+		glGenBuffers(1, &ebo);
+
+		// The copy targets leave the element array binding of whatever VAO is bound alone.
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+		glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(vertexCapacity) * layout.stride, nullptr, GL_STATIC_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+		glBufferData(GL_COPY_WRITE_BUFFER, GLsizeiptr(indexCapacity) * IndexAlignment, nullptr, GL_STATIC_DRAW);
+
+		// Vertex and index ranges are packed separately, each keeping its order so untouched runs copy at once.
+		std::vector<Allocation*> order(a.live);
+		uint32 vertexEnd = 0, indexEnd = 0;
+
+		glBindBuffer(GL_COPY_READ_BUFFER, a.vbo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+		std::sort(order.begin(), order.end(), [](const Allocation* l, const Allocation* r) { return l->vertexOffset < r->vertexOffset; });
+		CopyRuns runs{};
+		for (Allocation* alloc : order) {
+			runs.add(uint64(alloc->vertexOffset) * layout.stride, uint64(vertexEnd) * layout.stride, uint64(alloc->vertexCount) * layout.stride);
+			alloc->vertexOffset = vertexEnd;
+			vertexEnd += alloc->vertexCount;
+		}
+		runs.flush();
+
+		glBindBuffer(GL_COPY_READ_BUFFER, a.ebo);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+		std::sort(order.begin(), order.end(), [](const Allocation* l, const Allocation* r) { return l->indexOffset < r->indexOffset; });
+		for (Allocation* alloc : order) {
+			const uint32 words = indexWords(alloc->indexBytes);
+			runs.add(alloc->indexOffset, uint64(indexEnd) * IndexAlignment, uint64(words) * IndexAlignment);
+			alloc->indexOffset = indexEnd * IndexAlignment;
+			indexEnd += words;
+		}
+		runs.flush();
+
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		if (a.vbo) glDeleteBuffers(1, &a.vbo);
+		if (a.ebo) glDeleteBuffers(1, &a.ebo);
+		a.vbo = vbo;
+		a.ebo = ebo;
+		a.vertices.reset(vertexCapacity, vertexEnd);
+		a.indices.reset(indexCapacity, indexEnd);
+
+		if (a.vao == 0) glGenVertexArrays(1, &a.vao);
+		glBindVertexArray(a.vao);
+		glBindBuffer(GL_ARRAY_BUFFER, a.vbo);
+		for (uint32 i = 0; i < VertexLayout::AttributeCount; i++) glEnableVertexAttribArray(i);
+		setVertexAttributes(layout);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, a.ebo);
+		glBindVertexArray(0);
+	}
+}
@@ -0,0 +1,115 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include "integer.hpp"
+#include "glad.h"
+#include "vertex.h"
+
+#include <map>
+#include <vector>
+
+namespace ae {
+	/// Best-fit free list over [0, capacity), adjacent free ranges are merged on free().
+	class RangeAllocator {
+	public:
+		static constexpr uint32 Invalid = ~0u;
+
+		/// Starts over with [0, used) taken as a single block.
+		void reset(uint32 capacity, uint32 used = 0);
+
+		/// Offset of a size long range, Invalid when no free range is large enough.
+		uint32 allocate(uint32 size);
+		void free(uint32 offset, uint32 size);
+
+		uint32 capacity() const { return m_capacity; }
+		uint32 used() const { return m_used; }
+		uint32 freeRanges() const { return uint32(m_byOffset.size()); }
+		uint32 largestFree() const { return m_bySize.empty() ? 0 : m_bySize.rbegin()->first; }
+
+		/// 0 when all free space is one range, approaching 1 as it splits into many small ones.
+		float fragmentation() const;
+
+	private:
+		std::map<uint32, uint32> m_byOffset;
+		std::multimap<uint32, uint32> m_bySize;
+		uint32 m_capacity{ 0 }, m_used{ 0 };
+
+		void insert(uint32 offset, uint32 size);
+		void erase(std::map<uint32, uint32>::iterator it);
+	};
+
+	/// Shared vertex and index buffers, one pair and one VAO per vertex format. Static meshes built while the
+	/// pool is enabled become ranges of them, so meshes of the same format draw without rebinding.
+	class GeometryPool {
+	public:
+		static constexpr uint32 FormatCount = uint32(VertexFormat::Packed) + 1;
+		static constexpr uint32 InitialVertices = 1 << 16;
+		static constexpr uint32 InitialIndexBytes = 1 << 20;
+
+		/// Ranges of the pool buffers owned by one mesh. defragment() moves them, so draws read the offsets
+		/// through it every time.
+		struct Allocation {
+			uint32 vertexOffset{ RangeAllocator::Invalid }, vertexCount{ 0 };
+			uint32 indexOffset{ 0 }, indexBytes{ 0 }; // In bytes, indexOffset is a multiple of 4
+			uint32 slot{ 0 };
+			VertexFormat format{ VertexFormat::Float };
+
+			bool valid() const { return vertexOffset != RangeAllocator::Invalid; }
+		};
+
+		struct Stats {
+			uint32 allocations{ 0 };
+			uint64 vertexBytes{ 0 }, vertexCapacity{ 0 }; // In bytes
+			uint64 indexBytes{ 0 }, indexCapacity{ 0 };
+			uint32 freeRanges{ 0 };
+			float fragmentation{ 0.0f }; // The worse one of the vertex and index buffers
+		};
+
+		GeometryPool() = default;
+
+		GeometryPool(const GeometryPool&) = delete;
+		GeometryPool& operator =(const GeometryPool&) = delete;
+
+		/// Static meshes go to the pool on their next build() while enabled. Off by default.
+		bool enabled() const { return m_enabled; }
+		void enabled(bool v) { m_enabled = v; }
+
+		/// Reserves and fills ranges for the mesh. Compacts the buffers first if that makes enough room,
+		/// grows them otherwise. out must stay at the same address until release().
+		void allocate(
+			Allocation& out, VertexFormat format,
+			const void* vertexData, uint32 vertexCount, const void* indexData, uint32 indexBytes
+		);
+		void release(Allocation& alloc);
+
+		/// Moves every allocation of format to the start of the buffers, leaving one free range behind.
+		void defragment(VertexFormat format);
+		void defragment();
+
+		GLuint vao(VertexFormat format) const { return m_arenas[uint32(format)].vao; }
+		GLuint vbo(VertexFormat format) const { return m_arenas[uint32(format)].vbo; }
+		GLuint ebo(VertexFormat format) const { return m_arenas[uint32(format)].ebo; }
+
+		Stats stats(VertexFormat format) const;
+
+		static GeometryPool& ston() { return s_instance; }
+
+	private:
+		struct Arena {
+			GLuint vao{ 0 }, vbo{ 0 }, ebo{ 0 };
+			RangeAllocator vertices, indices; // In vertices and 4 byte words
+			std::vector<Allocation*> live;
+		};
+
+		Arena m_arenas[FormatCount];
+		bool m_enabled{ false };
+
+		/// Replaces the buffers of format with new ones of the given capacity, indices in 4 byte words, and copies
+		/// the live allocations to their start in offset order. Creates the arena on first use.
+		void compact(VertexFormat format, uint32 vertexCapacity, uint32 indexCapacity);
+
+		static GeometryPool s_instance;
+	};
+}
+
+#endif // GEOMETRY_POOL_H
@@ -0,0 +1,516 @@
+#include "gltf_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <string_view>
+
+namespace ae {
+	namespace {
+		constexpr uint32 GlbMagic = 0x46546C67; // "glTF"
+		constexpr uint32 ChunkJson = 0x4E4F534A;
+		constexpr uint32 ChunkBin = 0x004E4942;
+		constexpr uint32 MaxJsonDepth = 64;
+
+		/// Just enough JSON for glTF. Object members keep their order, lookups are linear.
+		struct Json {
+			enum Type : uint8 { Null, Bool, Number, String, Array, Object };
+
+			Type type{ Null };
+			bool boolean{ false };
+			double number{ 0.0 };
+			std::string string;
+			std::vector<Json> items; // Array elements or object values
+			std::vector<std::string> keys;
+
+			const Json& operator [](std::string_view key) const {
+				for (size_t i = 0; i < keys.size(); i++) {
+					if (keys[i] == key) return items[i];
+				}
+				return null();
+			}
+
+			const Json& operator [](size_t i) const { return i < items.size() ? items[i] : null(); }
+
+			size_t size() const { return type == Array ? items.size() : 0; }
+			bool has(std::string_view key) const { return &(*this)[key] != &null(); }
+
+			double num(double fallback) const { return type == Number ? number : fallback; }
+			int32 index() const { return type == Number && number >= 0.0 && number < 2147483647.0 ? int32(number) : -1; }
+			uint32 uint(uint32 fallback) const { return type == Number && number >= 0.0 && number <= 4294967295.0 ? uint32(number) : fallback; }
+
+			static const Json& null() {
+				static const Json n{};
+				return n;
+			}
+		};
+
+		struct JsonParser {
+			const char* p;
+			const char* end;
+
+			void skipSpace() {
+				while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+			}
+
+			bool literal(const char* word) {
+				const size_t n = std::strlen(word);
+				if (size_t(end - p) < n || std::memcmp(p, word, n) != 0) return false;
+				p += n;
+				return true;
+			}
+
+			static void appendUtf8(std::string& s, uint32 c) {
+				if (c < 0x80) {
+					s += char(c);
+				} else if (c < 0x800) {
+					s += char(0xC0 | (c >> 6));
+					s += char(0x80 | (c & 0x3F));
+				} else if (c < 0x10000) {
+					s += char(0xE0 | (c >> 12));
+					s += char(0x80 | ((c >> 6) & 0x3F));
+					s += char(0x80 | (c & 0x3F));
+				} else {
+					s += char(0xF0 | (c >> 18));
+					s += char(0x80 | ((c >> 12) & 0x3F));
+					s += char(0x80 | ((c >> 6) & 0x3F));
+					s += char(0x80 | (c & 0x3F));
+				}
+			}
+
+			bool hex4(uint32& out) {
+				if (end - p < 4) return false;
+				out = 0;
+				for (int i = 0; i < 4; i++) {
+					const char c = *p++;
+					out <<= 4;
+					if (c >= '0' && c <= '9') out |= uint32(c - '0');
+					else if (c >= 'a' && c <= 'f') out |= uint32(c - 'a' + 10);
+					else if (c >= 'A' && c <= 'F') out |= uint32(c - 'A' + 10);
+					else return false;
+				}
+				return true;
+			}
+
+			bool string(std::string& out) {
+				if (p >= end || *p != '"') return false;
+				p++;
+				while (p < end && *p != '"') {
+					if (*p != '\\') {
+						out += *p++;
+						continue;
+					}
+					if (++p >= end) return false;
+					switch (*p++) {
+						case '"': out += '"'; break;
+						case '\\': out += '\\'; break;
+						case '/': out += '/'; break;
+						case 'b': out += '\b'; break;
+						case 'f': out += '\f'; break;
+						case 'n': out += '\n'; break;
+						case 'r': out += '\r'; break;
+						case 't': out += '\t'; break;
+						case 'u': {
+							uint32 c;
+							if (!hex4(c)) return false;
+							if (c >= 0xD800 && c < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+								p += 2;
+								uint32 low;
+								if (!hex4(low)) return false;
+								c = 0x10000 + ((c - 0xD800) << 10) + (low - 0xDC00);
+							}
+							appendUtf8(out, c);
+						} break;
+						default: return false;
+					}
+				}
+				if (p >= end) return false;
+				p++;
+				return true;
+			}
+
+			bool value(Json& out, uint32 depth) {
+				if (depth > MaxJsonDepth) return false;
+				skipSpace();
+				if (p >= end) return false;
+
+				switch (*p) {
+					case 'n': return literal("null");
+					case 't': out.type = Json::Bool; out.boolean = true; return literal("true");
+					case 'f': out.type = Json::Bool; return literal("false");
+					case '"': out.type = Json::String; return string(out.string);
+					case '[': {
+						out.type = Json::Array;
+						p++;
+						skipSpace();
+						if (p < end && *p == ']') {
+							p++;
+							return true;
+						}
+						while (true) {
+							out.items.emplace_back();
+							if (!value(out.items.back(), depth + 1)) return false;
+							skipSpace();
+							if (p < end && *p == ',') { p++; continue; }
+							if (p < end && *p == ']') { p++; return true; }
+							return false;
+						}
+					}
+					case '{': {
+						out.type = Json::Object;
+						p++;
+						skipSpace();
+						if (p < end && *p == '}') {
+							p++;
+							return true;
+						}
+						while (true) {
+							skipSpace();
+							out.keys.emplace_back();
+							if (!string(out.keys.back())) return false;
+							skipSpace();
+							if (p >= end || *p != ':') return false;
+							p++;
+							out.items.emplace_back();
+							if (!value(out.items.back(), depth + 1)) return false;
+							skipSpace();
+							if (p < end && *p == ',') { p++; continue; }
+							if (p < end && *p == '}') { p++; return true; }
+							return false;
+						}
+					}
+					default: {
+						out.type = Json::Number;
+						const auto r = std::from_chars(p, end, out.number);
+						if (r.ec != std::errc()) return false;
+						p = r.ptr;
+						return true;
+					}
+				}
+			}
+		};
+
+		inline uint32 readU32(const uint8* p) {
+			uint32 v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		uint32 componentCount(const std::string& type) {
+			if (type == "SCALAR") return 1;
+			if (type == "VEC2") return 2;
+			if (type == "VEC3") return 3;
+			if (type == "VEC4" || type == "MAT2") return 4;
+			if (type == "MAT3") return 9;
+			if (type == "MAT4") return 16;
+			return 0;
+		}
+
+		/// Rotation of an orthonormal basis given as columns (Shepperd's method).
+		Quaternion rotationFromColumns(const Vector3& c0, const Vector3& c1, const Vector3& c2) {
+			const float trace = c0.x + c1.y + c2.z;
+			Quaternion q;
+			if (trace > 0.0f) {
+				const float s = std::sqrt(trace + 1.0f) * 2.0f;
+				q = Quaternion((c1.z - c2.y) / s, (c2.x - c0.z) / s, (c0.y - c1.x) / s, 0.25f * s);
+			} else if (c0.x > c1.y && c0.x > c2.z) {
+				const float s = std::sqrt(1.0f + c0.x - c1.y - c2.z) * 2.0f;
+				q = Quaternion(0.25f * s, (c1.x + c0.y) / s, (c2.x + c0.z) / s, (c1.z - c2.y) / s);
+			} else if (c1.y > c2.z) {
+				const float s = std::sqrt(1.0f + c1.y - c0.x - c2.z) * 2.0f;
+				q = Quaternion((c1.x + c0.y) / s, 0.25f * s, (c2.y + c1.z) / s, (c2.x - c0.z) / s);
+			} else {
+				const float s = std::sqrt(1.0f + c2.z - c0.x - c1.y) * 2.0f;
+				q = Quaternion((c2.x + c0.z) / s, (c2.y + c1.z) / s, 0.25f * s, (c0.y - c1.x) / s);
+			}
+			return q;
+		}
+
+		Vector3 vec3(const Json& j, const Vector3& fallback) {
+			if (j.size() < 3) return fallback;
+			return Vector3(float(j[0].num(0.0)), float(j[1].num(0.0)), float(j[2].num(0.0)));
+		}
+
+		void parseNode(const Json& j, GltfData::Node& node) {
+			node.name = j["name"].string;
+			node.mesh = j["mesh"].index();
+			for (size_t i = 0; i < j["children"].size(); i++) {
+				const int32 c = j["children"][i].index();
+				if (c >= 0) node.children.push_back(uint32(c));
+			}
+
+			const Json& m = j["matrix"];
+			if (m.size() == 16) {
+				// Column major, decomposed into translation, rotation and scale.
+				float v[16];
+				for (uint32 i = 0; i < 16; i++) v[i] = float(m[i].num(0.0));
+				Vector3 c0(v[0], v[1], v[2]), c1(v[4], v[5], v[6]), c2(v[8], v[9], v[10]);
+				node.translation = Vector3(v[12], v[13], v[14]);
+				node.scale = Vector3(c0.length(), c1.length(), c2.length());
+				if (c0.cross(c1).dot(c2) < 0.0f) node.scale.x = -node.scale.x;
+				if (node.scale.x != 0.0f && node.scale.y != 0.0f && node.scale.z != 0.0f) {
+					node.rotation = rotationFromColumns(c0 / node.scale.x, c1 / node.scale.y, c2 / node.scale.z);
+				}
+				return;
+			}
+
+			node.translation = vec3(j["translation"], Vector3(0.0f));
+			node.scale = vec3(j["scale"], Vector3(1.0f));
+			const Json& r = j["rotation"];
+			if (r.size() == 4) {
+				node.rotation = Quaternion(float(r[0].num(0.0)), float(r[1].num(0.0)), float(r[2].num(0.0)), float(r[3].num(1.0)));
+			}
+		}
+
+		bool parseGlb(const uint8* data, size_t size, GltfData& out, std::string& error) {
+			if (size < 20 || readU32(data) != GlbMagic) {
+				error = "not a binary glTF file";
+				return false;
+			}
+			if (readU32(data + 4) != 2) {
+				error = "unsupported glTF version " + std::to_string(readU32(data + 4));
+				return false;
+			}
+			const uint64 length = std::min<uint64>(readU32(data + 8), size);
+
+			// A JSON chunk, then an optional binary one. Unknown chunks are skipped.
+			std::string_view text;
+			for (uint64 offset = 12; offset + 8 <= length;) {
+				const uint32 chunkLength = readU32(data + offset), chunkType = readU32(data + offset + 4);
+				if (offset + 8 + chunkLength > length) {
+					error = "truncated chunk";
+					return false;
+				}
+				if (chunkType == ChunkJson && text.empty()) text = std::string_view((const char*) data + offset + 8, chunkLength);
+				if (chunkType == ChunkBin && out.bin == nullptr) {
+					out.bin = data + offset + 8;
+					out.binSize = chunkLength;
+				}
+				offset += 8 + ((uint64(chunkLength) + 3) & ~uint64(3));
+			}
+
+			Json root;
+			JsonParser parser{ text.data(), text.data() + text.size() };
+			if (text.empty() || !parser.value(root, 0) || root.type != Json::Object) {
+				error = "invalid JSON chunk";
+				return false;
+			}
+
+			// Compressed geometry and the like can't be read without the extension.
+			const Json& required = root["extensionsRequired"];
+			if (required.size() > 0) {
+				error = "requires extension " + required[0].string;
+				return false;
+			}
+
+			// Only the buffer stored in the BIN chunk is available, external .bin files aren't supported.
+			const Json& buffers = root["buffers"];
+			for (size_t i = 0; i < buffers.size(); i++) {
+				if (buffers[i].has("uri")) {
+					error = "external buffers are not supported";
+					return false;
+				}
+			}
+
+			const Json& views = root["bufferViews"];
+			out.bufferViews.resize(views.size());
+			for (size_t i = 0; i < views.size(); i++) {
+				GltfData::BufferView& v = out.bufferViews[i];
+				v.byteOffset = uint64(views[i]["byteOffset"].num(0.0));
+				v.byteLength = uint64(views[i]["byteLength"].num(0.0));
+				v.byteStride = views[i]["byteStride"].uint(0);
+				if (views[i]["buffer"].index() != 0 || v.byteOffset + v.byteLength > out.binSize) {
+					error = "buffer view " + std::to_string(i) + " is outside of the binary chunk";
+					return false;
+				}
+			}
+
+			const Json& accessors = root["accessors"];
+			out.accessors.resize(accessors.size());
+			for (size_t i = 0; i < accessors.size(); i++) {
+				const Json& j = accessors[i];
+				GltfData::Accessor& a = out.accessors[i];
+				a.bufferView = j["bufferView"].index();
+				a.byteOffset = uint64(j["byteOffset"].num(0.0));
+				a.componentType = j["componentType"].uint(0);
+				a.components = componentCount(j["type"].string);
+				a.count = j["count"].uint(0);
+				a.normalized = j["normalized"].boolean;
+				a.sparse = j.has("sparse");
+				if (j["min"].size() >= 3 && j["max"].size() >= 3) {
+					a.hasBounds = true;
+					a.min = vec3(j["min"], Vector3(0.0f));
+					a.max = vec3(j["max"], Vector3(0.0f));
+				}
+				if (a.components == 0 || gltf::componentSize(a.componentType) == 0 || (a.bufferView >= int32(out.bufferViews.size()))) {
+					error = "invalid accessor " + std::to_string(i);
+					return false;
+				}
+			}
+
+			const Json& meshes = root["meshes"];
+			out.meshes.resize(meshes.size());
+			for (size_t i = 0; i < meshes.size(); i++) {
+				out.meshes[i].name = meshes[i]["name"].string;
+				const Json& prims = meshes[i]["primitives"];
+				for (size_t k = 0; k < prims.size(); k++) {
+					const Json& attributes = prims[k]["attributes"];
+					GltfData::Primitive p{};
+					p.position = attributes["POSITION"].index();
+					p.normal = attributes["NORMAL"].index();
+					p.tangent = attributes["TANGENT"].index();
+					p.texCoord = attributes["TEXCOORD_0"].index();
+					p.indices = prims[k]["indices"].index();
+					p.material = prims[k]["material"].index();
+					p.mode = prims[k]["mode"].uint(GltfData::ModeTriangles);
+
+					const int32 count = int32(out.accessors.size());
+					if (p.position >= count || p.normal >= count || p.tangent >= count || p.texCoord >= count || p.indices >= count) {
+						error = "primitive of mesh " + std::to_string(i) + " refers to a missing accessor";
+						return false;
+					}
+					out.meshes[i].primitives.push_back(p);
+				}
+			}
+
+			// Textures only add a sampler to an image, materials refer to the image directly.
+			std::vector<int32> textureImages;
+			const Json& textures = root["textures"];
+			for (size_t i = 0; i < textures.size(); i++) textureImages.push_back(textures[i]["source"].index());
+			auto image = [&](const Json& info) {
+				const int32 t = info["index"].index();
+				return t >= 0 && t < int32(textureImages.size()) ? textureImages[t] : -1;
+			};
+
+			const Json& materials = root["materials"];
+			out.materials.resize(materials.size());
+			for (size_t i = 0; i < materials.size(); i++) {
+				const Json& pbr = materials[i]["pbrMetallicRoughness"];
+				GltfData::Material& m = out.materials[i];
+				m.name = materials[i]["name"].string;
+				const Json& base = pbr["baseColorFactor"];
+				if (base.size() == 4) {
+					m.baseColor = Vector4(float(base[0].num(1.0)), float(base[1].num(1.0)), float(base[2].num(1.0)), float(base[3].num(1.0)));
+				}
+				m.metallic = float(pbr["metallicFactor"].num(1.0));
+				m.roughness = float(pbr["roughnessFactor"].num(1.0));
+				m.baseColorTexture = image(pbr["baseColorTexture"]);
+				m.metallicRoughnessTexture = image(pbr["metallicRoughnessTexture"]);
+				m.normalTexture = image(materials[i]["normalTexture"]);
+			}
+
+			const Json& images = root["images"];
+			out.images.resize(images.size());
+			for (size_t i = 0; i < images.size(); i++) {
+				out.images[i].bufferView = images[i]["bufferView"].index();
+				out.images[i].mimeType = images[i]["mimeType"].string;
+			}
+
+			const Json& nodes = root["nodes"];
+			out.nodes.resize(nodes.size());
+			for (size_t i = 0; i < nodes.size(); i++) parseNode(nodes[i], out.nodes[i]);
+
+			// Every node needs at most one parent and must lead back to a root, otherwise walking the tree never ends.
+			std::vector<uint8> hasParent(out.nodes.size(), 0);
+			for (const GltfData::Node& n : out.nodes) {
+				for (uint32 c : n.children) {
+					if (c >= out.nodes.size() || hasParent[c]) {
+						error = "invalid node hierarchy";
+						return false;
+					}
+					hasParent[c] = 1;
+				}
+			}
+
+			const Json& scenes = root["scenes"];
+			const int32 scene = root["scene"].index() >= 0 ? root["scene"].index() : 0;
+			if (scenes.size() > 0) {
+				const Json& sceneNodes = scenes[size_t(scene)]["nodes"];
+				for (size_t i = 0; i < sceneNodes.size(); i++) {
+					const int32 n = sceneNodes[i].index();
+					if (n >= 0 && n < int32(out.nodes.size()) && !hasParent[n]) out.roots.push_back(uint32(n));
+				}
+			} else {
+				for (uint32 i = 0; i < out.nodes.size(); i++) {
+					if (!hasParent[i]) out.roots.push_back(i);
+				}
+			}
+			return true;
+		}
+	}
+
+	namespace gltf {
+		bool parse(const uint8* data, size_t size, GltfData& out, std::string& error) {
+			out = GltfData{};
+			if (!parseGlb(data, size, out, error)) {
+				out = GltfData{};
+				return false;
+			}
+			return true;
+		}
+
+		uint32 componentSize(uint32 componentType) {
+			switch (componentType) {
+				case GltfData::Byte:
+				case GltfData::UnsignedByte: return 1;
+				case GltfData::Short:
+				case GltfData::UnsignedShort: return 2;
+				case GltfData::UnsignedInt:
+				case GltfData::Float: return 4;
+				default: return 0;
+			}
+		}
+
+		uint32 stride(const GltfData& data, const GltfData::Accessor& accessor) {
+			const uint32 packed = componentSize(accessor.componentType) * accessor.components;
+			if (accessor.bufferView < 0) return packed;
+			const uint32 s = data.bufferViews[accessor.bufferView].byteStride;
+			return s == 0 ? packed : s;
+		}
+
+		const uint8* elements(const GltfData& data, const GltfData::Accessor& accessor) {
+			if (accessor.bufferView < 0 || accessor.count == 0) return nullptr;
+
+			const GltfData::BufferView& view = data.bufferViews[accessor.bufferView];
+			const uint64 last = accessor.byteOffset + uint64(accessor.count - 1) * stride(data, accessor) +
+				componentSize(accessor.componentType) * accessor.components;
+			if (last > view.byteLength) return nullptr;
+			return data.bin + view.byteOffset + accessor.byteOffset;
+		}
+
+		void read(const GltfData& data, const GltfData::Accessor& accessor, uint32 i, float out[4]) {
+			const uint8* p = elements(data, accessor) + uint64(i) * stride(data, accessor);
+			const uint32 n = std::min(accessor.components, 4u);
+			for (uint32 c = 0; c < n; c++) {
+				switch (accessor.componentType) {
+					case GltfData::Float: std::memcpy(&out[c], p + c * 4, 4); break;
+					case GltfData::UnsignedByte: {
+						const float v = float(p[c]);
+						out[c] = accessor.normalized ? v / 255.0f : v;
+					} break;
+					case GltfData::Byte: {
+						const float v = float(int8(p[c]));
+						out[c] = accessor.normalized ? std::max(v / 127.0f, -1.0f) : v;
+					} break;
+					case GltfData::UnsignedShort: {
+						uint16 v;
+						std::memcpy(&v, p + c * 2, 2);
+						out[c] = accessor.normalized ? float(v) / 65535.0f : float(v);
+					} break;
+					case GltfData::Short: {
+						int16 v;
+						std::memcpy(&v, p + c * 2, 2);
+						out[c] = accessor.normalized ? std::max(float(v) / 32767.0f, -1.0f) : float(v);
+					} break;
+					case GltfData::UnsignedInt: {
+						uint32 v;
+						std::memcpy(&v, p + c * 4, 4);
+						out[c] = float(v);
+					} break;
+					default: out[c] = 0.0f; break;
+				}
+			}
+		}
+	}
+}
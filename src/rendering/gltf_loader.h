@@ -0,0 +1,98 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+
+#include <string>
+#include <vector>
+
+namespace ae {
+	/// The parts of a binary glTF 2.0 file the engine uses. Indices refer to the other arrays, -1 when absent.
+	/// Buffer data isn't copied, bin points into the file contents given to gltf::parse().
+	struct GltfData {
+		enum ComponentType : uint32 {
+			Byte = 5120,
+			UnsignedByte = 5121,
+			Short = 5122,
+			UnsignedShort = 5123,
+			UnsignedInt = 5125,
+			Float = 5126
+		};
+
+		static constexpr uint32 ModeTriangles = 4;
+
+		struct BufferView {
+			uint64 byteOffset{ 0 }, byteLength{ 0 };
+			uint32 byteStride{ 0 }; // 0 when tightly packed
+		};
+
+		struct Accessor {
+			int32 bufferView{ -1 };
+			uint64 byteOffset{ 0 };
+			uint32 componentType{ Float }, components{ 1 }, count{ 0 };
+			bool normalized{ false }, sparse{ false }, hasBounds{ false };
+			Vector3 min{}, max{};
+		};
+
+		struct Primitive {
+			int32 position{ -1 }, normal{ -1 }, tangent{ -1 }, texCoord{ -1 }; // Accessors
+			int32 indices{ -1 }, material{ -1 };
+			uint32 mode{ ModeTriangles };
+		};
+
+		struct Mesh {
+			std::string name;
+			std::vector<Primitive> primitives;
+		};
+
+		struct Material {
+			std::string name;
+			Vector4 baseColor{ 1.0f };
+			float metallic{ 1.0f }, roughness{ 1.0f };
+			int32 baseColorTexture{ -1 }, normalTexture{ -1 }, metallicRoughnessTexture{ -1 }; // Images
+		};
+
+		struct Image {
+			int32 bufferView{ -1 };
+			std::string mimeType;
+		};
+
+		struct Node {
+			std::string name;
+			int32 mesh{ -1 };
+			std::vector<uint32> children;
+			Vector3 translation{ 0.0f }, scale{ 1.0f };
+			Quaternion rotation{};
+		};
+
+		std::vector<BufferView> bufferViews;
+		std::vector<Accessor> accessors;
+		std::vector<Mesh> meshes;
+		std::vector<Material> materials;
+		std::vector<Image> images;
+		std::vector<Node> nodes;
+		std::vector<uint32> roots; // Nodes of the default scene
+
+		const uint8* bin{ nullptr };
+		uint64 binSize{ 0 };
+	};
+
+	namespace gltf {
+		/// Parses a .glb container. On failure returns false with the reason in error.
+		bool parse(const uint8* data, size_t size, GltfData& out, std::string& error);
+
+		uint32 componentSize(uint32 componentType);
+
+		/// Distance between consecutive elements of accessor.
+		uint32 stride(const GltfData& data, const GltfData::Accessor& accessor);
+
+		/// First element of accessor in the binary chunk, nullptr unless all of its elements lie within it.
+		const uint8* elements(const GltfData& data, const GltfData::Accessor& accessor);
+
+		/// Element i as up to 4 floats, normalized integers mapped to [0, 1] or [-1, 1]. elements() must be valid.
+		void read(const GltfData& data, const GltfData::Accessor& accessor, uint32 i, float out[4]);
+	}
+}
+
+#endif // GLTF_LOADER_H
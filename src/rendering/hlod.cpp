@@ -0,0 +1,272 @@
+#include "hlod.h"
+
+#include "renderer.h"
+#include "texture_loader.h"
+#include "mesh_optimizer.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+namespace ae {
+	namespace {
+		/// A distinct member material in the atlas. Solid tiles hold one colour, for members without a diffuse map
+		/// or whose texture coordinates wrap, which the atlas can't repeat.
+		struct Tile {
+			Texture* texture;
+			Vector3 base;
+			bool solid;
+		};
+
+		/// Box filters an RGBA8 image down (or nearest up) to size x size texels at dst, rows dstStride apart.
+		void resample(const uint8* src, uint32 sw, uint32 sh, uint8* dst, uint32 dstStride, uint32 size) {
+			for (uint32 y = 0; y < size; y++) {
+				const uint32 y0 = y * sh / size, y1 = std::max(y0 + 1, (y + 1) * sh / size);
+				for (uint32 x = 0; x < size; x++) {
+					const uint32 x0 = x * sw / size, x1 = std::max(x0 + 1, (x + 1) * sw / size);
+					uint32 sum[4]{};
+					for (uint32 sy = y0; sy < y1; sy++) {
+						for (uint32 sx = x0; sx < x1; sx++) {
+							for (uint32 c = 0; c < 4; c++) sum[c] += src[(size_t(sy) * sw + sx) * 4 + c];
+						}
+					}
+					const uint32 n = (y1 - y0) * (x1 - x0);
+					for (uint32 c = 0; c < 4; c++) dst[size_t(y) * dstStride + x * 4 + c] = uint8((sum[c] + n / 2) / n);
+				}
+			}
+		}
+	}
+
+	void HLOD::build(EntityWorld* world, const Settings& settings) {
+		m_settings = settings;
+		// The atlases are baked from the member textures, placeholders would end up in them.
+		TextureLoader::ston().finish();
+
+		// std::map keeps the cells, and so the cluster order, independent of the hash seed.
+		std::map<std::tuple<int32, int32, int32>, std::vector<Entity*>> cells;
+		world->each([&](Entity* ent, MeshComponent* comp) {
+			const Mesh* mesh = comp->mesh();
+			if (!comp->staticGeometry() || comp->cluster() >= 0 || comp->proxy()) return;
+			if (mesh == nullptr || mesh->lodCount() == 0 || mesh->skinned() || mesh->streaming()) return;
+
+			const Vector3 c = mesh->aabb().transformed(ent->affineTransform()).center() * (1.0f / settings.cellSize);
+			cells[{ int32(std::floor(c.x)), int32(std::floor(c.y)), int32(std::floor(c.z)) }].push_back(ent);
+		});
+
+		uint32 baked = 0;
+		for (auto&& [cell, members] : cells) {
+			if (members.size() >= settings.minEntities && bake(world, members)) baked++;
+		}
+		Log.info("HLOD: " + std::to_string(baked) + " clusters from " + std::to_string(cells.size()) + " cells");
+	}
+
+	bool HLOD::bake(EntityWorld* world, std::vector<Entity*> members) {
+		AABB bounds = AABB::empty();
+		for (Entity* ent : members) {
+			bounds.expand(ent->getComponent<MeshComponent>()->mesh()->aabb().transformed(ent->affineTransform()));
+		}
+		const float diagonal = bounds.size().length();
+
+		std::vector<Tile> tiles;
+		std::vector<Vertex> vertices, memberVertices;
+		std::vector<uint32> indices, memberIndices, memberTiles, memberFirsts;
+		float shininess = 0.0f, specular = 0.0f;
+		bool castsShadow = false;
+
+		size_t kept = 0;
+		for (Entity* ent : members) {
+			MeshComponent* comp = ent->getComponent<MeshComponent>();
+			const Mesh* mesh = comp->mesh();
+			const Affine3x4 model = ent->affineTransform();
+
+			// The coarsest level that's still well below the proxy's own error saves simplification work.
+			const float meshDiagonal = mesh->aabb().transformed(model).size().length();
+			uint32 level = 0;
+			while (
+				level + 1 < mesh->lodCount() &&
+				mesh->lod(level + 1).error * meshDiagonal < m_settings.maxError * diagonal * 0.5f
+			) level++;
+			if (!mesh->readBack(level, memberVertices, memberIndices)) {
+				Log.warn("HLOD: couldn't read back a member mesh, it's left out of its cluster");
+				continue;
+			}
+
+			Material& mat = comp->material();
+			Texture* texture = mat.texture(Material::SlotDiffuse);
+			bool wraps = false;
+			for (const Vertex& v : memberVertices) {
+				wraps |= v.texCoord.x < -1e-3f || v.texCoord.x > 1.001f || v.texCoord.y < -1e-3f || v.texCoord.y > 1.001f;
+			}
+			const Tile tile{ texture, mat.base(), texture == nullptr || wraps };
+			auto found = std::find_if(tiles.begin(), tiles.end(), [&](const Tile& t) {
+				return t.texture == tile.texture && t.solid == tile.solid &&
+					t.base.x == tile.base.x && t.base.y == tile.base.y && t.base.z == tile.base.z;
+			});
+			memberTiles.push_back(uint32(found - tiles.begin()));
+			memberFirsts.push_back(uint32(vertices.size()));
+			if (found == tiles.end()) tiles.push_back(tile);
+
+			// Normals go through the inverse transpose, so non-uniform scale keeps them perpendicular.
+			const Affine3x4 inverse = model.inverse();
+			const Vector3 n0{ inverse[0].x, inverse[0].y, inverse[0].z };
+			const Vector3 n1{ inverse[1].x, inverse[1].y, inverse[1].z };
+			const Vector3 n2{ inverse[2].x, inverse[2].y, inverse[2].z };
+			const uint32 first = uint32(vertices.size());
+			for (Vertex v : memberVertices) {
+				v.position = model.transformPoint(v.position);
+				v.normal = (n0 * v.normal.x + n1 * v.normal.y + n2 * v.normal.z).normalized();
+				v.tangent = model.transformVector(v.tangent).normalized();
+				vertices.push_back(v);
+			}
+			for (uint32 i : memberIndices) indices.push_back(first + i);
+
+			shininess += mat.shininess();
+			specular += mat.specular();
+			castsShadow |= mat.castsShadow();
+			members[kept++] = ent;
+		}
+		members.resize(kept);
+		if (members.size() < m_settings.minEntities || indices.empty()) return false;
+
+		// Tiles sit in a square-ish grid, texture coordinates stay half a texel inside their tile.
+		const uint32 size = m_settings.tileSize;
+		const uint32 columns = uint32(std::ceil(std::sqrt(float(tiles.size()))));
+		const uint32 rows = (uint32(tiles.size()) + columns - 1) / columns;
+		const uint32 atlasWidth = columns * size, atlasHeight = rows * size;
+		auto tileOrigin = [&](uint32 t) { return Vector2(float(t % columns * size), float(t / columns * size)); };
+
+		std::vector<uint8> atlas(size_t(atlasWidth) * atlasHeight * 4), texels;
+		for (size_t t = 0; t < tiles.size(); t++) {
+			const Tile& tile = tiles[t];
+			const Vector2 origin = tileOrigin(uint32(t));
+			uint8* dst = atlas.data() + (size_t(origin.y) * atlasWidth + size_t(origin.x)) * 4;
+
+			// The smallest mip level still covering the tile, level 0 if the texture has no mips.
+			uint32 sw = 0, sh = 0;
+			bool read = false;
+			if (tile.texture != nullptr) {
+				const uint32 smaller = std::min(tile.texture->width(), tile.texture->height());
+				uint32 level = 0;
+				while ((smaller >> (level + 1)) >= size) level++;
+				read = tile.texture->readBack(level, texels, sw, sh) || tile.texture->readBack(0, texels, sw, sh);
+			}
+			if (read) {
+				resample(texels.data(), sw, sh, dst, atlasWidth * 4, size);
+			} else {
+				texels.assign(4, 255);
+				resample(texels.data(), 1, 1, dst, atlasWidth * 4, size);
+			}
+
+			// The atlas stands in with a white base, so the member's base colour is baked into the texels.
+			const float scales[4] = { tile.base.x, tile.base.y, tile.base.z, 1.0f };
+			uint64 sum[4]{};
+			for (uint32 y = 0; y < size; y++) {
+				for (uint32 x = 0; x < size * 4; x++) {
+					uint8& texel = dst[size_t(y) * atlasWidth * 4 + x];
+					const float scale = scales[x % 4];
+					texel = uint8(std::min(float(texel) * scale + 0.5f, 255.0f));
+					sum[x % 4] += texel;
+				}
+			}
+			if (!tile.solid) continue;
+			for (uint32 y = 0; y < size; y++) {
+				for (uint32 x = 0; x < size * 4; x++) {
+					dst[size_t(y) * atlasWidth * 4 + x] = uint8(sum[x % 4] / (size_t(size) * size));
+				}
+			}
+		}
+
+		for (size_t m = 0; m < members.size(); m++) {
+			const Tile& tile = tiles[memberTiles[m]];
+			const Vector2 origin = tileOrigin(memberTiles[m]);
+			const uint32 end = m + 1 < members.size() ? memberFirsts[m + 1] : uint32(vertices.size());
+			for (uint32 i = memberFirsts[m]; i < end; i++) {
+				Vector2& uv = vertices[i].texCoord;
+				const Vector2 local = tile.solid ? Vector2(float(size) * 0.5f) : uv * float(size - 1) + Vector2(0.5f);
+				uv = Vector2((origin.x + local.x) / float(atlasWidth), (origin.y + local.y) / float(atlasHeight));
+			}
+		}
+
+		const size_t sourceIndices = indices.size();
+		const size_t target = std::max<size_t>(size_t(float(sourceIndices) * m_settings.triangleRatio) / 3 * 3, 3);
+		float error = 0.0f;
+		std::vector<uint32> simplified = meshopt::simplify(
+			indices.data(), indices.size(), vertices.data(), vertices.size(), target, m_settings.maxError, &error
+		);
+		if (simplified.empty()) simplified = std::move(indices);
+
+		auto mesh = std::make_unique<Mesh>();
+		mesh->setData(vertices, simplified);
+		mesh->optimize();
+		mesh->generateLods(2, 0.5f, m_settings.maxError * 2.0f);
+		mesh->vertexFormat(VertexFormat::Packed);
+		mesh->raycastable(false);
+		mesh->build();
+
+		auto texture = std::make_unique<Texture>();
+		texture->setSize(atlasWidth, atlasHeight);
+		texture->bind();
+		texture->filter(TextureFilter::LinearMipLinear, TextureFilter::Linear);
+		texture->wrap(TextureWrap::Clamp, TextureWrap::Clamp);
+		texture->setData(atlas.data(), TextureFormat::RGBA);
+		texture->unbind();
+
+		const int32 index = int32(m_clusters.size());
+		Entity* proxy = world->create();
+		MeshComponent* comp = proxy->createComponent<MeshComponent>(mesh.get());
+		comp->m_cluster = index;
+		comp->m_proxy = true;
+		Material& mat = comp->material();
+		mat.texture(Material::SlotDiffuse, texture.get());
+		mat.shininess(shininess / float(members.size()));
+		mat.specular(specular / float(members.size()));
+		mat.castsShadow(castsShadow);
+		for (Entity* ent : members) ent->getComponent<MeshComponent>()->m_cluster = index;
+
+		const float radius = diagonal * 0.5f;
+		std::vector<EntityHandle> handles(members.begin(), members.end());
+		m_clusters.push_back({
+			bounds, std::move(handles), EntityHandle(proxy), m_settings.switchDistance * radius,
+			uint32(sourceIndices / 3), uint32(simplified.size() / 3), false
+		});
+		m_meshes.push_back(std::move(mesh));
+		m_atlases.push_back(std::move(texture));
+
+		Log.info(
+			"HLOD cluster " + std::to_string(index) + ": " + std::to_string(members.size()) + " members, " +
+			std::to_string(sourceIndices / 3) + " -> " + std::to_string(simplified.size() / 3) + " triangles, " +
+			std::to_string(tiles.size()) + " atlas tiles, error " + std::to_string(error)
+		);
+		return true;
+	}
+
+	void HLOD::clear() {
+		// Members and proxies recycled by the world since build() belong to someone else now.
+		auto component = [](const EntityHandle& handle) {
+			Entity* ent = handle.get();
+			return ent ? ent->getComponent<MeshComponent>() : nullptr;
+		};
+		for (Cluster& c : m_clusters) {
+			for (const EntityHandle& member : c.members) {
+				if (MeshComponent* comp = component(member)) comp->m_cluster = -1;
+			}
+			// The entity lives until the world's next update, it mustn't draw the freed mesh until then.
+			if (MeshComponent* comp = component(c.proxy)) {
+				comp->mesh(nullptr);
+				c.proxy.get()->destroy();
+			}
+		}
+		m_clusters.clear();
+		m_meshes.clear();
+		m_atlases.clear();
+	}
+
+	void HLOD::update(const Vector3& eye) {
+		for (Cluster& c : m_clusters) {
+			const float distance = (c.bounds.center() - eye).length();
+			c.far = distance > c.switchDistance * (c.far ? 1.0f - m_settings.hysteresis : 1.0f);
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#ifndef HLOD_H
+#define HLOD_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+#include "mesh.h"
+#include "texture.h"
+#include "game_logic.h"
+
+#include <memory>
+#include <vector>
+
+namespace ae {
+	/// Hierarchical level of detail: static mesh components grouped by a uniform grid, each group baked into one
+	/// simplified proxy mesh textured from an atlas of its members' diffuse maps. Past a cluster's switch distance
+	/// the renderer draws the proxy instead of the members, one draw instead of many.
+	/// Owns the proxy meshes and atlases, clear() it before it goes away while the world still draws them.
+	class HLOD {
+	public:
+		struct Settings {
+			float cellSize{ 32.0f };      // Grid cell edge in world units, members are grouped by their bounds centre
+			uint32 minEntities{ 4 };      // Cells with fewer members aren't worth a proxy
+			float triangleRatio{ 0.1f };  // Proxy triangles relative to the merged members
+			float maxError{ 0.02f };      // Simplification error, relative to the cluster diagonal
+			uint32 tileSize{ 64 };        // Atlas texels per side for each distinct member material
+			float switchDistance{ 6.0f }; // In cluster radii from the cluster centre
+			float hysteresis{ 0.1f };     // Fraction of the switch distance the camera has to come back in by
+		};
+
+		struct Cluster {
+			AABB bounds;
+			std::vector<EntityHandle> members; // Members and proxy may be destroyed behind the HLOD's back
+			EntityHandle proxy;
+			float switchDistance;
+			uint32 sourceTriangles, proxyTriangles;
+			bool far;
+		};
+
+		/// Groups the static mesh components of world that aren't clustered yet and adds a proxy entity for every
+		/// group with enough members. Reads the member geometry and textures back from the GPU.
+		void build(EntityWorld* world, const Settings& settings);
+		void build(EntityWorld* world) { build(world, Settings()); }
+
+		/// Destroys the proxy entities and hands the members back to the renderer.
+		void clear();
+
+		/// Decides for every cluster whether its proxy is drawn, from the camera position.
+		void update(const Vector3& eye);
+
+		/// True while cluster is drawn through its proxy.
+		bool far(uint32 cluster) const { return cluster < m_clusters.size() && m_clusters[cluster].far; }
+
+		const std::vector<Cluster>& clusters() const { return m_clusters; }
+
+	private:
+		Settings m_settings{};
+		std::vector<Cluster> m_clusters;
+		std::vector<std::unique_ptr<Mesh>> m_meshes;
+		std::vector<std::unique_ptr<Texture>> m_atlases;
+
+		/// Merges members into a proxy, false if too few of them could be read back.
+		bool bake(EntityWorld* world, std::vector<Entity*> members);
+	};
+}
+
+#endif // HLOD_H
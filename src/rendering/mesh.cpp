@@ -1,13 +1,102 @@
 #include "mesh.h"
 
 #include "file_system.h"
+#include "obj_loader.h"
+#include "mesh_optimizer.h"
+#include "geometry.h"
 #include "util.hpp"
 
-#include <sstream>
-#include <cfloat>
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <numeric>
 
 namespace ae {
+	namespace {
+		// .aemesh: header, then the GPU-ready vertex and index buffers, each 16 byte aligned.
+		constexpr uint32 MeshFileMagic = 0x534D4541; // "AEMS"
+		constexpr uint32 MeshFileVersion = 7;
+
+		struct MeshFileHeader {
+			uint32 magic, version;
+			uint64 sourceHash;
+			uint32 vertexFormat, vertexCount, indexCount, lodCount;
+			VertexLayout layout;
+			float aabbMin[3], aabbMax[3];
+			Mesh::Lod lods[Mesh::MaxLods];
+			uint32 meshletCount, indexSize;
+			uint64 vertexOffset, indexOffset, meshletOffset;
+		};
+
+		inline uint64 alignTo16(uint64 v) { return (v + 15) & ~uint64(15); }
+
+		/// 16 bit indices whenever they can address every vertex.
+		inline uint32 indexSizeFor(size_t vertexCount) { return vertexCount <= 65536 ? 2 : 4; }
+
+		inline const void* indexData(const std::vector<uint32>& indices, uint32 indexSize, std::vector<uint16>& narrow) {
+			if (indexSize == sizeof(uint32)) return indices.data();
+			narrow.resize(indices.size());
+			for (size_t i = 0; i < indices.size(); i++) narrow[i] = uint16(indices[i]);
+			return narrow.data();
+		}
+
+		/// Packs vertices against bounds, with the tangent sign of every vertex taken from the UV winding of its triangles.
+		void packMesh(const std::vector<Vertex>& vertices, const std::vector<uint32>& indices, const AABB& bounds, std::vector<PackedVertex>& out) {
+			std::vector<float> signs(vertices.size());
+			geometry::tangentSigns(vertices.data(), vertices.size(), indices.data(), indices.size(), signs.data());
+			out.resize(vertices.size());
+			packVertices(vertices.data(), out.data(), vertices.size(), bounds, signs.data());
+		}
+
+		inline uint32 componentSize(uint32 type) {
+			switch (type) {
+				case GL_BYTE: case GL_UNSIGNED_BYTE: return 1;
+				case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT: return 2;
+				default: return 4;
+			}
+		}
+
+		/// One vertex attribute component as the GL would feed it to the shader.
+		float readComponent(const uint8* p, uint32 type, bool normalized) {
+			switch (type) {
+				case GL_BYTE: { int8 v; std::memcpy(&v, p, 1); return normalized ? std::max(v / 127.0f, -1.0f) : v; }
+				case GL_UNSIGNED_BYTE: return normalized ? p[0] / 255.0f : p[0];
+				case GL_SHORT: { int16 v; std::memcpy(&v, p, 2); return normalized ? std::max(v / 32767.0f, -1.0f) : v; }
+				case GL_UNSIGNED_SHORT: { uint16 v; std::memcpy(&v, p, 2); return normalized ? v / 65535.0f : v; }
+				case GL_HALF_FLOAT: { uint16 v; std::memcpy(&v, p, 2); return packing::fromHalf(v); }
+				case GL_UNSIGNED_INT: { uint32 v; std::memcpy(&v, p, 4); return normalized ? v / 4294967295.0f : float(v); }
+				default: { float v; std::memcpy(&v, p, 4); return v; }
+			}
+		}
+	}
+
+	VertexLayout vertexLayout(VertexFormat format) {
+		VertexLayout l{};
+		if (format == VertexFormat::Packed) {
+			// vPosition.w carries the tangent sign, the octahedral normal/tangent leave z at 0 for the shader to decode.
+			l.stride = sizeof(PackedVertex);
+			l.attributes[0] = { 4, GL_UNSIGNED_SHORT, true, uint32(offsetof(PackedVertex, position)) };
+			l.attributes[1] = { 2, GL_SHORT, true, uint32(offsetof(PackedVertex, normal)) };
+			l.attributes[2] = { 2, GL_SHORT, true, uint32(offsetof(PackedVertex, tangent)) };
+			l.attributes[3] = { 2, GL_HALF_FLOAT, false, uint32(offsetof(PackedVertex, texCoord)) };
+		} else {
+			l.stride = sizeof(Vertex);
+			l.attributes[0] = { 3, GL_FLOAT, false, uint32(offsetof(Vertex, position)) };
+			l.attributes[1] = { 3, GL_FLOAT, false, uint32(offsetof(Vertex, normal)) };
+			l.attributes[2] = { 3, GL_FLOAT, false, uint32(offsetof(Vertex, tangent)) };
+			l.attributes[3] = { 2, GL_FLOAT, false, uint32(offsetof(Vertex, texCoord)) };
+		}
+		return l;
+	}
+
+	void setVertexAttributes(const VertexLayout& layout) {
+		for (uint32 i = 0; i < VertexLayout::AttributeCount; i++) {
+			const auto& a = layout.attributes[i];
+			glVertexAttribPointer(i, a.components, a.type, a.normalized, layout.stride, (void*) uintptr_t(a.offset));
+		}
+	}
+
 	void Mesh::create() {
 		glGenVertexArrays(1, &m_vao);
 		glGenBuffers(1, &m_vbo);
@@ -21,15 +110,34 @@ namespace ae {
 		glEnableVertexAttribArray(2);
 		glEnableVertexAttribArray(3);
 
-		glVertexAttribPointer(0, 3, GL_FLOAT, false, sizeof(Vertex), (void*) offsetof(Vertex, position));
-		glVertexAttribPointer(1, 3, GL_FLOAT, false, sizeof(Vertex), (void*) offsetof(Vertex, normal));
-		glVertexAttribPointer(2, 3, GL_FLOAT, false, sizeof(Vertex), (void*) offsetof(Vertex, tangent));
-		glVertexAttribPointer(3, 2, GL_FLOAT, false, sizeof(Vertex), (void*) offsetof(Vertex, texCoord));
+		setupAttributes();
 
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 		glBindVertexArray(0);
 	}
 
+	void Mesh::setupAttributes() {
+		setVertexAttributes(vertexLayout(m_format));
+	}
+
+	void Mesh::vertexFormat(VertexFormat format) {
+		if (format == m_format) return;
+		m_format = format;
+
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		setupAttributes();
+		glBindVertexArray(0);
+	}
+
+	Vector3 Mesh::positionScale() const {
+		return m_format == VertexFormat::Packed ? m_aabb.size() : Vector3(1.0f);
+	}
+
+	Vector3 Mesh::positionOffset() const {
+		return m_format == VertexFormat::Packed ? m_aabb.min : Vector3(0.0f);
+	}
+
 	Mesh::Mesh() {
 		create();
 	}
@@ -39,7 +147,7 @@ namespace ae {
 	}
 
 	void Mesh::bind() {
-		glBindVertexArray(m_vao);
+		glBindVertexArray(vao());
 	}
 
 	void Mesh::unbind() {
@@ -48,13 +156,77 @@ namespace ae {
 
 	void Mesh::draw(PrimitiveType primitive, int32 length, uint32 offset) {
 		length = length < 0 ? m_length : length;
-		glDrawElements(primitive, length, GL_UNSIGNED_INT, (void*) (offset * sizeof(uint32)));
+		const uintptr_t start = uintptr_t(offset + baseIndex()) * m_indexSize;
+		glDrawElementsBaseVertex(primitive, length, indexType(), (void*) start, GLint(baseVertex()));
+	}
+
+	void Mesh::drawInstanced(PrimitiveType primitive, int32 length, uint32 offset, uint32 instances) {
+		length = length < 0 ? m_length : length;
+		const uintptr_t start = uintptr_t(offset + baseIndex()) * m_indexSize;
+		glDrawElementsInstancedBaseVertex(
+			primitive, length, indexType(), (void*) start, GLsizei(instances), GLint(baseVertex())
+		);
+	}
+
+	void Mesh::drawRanges(PrimitiveType primitive, const int32* lengths, const uint32* offsets, uint32 drawCount) {
+		m_rangeOffsets.resize(drawCount);
+		const uint32 first = baseIndex();
+		for (uint32 i = 0; i < drawCount; i++) m_rangeOffsets[i] = (void*) (uintptr_t(offsets[i] + first) * m_indexSize);
+		m_rangeBaseVertices.assign(drawCount, GLint(baseVertex()));
+		glMultiDrawElementsBaseVertex(
+			primitive, lengths, indexType(), m_rangeOffsets.data(), drawCount, m_rangeBaseVertices.data()
+		);
 	}
 
 	void Mesh::dynamic(bool v) {
 		m_dynamic = v;
 	}
 
+	void Mesh::stream(uint32 maxVertices, uint32 maxIndices) {
+		m_dynamic = true;
+		m_format = VertexFormat::Float;
+		m_indexSize = sizeof(uint32);
+		m_lods.assign(1, { 0, 0, 0.0f });
+		m_meshlets.clear();
+
+		// Regions must start on whole vertices for the base vertex offset.
+		m_streamIndexOffset = maxVertices * sizeof(Vertex);
+		m_stream = std::make_unique<StreamBuffer>();
+		m_stream->create(m_streamIndexOffset + maxIndices * sizeof(uint32), std::lcm(uint32(sizeof(Vertex)), 16u));
+
+		// The same buffer holds vertices and indices.
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_stream->id());
+		setupAttributes();
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_stream->id());
+		glBindVertexArray(0);
+	}
+
+	void Mesh::beginStream() {
+		m_stream->begin();
+	}
+
+	Vertex* Mesh::streamVertices() {
+		return reinterpret_cast<Vertex*>(m_stream->data());
+	}
+
+	uint32* Mesh::streamIndices() {
+		return reinterpret_cast<uint32*>(m_stream->data() + m_streamIndexOffset);
+	}
+
+	void Mesh::endStream(uint32 vertexCount, uint32 indexCount, const AABB& bounds) {
+		Log.assert(
+			vertexCount * sizeof(Vertex) <= m_streamIndexOffset &&
+			m_streamIndexOffset + indexCount * sizeof(uint32) <= m_stream->regionSize(),
+			"Streamed geometry exceeds the reserved size."
+		);
+		m_baseVertex = m_stream->offset() / sizeof(Vertex);
+		m_baseIndex = (m_stream->offset() + m_streamIndexOffset) / sizeof(uint32);
+		m_lods[0].count = indexCount;
+		m_length = indexCount;
+		m_aabb = bounds;
+	}
+
 	void Mesh::addVertex(const Vertex& vertex) {
 		m_vertices.push_back(vertex);
 	}
@@ -75,327 +247,557 @@ namespace ae {
 	}
 
 	void Mesh::fromFile(const std::string& fileName) {
+		auto& fs = FileSystem::ston();
+		const size_t dot = fileName.find_last_of('.');
+		const std::string ext = dot == std::string::npos ? "" : fileName.substr(dot);
+
+		if (ext == ".aemesh") {
+			if (!loadBinary(fs.nativePath(fileName))) {
+				Log.error("Invalid mesh file: " + fileName);
+			}
+			return;
+		}
+
 		auto file = FileSystem::ston().open(fileName);
 		auto sz = file.size();
 		std::string data(sz, '\0');
 
 		if (file.read(data.data(), sz) == sz) {
-			std::stringstream ss, outVS, outFS, outGS, outCS;
-			ss << data.data();
-
-			std::vector<Face> faces;
-			std::vector<Vector3> vertices, normals;
-			std::vector<Vector2> texCoords;
-			bool reverseVertexOrder = false, calcNormals = false, calcTangs = false, fnormalize = false, fcentralize = false;
-			Vector4 uvTransform{ 0.0f, 0.0f, 1.0f, 1.0f };
-
-			std::string line;
-			while (std::getline(ss, line)) {
-				line = util::rtrim(line);
-
-				std::stringstream ls(line);
-				std::string tok; ls >> tok;
-
-				if (tok == "f") {
-					// WARNING! : Triangulate your meshes before using them!
-					for (uint32 i = 0; i < 3; i++) {
-						std::string face; ls >> face;
-						auto faceData = util::split(face, '/');
-						Face f{};
-						if (faceData.size() == 1) { // f v0 ...
-							f.vertex = std::stoi(faceData[0])-1;
-						} else if (faceData.size() == 2) { // f v0/vt0
-							f.vertex = std::stoi(faceData[0])-1;
-							f.texCoord = std::stoi(faceData[1])-1;
-						} else if (faceData.size() == 3) {
-							if (faceData[1].empty()) { // f v0//vn0
-								f.vertex = std::stoi(faceData[0])-1;
-								f.normal = std::stoi(faceData[2])-1;
-							} else { // f v0/vt0/vn0
-								f.vertex = std::stoi(faceData[0])-1;
-								f.texCoord = std::stoi(faceData[1])-1;
-								f.normal = std::stoi(faceData[2])-1;
-							}
-						}
-						faces.push_back(f);
-					}
-				} else if (tok == "v") {
-					std::string comp;
-					ls >> comp;
-					float x = std::stof(comp);
-					ls >> comp;
-					float y = std::stof(comp);
-					ls >> comp;
-					float z = std::stof(comp);
-					vertices.push_back(Vector3(x, y, z));
-				} else if (tok == "vt") {
-					std::string comp;
-					ls >> comp;
-					float x = std::stof(comp);
-					ls >> comp;
-					float y = std::stof(comp);
-					texCoords.push_back(Vector2(x, y));
-				} else if (tok == "vn") {
-					std::string comp;
-					ls >> comp;
-					float x = std::stof(comp);
-					ls >> comp;
-					float y = std::stof(comp);
-					ls >> comp;
-					float z = std::stof(comp);
-					normals.push_back(Vector3(x, y, z));
-				} else if (tok == "reverse_vertices") {
-					std::string comp;
-					ls >> comp;
-					if (comp == "1") reverseVertexOrder = true;
-				} else if (tok == "calc_normals") {
-					calcNormals = true;
-				} else if (tok == "calc_tangents") {
-					calcTangs = true;
-				} else if (tok == "normalize") {
-					fnormalize = true;
-				} else if (tok == "centralize") {
-					fcentralize = true;
-				} else if (tok == "uv_transform") {
-					std::string comp;
-					ls >> comp;
-					float x = std::stof(comp);
-					ls >> comp;
-					float y = std::stof(comp);
-					ls >> comp;
-					float z = std::stof(comp);
-					ls >> comp;
-					float w = std::stof(comp);
-					uvTransform = Vector4(x, y, z, w);
-				}
+			// Processed meshes are cached next to their source, keyed by its contents.
+			const uint64 sourceHash = util::hash64(data.data(), data.size());
+			const std::string sourcePath = fs.nativePath(fileName);
+			const std::string cachePath = sourcePath.empty() ? "" : sourcePath.substr(0, sourcePath.size() - ext.size()) + ".aemesh";
+			if (!cachePath.empty() && loadBinary(cachePath, sourceHash)) {
+				file.close();
+				return;
 			}
 
+			const auto start = std::chrono::steady_clock::now();
+
+			ObjData obj{};
+			obj::parse(data, obj);
+
+			const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			Log.info(
+				fileName + ": " + std::to_string(obj.corners.size() / 3) + " triangles, parsed at " +
+				std::to_string(int(double(sz) / (1024.0 * 1024.0) / std::max(secs, 1e-9))) + " MB/s"
+			);
+
 			std::vector<Vertex> verticesConverted;
 			std::vector<uint32> indices;
+			verticesConverted.reserve(obj.corners.size());
+			indices.reserve(obj.corners.size());
+
 			uint32 idx = 0;
-			for (uint32 i = 0; i < faces.size(); i += 3) {
+			for (uint32 i = 0; i + 2 < obj.corners.size(); i += 3) {
 				for (uint32 j = 0; j < 3; j++) {
-					uint32 k = i + (reverseVertexOrder ? (2 - j) : j);
-					Face& f = faces[k];
+					uint32 k = i + (obj.reverseVertexOrder ? (2 - j) : j);
+					const ObjData::Corner& f = obj.corners[k];
 					Vertex vert{};
-					if (f.vertex != -1) vert.position = vertices[f.vertex];
-					if (f.normal != -1) vert.normal = normals[f.normal];
-					if (f.texCoord != -1) vert.texCoord = texCoords[f.texCoord];
+					if (f.vertex < obj.positions.size()) vert.position = obj.positions[f.vertex];
+					if (f.normal < obj.normals.size()) vert.normal = obj.normals[f.normal];
+					if (f.texCoord < obj.texCoords.size()) vert.texCoord = obj.texCoords[f.texCoord];
 					verticesConverted.push_back(vert);
 					indices.push_back(idx++);
 				}
 			}
-			setData(verticesConverted, indices);
-			if (fcentralize) centralize();
-			if (fnormalize) normalize();
-			if (calcNormals) calculateNormals(Mesh::Triangles);
-			if (calcTangs) calculateTangents(Mesh::Triangles);
+			m_vertices = std::move(verticesConverted);
+			m_indices = std::move(indices);
+			if (obj.packedVertices) vertexFormat(VertexFormat::Packed);
+			if (obj.centralize) centralize();
+			if (obj.normalize) normalize();
+			if (obj.calcNormals) calculateNormals(Mesh::Triangles);
+			// Tangents are accumulated after welding so shared vertices get the average of their triangles.
+			weld(obj.weldEpsilon);
+			if (obj.calcTangents) calculateTangents(Mesh::Triangles);
+			optimize();
+			generateLods(obj.lodCount);
+			if (obj.meshlets) buildMeshlets();
 			transformTexCoord(
-				Matrix4::translation(Vector3(uvTransform.x, uvTransform.y, 0.0f)) *
-				Matrix4::scale(Vector3(uvTransform.z, uvTransform.w, 0.0f))
+				Matrix4::translation(Vector3(obj.uvTransform.x, obj.uvTransform.y, 0.0f)) *
+				Matrix4::scale(Vector3(obj.uvTransform.z, obj.uvTransform.w, 0.0f))
 			);
+			if (!cachePath.empty()) saveBinary(cachePath, sourceHash);
 			build();
 		}
 		file.close();
 	}
 
-	void Mesh::build() {
-		const GLenum usage = m_dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
-
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-		if (m_vertices.size() > m_previousVBOSize) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * m_vertices.size(), m_vertices.data(), usage);
-			m_previousVBOSize = m_vertices.size();
-		} else {
-			glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Vertex) * m_vertices.size(), m_vertices.data());
+	bool Mesh::loadBinary(const std::string& nativePath, uint64 sourceHash) {
+		if (nativePath.empty()) return false;
+
+		FileSystem::MappedFile file(nativePath);
+		if (!file.valid() || file.size() < sizeof(MeshFileHeader)) return false;
+
+		MeshFileHeader h;
+		std::memcpy(&h, file.data(), sizeof(h));
+		if (h.magic != MeshFileMagic || h.version != MeshFileVersion) return false;
+		if (sourceHash != 0 && h.sourceHash != sourceHash) return false;
+		if (h.vertexFormat > uint32(VertexFormat::Packed)) return false;
+
+		// A layout change invalidates the cache just like a source change.
+		const VertexFormat format = VertexFormat(h.vertexFormat);
+		const VertexLayout layout = vertexLayout(format);
+		if (std::memcmp(&h.layout, &layout, sizeof(layout)) != 0) return false;
+
+		const uint64 vertexBytes = uint64(h.vertexCount) * layout.stride;
+		if (h.indexSize != indexSizeFor(h.vertexCount)) return false;
+		const uint64 indexBytes = uint64(h.indexCount) * h.indexSize;
+		if (h.vertexOffset + vertexBytes > file.size() || h.indexOffset + indexBytes > file.size()) return false;
+		if (h.lodCount == 0 || h.lodCount > MaxLods) return false;
+		for (uint32 i = 0; i < h.lodCount; i++) {
+			if (uint64(h.lods[i].offset) + h.lods[i].count > h.indexCount) return false;
 		}
+		if (h.meshletOffset + uint64(h.meshletCount) * sizeof(meshopt::Meshlet) > file.size()) return false;
+
+		vertexFormat(format);
+		m_lods.assign(h.lods, h.lods + h.lodCount);
+		m_meshlets.resize(h.meshletCount);
+		std::memcpy(m_meshlets.data(), file.data() + h.meshletOffset, h.meshletCount * sizeof(meshopt::Meshlet));
+		m_aabb = AABB(
+			Vector3(h.aabbMin[0], h.aabbMin[1], h.aabbMin[2]),
+			Vector3(h.aabbMax[0], h.aabbMax[1], h.aabbMax[2])
+		);
+		upload(file.data() + h.vertexOffset, uint32(vertexBytes), file.data() + h.indexOffset, h.indexCount, h.indexSize);
+		m_length = m_lods[0].count;
+
+		if (m_raycastable) {
+			std::vector<Vertex> vertices(h.vertexCount);
+			if (format == VertexFormat::Packed) {
+				unpackVertices((const PackedVertex*) (file.data() + h.vertexOffset), vertices.data(), h.vertexCount, m_aabb);
+			} else {
+				std::memcpy(vertices.data(), file.data() + h.vertexOffset, vertexBytes);
+			}
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-		if (m_indices.size() > m_previousEBOSize) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint32) * m_indices.size(), m_indices.data(), usage);
-			m_previousEBOSize = m_indices.size();
+			std::vector<uint32> indices(m_lods[0].count);
+			const uint8* lod0 = file.data() + h.indexOffset + uint64(m_lods[0].offset) * h.indexSize;
+			if (h.indexSize == sizeof(uint16)) {
+				const uint16* narrow = (const uint16*) lod0;
+				for (size_t i = 0; i < indices.size(); i++) indices[i] = narrow[i];
+			} else {
+				std::memcpy(indices.data(), lod0, indices.size() * sizeof(uint32));
+			}
+			buildBVH(vertices.data(), vertices.size(), indices.data(), indices.size());
 		} else {
-			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(uint32) * m_indices.size(), m_indices.data());
+			m_bvh.reset();
 		}
+		return true;
+	}
 
+	bool Mesh::saveBinary(const std::string& nativePath, uint64 sourceHash) {
 		buildAABB();
+		validateLods();
 
-		m_length = m_indices.size();
+		std::vector<PackedVertex> packed;
+		const void* vertexData = m_vertices.data();
+		if (m_format == VertexFormat::Packed) {
+			packMesh(m_vertices, m_indices, m_aabb, packed);
+			vertexData = packed.data();
+		}
 
-		m_vertices.clear();
-		m_indices.clear();
+		MeshFileHeader h{};
+		h.magic = MeshFileMagic;
+		h.version = MeshFileVersion;
+		h.sourceHash = sourceHash;
+		h.vertexFormat = uint32(m_format);
+		h.vertexCount = uint32(m_vertices.size());
+		h.indexCount = uint32(m_indices.size());
+		h.lodCount = uint32(m_lods.size());
+		std::copy(m_lods.begin(), m_lods.end(), h.lods);
+		h.layout = vertexLayout(m_format);
+		h.aabbMin[0] = m_aabb.min.x; h.aabbMin[1] = m_aabb.min.y; h.aabbMin[2] = m_aabb.min.z;
+		h.aabbMax[0] = m_aabb.max.x; h.aabbMax[1] = m_aabb.max.y; h.aabbMax[2] = m_aabb.max.z;
+		h.vertexOffset = alignTo16(sizeof(h));
+		h.indexOffset = alignTo16(h.vertexOffset + uint64(h.vertexCount) * h.layout.stride);
+		h.indexSize = indexSizeFor(m_vertices.size());
+		h.meshletCount = uint32(m_meshlets.size());
+		h.meshletOffset = alignTo16(h.indexOffset + uint64(h.indexCount) * h.indexSize);
+
+		std::vector<uint16> narrow;
+		const void* indices = indexData(m_indices, h.indexSize, narrow);
+
+		std::vector<uint8> out(h.meshletOffset + uint64(h.meshletCount) * sizeof(meshopt::Meshlet), 0);
+		std::memcpy(out.data(), &h, sizeof(h));
+		std::memcpy(out.data() + h.vertexOffset, vertexData, uint64(h.vertexCount) * h.layout.stride);
+		std::memcpy(out.data() + h.indexOffset, indices, uint64(h.indexCount) * h.indexSize);
+		std::memcpy(out.data() + h.meshletOffset, m_meshlets.data(), uint64(h.meshletCount) * sizeof(meshopt::Meshlet));
+
+		if (!FileSystem::writeNative(nativePath, out.data(), out.size())) {
+			Log.warn("Could not write mesh cache " + nativePath);
+			return false;
+		}
+		return true;
 	}
 
-	void Mesh::normalize() {
-		buildAABB();
+	void Mesh::weld(float epsilon) {
+		const size_t before = m_vertices.size();
+		const auto cacheBefore = meshopt::analyzeVertexCache(m_indices.data(), m_indices.size(), before);
 
-		const Vector3 size = m_aabb.max - m_aabb.min;
-		const Vector3 scale{ 1.0f / size.x, 1.0f / size.y, 1.0f / size.z };
-		const float scaleFactor = scale.length();
+		meshopt::weld(m_vertices, m_indices, epsilon);
 
-		for (auto& v : m_vertices) {
-			v.position = v.position * scaleFactor;
-		}
+		const size_t after = m_vertices.size();
+		const auto cacheAfter = meshopt::analyzeVertexCache(m_indices.data(), m_indices.size(), after);
+
+		auto kb = [](size_t count) { return std::to_string(count * sizeof(Vertex) / 1024) + " KB"; };
+		Log.info(
+			"Welded " + std::to_string(before) + " -> " + std::to_string(after) + " vertices (" +
+			kb(before) + " -> " + kb(after) + "), vertex shader invocations " +
+			std::to_string(cacheBefore.invocations) + " -> " + std::to_string(cacheAfter.invocations)
+		);
 	}
 
-	void Mesh::centralize() {
-		Vector3 center{};
-		for (auto& v : m_vertices) {
-			center = center + v.position;
+	void Mesh::optimize(float overdrawThreshold) {
+		const auto before = meshopt::analyzeVertexCache(m_indices.data(), m_indices.size(), m_vertices.size());
+
+		meshopt::optimizeVertexCacheTipsify(m_indices.data(), m_indices.size(), m_vertices.size());
+		meshopt::optimizeOverdraw(m_indices.data(), m_indices.size(), m_vertices.data(), m_vertices.size(), overdrawThreshold);
+		meshopt::optimizeVertexFetch(m_vertices, m_indices);
+
+		const auto after = meshopt::analyzeVertexCache(m_indices.data(), m_indices.size(), m_vertices.size());
+
+		auto fmt = [](float v) { return std::to_string(v).substr(0, 5); };
+		Log.info(
+			"Optimized indices, ACMR " + fmt(before.acmr) + " -> " + fmt(after.acmr) +
+			", ATVR " + fmt(before.atvr) + " -> " + fmt(after.atvr)
+		);
+	}
+
+	void Mesh::generateLods(uint32 count, float reduction, float maxError) {
+		const uint32 baseCount = uint32(m_indices.size());
+		m_lods.assign(1, { 0, baseCount, 0.0f });
+		count = std::min(count, MaxLods - 1);
+
+		// Every level is simplified from the full mesh, errors don't accumulate across levels.
+		size_t target = baseCount;
+		for (uint32 i = 0; i < count; i++) {
+			target = size_t(float(target) * reduction) / 3 * 3;
+
+			float error = 0.0f;
+			std::vector<uint32> lod = meshopt::simplify(
+				m_indices.data(), baseCount, m_vertices.data(), m_vertices.size(), target, maxError, &error
+			);
+			if (lod.empty() || float(lod.size()) > float(m_lods.back().count) * 0.9f) break;
+
+			meshopt::optimizeVertexCacheTipsify(lod.data(), lod.size(), m_vertices.size());
+			m_lods.push_back({ uint32(m_indices.size()), uint32(lod.size()), error });
+			m_indices.insert(m_indices.end(), lod.begin(), lod.end());
+
+			Log.info(
+				"LOD " + std::to_string(m_lods.size() - 1) + ": " + std::to_string(lod.size() / 3) +
+				" triangles, error " + std::to_string(error)
+			);
 		}
-		center = center / m_vertices.size();
+	}
 
-		const Vector3 target = center * -1.0f;
-		for (auto& v : m_vertices) {
-			v.position = v.position + target;
+	void Mesh::buildMeshlets(uint32 maxVertices, uint32 maxTriangles) {
+		validateLods();
+		m_meshlets = meshopt::buildMeshlets(
+			m_indices.data(), m_lods[0].count, m_vertices.data(), m_vertices.size(), maxVertices, maxTriangles
+		);
+		Log.info(std::to_string(m_meshlets.size()) + " meshlets");
+	}
+
+	void Mesh::validateLods() {
+		// Anything that rewrote the indices after generateLods() or buildMeshlets() invalidates them.
+		const uint32 size = uint32(m_indices.size());
+		if (m_lods.empty() || m_lods[0].offset != 0 || m_lods.back().offset + m_lods.back().count != size) {
+			m_lods.assign(1, { 0, size, 0.0f });
+		}
+		if (!m_meshlets.empty() && m_meshlets.back().offset + m_meshlets.back().count != m_lods[0].count) {
+			m_meshlets.clear();
 		}
 	}
 
-	void Mesh::buildAABB() {
-		m_aabb.min = Vector3(FLT_MAX);
-		m_aabb.max = Vector3(FLT_MIN);
-		for (auto& i : m_indices) {
-			auto& v = m_vertices[i];
-			m_aabb.min.x = std::min(m_aabb.min.x, v.position.x);
-			m_aabb.min.y = std::min(m_aabb.min.y, v.position.y);
-			m_aabb.min.z = std::min(m_aabb.min.z, v.position.z);
-			m_aabb.max.x = std::max(m_aabb.max.x, v.position.x);
-			m_aabb.max.y = std::max(m_aabb.max.y, v.position.y);
-			m_aabb.max.z = std::max(m_aabb.max.z, v.position.z);
+	void Mesh::build() {
+		Log.assert(m_stream == nullptr, "Streaming meshes are written with beginStream()/endStream().");
+
+		// Packed positions are relative to the AABB, so it has to be up to date before the upload.
+		buildAABB();
+
+		std::vector<PackedVertex> packed;
+		const void* vertexData = m_vertices.data();
+		uint32 vertexBytes = sizeof(Vertex) * m_vertices.size();
+		if (m_format == VertexFormat::Packed) {
+			packMesh(m_vertices, m_indices, m_aabb, packed);
+			vertexData = packed.data();
+			vertexBytes = sizeof(PackedVertex) * packed.size();
+		}
+
+		validateLods();
+		std::vector<uint16> narrow;
+		const uint32 indexSize = indexSizeFor(m_vertices.size());
+		upload(vertexData, vertexBytes, indexData(m_indices, indexSize, narrow), m_indices.size(), indexSize);
+		m_length = m_lods[0].count;
+
+		if (m_raycastable) {
+			buildBVH(m_vertices.data(), m_vertices.size(), m_indices.data() + m_lods[0].offset, m_lods[0].count);
+		} else {
+			m_bvh.reset();
 		}
+
+		m_vertices.clear();
+		m_indices.clear();
 	}
 
-	void Mesh::calculateTriangleNormal(uint32 i0, uint32 i1, uint32 i2) {
-		const Vector3 p0 = m_vertices[i0].position;
-		const Vector3 p1 = m_vertices[i1].position;
-		const Vector3 p2 = m_vertices[i2].position;
+	void Mesh::uploadStreams(
+		const AttributeStream (&streams)[VertexLayout::AttributeCount], uint32 vertexCount,
+		const void* indices, uint32 indexCount, uint32 indexSize, const AABB& bounds
+	) {
+		Log.assert(m_stream == nullptr, "Streaming meshes are written with beginStream()/endStream().");
+		Log.assert(indexSize == sizeof(uint16) || indexSize == sizeof(uint32), "Indices have to be 16 or 32 bit.");
+		GeometryPool::ston().release(m_allocation);
+
+		m_format = VertexFormat::Float;
+		m_aabb = bounds;
+		m_lods.assign(1, { 0, indexCount, 0.0f });
+		m_meshlets.clear();
+		m_baseVertex = m_baseIndex = 0;
+		m_indexSize = indexSize;
+		m_length = indexCount;
+
+		// Streams start 16 byte aligned, one after the other.
+		uint32 offsets[VertexLayout::AttributeCount], total = 0;
+		for (uint32 i = 0; i < VertexLayout::AttributeCount; i++) {
+			offsets[i] = total;
+			if (streams[i].data) total += (streams[i].bytes + 15) & ~15u;
+		}
+
+		const GLenum usage = m_dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBufferData(GL_ARRAY_BUFFER, total, nullptr, usage);
+		m_previousVBOSize = total;
+		for (uint32 i = 0; i < VertexLayout::AttributeCount; i++) {
+			const AttributeStream& a = streams[i];
+			if (a.data == nullptr) {
+				glDisableVertexAttribArray(i);
+				continue;
+			}
+			glBufferSubData(GL_ARRAY_BUFFER, offsets[i], a.bytes, a.data);
+			glEnableVertexAttribArray(i);
+			glVertexAttribPointer(i, a.components, a.type, a.normalized, a.stride, (void*) uintptr_t(offsets[i]));
+		}
+		for (uint32 i = 0; i < VertexLayout::AttributeCount; i++) {
+			const AttributeStream& a = streams[i];
+			m_streamAttributes[i] = { a.data ? a.components : 0, a.type, a.normalized, offsets[i] };
+			m_streamStrides[i] = a.stride ? a.stride : uint32(a.components) * componentSize(a.type);
+		}
+		m_vertexCount = vertexCount;
 
-		const Vector3 e0 = p1 - p0;
-		const Vector3 e1 = p2 - p0;
-		const Vector3 n = e0.cross(e1);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indices, usage);
+		m_previousEBOSize = indexCount * indexSize;
+		glBindVertexArray(0);
+		m_streamLayout = true;
+
+		const AttributeStream& position = streams[0];
+		if (!m_raycastable || position.data == nullptr || position.type != GL_FLOAT || position.components != 3) {
+			m_bvh.reset();
+			return;
+		}
 
-		m_vertices[i0].normal = m_vertices[i0].normal + n;
-		m_vertices[i1].normal = m_vertices[i1].normal + n;
-		m_vertices[i2].normal = m_vertices[i2].normal + n;
+		const uint32 stride = position.stride == 0 ? sizeof(Vector3) : position.stride;
+		std::vector<Vertex> vertices(vertexCount);
+		for (uint32 i = 0; i < vertexCount; i++) {
+			std::memcpy(&vertices[i].position, (const uint8*) position.data + uint64(i) * stride, sizeof(Vector3));
+		}
+		std::vector<uint32> wide;
+		const uint32* triangles = (const uint32*) indices;
+		if (indexSize == sizeof(uint16)) {
+			wide.resize(indexCount);
+			for (uint32 i = 0; i < indexCount; i++) wide[i] = ((const uint16*) indices)[i];
+			triangles = wide.data();
+		}
+		buildBVH(vertices.data(), vertices.size(), triangles, indexCount);
 	}
 
-	void Mesh::calculateTriangleTangent(uint32 i0, uint32 i1, uint32 i2) {
-		const Vector3 v0 = m_vertices[i0].position;
-		const Vector3 v1 = m_vertices[i1].position;
-		const Vector3 v2 = m_vertices[i2].position;
+	void Mesh::upload(const void* vertexData, uint32 vertexBytes, const void* indexData, uint32 indexCount, uint32 indexSize) {
+		auto& pool = GeometryPool::ston();
+		m_indexSize = indexSize;
+		m_length = indexCount;
+		m_vertexCount = vertexBytes / vertexLayout(m_format).stride;
+
+		if (m_streamLayout) {
+			glBindVertexArray(m_vao);
+			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+			for (uint32 i = 0; i < VertexLayout::AttributeCount; i++) glEnableVertexAttribArray(i);
+			setupAttributes();
+			glBindVertexArray(0);
+			m_streamLayout = false;
+		}
 
-		const Vector3 t0 = m_vertices[i0].texCoord;
-		const Vector3 t1 = m_vertices[i1].texCoord;
-		const Vector3 t2 = m_vertices[i2].texCoord;
+		// Dynamic meshes keep their own buffers, rewriting them in place is cheaper than reallocating pool ranges.
+		// Skinned ones need their own vertex array for the joint attributes.
+		if (!m_dynamic && !skinned() && pool.enabled()) {
+			pool.allocate(m_allocation, m_format, vertexData, m_vertexCount, indexData, indexCount * indexSize);
+			return;
+		}
+		pool.release(m_allocation);
 
-		const Vector3 e0 = v1 - v0;
-		const Vector3 e1 = v2 - v0;
+		const GLenum usage = m_dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
 
-		const Vector3 dt1 = t1 - t0;
-		const Vector3 dt2 = t2 - t0;
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		if (vertexBytes > m_previousVBOSize) {
+			glBufferData(GL_ARRAY_BUFFER, vertexBytes, vertexData, usage);
+			m_previousVBOSize = vertexBytes;
+		} else {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, vertexData);
+		}
 
-		float dividend = dt1.x * dt2.y - dt2.x * dt1.y;
-		float f = dividend == 0.0f ? 0.0f : 1.0f / dividend;
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		const uint32 indexBytes = indexSize * indexCount;
+		if (indexBytes > m_previousEBOSize) {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, indexData, usage);
+			m_previousEBOSize = indexBytes;
+		} else {
+			glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indexBytes, indexData);
+		}
+	}
 
-		Vector3 t = Vector3();
-		t.x = (f * (dt2.y * e0.x - dt1.y * e1.x));
-		t.y = (f * (dt2.y * e0.y - dt1.y * e1.y));
-		t.z = (f * (dt2.y * e0.z - dt1.y * e1.z));
+	void Mesh::skin(const std::vector<SkinVertex>& vertices) {
+		Log.assert(!pooled(), "Pooled meshes can't be skinned, call skin() before build().");
 
-		m_vertices[i0].tangent = m_vertices[i0].tangent + t;
-		m_vertices[i1].tangent = m_vertices[i1].tangent + t;
-		m_vertices[i2].tangent = m_vertices[i2].tangent + t;
+		glBindVertexArray(m_vao);
+		if (vertices.empty()) {
+			glDisableVertexAttribArray(SkinJointsLocation);
+			glDisableVertexAttribArray(SkinWeightsLocation);
+			glBindVertexArray(0);
+			if (m_skinVbo) glDeleteBuffers(1, &m_skinVbo);
+			m_skinVbo = 0;
+			return;
+		}
+
+		if (!m_skinVbo) glGenBuffers(1, &m_skinVbo);
+		glBindBuffer(GL_ARRAY_BUFFER, m_skinVbo);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SkinVertex), vertices.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(SkinJointsLocation);
+		glVertexAttribIPointer(SkinJointsLocation, 4, GL_UNSIGNED_BYTE, sizeof(SkinVertex), (void*) offsetof(SkinVertex, joints));
+		glEnableVertexAttribArray(SkinWeightsLocation);
+		glVertexAttribPointer(SkinWeightsLocation, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SkinVertex), (void*) offsetof(SkinVertex, weights));
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
 	}
 
-	void Mesh::calculateNormals(PrimitiveType primitive) {
-#define index(x) m_indices[(x)]
-		switch (primitive) {
-			case Points:
-			case Lines:
-			case LineLoop:
-			case LineStrip:
-				break;
-			case Triangles: {
-				for (uint32 i = 0; i < m_indices.size(); i+=3) {
-					uint32 i0 = index(i + 0);
-					uint32 i1 = index(i + 1);
-					uint32 i2 = index(i + 2);
-					calculateTriangleNormal(i0, i1, i2);
-				}
-			} break;
-			case TriangleFan: {
-				uint32 i0 = index(0);
-				for (uint32 i = 0; i < m_indices.size(); i+=2) {
-					uint32 i1 = index(i + 0);
-					uint32 i2 = index(i + 1);
-					calculateTriangleNormal(i0, i1, i2);
-				}
-			} break;
-			case TriangleStrip: {
-				for (uint32 i = 0; i < m_indices.size(); i+=2) {
-					uint32 i0, i1, i2;
-					if (i % 2 == 0) {
-						i0 = index(i + 0);
-						i1 = index(i + 1);
-						i2 = index(i + 2);
-					} else {
-						i0 = index(i + 2);
-						i1 = index(i + 1);
-						i2 = index(i + 0);
+	bool Mesh::readBack(uint32 level, std::vector<Vertex>& vertices, std::vector<uint32>& indices) const {
+		if (m_stream || m_lods.empty() || m_vertexCount == 0) return false;
+		const Lod& lod = m_lods[std::min(level, lodCount() - 1)];
+
+		// Vertices go through the copy-read target so the bound vertex array keeps its buffers.
+		vertices.resize(m_vertexCount);
+		glBindBuffer(GL_COPY_READ_BUFFER, vbo());
+		if (m_streamLayout) {
+			std::vector<uint8> raw(m_previousVBOSize);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, raw.size(), raw.data());
+			for (uint32 i = 0; i < m_vertexCount; i++) {
+				float* fields[VertexLayout::AttributeCount] = {
+					&vertices[i].position.x, &vertices[i].normal.x, &vertices[i].tangent.x, &vertices[i].texCoord.x
+				};
+				const uint32 sizes[VertexLayout::AttributeCount] = { 3, 3, 3, 2 };
+				for (uint32 a = 0; a < VertexLayout::AttributeCount; a++) {
+					const auto& attribute = m_streamAttributes[a];
+					const uint32 n = std::min(uint32(std::max(attribute.components, 0)), sizes[a]);
+					const uint8* src = raw.data() + attribute.offset + uint64(i) * m_streamStrides[a];
+					for (uint32 c = 0; c < sizes[a]; c++) {
+						fields[a][c] = c < n ? readComponent(src + c * componentSize(attribute.type), attribute.type, attribute.normalized) : 0.0f;
 					}
-					calculateTriangleNormal(i0, i1, i2);
 				}
-			} break;
+			}
+		} else {
+			const uint32 stride = vertexLayout(m_format).stride;
+			const GLintptr start = GLintptr(baseVertex()) * stride;
+			if (m_format == VertexFormat::Packed) {
+				std::vector<PackedVertex> packed(m_vertexCount);
+				glGetBufferSubData(GL_COPY_READ_BUFFER, start, packed.size() * stride, packed.data());
+				unpackVertices(packed.data(), vertices.data(), packed.size(), m_aabb);
+			} else {
+				glGetBufferSubData(GL_COPY_READ_BUFFER, start, vertices.size() * stride, vertices.data());
+			}
 		}
 
-		for (auto& v : m_vertices) {
-			v.normal = v.normal.normalized();
+		indices.resize(lod.count);
+		glBindBuffer(GL_COPY_READ_BUFFER, ebo());
+		const GLintptr start = GLintptr(baseIndex() + lod.offset) * m_indexSize;
+		if (m_indexSize == sizeof(uint16)) {
+			std::vector<uint16> narrow(lod.count);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, start, narrow.size() * sizeof(uint16), narrow.data());
+			std::copy(narrow.begin(), narrow.end(), indices.begin());
+		} else {
+			glGetBufferSubData(GL_COPY_READ_BUFFER, start, indices.size() * sizeof(uint32), indices.data());
 		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		return true;
 	}
 
-	void Mesh::calculateTangents(PrimitiveType primitive) {
-#define index(x) m_indices[(x)]
+	void Mesh::normalize() {
+		buildAABB();
+
+		const Vector3 size = m_aabb.max - m_aabb.min;
+		const Vector3 scale{ 1.0f / size.x, 1.0f / size.y, 1.0f / size.z };
+		const float scaleFactor = scale.length();
+
+		geometry::transformPositions(m_vertices.data(), m_vertices.size(), scaleFactor, Vector3(0.0f));
+	}
+
+	void Mesh::centralize() {
+		const Vector3 center = geometry::centroid(m_vertices.data(), m_vertices.size());
+		geometry::transformPositions(m_vertices.data(), m_vertices.size(), 1.0f, center * -1.0f);
+	}
+
+	void Mesh::buildBVH(const Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount) {
+		const auto start = std::chrono::steady_clock::now();
+		if (!m_bvh) m_bvh = std::make_unique<MeshBVH>();
+		m_bvh->build(vertices, vertexCount, indices, indexCount);
+
+		const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Log.info(
+			"BVH: " + std::to_string(m_bvh->triangleCount()) + " triangles, " +
+			std::to_string(m_bvh->memoryUsage() / 1024) + " KB, " + std::to_string(ms) + " ms"
+		);
+	}
+
+	void Mesh::buildAABB() {
+		m_aabb = geometry::bounds(m_vertices.data(), m_indices.data(), m_indices.size());
+	}
+
+	std::vector<uint32> Mesh::triangleList(PrimitiveType primitive) const {
+		std::vector<uint32> ret;
+		const size_t n = m_indices.size();
 		switch (primitive) {
-			case Points:
-			case Lines:
-			case LineLoop:
-			case LineStrip:
+			case Triangles:
+				ret.assign(m_indices.begin(), m_indices.begin() + n / 3 * 3);
 				break;
-			case Triangles: {
-				for (uint32 i = 0; i < m_indices.size(); i+=3) {
-					uint32 i0 = index(i + 0);
-					uint32 i1 = index(i + 1);
-					uint32 i2 = index(i + 2);
-					calculateTriangleTangent(i0, i1, i2);
+			case TriangleFan:
+				for (size_t i = 1; i + 1 < n; i++) {
+					ret.insert(ret.end(), { m_indices[0], m_indices[i], m_indices[i + 1] });
 				}
-			} break;
-			case TriangleFan: {
-				uint32 i0 = index(0);
-				for (uint32 i = 0; i < m_indices.size(); i+=2) {
-					uint32 i1 = index(i + 0);
-					uint32 i2 = index(i + 1);
-					calculateTriangleTangent(i0, i1, i2);
-				}
-			} break;
-			case TriangleStrip: {
-				for (uint32 i = 0; i < m_indices.size(); i+=2) {
-					uint32 i0, i1, i2;
-					if (i % 2 == 0) {
-						i0 = index(i + 0);
-						i1 = index(i + 1);
-						i2 = index(i + 2);
-					} else {
-						i0 = index(i + 2);
-						i1 = index(i + 1);
-						i2 = index(i + 0);
-					}
-					calculateTriangleTangent(i0, i1, i2);
+				break;
+			case TriangleStrip:
+				// Every other triangle is flipped to keep the winding.
+				for (size_t i = 0; i + 2 < n; i++) {
+					if (i % 2 == 0) ret.insert(ret.end(), { m_indices[i], m_indices[i + 1], m_indices[i + 2] });
+					else ret.insert(ret.end(), { m_indices[i + 2], m_indices[i + 1], m_indices[i] });
 				}
-			} break;
+				break;
+			default: break;
 		}
+		return ret;
+	}
 
-		for (auto& v : m_vertices) {
-			v.tangent = v.tangent.normalized();
+	void Mesh::calculateNormals(PrimitiveType primitive) {
+		if (primitive == Triangles) {
+			geometry::accumulateNormals(m_vertices.data(), m_vertices.size(), m_indices.data(), m_indices.size());
+		} else {
+			const std::vector<uint32> tris = triangleList(primitive);
+			geometry::accumulateNormals(m_vertices.data(), m_vertices.size(), tris.data(), tris.size());
+		}
+	}
+
+	void Mesh::calculateTangents(PrimitiveType primitive) {
+		if (primitive == Triangles) {
+			geometry::accumulateTangents(m_vertices.data(), m_vertices.size(), m_indices.data(), m_indices.size());
+		} else {
+			const std::vector<uint32> tris = triangleList(primitive);
+			geometry::accumulateTangents(m_vertices.data(), m_vertices.size(), tris.data(), tris.size());
 		}
 	}
 
@@ -406,7 +808,10 @@ namespace ae {
 	}
 
 	void Mesh::free() {
+		GeometryPool::ston().release(m_allocation);
+		m_stream.reset();
 		if (m_vbo) glDeleteBuffers(1, &m_vbo);
+		if (m_skinVbo) glDeleteBuffers(1, &m_skinVbo);
 		if (m_ebo) glDeleteBuffers(1, &m_ebo);
 		if (m_vao) glDeleteVertexArrays(1, &m_vao);
 	}
@@ -4,18 +4,57 @@
 #include "integer.hpp"
 #include "glad.h"
 #include "vec_math.hpp"
+#include "vertex.h"
+#include "mesh_optimizer.h"
+#include "stream_buffer.h"
+#include "geometry_pool.h"
+#include "bvh.h"
 #include "resource_manager.h"
 
+#include <memory>
 #include <vector>
 
 namespace ae {
-	struct Vertex {
-		Vector3 position, normal, tangent;
-		Vector2 texCoord;
+	/// glVertexAttribPointer parameters of every vertex attribute, in location order.
+	struct VertexLayout {
+		static constexpr uint32 AttributeCount = 4;
+
+		struct Attribute {
+			int32 components;
+			uint32 type;
+			uint32 normalized;
+			uint32 offset;
+		};
+
+		uint32 stride;
+		Attribute attributes[AttributeCount];
+	};
+
+	VertexLayout vertexLayout(VertexFormat format);
+
+	/// One vertex attribute as it lies in loaded file data, glVertexAttribPointer parameters plus its bytes.
+	struct AttributeStream {
+		const void* data{ nullptr }; // nullptr leaves the attribute at its default of (0, 0, 0, 1)
+		uint32 bytes{ 0 }, stride{ 0 };
+		int32 components{ 0 };
+		uint32 type{ GL_FLOAT }, normalized{ false };
 	};
 
+	/// glVertexAttribPointer for every attribute of layout, reading from the bound GL_ARRAY_BUFFER.
+	void setVertexAttributes(const VertexLayout& layout);
+
 	class Mesh : public Resource {
 	public:
+		static constexpr uint32 MaxLods = 8;
+		static constexpr uint32 SkinJointsLocation = VertexLayout::AttributeCount;
+		static constexpr uint32 SkinWeightsLocation = VertexLayout::AttributeCount + 1;
+
+		/// Level of detail, a range of the index buffer. error is relative to the AABB diagonal.
+		struct Lod {
+			uint32 offset, count;
+			float error;
+		};
+
 		enum PrimitiveType {
 			Points = GL_POINTS,
 			Lines = GL_LINES,
@@ -37,7 +76,30 @@ namespace ae {
 
 		void draw(PrimitiveType primitive, int32 length = -1, uint32 offset = 0);
 
+		/// draw() of instances copies, shaders tell them apart by gl_InstanceID.
+		void drawInstanced(PrimitiveType primitive, int32 length, uint32 offset, uint32 instances);
+
+		/// One glMultiDrawElements over drawCount index ranges.
+		void drawRanges(PrimitiveType primitive, const int32* lengths, const uint32* offsets, uint32 drawCount);
+
 		void dynamic(bool v = true);
+
+		/// Switches to streaming: a persistently mapped ring of StreamBuffer::RegionCount regions, each holding up
+		/// to maxVertices Float format vertices and maxIndices indices. Replaces build() for per-frame geometry:
+		/// beginStream(), write through streamVertices()/streamIndices(), then endStream().
+		void stream(uint32 maxVertices, uint32 maxIndices);
+		bool streaming() const { return m_stream != nullptr; }
+
+		/// Moves to the next region, waiting only if the GPU still reads it. Once per frame, before writing.
+		void beginStream();
+		Vertex* streamVertices();
+		uint32* streamIndices();
+
+		/// Indices are relative to the region. bounds is used for culling, the vertices aren't read back.
+		void endStream(uint32 vertexCount, uint32 indexCount, const AABB& bounds);
+
+		/// nullptr unless streaming.
+		const StreamBuffer* streamBuffer() const { return m_stream.get(); }
 		void addVertex(const Vertex& vertex);
 		void addIndex(uint32 i);
 		void addTriangle(uint32 i0, uint32 i1, uint32 i2);
@@ -46,37 +108,124 @@ namespace ae {
 		void calculateNormals(PrimitiveType primitive);
 		void calculateTangents(PrimitiveType primitive);
 		void transformTexCoord(const Matrix4& mat);
+
+		/// Deduplicates vertices (see meshopt::weld) and logs the savings.
+		void weld(float epsilon = 0.0f);
+
+		/// Reorders triangles for the vertex cache and overdraw and vertices for fetch locality, logs ACMR/ATVR.
+		/// Triangle lists only, call before build().
+		void optimize(float overdrawThreshold = 1.05f);
+
+		/// Appends up to count simplified index sets, each with about reduction times the triangles of the
+		/// previous one. Stops early when a level would exceed maxError or barely shrink. Call before build().
+		void generateLods(uint32 count, float reduction = 0.5f, float maxError = 0.05f);
+
+		/// Splits the level 0 triangles into meshlets for cluster culling (see meshopt::buildMeshlets).
+		/// Call before build().
+		void buildMeshlets(uint32 maxVertices = 64, uint32 maxTriangles = 124);
 		void build();
 
+		/// Uploads attribute streams and 16 or 32 bit indices exactly as given, each stream to its own range of
+		/// the vertex buffer, for file data the GPU reads as is. Replaces build(). A float position stream also
+		/// feeds the BVH.
+		void uploadStreams(
+			const AttributeStream (&streams)[VertexLayout::AttributeCount], uint32 vertexCount,
+			const void* indices, uint32 indexCount, uint32 indexSize, const AABB& bounds
+		);
+
+		/// Joint influences for GPU skinning, one per vertex in the order build() or uploadStreams() upload them,
+		/// so after weld() and optimize(). They get a buffer of their own read at SkinJointsLocation and
+		/// SkinWeightsLocation. The GeometryPool's shared vertex arrays have no such attributes, call it before
+		/// build() to keep the mesh out of the pool. Empty removes the skin.
+		void skin(const std::vector<SkinVertex>& vertices);
+		bool skinned() const { return m_skinVbo != 0; }
+
+		/// Copies level of the uploaded geometry back from the GPU, indices relative to the returned vertices.
+		/// Packed and uploadStreams() vertices are expanded to Vertex. False for streaming meshes.
+		bool readBack(uint32 level, std::vector<Vertex>& vertices, std::vector<uint32>& indices) const;
+
 		void normalize();
 		void centralize();
 
 		bool dynamic() const { return m_dynamic; }
 
+		/// Layout of the GPU vertex buffer, takes effect on the next build().
+		VertexFormat vertexFormat() const { return m_format; }
+		void vertexFormat(VertexFormat format);
+
+		/// Shader-side dequantization, position = attribute * positionScale() + positionOffset().
+		Vector3 positionScale() const;
+		Vector3 positionOffset() const;
+
+		/// Level 0 is the full mesh, set up by build().
+		uint32 lodCount() const { return uint32(m_lods.size()); }
+		const Lod& lod(uint32 level) const { return m_lods[level]; }
+
+		/// Empty unless buildMeshlets() was called, ranges are within level 0.
+		const std::vector<meshopt::Meshlet>& meshlets() const { return m_meshlets; }
+
+		/// True when build() put the mesh into the GeometryPool, vao() is then shared by its vertex format.
+		bool pooled() const { return m_allocation.valid(); }
+
+		/// Keep a BVH of level 0 for raycasts, built by build() and when loading from the cache. On by default.
+		bool raycastable() const { return m_raycastable; }
+		void raycastable(bool v) { m_raycastable = v; }
+
+		/// nullptr unless raycastable() when the mesh was built.
+		const MeshBVH* bvh() const { return m_bvh.get(); }
+
 		const AABB& aabb() const { return m_aabb; }
-		GLuint vao() const { return m_vao; }
-		GLuint vbo() const { return m_vbo; }
-		GLuint ebo() const { return m_ebo; }
+		GLuint vao() const { return pooled() ? GeometryPool::ston().vao(m_allocation.format) : m_vao; }
+		GLuint vbo() const { return pooled() ? GeometryPool::ston().vbo(m_allocation.format) : m_vbo; }
+		GLuint ebo() const { return pooled() ? GeometryPool::ston().ebo(m_allocation.format) : m_ebo; }
+
+		/// GL_UNSIGNED_SHORT when build() found at most 65536 vertices, GL_UNSIGNED_INT otherwise.
+		GLenum indexType() const { return m_indexSize == sizeof(uint16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
 
 	private:
-		struct Face {
-			uint32 vertex, texCoord, normal;
-		};
+		GLuint m_vao{ 0 }, m_vbo{ 0 }, m_ebo{ 0 }, m_skinVbo{ 0 };
+		uint32 m_previousVBOSize{ 0 }, m_previousEBOSize{ 0 }, m_length{ 0 }, m_indexSize{ sizeof(uint32) };
+		uint32 m_vertexCount{ 0 };
 
-		GLuint m_vao{ 0 }, m_vbo{ 0 }, m_ebo{ 0 };
-		uint32 m_previousVBOSize{ 0 }, m_previousEBOSize{ 0 }, m_length{ 0 };
+		bool m_dynamic{ false }, m_raycastable{ true };
+		bool m_streamLayout{ false }; // The VAO reads uploadStreams() ranges instead of vertexLayout(m_format)
+		VertexFormat m_format{ VertexFormat::Float };
 
-		bool m_dynamic{ false };
+		/// Where uploadStreams() put each attribute, components is 0 for the missing ones.
+		VertexLayout::Attribute m_streamAttributes[VertexLayout::AttributeCount]{};
+		uint32 m_streamStrides[VertexLayout::AttributeCount]{};
 
 		std::vector<Vertex> m_vertices;
 		std::vector<uint32> m_indices;
+		std::vector<Lod> m_lods;
+		std::vector<meshopt::Meshlet> m_meshlets;
+		std::vector<const void*> m_rangeOffsets;
+		std::vector<GLint> m_rangeBaseVertices;
+
+		std::unique_ptr<StreamBuffer> m_stream;
+		uint32 m_streamIndexOffset{ 0 }, m_baseVertex{ 0 }, m_baseIndex{ 0 };
+
+		GeometryPool::Allocation m_allocation{};
+		std::unique_ptr<MeshBVH> m_bvh;
 
 		AABB m_aabb{};
 
-		void calculateTriangleNormal(uint32 i0, uint32 i1, uint32 i2);
-		void calculateTriangleTangent(uint32 i0, uint32 i1, uint32 i2);
+		/// m_indices drawn as primitive, as a triangle list. Empty for points and lines.
+		std::vector<uint32> triangleList(PrimitiveType primitive) const;
+
+		/// Where the mesh starts in the bound buffers, the pool may move it between frames.
+		uint32 baseVertex() const { return pooled() ? m_allocation.vertexOffset : m_baseVertex; }
+		uint32 baseIndex() const { return pooled() ? m_allocation.indexOffset / m_indexSize : m_baseIndex; }
 
 		void buildAABB();
+		void buildBVH(const Vertex* vertices, size_t vertexCount, const uint32* indices, size_t indexCount);
+		void validateLods();
+		void setupAttributes();
+		void upload(const void* vertexData, uint32 vertexBytes, const void* indexData, uint32 indexCount, uint32 indexSize);
+
+		/// .aemesh cache, sourceHash 0 accepts any source.
+		bool loadBinary(const std::string& nativePath, uint64 sourceHash = 0);
+		bool saveBinary(const std::string& nativePath, uint64 sourceHash);
 	};
 
 }
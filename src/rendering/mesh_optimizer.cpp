@@ -0,0 +1,741 @@
+#include "mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ae {
+	namespace meshopt {
+		namespace {
+			constexpr uint32 Empty = ~0u;
+
+			struct WeldKey {
+				float v[8];
+
+				bool operator ==(const WeldKey& o) const {
+					for (size_t i = 0; i < 8; i++) if (v[i] != o.v[i]) return false;
+					return true;
+				}
+			};
+
+			inline uint32 hash(const WeldKey& k) {
+				uint32 bits[8];
+				std::memcpy(bits, k.v, sizeof(bits));
+
+				uint32 h = 2166136261u;
+				for (uint32 b : bits) {
+					b *= 0xCC9E2D51u;
+					b = (b << 15) | (b >> 17);
+					h = (h ^ (b * 0x1B873593u)) * 16777619u;
+				}
+				return h ^ (h >> 16);
+			}
+
+			/// Triangles using each vertex, as ranges into a flat array.
+			struct Adjacency {
+				std::vector<uint32> counts, offsets, triangles;
+
+				Adjacency(const uint32* indices, size_t indexCount, size_t vertexCount)
+					: counts(vertexCount, 0), offsets(vertexCount, 0), triangles(indexCount) {
+					for (size_t i = 0; i < indexCount; i++) counts[indices[i]]++;
+
+					uint32 offset = 0;
+					for (size_t v = 0; v < vertexCount; v++) {
+						offsets[v] = offset;
+						offset += counts[v];
+					}
+
+					std::vector<uint32> fill(offsets);
+					for (size_t i = 0; i < indexCount; i++) triangles[fill[indices[i]]++] = uint32(i / 3);
+				}
+			};
+
+			constexpr uint32 ForsythCacheSize = 16;
+			constexpr uint32 ForsythMaxValence = 32;
+
+			struct ForsythTables {
+				float cache[ForsythCacheSize];
+				float valence[ForsythMaxValence];
+
+				ForsythTables() {
+					// The last triangle's vertices get a fixed score so it isn't simply repeated.
+					for (uint32 i = 0; i < ForsythCacheSize; i++) {
+						cache[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / float(ForsythCacheSize - 3), 1.5f);
+					}
+					// Boost vertices with few triangles left to get rid of them quickly.
+					for (uint32 i = 0; i < ForsythMaxValence; i++) {
+						valence[i] = i == 0 ? 0.0f : 2.0f / std::sqrt(float(i));
+					}
+				}
+
+				float score(int32 cachePosition, uint32 live) const {
+					if (live == 0) return -1.0f;
+					const float c = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+					return c + (live < ForsythMaxValence ? valence[live] : 2.0f / std::sqrt(float(live)));
+				}
+			};
+
+			/// Symmetric 4x4 error quadric, error(p) = (p'Ap + 2b'p + c) / w. The planes are weighted, dividing by
+			/// the summed weight w makes the error a mean squared distance rather than one that grows with area.
+			struct Quadric {
+				double a00{ 0 }, a11{ 0 }, a22{ 0 }, a10{ 0 }, a20{ 0 }, a21{ 0 };
+				double b0{ 0 }, b1{ 0 }, b2{ 0 }, c{ 0 }, w{ 0 };
+
+				static Quadric plane(double nx, double ny, double nz, double d, double w) {
+					Quadric q;
+					q.a00 = w * nx * nx; q.a11 = w * ny * ny; q.a22 = w * nz * nz;
+					q.a10 = w * ny * nx; q.a20 = w * nz * nx; q.a21 = w * nz * ny;
+					q.b0 = w * nx * d; q.b1 = w * ny * d; q.b2 = w * nz * d;
+					q.c = w * d * d;
+					q.w = w;
+					return q;
+				}
+
+				Quadric& operator +=(const Quadric& o) {
+					a00 += o.a00; a11 += o.a11; a22 += o.a22; a10 += o.a10; a20 += o.a20; a21 += o.a21;
+					b0 += o.b0; b1 += o.b1; b2 += o.b2; c += o.c; w += o.w;
+					return *this;
+				}
+
+				double error(const Vector3& p) const {
+					const double x = p.x, y = p.y, z = p.z;
+					const double rx = a00 * x + a10 * y + a20 * z;
+					const double ry = a10 * x + a11 * y + a21 * z;
+					const double rz = a20 * x + a21 * y + a22 * z;
+					const double e = rx * x + ry * y + rz * z + 2.0 * (b0 * x + b1 * y + b2 * z) + c;
+					return e > 0.0 && w > 0.0 ? e / w : 0.0;
+				}
+			};
+
+			/// FIFO cache simulation that can be flushed in O(1).
+			struct FifoCache {
+				std::vector<uint32> entered;
+				uint32 size, time;
+
+				FifoCache(size_t vertexCount, uint32 cacheSize) : entered(vertexCount, 0), size(cacheSize), time(cacheSize + 1) {}
+
+				uint32 misses(const uint32* tri) {
+					uint32 m = 0;
+					for (uint32 k = 0; k < 3; k++) {
+						if (time - entered[tri[k]] > size) {
+							entered[tri[k]] = time++;
+							m++;
+						}
+					}
+					return m;
+				}
+
+				void flush() { time += size + 1; }
+			};
+		}
+
+		VertexCacheStats analyzeVertexCache(const uint32* indices, size_t indexCount, size_t vertexCount, uint32 cacheSize) {
+			VertexCacheStats stats{};
+			if (indexCount < 3 || vertexCount == 0) return stats;
+
+			// A vertex is in the cache if it entered less than cacheSize misses ago.
+			std::vector<uint32> entered(vertexCount, 0);
+			uint32 time = cacheSize + 1;
+			for (size_t i = 0; i < indexCount; i++) {
+				const uint32 v = indices[i];
+				if (time - entered[v] > cacheSize) {
+					entered[v] = time++;
+					stats.invocations++;
+				}
+			}
+
+			stats.acmr = float(stats.invocations) / float(indexCount / 3);
+			stats.atvr = float(stats.invocations) / float(vertexCount);
+			return stats;
+		}
+
+		void optimizeVertexCache(uint32* indices, size_t indexCount, size_t vertexCount) {
+			const size_t triCount = indexCount / 3;
+			if (triCount == 0) return;
+
+			static const ForsythTables tables;
+			Adjacency adj(indices, triCount * 3, vertexCount);
+
+			// adj.counts doubles as the number of triangles left per vertex, emitted ones are swapped out of the range.
+			std::vector<uint32>& live = adj.counts;
+			std::vector<int32> cachePosition(vertexCount, -1);
+			std::vector<float> vertexScore(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++) vertexScore[v] = tables.score(-1, live[v]);
+
+			std::vector<float> triScore(triCount);
+			for (size_t t = 0; t < triCount; t++) {
+				const uint32* tri = indices + t * 3;
+				triScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+			}
+
+			std::vector<uint32> result(triCount * 3);
+			std::vector<uint8> emitted(triCount, 0);
+			uint32 cache[ForsythCacheSize + 3], newCache[ForsythCacheSize + 3];
+			uint32 cacheCount = 0;
+
+			uint32 best = 0, cursor = 0;
+			for (size_t out = 0; out < triCount; out++) {
+				if (best == ~0u) {
+					// Dead end, nothing in the cache has triangles left.
+					while (emitted[cursor]) cursor++;
+					best = cursor;
+				}
+
+				const uint32 tri[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+				std::memcpy(&result[out * 3], tri, sizeof(tri));
+				emitted[best] = 1;
+
+				for (uint32 v : tri) {
+					uint32* begin = adj.triangles.data() + adj.offsets[v];
+					uint32* it = std::find(begin, begin + live[v], best);
+					std::swap(*it, begin[--live[v]]);
+				}
+
+				// The triangle's vertices move to the front, everything else is pushed back.
+				uint32 newCount = 0;
+				for (uint32 v : tri) {
+					if (std::find(newCache, newCache + newCount, v) == newCache + newCount) newCache[newCount++] = v;
+				}
+				for (uint32 i = 0; i < cacheCount; i++) {
+					const uint32 v = cache[i];
+					if (v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+				}
+
+				for (uint32 i = 0; i < newCount; i++) {
+					const uint32 v = newCache[i];
+					cachePosition[v] = i < ForsythCacheSize ? int32(i) : -1;
+
+					const float score = tables.score(cachePosition[v], live[v]);
+					const float delta = score - vertexScore[v];
+					vertexScore[v] = score;
+
+					const uint32* vt = adj.triangles.data() + adj.offsets[v];
+					for (uint32 j = 0; j < live[v]; j++) triScore[vt[j]] += delta;
+				}
+
+				cacheCount = std::min(newCount, ForsythCacheSize);
+				std::memcpy(cache, newCache, cacheCount * sizeof(uint32));
+
+				best = ~0u;
+				float bestScore = -1.0f;
+				for (uint32 i = 0; i < cacheCount; i++) {
+					const uint32 v = cache[i];
+					const uint32* vt = adj.triangles.data() + adj.offsets[v];
+					for (uint32 j = 0; j < live[v]; j++) {
+						if (triScore[vt[j]] > bestScore) {
+							bestScore = triScore[vt[j]];
+							best = vt[j];
+						}
+					}
+				}
+			}
+
+			std::memcpy(indices, result.data(), result.size() * sizeof(uint32));
+		}
+
+		void optimizeVertexCacheTipsify(uint32* indices, size_t indexCount, size_t vertexCount, uint32 cacheSize) {
+			const size_t triCount = indexCount / 3;
+			if (triCount == 0) return;
+
+			Adjacency adj(indices, triCount * 3, vertexCount);
+			std::vector<uint32> live(adj.counts);
+			std::vector<uint32> cacheTime(vertexCount, 0);
+			std::vector<uint8> emitted(triCount, 0);
+			std::vector<uint32> deadEnd, candidates, result;
+			deadEnd.reserve(triCount * 3);
+			result.reserve(triCount * 3);
+
+			uint32 time = cacheSize + 1, cursor = 0;
+			int64 fan = 0;
+			while (fan >= 0) {
+				// Emit every remaining triangle around the fan vertex.
+				candidates.clear();
+				const uint32 f = uint32(fan);
+				for (uint32 j = 0; j < adj.counts[f]; j++) {
+					const uint32 t = adj.triangles[adj.offsets[f] + j];
+					if (emitted[t]) continue;
+					emitted[t] = 1;
+
+					for (uint32 k = 0; k < 3; k++) {
+						const uint32 v = indices[t * 3 + k];
+						result.push_back(v);
+						deadEnd.push_back(v);
+						candidates.push_back(v);
+						live[v]--;
+						if (time - cacheTime[v] > cacheSize) cacheTime[v] = time++;
+					}
+				}
+
+				// Next fan: the candidate that stays in the cache while its remaining triangles are emitted, oldest first.
+				fan = -1;
+				int64 bestPriority = -1;
+				for (uint32 v : candidates) {
+					if (live[v] == 0) continue;
+					int64 priority = 0;
+					if (time - cacheTime[v] + 2 * live[v] <= cacheSize) priority = time - cacheTime[v];
+					if (priority > bestPriority) {
+						bestPriority = priority;
+						fan = v;
+					}
+				}
+
+				while (fan < 0 && !deadEnd.empty()) {
+					const uint32 v = deadEnd.back();
+					deadEnd.pop_back();
+					if (live[v] > 0) fan = v;
+				}
+				while (fan < 0 && cursor < vertexCount) {
+					if (live[cursor] > 0) fan = cursor;
+					cursor++;
+				}
+			}
+
+			std::memcpy(indices, result.data(), result.size() * sizeof(uint32));
+		}
+
+		void optimizeOverdraw(uint32* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold) {
+			const size_t triCount = indexCount / 3;
+			if (triCount == 0) return;
+
+			constexpr uint32 CacheSize = 16;
+			FifoCache cache(vertexCount, CacheSize);
+
+			// Hard boundaries: the cache order starts over wherever a triangle misses all of its vertices.
+			std::vector<uint32> hard;
+			for (size_t t = 0; t < triCount; t++) {
+				if (cache.misses(indices + t * 3) == 3) hard.push_back(uint32(t));
+			}
+			hard.push_back(uint32(triCount));
+
+			// Soft boundaries: split further as long as every piece stays within threshold of its cluster's ACMR.
+			std::vector<uint32> clusters;
+			for (size_t c = 0; c + 1 < hard.size(); c++) {
+				const uint32 begin = hard[c], end = hard[c + 1];
+
+				cache.flush();
+				uint32 clusterMisses = 0;
+				for (uint32 t = begin; t < end; t++) clusterMisses += cache.misses(indices + t * 3);
+				const float limit = threshold * float(clusterMisses) / float(end - begin);
+
+				cache.flush();
+				clusters.push_back(begin);
+				uint32 start = begin, misses = 0;
+				for (uint32 t = begin; t < end; t++) {
+					misses += cache.misses(indices + t * 3);
+					if (t + 1 < end && float(misses) <= limit * float(t + 1 - start)) {
+						clusters.push_back(t + 1);
+						cache.flush();
+						start = t + 1;
+						misses = 0;
+					}
+				}
+			}
+			const size_t clusterCount = clusters.size();
+			clusters.push_back(uint32(triCount));
+
+			// Clusters facing away from the mesh centroid are on the outside and likely occlude the rest.
+			std::vector<Vector3> centroids(clusterCount), normals(clusterCount);
+			std::vector<float> areas(clusterCount, 0.0f);
+			Vector3 meshCentroid(0.0f);
+			float meshArea = 0.0f;
+			for (size_t c = 0; c < clusterCount; c++) {
+				Vector3 centroid(0.0f), normal(0.0f);
+				float area = 0.0f;
+				for (uint32 t = clusters[c]; t < clusters[c + 1]; t++) {
+					const Vector3& a = vertices[indices[t * 3]].position;
+					const Vector3& b = vertices[indices[t * 3 + 1]].position;
+					const Vector3& d = vertices[indices[t * 3 + 2]].position;
+					const Vector3 n = (b - a).cross(d - a);
+					const float w = n.length();
+					centroid = centroid + (a + b + d) * (w / 3.0f);
+					normal = normal + n;
+					area += w;
+				}
+				meshCentroid = meshCentroid + centroid;
+				meshArea += area;
+				centroids[c] = area > 0.0f ? centroid / area : centroid;
+				normals[c] = normal;
+				areas[c] = area;
+			}
+			if (meshArea > 0.0f) meshCentroid = meshCentroid / meshArea;
+
+			std::vector<float> keys(clusterCount);
+			std::vector<uint32> order(clusterCount);
+			for (size_t c = 0; c < clusterCount; c++) {
+				const float len = normals[c].length();
+				keys[c] = len > 0.0f ? (centroids[c] - meshCentroid).dot(normals[c]) / len : 0.0f;
+				order[c] = uint32(c);
+			}
+			std::stable_sort(order.begin(), order.end(), [&keys](uint32 a, uint32 b) { return keys[a] > keys[b]; });
+
+			std::vector<uint32> result;
+			result.reserve(triCount * 3);
+			for (uint32 c : order) {
+				result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+			}
+			std::memcpy(indices, result.data(), result.size() * sizeof(uint32));
+		}
+
+		void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32>& indices) {
+			std::vector<uint32> remap(vertices.size(), Empty);
+			std::vector<Vertex> ordered;
+			ordered.reserve(vertices.size());
+
+			for (auto& i : indices) {
+				if (remap[i] == Empty) {
+					remap[i] = uint32(ordered.size());
+					ordered.push_back(vertices[i]);
+				}
+				i = remap[i];
+			}
+			vertices = std::move(ordered);
+		}
+
+		std::vector<Meshlet> buildMeshlets(
+			uint32* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+			uint32 maxVertices, uint32 maxTriangles
+		) {
+			const size_t triCount = indexCount / 3;
+			std::vector<Meshlet> meshlets;
+			if (triCount == 0) return meshlets;
+
+			const Adjacency adj(indices, triCount * 3, vertexCount);
+			std::vector<uint8> emitted(triCount, 0);
+			std::vector<uint32> owner(vertexCount, Empty), result, local, candidates;
+			std::vector<Vector3> points;
+			result.reserve(triCount * 3);
+
+			uint32 cursor = 0;
+			while (result.size() < triCount * 3) {
+				const uint32 id = uint32(meshlets.size());
+				const uint32 begin = uint32(result.size());
+				local.clear();
+				candidates.clear();
+
+				auto newVertices = [&](uint32 t) {
+					uint32 n = 0;
+					for (uint32 k = 0; k < 3; k++) n += owner[indices[t * 3 + k]] != id;
+					return n;
+				};
+
+				auto add = [&](uint32 t) {
+					emitted[t] = 1;
+					for (uint32 k = 0; k < 3; k++) {
+						const uint32 v = indices[t * 3 + k];
+						result.push_back(v);
+						if (owner[v] == id) continue;
+
+						owner[v] = id;
+						local.push_back(v);
+						const uint32* vt = adj.triangles.data() + adj.offsets[v];
+						candidates.insert(candidates.end(), vt, vt + adj.counts[v]);
+					}
+				};
+
+				while (emitted[cursor]) cursor++;
+				add(cursor);
+
+				// Grow through the triangle that adds the fewest vertices, earliest first on ties.
+				for (uint32 tris = 1; tris < maxTriangles; tris++) {
+					uint32 best = Empty, bestNew = 4;
+					for (uint32 t : candidates) {
+						if (emitted[t]) continue;
+						const uint32 n = newVertices(t);
+						if (n < bestNew || (n == bestNew && t < best)) {
+							best = t;
+							bestNew = n;
+						}
+					}
+					if (best == Empty || local.size() + bestNew > maxVertices) break;
+					add(best);
+				}
+
+				Meshlet m{};
+				m.offset = begin;
+				m.count = uint32(result.size()) - begin;
+
+				points.clear();
+				for (uint32 v : local) points.push_back(vertices[v].position);
+				m.bounds = BoundingSphere::fromPoints(points.data(), points.size());
+
+				// The cone has to contain every triangle normal, the cutoff is the sine of its half angle
+				// widened by 90 degrees so a single dot product against the view direction tests it.
+				Vector3 axis(0.0f);
+				std::vector<Vector3>& normals = points;
+				normals.clear();
+				for (uint32 i = m.offset; i < m.offset + m.count; i += 3) {
+					const Vector3& p0 = vertices[result[i]].position;
+					const Vector3 n = (vertices[result[i + 1]].position - p0).cross(vertices[result[i + 2]].position - p0);
+					const float len = n.length();
+					if (len <= 0.0f) continue;
+					normals.push_back(n / len);
+					axis = axis + normals.back();
+				}
+
+				m.coneAxis = Vector3(0.0f);
+				m.coneCutoff = 1.0f;
+				const float axisLength = axis.length();
+				if (axisLength > 0.0f) {
+					axis = axis / axisLength;
+					float minDot = 1.0f;
+					for (const Vector3& n : normals) minDot = std::min(minDot, n.dot(axis));
+
+					// Past ~85 degrees the cone is useless.
+					if (minDot > 0.1f) {
+						m.coneAxis = axis;
+						m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+					}
+				}
+				meshlets.push_back(m);
+			}
+
+			std::memcpy(indices, result.data(), result.size() * sizeof(uint32));
+			return meshlets;
+		}
+
+		std::vector<uint32> simplify(
+			const uint32* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+			size_t targetIndexCount, float targetError, float* resultError
+		) {
+			std::vector<uint32> result(indices, indices + indexCount / 3 * 3);
+			if (resultError) *resultError = 0.0f;
+			if (result.empty() || vertexCount == 0) return result;
+
+			// Work in units of the AABB diagonal so the errors don't depend on the mesh scale.
+			AABB bounds = AABB::empty();
+			for (size_t v = 0; v < vertexCount; v++) bounds.expand(vertices[v].position);
+			const float diagonal = bounds.size().length();
+			const float scale = diagonal > 0.0f ? 1.0f / diagonal : 1.0f;
+
+			std::vector<Vector3> positions(vertexCount);
+			for (size_t v = 0; v < vertexCount; v++) positions[v] = (vertices[v].position - bounds.min) * scale;
+
+			// Vertices sharing a position (seams) share a quadric and are never moved.
+			std::vector<uint32> canonical(vertexCount);
+			{
+				std::vector<Vertex> unique(vertexCount);
+				std::vector<uint32> welded(vertexCount);
+				for (size_t v = 0; v < vertexCount; v++) {
+					unique[v].position = vertices[v].position;
+					welded[v] = uint32(v);
+				}
+				weld(unique, welded);
+				std::vector<uint32> first(unique.size(), Empty);
+				for (size_t v = 0; v < vertexCount; v++) {
+					if (first[welded[v]] == Empty) first[welded[v]] = uint32(v);
+					canonical[v] = first[welded[v]];
+				}
+			}
+
+			std::vector<uint8> locked(vertexCount, 0);
+			std::vector<uint32> groupSize(vertexCount, 0);
+			for (size_t v = 0; v < vertexCount; v++) groupSize[canonical[v]]++;
+			for (size_t v = 0; v < vertexCount; v++) locked[v] = groupSize[canonical[v]] > 1;
+
+			// Border edges only appear in one direction.
+			{
+				std::vector<uint64> edges;
+				edges.reserve(result.size());
+				auto key = [](uint32 a, uint32 b) { return (uint64(a) << 32) | b; };
+				for (size_t i = 0; i < result.size(); i += 3) {
+					for (uint32 k = 0; k < 3; k++) {
+						edges.push_back(key(canonical[result[i + k]], canonical[result[i + (k + 1) % 3]]));
+					}
+				}
+				std::sort(edges.begin(), edges.end());
+				std::vector<uint8> border(vertexCount, 0);
+				for (uint64 e : edges) {
+					const uint32 a = uint32(e >> 32), b = uint32(e);
+					if (!std::binary_search(edges.begin(), edges.end(), key(b, a))) border[a] = border[b] = 1;
+				}
+				for (size_t v = 0; v < vertexCount; v++) locked[v] |= border[canonical[v]];
+			}
+
+			std::vector<Quadric> quadrics(vertexCount);
+			for (size_t i = 0; i < result.size(); i += 3) {
+				const Vector3& p0 = positions[result[i]];
+				const Vector3 n = (positions[result[i + 1]] - p0).cross(positions[result[i + 2]] - p0);
+				const float len = n.length();
+				if (len <= 0.0f) continue;
+
+				// Area weighted, len is twice the triangle area.
+				const double nx = n.x / len, ny = n.y / len, nz = n.z / len;
+				const Quadric q = Quadric::plane(nx, ny, nz, -(nx * p0.x + ny * p0.y + nz * p0.z), len * 0.5);
+				for (uint32 k = 0; k < 3; k++) quadrics[canonical[result[i + k]]] += q;
+			}
+
+			struct Collapse {
+				uint32 from, to;
+				double error;
+			};
+			std::vector<Collapse> collapses;
+			std::vector<uint32> remap(vertexCount);
+			std::vector<uint8> touched(vertexCount);
+
+			const double maxError = double(targetError) * double(targetError);
+			double worst = 0.0;
+
+			auto flips = [&](const Adjacency& adj, uint32 from, uint32 to) {
+				const uint32* tris = adj.triangles.data() + adj.offsets[from];
+				for (uint32 j = 0; j < adj.counts[from]; j++) {
+					const uint32* t = result.data() + tris[j] * 3;
+					if (t[0] == to || t[1] == to || t[2] == to) continue;
+
+					Vector3 p[3] = { positions[t[0]], positions[t[1]], positions[t[2]] };
+					const Vector3 before = (p[1] - p[0]).cross(p[2] - p[0]);
+					for (uint32 k = 0; k < 3; k++) if (t[k] == from) p[k] = positions[to];
+					const Vector3 after = (p[1] - p[0]).cross(p[2] - p[0]);
+					if (before.dot(after) <= 0.0f) return true;
+				}
+				return false;
+			};
+
+			while (result.size() > targetIndexCount) {
+				const Adjacency adj(result.data(), result.size(), vertexCount);
+
+				// Interior edges show up once per direction, a < b keeps one copy.
+				collapses.clear();
+				for (size_t i = 0; i < result.size(); i += 3) {
+					for (uint32 k = 0; k < 3; k++) {
+						const uint32 a = result[i + k], b = result[i + (k + 1) % 3];
+						if (a >= b || (locked[a] && locked[b])) continue;
+
+						Quadric q = quadrics[canonical[a]];
+						q += quadrics[canonical[b]];
+						const double ab = locked[a] ? maxError * 2.0 + 1.0 : q.error(positions[b]);
+						const double ba = locked[b] ? maxError * 2.0 + 1.0 : q.error(positions[a]);
+						collapses.push_back(ab <= ba ? Collapse{ a, b, ab } : Collapse{ b, a, ba });
+					}
+				}
+				std::sort(collapses.begin(), collapses.end(), [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+				// Every collapse removes about two triangles, don't overshoot the target by much.
+				const size_t limit = (result.size() - targetIndexCount) / 6 + 1;
+				for (size_t v = 0; v < vertexCount; v++) remap[v] = uint32(v);
+				std::fill(touched.begin(), touched.end(), 0);
+
+				size_t applied = 0;
+				for (const Collapse& c : collapses) {
+					if (c.error > maxError || applied >= limit) break;
+					if (touched[c.from] || touched[c.to] || flips(adj, c.from, c.to)) continue;
+
+					remap[c.from] = c.to;
+					quadrics[canonical[c.to]] += quadrics[canonical[c.from]];
+					worst = std::max(worst, c.error);
+					applied++;
+
+					// The neighbourhood changed, later flip tests around it would be stale.
+					const uint32* tris = adj.triangles.data() + adj.offsets[c.from];
+					for (uint32 j = 0; j < adj.counts[c.from]; j++) {
+						for (uint32 k = 0; k < 3; k++) touched[result[tris[j] * 3 + k]] = 1;
+					}
+				}
+				if (applied == 0) break;
+
+				size_t write = 0;
+				for (size_t i = 0; i < result.size(); i += 3) {
+					const uint32 a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+					if (a == b || b == c || a == c) continue;
+					result[write++] = a;
+					result[write++] = b;
+					result[write++] = c;
+				}
+				result.resize(write);
+			}
+
+			if (resultError) *resultError = float(std::sqrt(worst));
+			return result;
+		}
+
+		void weld(std::vector<Vertex>& vertices, std::vector<uint32>& indices, float epsilon) {
+			const size_t count = vertices.size();
+			const float inv = epsilon > 0.0f ? 1.0f / epsilon : 0.0f;
+
+			// Exact welds key on all the attributes. With epsilon the key is the grid cell of the position, and as
+			// vertices within epsilon of each other may fall into neighbouring cells, all 27 around it are searched.
+			// Adding 0 turns -0 into +0, so both compare and hash equal.
+			auto keyOf = [inv](const Vertex& v, float dx, float dy, float dz) {
+				WeldKey k{};
+				if (inv > 0.0f) {
+					k.v[0] = std::floor(v.position.x * inv) + dx + 0.0f;
+					k.v[1] = std::floor(v.position.y * inv) + dy + 0.0f;
+					k.v[2] = std::floor(v.position.z * inv) + dz + 0.0f;
+					return k;
+				}
+				const float src[8] = {
+					v.position.x, v.position.y, v.position.z,
+					v.normal.x, v.normal.y, v.normal.z,
+					v.texCoord.x, v.texCoord.y
+				};
+				for (size_t i = 0; i < 8; i++) k.v[i] = src[i] + 0.0f;
+				return k;
+			};
+			auto near = [epsilon](const Vertex& a, const Vertex& b) {
+				return std::abs(a.position.x - b.position.x) <= epsilon && std::abs(a.position.y - b.position.y) <= epsilon &&
+					std::abs(a.position.z - b.position.z) <= epsilon && std::abs(a.normal.x - b.normal.x) <= epsilon &&
+					std::abs(a.normal.y - b.normal.y) <= epsilon && std::abs(a.normal.z - b.normal.z) <= epsilon &&
+					std::abs(a.texCoord.x - b.texCoord.x) <= epsilon && std::abs(a.texCoord.y - b.texCoord.y) <= epsilon;
+			};
+
+			// Open addressing from keys to chains of the kept vertices under them, linked through next.
+			size_t tableSize = 16;
+			while (tableSize < count * 2) tableSize <<= 1;
+			std::vector<uint32> table(tableSize, Empty);
+			std::vector<WeldKey> keys;
+			std::vector<uint32> heads;
+			keys.reserve(count);
+			heads.reserve(count);
+			auto slotOf = [&](const WeldKey& k) {
+				size_t slot = hash(k) & (tableSize - 1);
+				while (table[slot] != Empty && !(keys[table[slot]] == k)) slot = (slot + 1) & (tableSize - 1);
+				return slot;
+			};
+
+			std::vector<uint32> remap(count), next;
+			std::vector<Vertex> unique;
+			unique.reserve(count);
+			next.reserve(count);
+
+			for (size_t i = 0; i < count; i++) {
+				const Vertex& v = vertices[i];
+
+				// The first kept vertex in reach wins, so the result doesn't depend on the chain order.
+				uint32 match = Empty;
+				if (inv > 0.0f) {
+					for (float dz = -1.0f; dz <= 1.0f; dz++) {
+						for (float dy = -1.0f; dy <= 1.0f; dy++) {
+							for (float dx = -1.0f; dx <= 1.0f; dx++) {
+								const size_t slot = slotOf(keyOf(v, dx, dy, dz));
+								if (table[slot] == Empty) continue;
+								for (uint32 u = heads[table[slot]]; u != Empty; u = next[u]) {
+									if (u < match && near(unique[u], v)) match = u;
+								}
+							}
+						}
+					}
+				} else {
+					const size_t slot = slotOf(keyOf(v, 0.0f, 0.0f, 0.0f));
+					if (table[slot] != Empty) match = heads[table[slot]];
+				}
+
+				if (match == Empty) {
+					match = uint32(unique.size());
+					const WeldKey k = keyOf(v, 0.0f, 0.0f, 0.0f);
+					const size_t slot = slotOf(k);
+					if (table[slot] == Empty) {
+						table[slot] = uint32(keys.size());
+						keys.push_back(k);
+						heads.push_back(Empty);
+					}
+					next.push_back(heads[table[slot]]);
+					heads[table[slot]] = match;
+					unique.push_back(v);
+				}
+				remap[i] = match;
+			}
+
+			for (auto& i : indices) i = remap[i];
+			vertices = std::move(unique);
+		}
+	}
+}
@@ -0,0 +1,71 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "integer.hpp"
+#include "vertex.h"
+
+#include <vector>
+
+namespace ae {
+	namespace meshopt {
+		/// Post-transform vertex cache behaviour of an index buffer, simulated as a FIFO.
+		struct VertexCacheStats {
+			uint32 invocations{ 0 }; // Vertex shader runs
+			float acmr{ 0.0f }; // Average cache miss ratio, invocations per triangle (0.5 is ideal, 3 is worst)
+			float atvr{ 0.0f }; // Average transformed vertex ratio, invocations per vertex (1 is ideal)
+		};
+
+		/// Small cluster of triangles, a contiguous range of the index buffer, with culling data.
+		struct Meshlet {
+			uint32 offset, count; // Index range
+			BoundingSphere bounds;
+			Vector3 coneAxis; // Average facing direction
+			float coneCutoff; // 1 when the triangles face too many directions to ever be culled
+
+			/// All triangles face away from eye.
+			bool backFacing(const Vector3& eye) const {
+				const Vector3 d = bounds.center - eye;
+				return d.dot(coneAxis) >= coneCutoff * d.length() + bounds.radius;
+			}
+		};
+
+		VertexCacheStats analyzeVertexCache(const uint32* indices, size_t indexCount, size_t vertexCount, uint32 cacheSize = 16);
+
+		/// Reorders triangles for the post-transform cache (Forsyth's linear-speed algorithm).
+		void optimizeVertexCache(uint32* indices, size_t indexCount, size_t vertexCount);
+
+		/// Reorders triangles for the post-transform cache (Tipsify, Sander et al.), about 5x faster than Forsyth and at
+		/// least as good on the meshes measured (bunny ACMR 0.68 for both, 200x200 grid 0.60 against 0.74).
+		void optimizeVertexCacheTipsify(uint32* indices, size_t indexCount, size_t vertexCount, uint32 cacheSize = 16);
+
+		/// Splits a cache-optimized index buffer into clusters and sorts them outside-in so the front
+		/// surfaces tend to draw first. threshold bounds the ACMR loss (1.05 = at most 5% worse).
+		void optimizeOverdraw(uint32* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount, float threshold = 1.05f);
+
+		/// Reorders vertices by first use in the index buffer and drops unreferenced ones.
+		void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32>& indices);
+
+		/// Groups triangles into meshlets of at most maxVertices unique vertices and maxTriangles triangles,
+		/// growing each one through shared vertices. Reorders the triangles so every meshlet is contiguous.
+		std::vector<Meshlet> buildMeshlets(
+			uint32* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+			uint32 maxVertices = 64, uint32 maxTriangles = 124
+		);
+
+		/// Quadric error edge-collapse simplification towards targetIndexCount, stopping early once the error would
+		/// exceed targetError. Errors are root mean square distances to the original surface around a collapse,
+		/// relative to the AABB diagonal. Vertices only ever collapse onto existing ones, so the result indexes the
+		/// same vertex buffer. Borders and attribute seams are kept intact.
+		std::vector<uint32> simplify(
+			const uint32* indices, size_t indexCount, const Vertex* vertices, size_t vertexCount,
+			size_t targetIndexCount, float targetError, float* resultError = nullptr
+		);
+
+		/// Merges vertices with equal position, normal and texture coordinates and remaps the indices.
+		/// With epsilon > 0 a vertex merges into the first kept one whose attributes are all within epsilon of its own.
+		/// The first vertex of every group is kept, the order of the survivors is preserved.
+		void weld(std::vector<Vertex>& vertices, std::vector<uint32>& indices, float epsilon = 0.0f);
+	}
+}
+
+#endif // MESH_OPTIMIZER_H
@@ -0,0 +1,387 @@
+#include "mipmap.h"
+
+#include "simd.h"
+#include "util.hpp"
+#include "texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace {
+		constexpr float KaiserRadius = 2.0f; // In destination texels
+		constexpr float KaiserAlpha = 4.0f;
+		constexpr float Pi = 3.14159265358979f;
+
+		constexpr uint8 Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		constexpr uint32 VkR8G8B8A8Unorm = 37, VkR8G8B8A8Srgb = 43;
+		constexpr char CacheKeyName[] = "AEmipCacheKey"; // Key/value entry of writeKTX2(), 8 byte value
+
+		/// Source texels and weights of every destination texel along one axis, count of them each.
+		struct Taps {
+			uint32 count;
+			std::vector<uint32> index; // Clamped to the image
+			std::vector<float> weight; // Normalized
+		};
+
+		// Zeroth order modified Bessel function of the first kind, its series converges quickly for the alphas used.
+		float besselI0(float x) {
+			float sum = 1.0f, term = 1.0f;
+			for (uint32 k = 1; k < 20; k++) {
+				term *= (x * 0.5f / float(k)) * (x * 0.5f / float(k));
+				sum += term;
+			}
+			return sum;
+		}
+
+		float kaiser(float t) {
+			const float sinc = std::abs(t) < 1e-6f ? 1.0f : std::sin(Pi * t) / (Pi * t);
+			const float x = t / KaiserRadius;
+			return sinc * besselI0(KaiserAlpha * std::sqrt(std::max(1.0f - x * x, 0.0f))) / besselI0(KaiserAlpha);
+		}
+
+		Taps buildTaps(uint32 source, uint32 target, MipFilter filter) {
+			const float scale = float(source) / float(target);
+			Taps taps;
+			taps.count = filter == MipFilter::Box ? uint32(std::ceil(scale)) + 1 : uint32(std::ceil(KaiserRadius * scale * 2.0f)) + 1;
+			taps.index.assign(size_t(target) * taps.count, 0);
+			taps.weight.assign(size_t(target) * taps.count, 0.0f);
+
+			for (uint32 x = 0; x < target; x++) {
+				uint32* index = &taps.index[size_t(x) * taps.count];
+				float* weight = &taps.weight[size_t(x) * taps.count];
+				uint32 k = 0;
+				float sum = 0.0f;
+				auto add = [&](int32 i, float w) {
+					if (w == 0.0f || k == taps.count) return;
+					index[k] = uint32(std::clamp(i, 0, int32(source) - 1));
+					weight[k++] = w;
+					sum += w;
+				};
+
+				if (filter == MipFilter::Box) {
+					// The overlap of every source texel with the destination texel's footprint.
+					const float lo = float(x) * scale, hi = float(x + 1) * scale;
+					for (int32 i = int32(lo); float(i) < hi; i++) add(i, std::min(float(i + 1), hi) - std::max(float(i), lo));
+				} else {
+					const float centre = (float(x) + 0.5f) * scale;
+					const int32 first = int32(std::floor(centre - KaiserRadius * scale));
+					const int32 last = int32(std::ceil(centre + KaiserRadius * scale));
+					for (int32 i = first; i <= last; i++) {
+						const float t = (float(i) + 0.5f - centre) / scale;
+						if (std::abs(t) < KaiserRadius) add(i, kaiser(t));
+					}
+				}
+
+				for (uint32 j = 0; j < k; j++) weight[j] /= sum;
+				for (uint32 j = k; j < taps.count; j++) index[j] = index[0];
+			}
+			return taps;
+		}
+
+		// in and out are RGBA float images, in is inWidth wide. Rows [begin, end) are filtered horizontally.
+		void filterRowsScalar(const float* in, uint32 inWidth, float* out, uint32 outWidth, const Taps& taps, size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				const float* src = in + y * inWidth * 4;
+				float* dst = out + y * outWidth * 4;
+				for (uint32 x = 0; x < outWidth; x++) {
+					float acc[4]{};
+					for (uint32 k = 0; k < taps.count; k++) {
+						const float w = taps.weight[size_t(x) * taps.count + k];
+						const float* texel = src + size_t(taps.index[size_t(x) * taps.count + k]) * 4;
+						for (uint32 c = 0; c < 4; c++) acc[c] += w * texel[c];
+					}
+					std::memcpy(dst + size_t(x) * 4, acc, sizeof(acc));
+				}
+			}
+		}
+
+		// Output rows [begin, end) are weighted sums of whole input rows, floats wide.
+		void filterColumnsScalar(const float* in, uint32 floats, float* out, const Taps& taps, size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				float* dst = out + y * floats;
+				std::fill(dst, dst + floats, 0.0f);
+				for (uint32 k = 0; k < taps.count; k++) {
+					const float w = taps.weight[y * taps.count + k];
+					const float* src = in + size_t(taps.index[y * taps.count + k]) * floats;
+					for (uint32 i = 0; i < floats; i++) dst[i] += w * src[i];
+				}
+			}
+		}
+
+#if defined(AE_X86)
+		// SSE2, one RGBA texel per register.
+		AE_TARGET("sse2") void filterRows_SSE2(const float* in, uint32 inWidth, float* out, uint32 outWidth, const Taps& taps, size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				const float* src = in + y * inWidth * 4;
+				float* dst = out + y * outWidth * 4;
+				const uint32* index = taps.index.data();
+				const float* weight = taps.weight.data();
+				for (uint32 x = 0; x < outWidth; x++) {
+					__m128 acc = _mm_setzero_ps();
+					for (uint32 k = 0; k < taps.count; k++) {
+						acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(src + size_t(index[k]) * 4)));
+					}
+					_mm_storeu_ps(dst + size_t(x) * 4, acc);
+					index += taps.count;
+					weight += taps.count;
+				}
+			}
+		}
+
+		// Rows are whole texels, floats is a multiple of 4.
+		AE_TARGET("sse2") void filterColumns_SSE2(const float* in, uint32 floats, float* out, const Taps& taps, size_t begin, size_t end) {
+			for (size_t y = begin; y < end; y++) {
+				float* dst = out + y * floats;
+				const uint32* index = &taps.index[y * taps.count];
+				const float* weight = &taps.weight[y * taps.count];
+				for (uint32 i = 0; i < floats; i += 4) {
+					__m128 acc = _mm_setzero_ps();
+					for (uint32 k = 0; k < taps.count; k++) {
+						acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(in + size_t(index[k]) * floats + i)));
+					}
+					_mm_storeu_ps(dst + i, acc);
+				}
+			}
+		}
+#endif
+
+		void filterRows(const float* in, uint32 inWidth, float* out, uint32 outWidth, const Taps& taps, size_t begin, size_t end) {
+#if defined(AE_X86)
+			if (simd::level() >= SimdLevel::SSE2) return filterRows_SSE2(in, inWidth, out, outWidth, taps, begin, end);
+#endif
+			filterRowsScalar(in, inWidth, out, outWidth, taps, begin, end);
+		}
+
+		void filterColumns(const float* in, uint32 floats, float* out, const Taps& taps, size_t begin, size_t end) {
+#if defined(AE_X86)
+			if (simd::level() >= SimdLevel::SSE2) return filterColumns_SSE2(in, floats, out, taps, begin, end);
+#endif
+			filterColumnsScalar(in, floats, out, taps, begin, end);
+		}
+
+		float srgbToLinear(float v) {
+			return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float linearToSrgb(float v) {
+			return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+		}
+
+		inline uint8 quantize(float v) {
+			return uint8(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f);
+		}
+
+		// Linear to 8 bit sRGB through a table, fine enough that every dark code has entries of its own.
+		constexpr uint32 SrgbTableSize = 16384;
+
+		/// Back to RGBA8 in place of texels [begin, end) of level, renormalizing normal maps first.
+		void encodeTexels(float* level, uint8* out, size_t begin, size_t end, const MipOptions& options, const uint8* toSrgb) {
+			for (size_t i = begin; i < end; i++) {
+				float* t = level + i * 4;
+				if (options.normalMap) {
+					const float length = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+					if (length > 1e-6f) {
+						for (uint32 c = 0; c < 3; c++) t[c] /= length;
+					}
+					for (uint32 c = 0; c < 3; c++) out[i * 4 + c] = quantize(t[c] * 0.5f + 0.5f);
+				} else if (options.srgb) {
+					for (uint32 c = 0; c < 3; c++) {
+						out[i * 4 + c] = toSrgb[uint32(std::clamp(t[c], 0.0f, 1.0f) * float(SrgbTableSize - 1) + 0.5f)];
+					}
+				} else {
+					for (uint32 c = 0; c < 3; c++) out[i * 4 + c] = quantize(t[c]);
+				}
+				out[i * 4 + 3] = quantize(t[3]);
+			}
+		}
+
+		inline void write32(std::vector<uint8>& out, size_t at, uint32 v) {
+			std::memcpy(out.data() + at, &v, sizeof(v));
+		}
+
+		inline void write64(std::vector<uint8>& out, size_t at, uint64 v) {
+			std::memcpy(out.data() + at, &v, sizeof(v));
+		}
+
+		inline uint32 read32(const uint8* p) {
+			uint32 v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline uint64 read64(const uint8* p) {
+			uint64 v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+	}
+
+	namespace mip {
+		void generate(const uint8* rgba, uint32 width, uint32 height, const MipOptions& options, MipChain& out) {
+			out.levels.clear();
+			out.data.clear();
+			if (width == 0 || height == 0) return;
+
+			size_t total = 0;
+			for (uint32 w = width, h = height;; w = std::max(w / 2, 1u), h = std::max(h / 2, 1u)) {
+				out.levels.push_back({ w, h, total });
+				total += size_t(w) * h * 4;
+				if (w == 1 && h == 1) break;
+			}
+			out.data.resize(total);
+			std::memcpy(out.data.data(), rgba, size_t(width) * height * 4);
+
+			float toLinear[256];
+			for (uint32 i = 0; i < 256; i++) {
+				const float v = float(i) / 255.0f;
+				toLinear[i] = options.normalMap ? v * 2.0f - 1.0f : options.srgb ? srgbToLinear(v) : v;
+			}
+
+			std::vector<uint8> toSrgb(options.srgb && !options.normalMap ? SrgbTableSize : 0);
+			for (uint32 i = 0; i < toSrgb.size(); i++) toSrgb[i] = quantize(linearToSrgb(float(i) / float(SrgbTableSize - 1)));
+
+			std::vector<float> level(size_t(width) * height * 4), rows, next;
+			const size_t texels = size_t(width) * height;
+			util::parallelFor(texels, util::parallelRanges(texels, 16384), [&](size_t begin, size_t end, size_t) {
+				for (size_t i = begin; i < end; i++) {
+					for (uint32 c = 0; c < 3; c++) level[i * 4 + c] = toLinear[rgba[i * 4 + c]];
+					level[i * 4 + 3] = float(rgba[i * 4 + 3]) / 255.0f;
+				}
+			});
+
+			for (size_t l = 1; l < out.levels.size(); l++) {
+				const auto& src = out.levels[l - 1];
+				const auto& dst = out.levels[l];
+				const Taps horizontal = buildTaps(src.width, dst.width, options.filter);
+				const Taps vertical = buildTaps(src.height, dst.height, options.filter);
+
+				rows.resize(size_t(dst.width) * src.height * 4);
+				next.resize(size_t(dst.width) * dst.height * 4);
+				util::parallelFor(src.height, util::parallelRanges(src.height, 16), [&](size_t begin, size_t end, size_t) {
+					filterRows(level.data(), src.width, rows.data(), dst.width, horizontal, begin, end);
+				});
+
+				uint8* pixels = out.data.data() + dst.offset;
+				util::parallelFor(dst.height, util::parallelRanges(dst.height, 16), [&](size_t begin, size_t end, size_t) {
+					filterColumns(rows.data(), dst.width * 4, next.data(), vertical, begin, end);
+					encodeTexels(next.data(), pixels, begin * dst.width, end * dst.width, options, toSrgb.data());
+				});
+				level.swap(next);
+			}
+		}
+
+		void writeKTX2(const MipChain& chain, bool srgb, bool flipVertically, std::vector<uint8>& out, uint64 cacheKey) {
+			const uint32 levels = uint32(chain.levels.size());
+			const uint32 dfdOffset = 80 + levels * 24;
+			const uint32 dfdSize = 4 + 24 + 16 * 4; // Basic descriptor block with four samples
+			const uint32 kvdEntry = uint32(sizeof(CacheKeyName)) + 8; // Name, its NUL, then the value
+			const uint32 kvdSize = cacheKey != 0 ? 4 + (kvdEntry + 3) / 4 * 4 : 0;
+
+			out.assign(dfdOffset + dfdSize + kvdSize, 0);
+			std::memcpy(out.data(), Ktx2Identifier, sizeof(Ktx2Identifier));
+			write32(out, 12, srgb ? VkR8G8B8A8Srgb : VkR8G8B8A8Unorm);
+			write32(out, 16, 1); // typeSize
+			write32(out, 20, chain.levels.empty() ? 0 : chain.levels[0].width);
+			write32(out, 24, chain.levels.empty() ? 0 : chain.levels[0].height);
+			write32(out, 36, 1); // faceCount
+			write32(out, 40, levels);
+			write32(out, 48, dfdOffset);
+			write32(out, 52, dfdSize);
+			if (cacheKey != 0) {
+				const uint32 kvdOffset = dfdOffset + dfdSize;
+				write32(out, 56, kvdOffset);
+				write32(out, 60, kvdSize);
+				write32(out, kvdOffset, kvdEntry);
+				std::memcpy(out.data() + kvdOffset + 4, CacheKeyName, sizeof(CacheKeyName));
+				write64(out, kvdOffset + 4 + sizeof(CacheKeyName), cacheKey);
+			}
+
+			// RGBSDA, BT.709 primaries, straight alpha, one byte per channel. Alpha is always linear.
+			uint32 at = dfdOffset;
+			write32(out, at, dfdSize);
+			write32(out, at + 8, 2u | (24u + 16u * 4u) << 16);
+			write32(out, at + 12, 1u | 1u << 8 | (srgb ? 2u : 1u) << 16);
+			write32(out, at + 20, 4); // bytesPlane0
+			at += 4 + 24;
+			static constexpr uint32 channels[4] = { 0, 1, 2, 15 };
+			for (uint32 c = 0; c < 4; c++, at += 16) {
+				write32(out, at, c * 8 | 7u << 16 | channels[c] << 24 | (c == 3 ? 1u << 28 : 0u));
+				write32(out, at + 12, 255);
+			}
+
+			// Level data is stored smallest first, the index stays largest first.
+			std::vector<uint8> flipped;
+			for (uint32 l = levels; l-- > 0;) {
+				const auto& level = chain.levels[l];
+				const size_t size = size_t(level.width) * level.height * 4, offset = out.size();
+				write64(out, 80 + size_t(l) * 24, offset);
+				write64(out, 80 + size_t(l) * 24 + 8, size);
+				write64(out, 80 + size_t(l) * 24 + 16, size);
+				out.insert(out.end(), chain.level(l), chain.level(l) + size);
+				if (flipVertically) intern::flipRows(out.data() + offset, level.width * 4, level.height);
+			}
+		}
+
+		bool isKTX2(const uint8* data, size_t size) {
+			if (size < 80 || std::memcmp(data, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0) return false;
+			const uint32 format = read32(data + 12);
+			return format == VkR8G8B8A8Unorm || format == VkR8G8B8A8Srgb;
+		}
+
+		uint64 cacheKey(const uint8* data, size_t size) {
+			if (!isKTX2(data, size)) return 0;
+			const uint32 kvdOffset = read32(data + 56), kvdSize = read32(data + 60);
+			if (kvdOffset > size || kvdSize > size - kvdOffset) return 0;
+
+			const uint8* entry = data + kvdOffset;
+			const uint8* end = entry + kvdSize;
+			while (end - entry >= 4) {
+				const uint32 length = read32(entry);
+				if (length > size_t(end - entry) - 4) return 0;
+				if (length == sizeof(CacheKeyName) + 8 && std::memcmp(entry + 4, CacheKeyName, sizeof(CacheKeyName)) == 0) {
+					return read64(entry + 4 + sizeof(CacheKeyName));
+				}
+				entry += 4 + (length + 3) / 4 * 4;
+			}
+			return 0;
+		}
+
+		bool readKTX2(const uint8* data, size_t size, bool flipVertically, MipChain& out) {
+			out.levels.clear();
+			out.data.clear();
+			if (!isKTX2(data, size)) return false;
+
+			const uint32 width = read32(data + 20), height = read32(data + 24), depth = read32(data + 28);
+			const uint32 layers = read32(data + 32), faces = read32(data + 36), levels = std::max(read32(data + 40), 1u);
+			if (depth > 0 || layers > 1 || faces != 1 || read32(data + 44) != 0) return false;
+			if (width == 0 || height == 0 || levels > intern::mipLevels(width, height)) return false;
+			if (80 + size_t(levels) * 24 > size) return false;
+
+			for (uint32 l = 0; l < levels; l++) {
+				const uint8* entry = data + 80 + size_t(l) * 24;
+				const uint64 offset = read64(entry), length = read64(entry + 8);
+				const uint32 w = std::max(width >> l, 1u), h = std::max(height >> l, 1u);
+				const size_t bytes = size_t(w) * h * 4;
+				if (offset > size || length > size - offset || length < bytes) {
+					out.levels.clear();
+					out.data.clear();
+					return false;
+				}
+				out.levels.push_back({ w, h, out.data.size() });
+				out.data.insert(out.data.end(), data + offset, data + offset + bytes);
+				if (flipVertically) intern::flipRows(out.data.data() + out.levels.back().offset, w * 4, h);
+			}
+			return true;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include "integer.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace ae {
+	enum class MipFilter : uint8 {
+		Box = 0, // Area average, what glGenerateMipmap does
+		Kaiser   // Kaiser windowed sinc, keeps distant detail sharper
+	};
+
+	/// How a texture gets its mips.
+	struct MipOptions {
+		bool cpu{ false };                     // Built here instead of by glGenerateMipmap
+		MipFilter filter{ MipFilter::Kaiser };
+		bool srgb{ true };                     // Colour is sRGB encoded and filtered in linear space
+		bool normalMap{ false };               // Texels are unit vectors, renormalized after filtering. Ignores srgb
+		bool keep{ false };                    // The texture holds on to the chain, see Texture::mipChain()
+		bool cache{ true };                    // Texture::fromFile() keeps CPU built chains in a KTX2 file next to the image
+	};
+
+	/// RGBA8 image and its mips down to 1x1, level 0 first.
+	struct MipChain {
+		struct Level {
+			uint32 width, height;
+			size_t offset; // Within data, levels are width * height * 4 bytes
+		};
+
+		std::vector<Level> levels;
+		std::vector<uint8> data;
+
+		const uint8* level(uint32 index) const { return data.data() + levels[index].offset; }
+	};
+
+	namespace mip {
+		/// Builds the chain of a width x height RGBA8 image. Every level is filtered from the float copy of the one
+		/// above, rows spread over the cores.
+		void generate(const uint8* rgba, uint32 width, uint32 height, const MipOptions& options, MipChain& out);
+
+		/// Serializes chain as an R8G8B8A8 (sRGB if srgb) KTX2 file, which loads back through Texture::fromFile().
+		/// flipVertically undoes the flip fromFile() applies, so loading the file the same way gives the same texture.
+		/// A non-zero cacheKey is stored in the key/value data, see cacheKey().
+		void writeKTX2(const MipChain& chain, bool srgb, bool flipVertically, std::vector<uint8>& out, uint64 cacheKey = 0);
+
+		/// The cacheKey writeKTX2() stored in an R8G8B8A8 KTX2 file, 0 if there is none.
+		uint64 cacheKey(const uint8* data, size_t size);
+
+		/// Whether data is an R8G8B8A8 KTX2 file, as writeKTX2() makes them.
+		bool isKTX2(const uint8* data, size_t size);
+
+		/// Reads an R8G8B8A8 KTX2 file with its levels, false for anything else.
+		bool readKTX2(const uint8* data, size_t size, bool flipVertically, MipChain& out);
+	}
+}
+
+#endif // MIPMAP_H
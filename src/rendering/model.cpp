@@ -0,0 +1,340 @@
+#include "model.h"
+
+#include "gltf_loader.h"
+#include "file_system.h"
+#include "log.h"
+#include "texture_loader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+
+namespace ae {
+	namespace {
+		constexpr uint32 ModeTriangleStrip = 5;
+		constexpr uint32 ModeTriangleFan = 6;
+
+		inline uint32 readIndex(const uint8* p, uint32 componentType) {
+			switch (componentType) {
+				case GltfData::UnsignedByte: return *p;
+				case GltfData::UnsignedShort: {
+					uint16 v;
+					std::memcpy(&v, p, sizeof(v));
+					return v;
+				}
+				default: {
+					uint32 v;
+					std::memcpy(&v, p, sizeof(v));
+					return v;
+				}
+			}
+		}
+
+		/// Strips and fans as a triangle list, keeping the winding.
+		std::vector<uint32> triangulate(const std::vector<uint32>& indices, uint32 mode) {
+			if (mode == GltfData::ModeTriangles) return std::vector<uint32>(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+
+			std::vector<uint32> ret;
+			for (size_t i = 0; i + 2 < indices.size(); i++) {
+				if (mode == ModeTriangleFan) ret.insert(ret.end(), { indices[0], indices[i + 1], indices[i + 2] });
+				else if (i % 2 == 0) ret.insert(ret.end(), { indices[i], indices[i + 1], indices[i + 2] });
+				else ret.insert(ret.end(), { indices[i + 1], indices[i], indices[i + 2] });
+			}
+			return ret;
+		}
+
+		AttributeStream stream(const GltfData& data, const GltfData::Accessor& a, int32 components) {
+			AttributeStream s{};
+			s.data = gltf::elements(data, a);
+			s.stride = gltf::stride(data, a);
+			s.bytes = (a.count - 1) * s.stride + gltf::componentSize(a.componentType) * a.components;
+			s.components = components;
+			s.type = a.componentType;
+			s.normalized = a.normalized;
+			return s;
+		}
+	}
+
+	void Model::fromFile(const std::string& fileName) {
+		const auto start = std::chrono::steady_clock::now();
+
+		// Mapped when it is a native file, so the buffers go to the GPU without another copy in memory.
+		auto& fs = FileSystem::ston();
+		const std::string nativePath = fs.nativePath(fileName);
+		std::unique_ptr<FileSystem::MappedFile> mapped;
+		std::vector<uint8> contents;
+		const uint8* bytes = nullptr;
+		size_t size = 0;
+		if (!nativePath.empty()) mapped = std::make_unique<FileSystem::MappedFile>(nativePath);
+		if (mapped && mapped->valid()) {
+			bytes = mapped->data();
+			size = mapped->size();
+		} else {
+			auto file = fs.open(fileName);
+			contents.resize(file.size());
+			if (file.read(contents.data(), contents.size()) == contents.size()) {
+				bytes = contents.data();
+				size = contents.size();
+			}
+			file.close();
+		}
+
+		GltfData data;
+		std::string error;
+		if (bytes == nullptr || !gltf::parse(bytes, size, data, error)) {
+			Log.error("Invalid model file " + fileName + ": " + (bytes == nullptr ? "can't read it" : error));
+			return;
+		}
+
+		loadTextures(data);
+		loadMaterials(data);
+
+		std::vector<std::pair<uint32, uint32>> meshParts(data.meshes.size());
+		for (uint32 m = 0; m < data.meshes.size(); m++) {
+			meshParts[m].first = uint32(m_parts.size());
+			for (uint32 p = 0; p < data.meshes[m].primitives.size(); p++) {
+				Mesh* mesh = loadPrimitive(data, m, p);
+				if (mesh == nullptr) continue;
+
+				const int32 material = data.meshes[m].primitives[p].material;
+				m_parts.push_back({ mesh, material < int32(m_materials.size()) ? material : -1 });
+			}
+			meshParts[m].second = uint32(m_parts.size()) - meshParts[m].first;
+		}
+
+		m_nodes.resize(data.nodes.size());
+		for (size_t i = 0; i < data.nodes.size(); i++) {
+			const GltfData::Node& src = data.nodes[i];
+			Node& n = m_nodes[i];
+			n.name = src.name;
+			n.position = src.translation;
+			n.rotation = src.rotation;
+			n.scale = src.scale;
+			n.children = src.children;
+			if (src.mesh >= 0 && src.mesh < int32(meshParts.size())) {
+				n.firstPart = meshParts[src.mesh].first;
+				n.partCount = meshParts[src.mesh].second;
+			}
+		}
+		m_roots = data.roots;
+
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		Log.info(
+			fileName + ": " + std::to_string(m_parts.size()) + " primitives (" + std::to_string(m_directUploads) +
+			" uploaded directly), " + std::to_string(m_textures.size()) + " textures, " + std::to_string(m_nodes.size()) +
+			" nodes in " + std::to_string(ms) + " ms"
+		);
+	}
+
+	void Model::loadTextures(const GltfData& data) {
+		m_textures.resize(data.images.size());
+		for (size_t i = 0; i < data.images.size(); i++) {
+			const GltfData::Image& image = data.images[i];
+			if (image.bufferView < 0 || image.bufferView >= int32(data.bufferViews.size())) {
+				Log.warn("Image " + std::to_string(i) + " isn't embedded, skipped.");
+				continue;
+			}
+
+			// Decoded in the background, the file data is gone by then.
+			const GltfData::BufferView& view = data.bufferViews[image.bufferView];
+			const uint8* bytes = data.bin + view.byteOffset;
+			m_textures[i] = std::make_unique<Texture>();
+			TextureLoader::ston().load(m_textures[i].get(), std::vector<uint8>(bytes, bytes + view.byteLength), false);
+		}
+	}
+
+	void Model::loadMaterials(const GltfData& data) {
+		auto texture = [&](int32 image) {
+			return image >= 0 && image < int32(m_textures.size()) ? m_textures[image].get() : nullptr;
+		};
+
+		// Metallic-roughness has no direct counterpart, roughness becomes the inverse of shininess.
+		m_materials.resize(data.materials.size());
+		for (size_t i = 0; i < data.materials.size(); i++) {
+			const GltfData::Material& src = data.materials[i];
+			Material& m = m_materials[i];
+			m.base(Vector3(src.baseColor.x, src.baseColor.y, src.baseColor.z));
+			m.shininess(std::clamp(1.0f - src.roughness, 0.0f, 1.0f));
+			m.texture(Material::SlotDiffuse, texture(src.baseColorTexture));
+			m.texture(Material::SlotNormal, texture(src.normalTexture));
+		}
+	}
+
+	Mesh* Model::loadPrimitive(const GltfData& data, uint32 meshIndex, uint32 primitiveIndex) {
+		const GltfData::Primitive& p = data.meshes[meshIndex].primitives[primitiveIndex];
+		const std::string name = "Primitive " + std::to_string(primitiveIndex) + " of mesh " + std::to_string(meshIndex);
+
+		auto accessor = [&](int32 i) -> const GltfData::Accessor* {
+			if (i < 0 || data.accessors[i].sparse || gltf::elements(data, data.accessors[i]) == nullptr) return nullptr;
+			return &data.accessors[i];
+		};
+		const GltfData::Accessor* position = accessor(p.position);
+		const GltfData::Accessor* normal = accessor(p.normal);
+		const GltfData::Accessor* tangent = accessor(p.tangent);
+		const GltfData::Accessor* texCoord = accessor(p.texCoord);
+		const GltfData::Accessor* indices = accessor(p.indices);
+
+		if (p.mode != GltfData::ModeTriangles && p.mode != ModeTriangleStrip && p.mode != ModeTriangleFan) {
+			Log.warn(name + " isn't made of triangles, skipped.");
+			return nullptr;
+		}
+		if (position == nullptr || position->components != 3) {
+			Log.warn(name + " has no readable positions, skipped.");
+			return nullptr;
+		}
+
+		const uint32 vertexCount = position->count;
+		for (const GltfData::Accessor* a : { normal, tangent, texCoord }) {
+			if (a != nullptr && a->count != vertexCount) {
+				Log.warn(name + " has attributes of different lengths, skipped.");
+				return nullptr;
+			}
+		}
+		if (p.indices >= 0 && indices == nullptr) {
+			Log.warn(name + " has unreadable indices, skipped.");
+			return nullptr;
+		}
+
+		const bool needsTangents = p.material >= 0 && p.material < int32(data.materials.size()) && data.materials[p.material].normalTexture >= 0;
+
+		// The GPU reads the file data as is when it is an indexed triangle list with float positions and normals,
+		// and float tangents where a normal map needs them.
+		bool direct = p.mode == GltfData::ModeTriangles && indices != nullptr && indices->components == 1 &&
+			indices->count % 3 == 0 &&
+			(indices->componentType == GltfData::UnsignedShort || indices->componentType == GltfData::UnsignedInt) &&
+			gltf::stride(data, *indices) == gltf::componentSize(indices->componentType) &&
+			position->componentType == GltfData::Float &&
+			normal != nullptr && normal->componentType == GltfData::Float && normal->components == 3 &&
+			(!needsTangents || (tangent != nullptr && tangent->componentType == GltfData::Float && tangent->components == 4)) &&
+			(texCoord == nullptr || texCoord->components == 2);
+
+		// Out of range indices would read past the vertex buffer, those primitives take the checked path.
+		if (direct) {
+			const uint8* first = gltf::elements(data, *indices);
+			const uint32 size = gltf::componentSize(indices->componentType);
+			for (uint32 i = 0; i < indices->count && direct; i++) direct = readIndex(first + i * size, indices->componentType) < vertexCount;
+		}
+
+		auto mesh = std::make_unique<Mesh>();
+		if (direct) {
+			AttributeStream streams[VertexLayout::AttributeCount];
+			streams[0] = stream(data, *position, 3);
+			streams[1] = stream(data, *normal, 3);
+			if (tangent != nullptr && tangent->componentType == GltfData::Float && tangent->components == 4) {
+				streams[2] = stream(data, *tangent, 3); // w, the bitangent sign, isn't read by Float vertices
+			}
+			if (texCoord != nullptr) streams[3] = stream(data, *texCoord, 2);
+
+			AABB bounds = AABB(position->min, position->max);
+			if (!position->hasBounds) {
+				bounds = AABB::empty();
+				for (uint32 i = 0; i < vertexCount; i++) {
+					float v[4];
+					gltf::read(data, *position, i, v);
+					bounds.expand(Vector3(v[0], v[1], v[2]));
+				}
+			}
+
+			mesh->uploadStreams(
+				streams, vertexCount, gltf::elements(data, *indices), indices->count,
+				gltf::componentSize(indices->componentType), bounds
+			);
+			m_directUploads++;
+		} else {
+			std::vector<Vertex> vertices(vertexCount);
+			float v[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (uint32 i = 0; i < vertexCount; i++) {
+				Vertex& vert = vertices[i];
+				gltf::read(data, *position, i, v);
+				vert.position = Vector3(v[0], v[1], v[2]);
+				if (normal) {
+					gltf::read(data, *normal, i, v);
+					vert.normal = Vector3(v[0], v[1], v[2]);
+				}
+				if (tangent) {
+					gltf::read(data, *tangent, i, v);
+					vert.tangent = Vector3(v[0], v[1], v[2]);
+				}
+				if (texCoord) {
+					gltf::read(data, *texCoord, i, v);
+					vert.texCoord = Vector2(v[0], v[1]);
+				}
+			}
+
+			std::vector<uint32> list(indices ? indices->count : vertexCount);
+			if (indices) {
+				const uint8* first = gltf::elements(data, *indices);
+				const uint32 stride = gltf::stride(data, *indices);
+				for (uint32 i = 0; i < indices->count; i++) list[i] = readIndex(first + i * stride, indices->componentType);
+			} else {
+				std::iota(list.begin(), list.end(), 0u);
+			}
+
+			std::vector<uint32> triangles = triangulate(list, p.mode);
+			size_t kept = 0;
+			for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+				if (triangles[t] >= vertexCount || triangles[t + 1] >= vertexCount || triangles[t + 2] >= vertexCount) continue;
+				for (uint32 k = 0; k < 3; k++) triangles[kept++] = triangles[t + k];
+			}
+			triangles.resize(kept);
+			if (triangles.empty()) {
+				Log.warn(name + " has no valid triangles, skipped.");
+				return nullptr;
+			}
+
+			mesh->setData(vertices, triangles);
+			if (normal == nullptr) mesh->calculateNormals(Mesh::Triangles);
+			if (needsTangents && tangent == nullptr) mesh->calculateTangents(Mesh::Triangles);
+			mesh->build();
+		}
+
+		m_meshes.push_back(std::move(mesh));
+		return m_meshes.back().get();
+	}
+
+	Entity* Model::instantiate(EntityWorld& world) const {
+		// Only the nodes of the scene are created.
+		size_t count = 1;
+		std::vector<uint32> stack(m_roots.begin(), m_roots.end());
+		while (!stack.empty()) {
+			const Node& node = m_nodes[stack.back()];
+			stack.pop_back();
+			count += std::max(node.partCount, 1u);
+			stack.insert(stack.end(), node.children.begin(), node.children.end());
+		}
+
+		std::vector<Entity*> entities;
+		world.create(count, entities);
+		Entity* root = entities[0];
+		size_t next = 1;
+
+		// Parents are created before their children.
+		std::vector<std::pair<uint32, Entity*>> pending;
+		for (uint32 r : m_roots) pending.emplace_back(r, root);
+		while (!pending.empty()) {
+			const auto [n, parent] = pending.back();
+			pending.pop_back();
+
+			const Node& node = m_nodes[n];
+			Entity* e = entities[next++];
+			e->position(node.position);
+			e->rotation(node.rotation);
+			e->scale(node.scale);
+			e->parent(parent);
+			for (uint32 c : node.children) pending.emplace_back(c, e);
+
+			for (uint32 k = 0; k < node.partCount; k++) {
+				Entity* target = e;
+				if (k > 0) {
+					target = entities[next++];
+					target->parent(e);
+				}
+				const Part& part = m_parts[node.firstPart + k];
+				MeshComponent* component = target->createComponent<MeshComponent>(part.mesh);
+				if (part.material >= 0) component->material() = m_materials[part.material];
+			}
+		}
+		return root;
+	}
+}
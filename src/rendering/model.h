@@ -0,0 +1,66 @@
+#ifndef MODEL_H
+#define MODEL_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+#include "mesh.h"
+#include "texture.h"
+#include "renderer.h"
+#include "resource_manager.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace ae {
+	struct GltfData;
+
+	/// A binary glTF (.glb) scene: a Mesh per primitive, embedded textures, materials and the node hierarchy.
+	/// instantiate() turns it into entities.
+	class Model : public Resource {
+	public:
+		/// A mesh with the material it is drawn with, -1 for the default one.
+		struct Part {
+			Mesh* mesh;
+			int32 material;
+		};
+
+		struct Node {
+			std::string name;
+			Vector3 position{ 0.0f }, scale{ 1.0f };
+			Quaternion rotation{};
+			std::vector<uint32> children;
+			uint32 firstPart{ 0 }, partCount{ 0 };
+		};
+
+		void fromFile(const std::string& fileName) override;
+
+		/// Creates an entity per node, parented the same way under a new root entity that is returned. A node
+		/// with several parts gets a child entity for each part after the first.
+		Entity* instantiate(EntityWorld& world) const;
+
+		const std::vector<Node>& nodes() const { return m_nodes; }
+		const std::vector<Part>& parts() const { return m_parts; }
+		const std::vector<Material>& materials() const { return m_materials; }
+
+		/// Primitives uploaded straight from the file, the rest needed conversion.
+		uint32 directUploads() const { return m_directUploads; }
+
+	private:
+		std::vector<std::unique_ptr<Mesh>> m_meshes;
+		std::vector<std::unique_ptr<Texture>> m_textures; // One per image, nullptr if it isn't embedded
+		std::vector<Material> m_materials;
+		std::vector<Part> m_parts;
+		std::vector<Node> m_nodes;
+		std::vector<uint32> m_roots;
+		uint32 m_directUploads{ 0 };
+
+		void loadTextures(const GltfData& data);
+		void loadMaterials(const GltfData& data);
+
+		/// Builds a Mesh for a primitive, nullptr if it can't be drawn as triangles.
+		Mesh* loadPrimitive(const GltfData& data, uint32 mesh, uint32 primitive);
+	};
+}
+
+#endif // MODEL_H
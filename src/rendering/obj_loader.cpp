@@ -0,0 +1,246 @@
+#include "obj_loader.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <thread>
+
+namespace ae {
+	namespace {
+		inline bool isSpace(char c) {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+		}
+
+		inline std::string_view nextToken(std::string_view& line) {
+			size_t i = 0;
+			while (i < line.size() && isSpace(line[i])) i++;
+			size_t j = i;
+			while (j < line.size() && !isSpace(line[j])) j++;
+
+			const std::string_view tok = line.substr(i, j - i);
+			line.remove_prefix(j);
+			return tok;
+		}
+
+		inline float toFloat(std::string_view s) {
+			if (!s.empty() && s[0] == '+') s.remove_prefix(1);
+			float v = 0.0f;
+			std::from_chars(s.data(), s.data() + s.size(), v);
+			return v;
+		}
+
+		inline Vector3 toVector3(std::string_view& line) {
+			const float x = toFloat(nextToken(line));
+			const float y = toFloat(nextToken(line));
+			const float z = toFloat(nextToken(line));
+			return Vector3(x, y, z);
+		}
+
+		// Negative (relative) indices are stored relative to the start of the chunk being parsed and tagged, the
+		// merge adds the number of elements in the preceding chunks to them. They may reach back into those chunks,
+		// so the offset is biased to stay positive in the low 31 bits, short of NoIndex.
+		constexpr uint32 ChunkLocal = 0x80000000u;
+		constexpr int64 ChunkLocalBias = int64(1) << 30;
+
+		// Files smaller than this are not worth a thread.
+		constexpr size_t MinChunkSize = 1 << 20;
+
+		inline uint32 toIndex(std::string_view s, size_t count) {
+			int64 v = 0;
+			std::from_chars(s.data(), s.data() + s.size(), v);
+			if (v > 0) return uint32(v - 1);
+			const int64 biased = int64(count) + v + ChunkLocalBias;
+			if (v < 0 && biased >= 0 && biased < int64(~ChunkLocal)) return uint32(biased) | ChunkLocal;
+			return ObjData::NoIndex;
+		}
+
+		/// v, v/vt, v//vn or v/vt/vn
+		inline ObjData::Corner toCorner(std::string_view tok, const ObjData& out) {
+			ObjData::Corner c{};
+			const size_t s0 = tok.find('/');
+			c.vertex = toIndex(tok.substr(0, s0), out.positions.size());
+			if (s0 == std::string_view::npos) return c;
+
+			tok.remove_prefix(s0 + 1);
+			const size_t s1 = tok.find('/');
+			c.texCoord = toIndex(tok.substr(0, s1), out.texCoords.size());
+			if (s1 != std::string_view::npos) c.normal = toIndex(tok.substr(s1 + 1), out.normals.size());
+			return c;
+		}
+
+		inline uint32 resolve(uint32 i, size_t base) {
+			if (i == ObjData::NoIndex || (i & ChunkLocal) == 0) return i;
+			const int64 global = int64(base) + int64(i & ~ChunkLocal) - ChunkLocalBias;
+			return global >= 0 ? uint32(global) : ObjData::NoIndex;
+		}
+
+		void parseLine(std::string_view line, ObjData& out) {
+			const std::string_view tok = nextToken(line);
+			if (tok.empty()) return;
+
+			if (tok == "f") {
+				ObjData::Corner first{}, prev{};
+				uint32 n = 0;
+				for (std::string_view c = nextToken(line); !c.empty(); c = nextToken(line), n++) {
+					const ObjData::Corner cur = toCorner(c, out);
+					if (n == 0) first = cur;
+					else if (n >= 2) {
+						out.corners.push_back(first);
+						out.corners.push_back(prev);
+						out.corners.push_back(cur);
+					}
+					prev = cur;
+				}
+			} else if (tok == "v") {
+				out.positions.push_back(toVector3(line));
+			} else if (tok == "vt") {
+				const float x = toFloat(nextToken(line));
+				const float y = toFloat(nextToken(line));
+				out.texCoords.push_back(Vector2(x, y));
+			} else if (tok == "vn") {
+				out.normals.push_back(toVector3(line));
+			} else if (tok == "reverse_vertices") {
+				if (nextToken(line) == "1") out.reverseVertexOrder = true;
+			} else if (tok == "calc_normals") {
+				out.calcNormals = true;
+			} else if (tok == "calc_tangents") {
+				out.calcTangents = true;
+			} else if (tok == "normalize") {
+				out.normalize = true;
+			} else if (tok == "centralize") {
+				out.centralize = true;
+			} else if (tok == "packed_vertices") {
+				out.packedVertices = true;
+			} else if (tok == "weld_epsilon") {
+				out.weldEpsilon = toFloat(nextToken(line));
+				out.hasWeldEpsilon = true;
+			} else if (tok == "meshlets") {
+				out.meshlets = true;
+			} else if (tok == "lods") {
+				const std::string_view count = nextToken(line);
+				std::from_chars(count.data(), count.data() + count.size(), out.lodCount);
+				out.hasLodCount = true;
+			} else if (tok == "uv_transform") {
+				const float x = toFloat(nextToken(line));
+				const float y = toFloat(nextToken(line));
+				const float z = toFloat(nextToken(line));
+				const float w = toFloat(nextToken(line));
+				out.uvTransform = Vector4(x, y, z, w);
+				out.hasUvTransform = true;
+			}
+		}
+
+		void parseChunk(std::string_view text, ObjData& out) {
+			const char* p = text.data();
+			const char* end = p + text.size();
+			while (p < end) {
+				const char* eol = static_cast<const char*>(std::memchr(p, '\n', size_t(end - p)));
+				if (eol == nullptr) eol = end;
+
+				parseLine(std::string_view(p, size_t(eol - p)), out);
+				p = eol + 1;
+			}
+		}
+
+		template <typename T>
+		inline void copyAt(const std::vector<T>& from, std::vector<T>& to, size_t offset) {
+			std::copy(from.begin(), from.end(), to.begin() + offset);
+		}
+	}
+
+	namespace obj {
+		void parse(std::string_view text, ObjData& out, uint32 threads) {
+			if (threads == 0) threads = std::max(std::thread::hardware_concurrency(), 1u);
+			const size_t count = std::max<size_t>(std::min<size_t>(threads, text.size() / MinChunkSize), 1);
+
+			if (count == 1) {
+				parseChunk(text, out);
+				for (auto& c : out.corners) {
+					c.vertex = resolve(c.vertex, 0);
+					c.texCoord = resolve(c.texCoord, 0);
+					c.normal = resolve(c.normal, 0);
+				}
+				return;
+			}
+
+			// Split evenly, then move every boundary past the end of the line it falls in.
+			std::vector<std::string_view> views(count);
+			size_t begin = 0;
+			for (size_t i = 0; i < count; i++) {
+				size_t end = i + 1 == count ? text.size() : std::max(begin, text.size() * (i + 1) / count);
+				if (end < text.size()) {
+					end = text.find('\n', end);
+					end = end == std::string_view::npos ? text.size() : end + 1;
+				}
+				views[i] = text.substr(begin, end - begin);
+				begin = end;
+			}
+
+			std::vector<ObjData> chunks(count);
+			std::vector<std::thread> workers;
+			workers.reserve(count);
+			for (size_t i = 0; i < count; i++) {
+				workers.emplace_back([&, i]() { parseChunk(views[i], chunks[i]); });
+			}
+			for (auto& w : workers) w.join();
+			workers.clear();
+
+			// Exclusive prefix sums give every chunk its place in the merged arrays.
+			struct Offsets { size_t positions, normals, texCoords, corners; };
+			std::vector<Offsets> offsets(count + 1, Offsets{ 0, 0, 0, 0 });
+			for (size_t i = 0; i < count; i++) {
+				const ObjData& c = chunks[i];
+				offsets[i + 1] = {
+					offsets[i].positions + c.positions.size(),
+					offsets[i].normals + c.normals.size(),
+					offsets[i].texCoords + c.texCoords.size(),
+					offsets[i].corners + c.corners.size()
+				};
+
+				out.reverseVertexOrder |= c.reverseVertexOrder;
+				out.calcNormals |= c.calcNormals;
+				out.calcTangents |= c.calcTangents;
+				out.normalize |= c.normalize;
+				out.centralize |= c.centralize;
+				out.packedVertices |= c.packedVertices;
+				out.meshlets |= c.meshlets;
+				if (c.hasWeldEpsilon) {
+					out.weldEpsilon = c.weldEpsilon;
+					out.hasWeldEpsilon = true;
+				}
+				if (c.hasUvTransform) {
+					out.uvTransform = c.uvTransform;
+					out.hasUvTransform = true;
+				}
+				if (c.hasLodCount) {
+					out.lodCount = c.lodCount;
+					out.hasLodCount = true;
+				}
+			}
+
+			out.positions.resize(offsets[count].positions);
+			out.normals.resize(offsets[count].normals);
+			out.texCoords.resize(offsets[count].texCoords);
+			out.corners.resize(offsets[count].corners);
+
+			for (size_t i = 0; i < count; i++) {
+				workers.emplace_back([&, i]() {
+					const ObjData& c = chunks[i];
+					const Offsets& o = offsets[i];
+					copyAt(c.positions, out.positions, o.positions);
+					copyAt(c.normals, out.normals, o.normals);
+					copyAt(c.texCoords, out.texCoords, o.texCoords);
+
+					for (size_t j = 0; j < c.corners.size(); j++) {
+						const ObjData::Corner& src = c.corners[j];
+						ObjData::Corner& dst = out.corners[o.corners + j];
+						dst.vertex = resolve(src.vertex, o.positions);
+						dst.texCoord = resolve(src.texCoord, o.texCoords);
+						dst.normal = resolve(src.normal, o.normals);
+					}
+				});
+			}
+			for (auto& w : workers) w.join();
+		}
+	}
+}
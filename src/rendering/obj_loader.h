@@ -0,0 +1,40 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+
+#include <string_view>
+#include <vector>
+
+namespace ae {
+	/// Raw contents of an OBJ file, plus the engine-specific loading directives.
+	struct ObjData {
+		static constexpr uint32 NoIndex = ~0u;
+
+		/// Zero-based attribute indices of a face corner, NoIndex when absent.
+		struct Corner {
+			uint32 vertex{ NoIndex }, texCoord{ NoIndex }, normal{ NoIndex };
+		};
+
+		std::vector<Vector3> positions, normals;
+		std::vector<Vector2> texCoords;
+		std::vector<Corner> corners; // 3 per triangle
+
+		bool reverseVertexOrder{ false }, calcNormals{ false }, calcTangents{ false };
+		bool normalize{ false }, centralize{ false }, packedVertices{ false }, hasUvTransform{ false }, hasLodCount{ false };
+		bool meshlets{ false }, hasWeldEpsilon{ false };
+		Vector4 uvTransform{ 0.0f, 0.0f, 1.0f, 1.0f };
+		float weldEpsilon{ 0.0f };
+		uint32 lodCount{ 3 }; // Simplified levels to generate, "lods 0" disables them
+	};
+
+	namespace obj {
+		/// Parses OBJ text without copying it or allocating per line. Polygons are triangulated as fans.
+		/// Large files are split at line boundaries and parsed on up to `threads` threads (0 = one per core),
+		/// the result is identical to the single-threaded parse.
+		void parse(std::string_view text, ObjData& out, uint32 threads = 0);
+	}
+}
+
+#endif // OBJ_LOADER_H
@@ -1,18 +1,53 @@
 #include "renderer.h"
+#include "animation.h"
+#include "hlod.h"
+#include "texture_loader.h"
+#include "texture_array.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <tuple>
 
 namespace ae {
 	
 	Renderer::Renderer() {
 		const std::string VS = R"(
 			#version 440 core
-			layout (location = 0) in vec3 vPosition;
+			layout (location = 0) in vec4 vPosition;
 			layout (location = 1) in vec3 vNormal;
 			layout (location = 2) in vec3 vTangent;
 			layout (location = 3) in vec2 vTexCoord;
+			layout (location = 4) in uvec4 vJoints;
+			layout (location = 5) in vec4 vWeights;
+
+			// Three rows of an Affine3x4 per joint.
+			layout (std430, binding = 0) readonly buffer JointPalette {
+				vec4 uJoints[];
+			};
+
+			struct Instance {
+				vec4 model[3]; // Rows of an Affine3x4
+				vec3 base;
+				float shininess;
+				float specular;
+				float heightScale;
+				int receivesShadow;
+				int layers[5];
+				int jointOffset; // -1 for meshes without a skin
+			};
+
+			layout (std430, binding = 1) readonly buffer Instances {
+				Instance uInstances[];
+			};
 
 			uniform mat4 uProjection;
 			uniform mat4 uView;
-			uniform mat4 uModel;
+			uniform int uInstanceOffset; // Of the draw's first instance
+
+			uniform bool uPackedVertices;
+			uniform vec3 uPositionScale;
+			uniform vec3 uPositionOffset;
 
 			out Data {
 				vec3 position;
@@ -20,20 +55,54 @@ namespace ae {
 				vec3 tangent;
 				vec2 texCoord;
 				mat3 tbn;
+				flat int instance;
 			} VS;
 
+			vec3 octDecode(vec2 e) {
+				vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+				float t = max(-n.z, 0.0);
+				n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+				return normalize(n);
+			}
+
+			mat4x3 skinMatrix(int jointOffset) {
+				mat3x4 rows = mat3x4(0.0);
+				for (int i = 0; i < 4; i++) {
+					int j = (jointOffset + int(vJoints[i])) * 3;
+					rows += mat3x4(uJoints[j], uJoints[j + 1], uJoints[j + 2]) * vWeights[i];
+				}
+				return transpose(rows);
+			}
+
 			void main() {
-				vec4 pos = uModel * vec4(vPosition, 1.0);
+				int id = uInstanceOffset + gl_InstanceID;
+				Instance inst = uInstances[id];
+				mat4x3 model = transpose(mat3x4(inst.model[0], inst.model[1], inst.model[2]));
+
+				vec3 position = vPosition.xyz * uPositionScale + uPositionOffset;
+				vec3 normal = uPackedVertices ? octDecode(vNormal.xy) : vNormal;
+				vec3 tangent = uPackedVertices ? octDecode(vTangent.xy) : vTangent;
+				float tangentSign = vPosition.w * 2.0 - 1.0;
+
+				if (inst.jointOffset >= 0) {
+					mat4x3 skin = skinMatrix(inst.jointOffset);
+					position = skin * vec4(position, 1.0);
+					normal = skin * vec4(normal, 0.0);
+					tangent = skin * vec4(tangent, 0.0);
+				}
+
+				vec4 pos = vec4(model * vec4(position, 1.0), 1.0);
 				gl_Position = uProjection * uView * pos;
 
 				VS.position = pos.xyz;
-				VS.normal = normalize((uModel * vec4(vNormal, 0.0)).xyz);
-				VS.tangent = normalize((uModel * vec4(vTangent, 0.0)).xyz);
+				VS.normal = normalize(model * vec4(normal, 0.0));
+				VS.tangent = normalize(model * vec4(tangent, 0.0));
 				VS.tangent = normalize(VS.tangent - dot(VS.tangent, VS.normal) * VS.normal);
 				VS.texCoord = vTexCoord;
 				
-				vec3 b = cross(VS.tangent, VS.normal);
+				vec3 b = cross(VS.tangent, VS.normal) * tangentSign;
 				VS.tbn = mat3(VS.tangent, b, VS.normal);
+				VS.instance = id;
 			}
 		)";
 
@@ -126,11 +195,19 @@ namespace ae {
 				mat4 viewProj;
 			};
 
-			struct Material {
+			struct Instance {
+				vec4 model[3];
 				vec3 base;
 				float shininess;
 				float specular;
-				bool receivesShadow;
+				float heightScale;
+				int receivesShadow;
+				int layers[5]; // Diffuse, normal, specular, reflection and height, -1 for empty slots
+				int jointOffset;
+			};
+
+			layout (std430, binding = 1) readonly buffer Instances {
+				Instance uInstances[];
 			};
 
 			in Data {
@@ -139,6 +216,7 @@ namespace ae {
 				vec3 tangent;
 				vec2 texCoord;
 				mat3 tbn;
+				flat int instance;
 			} VS;
 
 			uniform Light uLights[32];
@@ -149,23 +227,13 @@ namespace ae {
 			uniform vec3 uEyePos;
 			uniform vec3 uAmbient;
 
-			uniform Material uMaterial;
-
-			uniform sampler2D uDiffuse;
-			uniform bool uDiffuseOn = false;
-
-			uniform sampler2D uNormal;
-			uniform bool uNormalOn = false;
-
-			uniform sampler2D uSpecular;
-			uniform bool uSpecularOn = false;
-
-			uniform sampler2D uReflection;
-			uniform bool uReflectionOn = false;
-
-			uniform sampler2D uHeight;
-			uniform float uHeightScale = 1.0;
-			uniform bool uHeightOn = false;
+			// The arrays of the draw's material maps, the instance picks the layers.
+			uniform sampler2DArray uDiffuse;
+			uniform sampler2DArray uNormal;
+			uniform bool uNormalXY = false; // BC5, z is rebuilt from x and y
+			uniform sampler2DArray uSpecular;
+			uniform sampler2DArray uReflection;
+			uniform sampler2DArray uHeight;
 
 			float rim(vec3 D, vec3 N) {
 				float cs = abs(dot(D, N));
@@ -180,7 +248,7 @@ namespace ae {
 				return ret;
 			}
 
-			vec2 parallax(sampler2D depthMap, vec2 uv, vec3 V, float height) {
+			vec2 parallax(sampler2DArray depthMap, float layer, vec2 uv, vec3 V, float height) {
 				const float minLayers = 8.0;
 				const float maxLayers = 32.0;
 				float numLayers = mix(maxLayers, minLayers, abs(dot(vec3(0.0, 0.0, 1.0), V)));
@@ -192,18 +260,18 @@ namespace ae {
 				vec2 deltaTexCoords = P / numLayers;
 
 				vec2  currentTexCoords     = uv;
-				float currentDepthMapValue = 1.0 - texture(depthMap, currentTexCoords).r;
+				float currentDepthMapValue = 1.0 - texture(depthMap, vec3(currentTexCoords, layer)).r;
 
 				while (currentLayerDepth < currentDepthMapValue) {
 					currentTexCoords -= deltaTexCoords;
-					currentDepthMapValue = 1.0 - texture(depthMap, currentTexCoords).r;
+					currentDepthMapValue = 1.0 - texture(depthMap, vec3(currentTexCoords, layer)).r;
 					currentLayerDepth += layerDepth;
 				}
 
 				vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
 
 				float afterDepth  = currentDepthMapValue - currentLayerDepth;
-				float beforeDepth = (1.0 - texture(depthMap, prevTexCoords).r) - currentLayerDepth + layerDepth;
+				float beforeDepth = (1.0 - texture(depthMap, vec3(prevTexCoords, layer)).r) - currentLayerDepth + layerDepth;
 
 				float weight = afterDepth / (afterDepth - beforeDepth);
 				vec2 finalTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
@@ -266,22 +334,25 @@ namespace ae {
 			}
 
 			void main() {
+				Instance inst = uInstances[VS.instance];
 				vec3 V = normalize(uEyePos - VS.position);
 				vec3 N = normalize(VS.normal);
 				vec2 uv = VS.texCoord;
 
-				float h = abs(uHeightScale);
-				if (uHeightOn && h > 0.0) {
+				bool heightOn = inst.layers[4] >= 0;
+				float h = abs(inst.heightScale);
+				if (heightOn && h > 0.0) {
 					vec3 tanViewPos = VS.tbn * uEyePos;
 					vec3 tanFragPos = VS.tbn * VS.position;
 					vec3 viewDir = normalize(tanViewPos - tanFragPos);
-					uv = parallax(uHeight, uv, viewDir, h);
+					uv = parallax(uHeight, float(inst.layers[4]), uv, viewDir, h);
 				}
 
-				if (uNormalOn) {
-					vec3 norm = texture(uNormal, uv).xyz;
-					norm.y = 1.0 - norm.y;
-					N = normalize(VS.tbn * (norm * 2.0 - 1.0));
+				if (inst.layers[1] >= 0) {
+					vec3 norm = texture(uNormal, vec3(uv, inst.layers[1])).xyz * 2.0 - 1.0;
+					if (uNormalXY) norm.z = sqrt(max(1.0 - dot(norm.xy, norm.xy), 0.0));
+					norm.y = -norm.y;
+					N = normalize(VS.tbn * norm);
 				}
 
 				vec3 lighting = uAmbient;
@@ -322,11 +393,11 @@ namespace ae {
 
 					float NoL = max(dot(N, L), 0.0);
 					float vis = 1.0;
-					if (light.hasShadow && uMaterial.receivesShadow) {
+					if (light.hasShadow && inst.receivesShadow != 0) {
 						vec4 sc = mBias * light.viewProj * vec4(VS.position, 1.0);
 						vec3 coord = sc.xyz / sc.w;
-						if (uHeightOn && h > 0.0) {
-							coord += VS.normal * texture(uHeight, uv).r * h;
+						if (heightOn && h > 0.0) {
+							coord += VS.normal * texture(uHeight, vec3(uv, inst.layers[4])).r * h;
 						}
 
 						float bias = clamp(tan(acos(NoL)) * 0.000001, 0.0, 0.000001);
@@ -340,16 +411,16 @@ namespace ae {
 
 						vec3 R = reflect(-L, N);
 
-						float shin = uMaterial.shininess;
-						if (uSpecularOn) {
-							shin *= texture(uSpecular, uv).r;
+						float shin = inst.shininess;
+						if (inst.layers[2] >= 0) {
+							shin *= texture(uSpecular, vec3(uv, inst.layers[2])).r;
 						}
 
 						float spec = max(0.0, dot(R, V));
-						spec = att * pow(spec, shin * 255.0) * uMaterial.specular;
+						spec = att * pow(spec, shin * 255.0) * inst.specular;
 
-						if (uSpecularOn) {
-							spec *= texture(uSpecular, uv).g;
+						if (inst.layers[2] >= 0) {
+							spec *= texture(uSpecular, vec3(uv, inst.layers[2])).g;
 						}
 
 						vec3 col = (light.color * fact);
@@ -359,12 +430,12 @@ namespace ae {
 					}
 				}
 
-				fragColor = vec4(uMaterial.base * lighting, 1.0);
-				if (uDiffuseOn) {
-					fragColor *= texture(uDiffuse, uv);
+				fragColor = vec4(inst.base * lighting, 1.0);
+				if (inst.layers[0] >= 0) {
+					fragColor *= texture(uDiffuse, vec3(uv, inst.layers[0]));
 				}
-				if (uReflectionOn) {
-					fragColor *= texture(uReflection, matcap(V, N));
+				if (inst.layers[3] >= 0) {
+					fragColor *= texture(uReflection, vec3(matcap(V, N), inst.layers[3]));
 				}
 				fragColor.rgb = pow(fragColor.rgb, vec3(1.0 / 2.2));
 			}
@@ -372,17 +443,36 @@ namespace ae {
 
 		const std::string shadowVS = R"(
 			#version 440 core
-			layout (location = 0) in vec3 vPosition;
+			layout (location = 0) in vec4 vPosition;
 			layout (location = 1) in vec3 vNormal;
 			layout (location = 2) in vec3 vTangent;
 			layout (location = 3) in vec2 vTexCoord;
+			layout (location = 4) in uvec4 vJoints;
+			layout (location = 5) in vec4 vWeights;
+
+			layout (std430, binding = 0) readonly buffer JointPalette {
+				vec4 uJoints[];
+			};
 
 			uniform mat4 uProjection;
 			uniform mat4 uView;
-			uniform mat4 uModel;
+			uniform mat4x3 uModel;
+			uniform int uJointOffset;
+
+			uniform vec3 uPositionScale;
+			uniform vec3 uPositionOffset;
 
 			void main() {
-				gl_Position = uProjection * uView * uModel * vec4(vPosition, 1.0);
+				vec3 position = vPosition.xyz * uPositionScale + uPositionOffset;
+				if (uJointOffset >= 0) {
+					mat3x4 rows = mat3x4(0.0);
+					for (int i = 0; i < 4; i++) {
+						int j = (uJointOffset + int(vJoints[i])) * 3;
+						rows += mat3x4(uJoints[j], uJoints[j + 1], uJoints[j + 2]) * vWeights[i];
+					}
+					position = transpose(rows) * vec4(position, 1.0);
+				}
+				gl_Position = uProjection * uView * vec4(uModel * vec4(position, 1.0), 1.0);
 			}
 		)";
 
@@ -403,6 +493,7 @@ namespace ae {
 	}
 
 	void Renderer::render(EntityWorld* world, uint32 width, uint32 height) {
+		TextureLoader::ston().update();
 		m_uber->bind();
 
 		if (m_camera == nullptr) {
@@ -414,9 +505,14 @@ namespace ae {
 			}
 		}
 
+		uploadPalettes(world);
+		if (m_hlod) m_hlod->update(m_camera->owner()->position());
+
 		const float aspect = float(width) / height;
-		m_uber->get("uProjection").set(m_camera->projection(aspect));
-		m_uber->get("uView").set(m_camera->viewTransform());
+		const Matrix4 projection = m_camera->projection(aspect);
+		const Matrix4 view = m_camera->viewTransform();
+		m_uber->get("uProjection").set(projection);
+		m_uber->get("uView").set(view);
 		m_uber->get("uEyePos").set(m_camera->owner()->position());
 		m_uber->get("uAmbient").set(m_ambient);
 
@@ -433,7 +529,7 @@ namespace ae {
 			m_uber->get("uLights[" + istr + "].cutoff").set(light->cutOff());
 			m_uber->get("uLights[" + istr + "].viewProj").set(light->projection() * light->viewTransform());
 
-			if ((light->type() == LightType::Directional || light->type() == LightType::Spot) && light->shadowsEnabled() && shadowIndex < 8) {
+			if ((light->type() == LightType::Directional || light->type() == LightType::Spot) && light->shadowsEnabled() && shadowIndex < int(MaterialUnit)) {
 				renderShadows(world, light);
 				m_uber->bind();
 				light->shadowBuffer()->depthAttachment()->bind(shadowIndex);
@@ -449,61 +545,238 @@ namespace ae {
 		});
 		m_uber->get("uLightCount").set(i);
 
-		world->each([&](Entity* ent, MeshComponent* mesh) {
-			m_uber->get("uDiffuseOn").set(0);
-			m_uber->get("uNormalOn").set(0);
-			m_uber->get("uSpecularOn").set(0);
-			m_uber->get("uReflectionOn").set(0);
-			m_uber->get("uHeightOn").set(0);
-
-			m_uber->get("uModel").set(ent->transform());
-			m_uber->get("uMaterial.base").set(mesh->material().base());
-			m_uber->get("uMaterial.shininess").set(mesh->material().shininess());
-			m_uber->get("uMaterial.specular").set(mesh->material().specular());
-			m_uber->get("uMaterial.receivesShadow").set(mesh->material().receivesShadow());
-
-			uint32 slot = shadowIndex;
+		const Matrix4 viewProj = Matrix4(projection) * view;
+		m_clusterStats = {};
+		cull(world, viewProj);
+		selectLods(m_camera->owner()->position(), float(height) * 0.5f / std::tan(m_camera->fov() * 0.5f));
+		uploadInstances();
+
+		// Each slot samples its own unit, only a change of array between draws rebinds one.
+		static const char* const samplers[Material::SlotCount] = { "uDiffuse", "uNormal", "uSpecular", "uReflection", "uHeight" };
+		for (uint32 k = 0; k < Material::SlotCount; k++) m_uber->get(samplers[k]).set(int(MaterialUnit + k));
+		int32 boundArrays[Material::SlotCount];
+		std::fill(std::begin(boundArrays), std::end(boundArrays), -1);
+
+		auto& arrays = TextureArrays::ston();
+		auto clustered = [this](const DrawItem& item) {
+			// Meshlet bounds and cones are of the bind pose, they don't hold for skinned meshes.
+			const Mesh* m = item.mesh->mesh();
+			return m_clusterCulling && item.mesh->lod() == 0 && !m->meshlets().empty() && item.animator == nullptr;
+		};
+		auto sameBatch = [&](const DrawItem& a, const DrawItem& b) {
+			if (a.mesh->mesh() != b.mesh->mesh() || a.mesh->lod() != b.mesh->lod() || clustered(b)) return false;
 			for (uint32 k = 0; k < Material::SlotCount; k++) {
-				Texture* tex = mesh->material().m_textures[k];
-				if (tex == nullptr) continue;
-
-				tex->bind(slot);
-				switch (k) {
-					case Material::SlotDiffuse:
-						m_uber->get("uDiffuse").set(int(slot));
-						m_uber->get("uDiffuseOn").set(1);
-						break;
-					case Material::SlotNormal:
-						m_uber->get("uNormal").set(int(slot));
-						m_uber->get("uNormalOn").set(1);
-						break;
-					case Material::SlotSpecular:
-						m_uber->get("uSpecular").set(int(slot));
-						m_uber->get("uSpecularOn").set(1);
-						break;
-					case Material::SlotReflection:
-						m_uber->get("uReflection").set(int(slot));
-						m_uber->get("uReflectionOn").set(1);
-						break;
-					case Material::SlotHeight:
-						m_uber->get("uHeight").set(int(slot));
-						m_uber->get("uHeightScale").set(mesh->material().height());
-						m_uber->get("uHeightOn").set(1);
-						break;
+				if (a.mesh->material().m_layers[k].array != b.mesh->material().m_layers[k].array) return false;
+			}
+			return true;
+		};
+
+		GLuint boundVao = 0;
+		for (size_t first = 0; first < m_visible.size();) {
+			const DrawItem& item = m_visible[first];
+			size_t last = first + 1;
+			if (!clustered(item)) {
+				while (last < m_visible.size() && sameBatch(item, m_visible[last])) last++;
+			}
+
+			Mesh* m = item.mesh->mesh();
+			m_uber->get("uInstanceOffset").set(int(first));
+			m_uber->get("uPackedVertices").set(int(m->vertexFormat() == VertexFormat::Packed));
+			m_uber->get("uPositionScale").set(m->positionScale());
+			m_uber->get("uPositionOffset").set(m->positionOffset());
+
+			const Material& material = item.mesh->material();
+			for (uint32 k = 0; k < Material::SlotCount; k++) {
+				const int32 array = material.m_layers[k].array;
+				if (array < 0 || array == boundArrays[k]) continue;
+				arrays.bind(array, MaterialUnit + k);
+				boundArrays[k] = array;
+				if (k == Material::SlotNormal) m_uber->get("uNormalXY").set(int(arrays.format(array) == TextureFormat::BC5));
+			}
+
+			const Mesh::Lod& lod = m->lod(item.mesh->lod());
+			if (m->vao() != boundVao) {
+				m->bind();
+				boundVao = m->vao();
+			}
+			if (clustered(item)) {
+				cullClusters(item, viewProj, m_camera->owner()->position());
+				if (!m_rangeLengths.empty()) {
+					m->drawRanges(Mesh::Triangles, m_rangeLengths.data(), m_rangeOffsets.data(), uint32(m_rangeLengths.size()));
 				}
-				slot++;
+			} else {
+				m->drawInstanced(Mesh::Triangles, lod.count, lod.offset, uint32(last - first));
 			}
+			first = last;
+		}
+		glBindVertexArray(0);
 
-			Mesh* m = mesh->mesh();
-			m->bind();
-			m->draw(Mesh::Triangles);
+		for (uint32 k = 0; k < Material::SlotCount; k++) {
+			if (boundArrays[k] < 0) continue;
+			glActiveTexture(GL_TEXTURE0 + MaterialUnit + k);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		}
+	}
 
+	void Renderer::uploadInstances() {
+		auto& arrays = TextureArrays::ston();
+		for (auto&& item : m_visible) {
+			Material& material = item.mesh->material();
 			for (uint32 k = 0; k < Material::SlotCount; k++) {
-				Texture* tex = mesh->material().m_textures[k];
-				if (tex == nullptr) continue;
-				tex->unbind();
+				Texture* tex = material.m_textures[k];
+				material.m_layers[k] = tex ? arrays.pack(tex) : ArrayLayer{};
+			}
+		}
+
+		// Items drawn together have to be neighbours, cull() already grouped them by vertex array.
+		auto batchKey = [](const DrawItem& item) {
+			const Mesh* m = item.mesh->mesh();
+			const ArrayLayer* layers = item.mesh->material().m_layers;
+			return std::make_tuple(
+				m->vao(), m, item.mesh->lod(),
+				layers[0].array, layers[1].array, layers[2].array, layers[3].array, layers[4].array
+			);
+		};
+		std::stable_sort(m_visible.begin(), m_visible.end(), [&](const DrawItem& a, const DrawItem& b) {
+			return batchKey(a) < batchKey(b);
+		});
+		if (m_visible.empty()) return;
+
+		static_assert(sizeof(InstanceData) == 112, "InstanceData has to match the std430 layout of Instance.");
+		const uint32 bytes = uint32(m_visible.size() * sizeof(InstanceData));
+		if (bytes > m_instances.regionSize()) {
+			GLint alignment = 16;
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			m_instances.create(bytes + bytes / 2, uint32(std::max(alignment, 16)));
+		}
+
+		InstanceData* out = reinterpret_cast<InstanceData*>(m_instances.begin());
+		for (auto&& item : m_visible) {
+			const Material& material = item.mesh->material();
+			InstanceData& data = *out++;
+			data.model = item.entity->affineTransform();
+			data.base = material.base();
+			data.shininess = material.shininess();
+			data.specular = material.specular();
+			data.height = material.height();
+			data.receivesShadow = int32(material.receivesShadow());
+			for (uint32 k = 0; k < Material::SlotCount; k++) data.layers[k] = material.m_layers[k].layer;
+			data.jointOffset = item.animator ? int32(item.animator->m_paletteOffset) : -1;
+		}
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, m_instances.id(), m_instances.offset(), bytes);
+	}
+
+	void Renderer::cull(EntityWorld* world, const Matrix4& viewProj) {
+		m_candidates.clear();
+		m_bounds.clear();
+		world->each([&](Entity* ent, MeshComponent* mesh) {
+			if (mesh->mesh() == nullptr || mesh->mesh()->lodCount() == 0) return;
+			// Shadow passes go through here too, so they see the same side of every cluster as the camera.
+			if (mesh->cluster() >= 0 && (m_hlod ? m_hlod->far(uint32(mesh->cluster())) : false) != mesh->proxy()) return;
+			AnimatorComponent* animator = mesh->mesh()->skinned() ? ent->getComponent<AnimatorComponent>() : nullptr;
+			AABB local = mesh->mesh()->aabb();
+			if (animator != nullptr && animator->bounds().valid()) local.expand(animator->bounds());
+
+			const AABB bounds = local.transformed(ent->affineTransform());
+			m_candidates.push_back({ ent, mesh, animator, bounds });
+			m_bounds.push_back(bounds);
+		});
+
+		m_containment.resize(m_bounds.size());
+		Frustum::fromMatrix(viewProj).classify(m_bounds.data(), m_containment.data(), m_bounds.size());
+
+		m_visible.clear();
+		for (size_t i = 0; i < m_candidates.size(); i++) {
+			if (m_containment[i] != Containment::Outside) m_visible.push_back(m_candidates[i]);
+		}
+
+		// Pooled meshes share a VAO per vertex format, grouping them leaves one bind per group.
+		std::stable_sort(m_visible.begin(), m_visible.end(), [](const DrawItem& a, const DrawItem& b) {
+			return a.mesh->mesh()->vao() < b.mesh->mesh()->vao();
+		});
+	}
+
+	void Renderer::selectLods(const Vector3& eye, float focal) {
+		size_t kept = 0;
+		for (auto&& item : m_visible) {
+			// Projected diameter of the bounds, unbounded once the camera is inside them.
+			const float diameter = item.bounds.size().length();
+			const float distance = (item.bounds.center() - eye).length();
+			const float screenSize = distance > diameter * 0.5f ? diameter * focal / distance : 1e30f;
+			if (screenSize < m_minScreenSize) continue;
+
+			// Level errors are relative to the mesh diagonal, so errors in pixels scale with the screen size.
+			const Mesh* m = item.mesh->mesh();
+			uint32 level = std::min(item.mesh->lod(), m->lodCount() - 1);
+			while (level > 0 && m->lod(level).error * screenSize > m_lodPixelError) level--;
+			while (
+				level + 1 < m->lodCount() &&
+				m->lod(level + 1).error * screenSize < m_lodPixelError * (1.0f - m_lodHysteresis)
+			) level++;
+			item.mesh->lod(level);
+
+			m_visible[kept++] = item;
+		}
+		m_visible.resize(kept);
+	}
+
+	void Renderer::cullClusters(const DrawItem& item, const Matrix4& viewProj, const Vector3& eye) {
+		m_rangeLengths.clear();
+		m_rangeOffsets.clear();
+
+		// Test in object space, the meshlet data stays untouched. Normal cones only keep their angles under
+		// rotation and uniform scale, anything else would cull visible clusters, so they're skipped then.
+		const Affine3x4 model = item.entity->affineTransform();
+		const Frustum frustum = Frustum::fromMatrix(Matrix4(viewProj) * model.toMatrix4());
+		const Vector3 localEye = model.inverse().transformPoint(eye);
+		const bool cones = model.conformal();
+
+		const auto& meshlets = item.mesh->mesh()->meshlets();
+		m_clusterStats.tested += uint32(meshlets.size());
+		for (const auto& ml : meshlets) {
+			if (!frustum.intersects(ml.bounds)) {
+				m_clusterStats.frustumCulled++;
+				continue;
+			}
+			if (cones && ml.backFacing(localEye)) {
+				m_clusterStats.backFaceCulled++;
+				continue;
 			}
+
+			// Neighbouring survivors merge into one range.
+			if (!m_rangeOffsets.empty() && m_rangeOffsets.back() + uint32(m_rangeLengths.back()) == ml.offset) {
+				m_rangeLengths.back() += int32(ml.count);
+			} else {
+				m_rangeLengths.push_back(int32(ml.count));
+				m_rangeOffsets.push_back(ml.offset);
+			}
+		}
+	}
+
+	void Renderer::uploadPalettes(EntityWorld* world) {
+		uint32 joints = 0;
+		world->each([&](Entity*, AnimatorComponent* anim) {
+			anim->m_paletteOffset = joints;
+			joints += uint32(anim->palette().size());
 		});
+		if (joints == 0) return;
+
+		static_assert(sizeof(Affine3x4) == 3 * 4 * sizeof(float), "The JointPalette block reads three vec4 per joint.");
+		const uint32 bytes = joints * sizeof(Affine3x4);
+		if (bytes > m_palettes.regionSize()) {
+			// Regions have to start on the binding alignment, with headroom so a few more characters don't
+			// reallocate right away.
+			GLint alignment = 16;
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			m_palettes.create(bytes + bytes / 2, uint32(std::max(alignment, 16)));
+		}
+
+		uint8* data = m_palettes.begin();
+		world->each([&](Entity*, AnimatorComponent* anim) {
+			const auto& palette = anim->palette();
+			std::memcpy(data + anim->m_paletteOffset * sizeof(Affine3x4), palette.data(), palette.size() * sizeof(Affine3x4));
+		});
+		glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, m_palettes.id(), m_palettes.offset(), bytes);
 	}
 
 	void Renderer::renderShadows(EntityWorld* world, LightComponent* comp) {
@@ -518,21 +791,33 @@ namespace ae {
 
 		m_shadows->bind();
 
-		m_shadows->get("uProjection").set(comp->projection());
-		m_shadows->get("uView").set(comp->viewTransform());
-
-		world->each([&](Entity* ent, MeshComponent* mesh) {
-			if (mesh->material().castsShadow()) {
-				m_shadows->get("uModel").set(ent->transform());
-				Mesh* m = mesh->mesh();
-
-				glCullFace(GL_FRONT);
-				m->bind();
-				m->draw(Mesh::Triangles);
-				m->unbind();
-				glCullFace(GL_BACK);
+		const Matrix4 projection = comp->projection();
+		const Matrix4 view = comp->viewTransform();
+		m_shadows->get("uProjection").set(projection);
+		m_shadows->get("uView").set(view);
+
+		cull(world, Matrix4(projection) * view);
+		GLuint boundVao = 0;
+		glCullFace(GL_FRONT);
+		for (auto&& item : m_visible) {
+			if (item.mesh->material().castsShadow()) {
+				Mesh* m = item.mesh->mesh();
+				m_shadows->get("uModel").set(item.entity->affineTransform());
+				m_shadows->get("uJointOffset").set(item.animator ? int(item.animator->m_paletteOffset) : -1);
+				m_shadows->get("uPositionScale").set(m->positionScale());
+				m_shadows->get("uPositionOffset").set(m->positionOffset());
+
+				// Uses the level picked for the camera in the previous frame.
+				const Mesh::Lod& lod = m->lod(std::min(item.mesh->lod(), m->lodCount() - 1));
+				if (m->vao() != boundVao) {
+					m->bind();
+					boundVao = m->vao();
+				}
+				m->draw(Mesh::Triangles, lod.count, lod.offset);
 			}
-		});
+		}
+		glCullFace(GL_BACK);
+		glBindVertexArray(0);
 
 		m_shadows->unbind();
 		buff->unbind();
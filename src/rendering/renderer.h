@@ -10,6 +10,9 @@
 
 namespace ae {
 
+	class AnimatorComponent;
+	class HLOD;
+
 	constexpr uint32 shadowMapSize = 1024;
 
 	enum class LightType : uint8 {
@@ -85,6 +88,10 @@ namespace ae {
 		inline void texture(SlotType slot, Texture* texture) { m_textures[slot] = texture; }
 		inline Texture* texture(SlotType slot) {return m_textures[slot]; }
 
+		/// Where the slot's texture sits in TextureArrays as of the last frame drawn. Invalid for empty slots and
+		/// textures that aren't packed yet.
+		const ArrayLayer& layer(SlotType slot) const { return m_layers[slot]; }
+
 		const Vector3& base() const { return m_base; }
 		void base(const Vector3& base) { m_base = base; }
 
@@ -107,10 +114,12 @@ namespace ae {
 		Vector3 m_base{ Vector3(1.0f) };
 		float m_shininess{ 0.15f }, m_specular{ 1.0f }, m_height{ 0.05f };
 		Texture* m_textures[SlotCount]{ nullptr };
+		ArrayLayer m_layers[SlotCount]{};
 		bool m_castsShadow{ true }, m_receivesShadow{ true };
 	};
 
 	class MeshComponent : public Component {
+		friend class HLOD;
 	public:
 		MeshComponent() = default;
 		explicit MeshComponent(Mesh* mesh) : m_mesh(mesh) {}
@@ -120,9 +129,24 @@ namespace ae {
 
 		Material& material() { return m_material; }
 
+		/// Level of detail picked by the renderer, kept between frames for the hysteresis.
+		uint32 lod() const { return m_lod; }
+		void lod(uint32 level) { m_lod = level; }
+
+		/// The entity never moves, so HLOD::build() may merge it with its neighbours.
+		bool staticGeometry() const { return m_static; }
+		void staticGeometry(bool v) { m_static = v; }
+
+		/// HLOD cluster the component is a member or the proxy of, -1 for none.
+		int32 cluster() const { return m_cluster; }
+		bool proxy() const { return m_proxy; }
+
 	private:
 		Mesh* m_mesh{ nullptr };
 		Material m_material{};
+		uint32 m_lod{ 0 };
+		int32 m_cluster{ -1 };
+		bool m_static{ false }, m_proxy{ false };
 	};
 
 	class CameraComponent : public Component {
@@ -149,6 +173,11 @@ namespace ae {
 		float m_near{ 0.01f }, m_far{ 500.0f }, m_fov{ mathutils::toRadians(60.0f) };
 	};
 
+	/// Meshlet culling counters of the last frame's main pass.
+	struct ClusterStats {
+		uint32 tested{ 0 }, frustumCulled{ 0 }, backFaceCulled{ 0 };
+	};
+
 	class Renderer {
 	public:
 		Renderer();
@@ -160,12 +189,88 @@ namespace ae {
 		const Vector3& ambient() const { return m_ambient; }
 		void ambient(const Vector3& ambient) { m_ambient = ambient; }
 
+		/// Largest simplification error on screen, in pixels, a level of detail is allowed to have.
+		float lodPixelError() const { return m_lodPixelError; }
+		void lodPixelError(float px) { m_lodPixelError = px; }
+
+		/// Fraction of lodPixelError() a coarser level has to stay under before switching to it.
+		float lodHysteresis() const { return m_lodHysteresis; }
+		void lodHysteresis(float v) { m_lodHysteresis = v; }
+
+		/// Objects with a smaller projected size, in pixels, are not drawn. 0 disables it.
+		float minScreenSize() const { return m_minScreenSize; }
+		void minScreenSize(float px) { m_minScreenSize = px; }
+
+		/// Culls the meshlets of meshes that have them before drawing level 0.
+		bool clusterCulling() const { return m_clusterCulling; }
+		void clusterCulling(bool v) { m_clusterCulling = v; }
+
+		const ClusterStats& clusterStats() const { return m_clusterStats; }
+
+		/// Swaps the members of its clusters for their proxies in the distance, nullptr draws every member.
+		HLOD* hlod() { return m_hlod; }
+		void hlod(HLOD* hlod) { m_hlod = hlod; }
+
 	private:
+		/// First texture unit of the material arrays, one per slot. The shadow maps take the ones below.
+		static constexpr uint32 MaterialUnit = 8;
+
 		std::unique_ptr<Shader> m_uber, m_shadows;
 
 		CameraComponent* m_camera{ nullptr };
+		HLOD* m_hlod{ nullptr };
 
 		Vector3 m_ambient{ Vector3(0.15f) };
+		float m_lodPixelError{ 1.0f }, m_lodHysteresis{ 0.2f }, m_minScreenSize{ 0.0f };
+		bool m_clusterCulling{ true };
+		ClusterStats m_clusterStats{};
+		std::vector<int32> m_rangeLengths;
+		std::vector<uint32> m_rangeOffsets;
+
+		/// Skinning matrices of every AnimatorComponent, one frame per region.
+		StreamBuffer m_palettes{};
+
+		/// One element of the uber shader's Instances block (std430), per visible item.
+		struct InstanceData {
+			Affine3x4 model;
+			Vector3 base;
+			float shininess, specular, height;
+			int32 receivesShadow;
+			int32 layers[Material::SlotCount]; // -1 for empty slots
+			int32 jointOffset;                  // -1 for meshes without a skin
+			int32 padding[3];
+		};
+
+		/// Instance data of the visible items, one frame per region.
+		StreamBuffer m_instances{};
+
+		struct DrawItem {
+			Entity* entity;
+			MeshComponent* mesh;
+			AnimatorComponent* animator; // nullptr unless the mesh is skinned
+			AABB bounds;
+		};
+
+		std::vector<DrawItem> m_candidates, m_visible;
+		std::vector<AABB> m_bounds;
+		std::vector<Containment> m_containment;
+
+		/// Fills m_visible with the mesh components whose world bounds touch the frustum of viewProj.
+		void cull(EntityWorld* world, const Matrix4& viewProj);
+
+		/// Picks the level of detail of every visible item from its projected size and drops the too small ones.
+		/// focal is the viewport height over 2 tan(fov / 2).
+		void selectLods(const Vector3& eye, float focal);
+
+		/// Packs the material maps of the visible items, sorts them so items of the same mesh, level and arrays
+		/// follow each other and writes their instance data to m_instances.
+		void uploadInstances();
+
+		/// Fills m_rangeLengths/m_rangeOffsets with the meshlets of item that survive the frustum and cone tests.
+		void cullClusters(const DrawItem& item, const Matrix4& viewProj, const Vector3& eye);
+
+		/// Copies the palettes of all animators into m_palettes and binds them to the JointPalette block.
+		void uploadPalettes(EntityWorld* world);
 
 		void renderShadows(EntityWorld* world, LightComponent* comp);
 	};
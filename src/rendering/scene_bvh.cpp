@@ -0,0 +1,151 @@
+#include "scene_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace ae {
+	namespace {
+		/// Normals go through the inverse transpose, a row of inverse per input component.
+		inline Vector3 transformNormal(const Affine3x4& inverse, const Vector3& n) {
+			return Vector3(
+				inverse[0].x * n.x + inverse[1].x * n.y + inverse[2].x * n.z,
+				inverse[0].y * n.x + inverse[1].y * n.y + inverse[2].y * n.z,
+				inverse[0].z * n.x + inverse[1].z * n.y + inverse[2].z * n.z
+			);
+		}
+
+		/// Largest factor inverse stretches a world vector by, exact for rotation and scale.
+		inline float maxStretch(const Affine3x4& inverse) {
+			float s = 0.0f;
+			for (size_t i = 0; i < 3; i++) s = std::max(s, Vector3(inverse[i].x, inverse[i].y, inverse[i].z).length());
+			return s;
+		}
+
+		inline bool normalizedRay(const Ray& ray, Ray& out) {
+			const float len = ray.direction.length();
+			if (!(len > 0.0f)) return false;
+			out = Ray(ray.origin, ray.direction / len);
+			return true;
+		}
+	}
+
+	void SceneBVH::update(EntityWorld* world) {
+		m_previous.swap(m_items);
+		m_items.clear();
+		world->each([&](Entity* entity, MeshComponent* component) {
+			Mesh* mesh = component->mesh();
+			if (!component->enabled() || mesh == nullptr || mesh->bvh() == nullptr || mesh->bvh()->empty()) return;
+
+			Item item{ entity, component, mesh->bvh(), entity->affineTransform(), {}, {} };
+			item.inverse = item.transform.inverse();
+			item.bounds = item.bvh->bounds().transformed(item.transform);
+			m_items.push_back(item);
+		});
+
+		bool same = m_items.size() == m_previous.size() && !m_nodes.empty();
+		for (size_t i = 0; same && i < m_items.size(); i++) {
+			same = m_items[i].component == m_previous[i].component && m_items[i].bvh == m_previous[i].bvh;
+		}
+		if (!same) {
+			rebuild();
+			return;
+		}
+
+		bvh::refit(m_nodes, [&](uint32 leaf) {
+			AABB b = AABB::empty();
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				const uint32 item = m_leaves[leaf * bvh::Width + i];
+				if (item != bvh::Empty) b.expand(m_items[item].bounds);
+			}
+			return b;
+		});
+		if (bvh::cost(m_nodes) > m_builtCost * 2.0f) rebuild();
+	}
+
+	void SceneBVH::rebuild() {
+		std::vector<AABB> boxes(m_items.size());
+		for (size_t i = 0; i < m_items.size(); i++) boxes[i] = m_items[i].bounds;
+		bvh::build(boxes.data(), boxes.size(), m_nodes, m_leaves);
+		m_builtCost = bvh::cost(m_nodes);
+		m_rebuilds++;
+	}
+
+	bool SceneBVH::raycastItem(const Item& item, const Ray& ray, float maxDistance, RaycastHit& hit) const {
+		// The local direction keeps its length, so t is the world distance.
+		const Ray local(item.inverse.transformPoint(ray.origin), item.inverse.transformVector(ray.direction));
+		MeshBVH::Hit h;
+		if (!item.bvh->raycast(local, maxDistance, h)) return false;
+
+		Vector3 n = transformNormal(item.inverse, h.normal);
+		if (n.dot(ray.direction) > 0.0f) n = n * -1.0f;
+		hit.entity = item.entity;
+		hit.mesh = item.component;
+		hit.distance = h.t;
+		hit.point = ray.at(h.t);
+		hit.normal = n.normalized();
+		hit.triangle = h.triangle;
+		return true;
+	}
+
+	bool SceneBVH::raycast(const Ray& ray, float maxDistance, RaycastHit& hit) const {
+		Ray r;
+		if (!normalizedRay(ray, r)) return false;
+
+		bool found = false;
+		bvh::traverse(m_nodes, bvh::RayData(r), maxDistance, 0.0f, [&](uint32 leaf, float best) {
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				const uint32 item = m_leaves[leaf * bvh::Width + i];
+				if (item == bvh::Empty || !raycastItem(m_items[item], r, best, hit)) continue;
+				best = hit.distance;
+				found = true;
+			}
+			return best;
+		});
+		return found;
+	}
+
+	void SceneBVH::raycastAll(const Ray& ray, float maxDistance, std::vector<RaycastHit>& out) const {
+		out.clear();
+		Ray r;
+		if (!normalizedRay(ray, r)) return;
+
+		bvh::traverse(m_nodes, bvh::RayData(r), maxDistance, 0.0f, [&](uint32 leaf, float tmax) {
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				const uint32 item = m_leaves[leaf * bvh::Width + i];
+				RaycastHit hit;
+				if (item != bvh::Empty && raycastItem(m_items[item], r, tmax, hit)) out.push_back(hit);
+			}
+			return tmax;
+		});
+		std::sort(out.begin(), out.end(), [](const RaycastHit& l, const RaycastHit& r) { return l.distance < r.distance; });
+	}
+
+	bool SceneBVH::sweepSphere(const Ray& ray, float radius, float maxDistance, RaycastHit& hit) const {
+		Ray r;
+		if (!normalizedRay(ray, r)) return false;
+
+		bool found = false;
+		bvh::traverse(m_nodes, bvh::RayData(r), maxDistance, radius, [&](uint32 leaf, float best) {
+			for (uint32 i = 0; i < bvh::Width; i++) {
+				const uint32 index = m_leaves[leaf * bvh::Width + i];
+				if (index == bvh::Empty) continue;
+
+				const Item& item = m_items[index];
+				const Ray local(item.inverse.transformPoint(r.origin), item.inverse.transformVector(r.direction));
+				MeshBVH::Hit h;
+				if (!item.bvh->sweepSphere(local, radius * maxStretch(item.inverse), best, h)) continue;
+
+				best = h.t;
+				found = true;
+				hit.entity = item.entity;
+				hit.mesh = item.component;
+				hit.distance = h.t;
+				hit.normal = transformNormal(item.inverse, h.normal).normalized();
+				hit.point = r.at(h.t) - hit.normal * radius;
+				hit.triangle = h.triangle;
+			}
+			return best;
+		});
+		return found;
+	}
+}
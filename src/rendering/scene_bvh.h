@@ -0,0 +1,62 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include "bvh.h"
+#include "renderer.h"
+
+#include <vector>
+
+namespace ae {
+	struct RaycastHit {
+		Entity* entity{ nullptr };
+		MeshComponent* mesh{ nullptr };
+		float distance{ 0.0f };
+		Vector3 point{}, normal{}; // World space, normal is unit length and faces the ray
+		uint32 triangle{ 0 };
+	};
+
+	/// Top level BVH over the entities with a MeshComponent whose mesh has a BVH, queried in world space.
+	/// Ray directions don't need to be normalized, distances are in world units either way.
+	class SceneBVH {
+	public:
+		/// Picks up the transforms of world. Refits when the same meshes only moved, rebuilds when the set changed
+		/// or refitting made the tree twice as expensive to traverse as a fresh one. Once per frame.
+		void update(EntityWorld* world);
+
+		/// Closest hit within maxDistance.
+		bool raycast(const Ray& ray, float maxDistance, RaycastHit& hit) const;
+
+		/// The closest hit of every entity within maxDistance, nearest first. Clears out.
+		void raycastAll(const Ray& ray, float maxDistance, std::vector<RaycastHit>& out) const;
+
+		/// First contact of a sphere moving along ray, hit.point is where it touches and hit.distance how far its
+		/// center got. Exact for uniformly scaled entities, under non-uniform scale the sphere is grown to cover
+		/// its smallest axis, so contacts can come a little early.
+		bool sweepSphere(const Ray& ray, float radius, float maxDistance, RaycastHit& hit) const;
+
+		uint32 itemCount() const { return uint32(m_items.size()); }
+		uint32 rebuilds() const { return m_rebuilds; }
+
+	private:
+		struct Item {
+			Entity* entity;
+			MeshComponent* component;
+			const MeshBVH* bvh;
+			Affine3x4 transform, inverse;
+			AABB bounds;
+		};
+
+		std::vector<Item> m_items, m_previous;
+		std::vector<bvh::Node> m_nodes;
+		std::vector<uint32> m_leaves; // Item indices, bvh::Width per leaf
+		float m_builtCost{ 0.0f };
+		uint32 m_rebuilds{ 0 };
+
+		void rebuild();
+
+		/// The hit of a single item in world space, ray.direction normalized.
+		bool raycastItem(const Item& item, const Ray& ray, float maxDistance, RaycastHit& hit) const;
+	};
+}
+
+#endif // SCENE_BVH_H
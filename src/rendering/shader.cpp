@@ -203,5 +203,6 @@ namespace ae {
 	void intern::Uniform::set(const Vector3& v) { glUniform3f(loc, v.x, v.y, v.z); }
 	void intern::Uniform::set(const Vector4& v) { glUniform4f(loc, v.x, v.y, v.z, v.w); }
 	void intern::Uniform::set(Matrix4 v) { glUniformMatrix4fv(loc, 1, true, v.data()); }
+	void intern::Uniform::set(const Affine3x4& v) { glUniformMatrix4x3fv(loc, 1, true, v.data()); }
 
 }
\ No newline at end of file
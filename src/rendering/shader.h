@@ -42,6 +42,7 @@ namespace ae {
 			void set(const Vector3& v);
 			void set(const Vector4& v);
 			void set(Matrix4 v);
+			void set(const Affine3x4& v);
 			uint32 loc;
 		};
 	}
@@ -0,0 +1,58 @@
+#include "stream_buffer.h"
+
+#include <chrono>
+
+namespace ae {
+	void StreamBuffer::create(uint32 regionSize, uint32 alignment) {
+		free();
+		m_regionSize = (regionSize + alignment - 1) / alignment * alignment;
+
+		// Coherent, so writes become visible to the GPU without explicit flushes.
+		const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+		glBufferStorage(GL_ARRAY_BUFFER, GLsizeiptr(m_regionSize) * RegionCount, nullptr, flags);
+		m_mapped = static_cast<uint8*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, GLsizeiptr(m_regionSize) * RegionCount, flags));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	void StreamBuffer::free() {
+		for (auto& fence : m_fences) {
+			if (fence) glDeleteSync(fence);
+			fence = nullptr;
+		}
+		if (m_buffer) {
+			glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+			glUnmapBuffer(GL_ARRAY_BUFFER);
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+			glDeleteBuffers(1, &m_buffer);
+		}
+		m_buffer = 0;
+		m_mapped = nullptr;
+		m_region = 0;
+		m_started = false;
+	}
+
+	uint8* StreamBuffer::begin() {
+		if (m_started) {
+			m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			m_region = (m_region + 1) % RegionCount;
+		}
+		m_started = true;
+		m_stats.frames++;
+
+		GLsync& fence = m_fences[m_region];
+		if (fence) {
+			if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+				// The GPU is more than RegionCount - 1 frames behind.
+				const auto start = std::chrono::steady_clock::now();
+				while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+				m_stats.stalls++;
+				m_stats.stallSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+		return data();
+	}
+}
@@ -0,0 +1,52 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "integer.hpp"
+#include "glad.h"
+
+namespace ae {
+	/// Persistently mapped buffer split into RegionCount regions. The CPU writes one region per frame
+	/// while the GPU may still read the others, a fence per region guards against overwriting them too early.
+	class StreamBuffer {
+	public:
+		static constexpr uint32 RegionCount = 3;
+
+		struct Stats {
+			uint64 frames{ 0 }; // begin() calls
+			uint64 stalls{ 0 }; // begin() calls that had to wait for the GPU
+			double stallSeconds{ 0.0 };
+		};
+
+		StreamBuffer() = default;
+		inline ~StreamBuffer() { free(); }
+
+		StreamBuffer(const StreamBuffer&) = delete;
+		StreamBuffer& operator =(const StreamBuffer&) = delete;
+
+		/// regionSize is rounded up to a multiple of alignment.
+		void create(uint32 regionSize, uint32 alignment = 16);
+		void free();
+
+		/// Fences the current region, moves to the next one and waits until the GPU is done with it.
+		/// Call once per frame, after every draw reading the previous region was issued.
+		uint8* begin();
+
+		uint8* data() { return m_mapped + offset(); }
+		uint32 offset() const { return m_region * m_regionSize; }
+		uint32 regionSize() const { return m_regionSize; }
+
+		GLuint id() const { return m_buffer; }
+		const Stats& stats() const { return m_stats; }
+
+	private:
+		GLuint m_buffer{ 0 };
+		uint8* m_mapped{ nullptr };
+		GLsync m_fences[RegionCount]{ nullptr };
+		uint32 m_region{ 0 }, m_regionSize{ 0 };
+		bool m_started{ false };
+
+		Stats m_stats{};
+	};
+}
+
+#endif // STREAM_BUFFER_H
@@ -2,6 +2,12 @@
 
 #include "stb_image.h"
 #include "file_system.h"
+#include "texture_loader.h"
+#include "texture_compression.h"
+#include "texture_array.h"
+#include "log.h"
+
+#include <algorithm>
 
 namespace ae {
 
@@ -22,9 +28,31 @@ namespace ae {
 				case TextureFormat::RGBAf: ifmt = GL_RGBA32F; fmt = GL_RGBA; type = GL_FLOAT; comps = 4; break;
 				case TextureFormat::Depthf: ifmt = GL_DEPTH_COMPONENT32F; fmt = GL_DEPTH_COMPONENT; type = GL_FLOAT; comps = 1; break;
 				case TextureFormat::DepthStencil: ifmt = GL_DEPTH24_STENCIL8; fmt = GL_DEPTH_STENCIL; type = GL_FLOAT; comps = 2; break;
+				// Compressed uploads only use the internal format
+				case TextureFormat::BC1: ifmt = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; fmt = GL_RGBA; type = GL_UNSIGNED_BYTE; comps = 4; break;
+				case TextureFormat::BC2: ifmt = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT; fmt = GL_RGBA; type = GL_UNSIGNED_BYTE; comps = 4; break;
+				case TextureFormat::BC3: ifmt = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; fmt = GL_RGBA; type = GL_UNSIGNED_BYTE; comps = 4; break;
+				case TextureFormat::BC4: ifmt = GL_COMPRESSED_RED_RGTC1; fmt = GL_RED; type = GL_UNSIGNED_BYTE; comps = 1; break;
+				case TextureFormat::BC5: ifmt = GL_COMPRESSED_RG_RGTC2; fmt = GL_RG; type = GL_UNSIGNED_BYTE; comps = 2; break;
+				case TextureFormat::BC6H: ifmt = GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT; fmt = GL_RGB; type = GL_FLOAT; comps = 3; break;
+				case TextureFormat::BC7: ifmt = GL_COMPRESSED_RGBA_BPTC_UNORM; fmt = GL_RGBA; type = GL_UNSIGNED_BYTE; comps = 4; break;
 			}
 			return std::make_tuple(ifmt, fmt, type, comps);
 		}
+
+		void flipRows(uint8* pixels, uint32 rowBytes, uint32 rows) {
+			for (uint32 y = 0; y < rows / 2; y++) {
+				std::swap_ranges(
+					pixels + size_t(y) * rowBytes, pixels + size_t(y + 1) * rowBytes, pixels + size_t(rows - 1 - y) * rowBytes
+				);
+			}
+		}
+
+		uint32 mipLevels(uint32 width, uint32 height, uint32 depth) {
+			uint32 size = std::max({ width, height, depth, 1u }), levels = 1;
+			while (size >>= 1) levels++;
+			return levels;
+		}
 	}
 	
 	Texture::Texture() {
@@ -32,6 +60,8 @@ namespace ae {
 	}
 
 	Texture::~Texture() {
+		if (!m_ready) TextureLoader::ston().cancel(this);
+		unpack();
 		free();
 	}
 
@@ -44,6 +74,7 @@ namespace ae {
 	}
 
 	void Texture::bind(uint32 slot) {
+		if (m_inArray) unpack(true);
 		glActiveTexture(GL_TEXTURE0 + slot);
 		glBindTexture(GLenum(m_target), m_id);
 	}
@@ -58,77 +89,242 @@ namespace ae {
 		m_depth = depth;
 	}
 
+	void Texture::storage(TextureFormat format, uint32 levels) {
+		unpack();
+		if (m_levels > 0) {
+			// Immutable storage stays with its name, a fresh one takes over the parameters.
+			glDeleteTextures(1, &m_id);
+			glGenTextures(1, &m_id);
+			glBindTexture(GLenum(m_target), m_id);
+			filter(m_min, m_mag);
+			wrap(m_wrap[0], m_wrap[1], m_wrap[2]);
+		} else {
+			glBindTexture(GLenum(m_target), m_id);
+		}
+
+		levels = std::max(levels, 1u);
+		const GLenum ifmt = GLenum(std::get<0>(intern::getTextureFormat(format)));
+		switch (m_target) {
+			case TextureTarget::Texture1D: glTexStorage1D(GLenum(m_target), levels, ifmt, m_width); break;
+			case TextureTarget::Texture2D:
+			case TextureTarget::CubeMap: glTexStorage2D(GLenum(m_target), levels, ifmt, m_width, m_height); break;
+			case TextureTarget::Texture3D:
+			case TextureTarget::Texture2DArray: glTexStorage3D(GLenum(m_target), levels, ifmt, m_width, m_height, m_depth); break;
+		}
+		m_levels = levels;
+		m_storageSize[0] = m_width;
+		m_storageSize[1] = m_height;
+		m_storageSize[2] = m_depth;
+		m_format = format;
+	}
+
+	bool Texture::hasStorage(TextureFormat format, uint32 levels) const {
+		return !m_inArray && m_levels == levels && m_format == format &&
+			m_storageSize[0] == m_width && m_storageSize[1] == m_height && m_storageSize[2] == m_depth;
+	}
+
+	uint32 Texture::dataLevels() const {
+		if (!mipmapped()) return 1;
+		return m_target == TextureTarget::Texture3D ? intern::mipLevels(m_width, m_height, m_depth) : intern::mipLevels(m_width, m_height);
+	}
+
+	void Texture::unpack(bool restore) {
+		if (m_layer.valid()) TextureArrays::ston().release(this, restore);
+	}
+
 	void Texture::setData(const void* data, TextureFormat format) {
-		glBindTexture(GLenum(m_target), m_id);
+		if (hasStorage(format, dataLevels())) {
+			unpack();
+			glBindTexture(GLenum(m_target), m_id);
+		} else {
+			storage(format, dataLevels());
+		}
+		m_mipChain.reset();
+		if (!data) return;
+
 		auto [ifmt, fmt, type, comps] = intern::getTextureFormat(format);
 		switch (m_target) {
 			default: break;
-			case TextureTarget::Texture1D: glTexImage1D(GLenum(m_target), 0, ifmt, m_width, 0, fmt, type, data); break;
-			case TextureTarget::Texture2D: glTexImage2D(GLenum(m_target), 0, ifmt, m_width, m_height, 0, fmt, type, data); break;
-			case TextureTarget::Texture3D: glTexImage3D(GLenum(m_target), 0, ifmt, m_width, m_height, m_depth, 0, fmt, type, data); break;
+			case TextureTarget::Texture1D: glTexSubImage1D(GLenum(m_target), 0, 0, m_width, fmt, type, data); break;
+			case TextureTarget::Texture2D: glTexSubImage2D(GLenum(m_target), 0, 0, 0, m_width, m_height, fmt, type, data); break;
+			case TextureTarget::Texture3D:
+			case TextureTarget::Texture2DArray:
+				glTexSubImage3D(GLenum(m_target), 0, 0, 0, 0, m_width, m_height, m_depth, fmt, type, data);
+				break;
+		}
+		if (mipmapped()) generateMips(GLenum(m_target), data, format);
+	}
+
+	void Texture::setCompressedData(const CompressedImage& image) {
+		if (image.levels.empty()) return;
+		setSize(image.levels[0].width, image.levels[0].height);
+		storage(image.format, uint32(image.levels.size()));
+		const GLenum ifmt = GLenum(std::get<0>(intern::getTextureFormat(image.format)));
+		for (size_t i = 0; i < image.levels.size(); i++) {
+			const auto& level = image.levels[i];
+			glCompressedTexSubImage2D(
+				GL_TEXTURE_2D, GLint(i), 0, 0, GLsizei(level.width), GLsizei(level.height), ifmt,
+				GLsizei(level.size), image.data.data() + level.offset
+			);
+		}
+
+		// The chain may stop short of 1x1, the storage ends with it so sampling never reaches past it.
+		filter(image.levels.size() > 1 ? TextureFilter::LinearMipLinear : TextureFilter::Linear, TextureFilter::Linear);
+		wrap(TextureWrap::Repeat, TextureWrap::Repeat);
+		m_mipChain.reset();
+	}
+
+	void Texture::setMipChain(const MipChain& chain) {
+		if (chain.levels.empty()) return;
+		setSize(chain.levels[0].width, chain.levels[0].height);
+		storage(TextureFormat::RGBA, uint32(chain.levels.size()));
+		for (size_t i = 0; i < chain.levels.size(); i++) {
+			const auto& level = chain.levels[i];
+			glTexSubImage2D(
+				GL_TEXTURE_2D, GLint(i), 0, 0, GLsizei(level.width), GLsizei(level.height), GL_RGBA, GL_UNSIGNED_BYTE,
+				chain.level(uint32(i))
+			);
 		}
-		
-		if (m_min == TextureFilter::LinearMipLinear ||
+		filter(chain.levels.size() > 1 ? TextureFilter::LinearMipLinear : TextureFilter::Linear, TextureFilter::Linear);
+		wrap(TextureWrap::Repeat, TextureWrap::Repeat);
+		m_mipChain = m_mipOptions.keep ? std::make_unique<MipChain>(chain) : nullptr;
+	}
+
+	bool Texture::mipmapped() const {
+		return m_min == TextureFilter::LinearMipLinear ||
 			m_min == TextureFilter::LinearMipNearest ||
 			m_min == TextureFilter::NearestMipLinear ||
-			m_min == TextureFilter::NearestMipNearest)
-		{
+			m_min == TextureFilter::NearestMipNearest;
+	}
+
+	void Texture::generateMips(GLenum face, const void* data, TextureFormat format) {
+		const bool cpu = m_mipOptions.cpu && format == TextureFormat::RGBA &&
+			(m_target == TextureTarget::Texture2D || m_target == TextureTarget::CubeMap);
+		if (!cpu) {
 			glGenerateMipmap(GLenum(m_target));
+			return;
+		}
+
+		// setData() allocated the full chain, the levels only have to be filled.
+		MipChain chain;
+		mip::generate(static_cast<const uint8*>(data), m_width, m_height, m_mipOptions, chain);
+		for (uint32 i = 1; i < chain.levels.size() && i < m_levels; i++) {
+			const auto& level = chain.levels[i];
+			glTexSubImage2D(
+				face, GLint(i), 0, 0, GLsizei(level.width), GLsizei(level.height), GL_RGBA, GL_UNSIGNED_BYTE, chain.level(i)
+			);
 		}
+		if (m_mipOptions.keep && m_target == TextureTarget::Texture2D) m_mipChain = std::make_unique<MipChain>(std::move(chain));
 	}
 
 	void Texture::fromFile(const std::string& fileName) {
+		fromFile(fileName, TextureFormat::RGBA);
+	}
+
+	void Texture::fromFile(const std::string& fileName, TextureFormat format) {
 		auto file = FileSystem::ston().open(fileName);
 		auto sz = file.size();
 		std::vector<uint8> data;
 		data.resize(sz);
 
-		if (file.read(data.data(), sz) == sz) {
-			int w, h, comp;
-			stbi_set_flip_vertically_on_load(1);
-			unsigned char* imgData = stbi_load_from_memory(data.data(), sz, &w, &h, &comp, STBI_rgb_alpha);
-			if (imgData) {
-				setSize(w, h);
-				bind();
-				filter(TextureFilter::LinearMipLinear, TextureFilter::Linear);
-				wrap(TextureWrap::Repeat, TextureWrap::Repeat);
-				setData(imgData, TextureFormat::RGBA);
-				unbind();
-				stbi_image_free(imgData);
-			}
-		}
+		const bool read = file.read(data.data(), sz) == sz;
 		file.close();
+		if (!read) return;
+
+		// CPU built chains are kept next to the image, e.g. bricks.png -> bricks.mips.ktx2.
+		std::string mipCache;
+		if (m_mipOptions.cpu && m_mipOptions.cache) {
+			mipCache = FileSystem::ston().nativePath(fileName);
+			const size_t dot = mipCache.find_last_of('.'), slash = mipCache.find_last_of("/\\");
+			const bool hasExt = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+			if (!mipCache.empty()) mipCache = mipCache.substr(0, hasExt ? dot : mipCache.size()) + ".mips.ktx2";
+		}
+		TextureLoader::ston().load(this, std::move(data), true, format, mipCache);
+	}
+
+	bool Texture::fromMemory(const uint8* data, size_t size, bool flipVertically) {
+		if (!m_ready) TextureLoader::ston().cancel(this);
+
+		if (mip::isKTX2(data, size)) {
+			MipChain chain;
+			if (!mip::readKTX2(data, size, flipVertically, chain)) return false;
+			setMipChain(chain);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			return true;
+		}
+
+		if (isCompressedContainer(data, size)) {
+			CompressedImage image;
+			if (!parseCompressedContainer(data, size, image)) return false;
+			if (flipVertically && !bc::flipVertically(image)) Log.warn("This compressed image can't be flipped, it stays as it is.");
+			setCompressedData(image);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			return true;
+		}
+
+		// stb_image's own flip is a global flag, the TextureLoader's workers decode at the same time.
+		int w, h, comp;
+		unsigned char* imgData = stbi_load_from_memory(data, int(size), &w, &h, &comp, STBI_rgb_alpha);
+		if (imgData == nullptr) return false;
+		if (flipVertically) intern::flipRows(imgData, uint32(w) * 4, uint32(h));
+
+		setSize(w, h);
+		bind();
+		filter(TextureFilter::LinearMipLinear, TextureFilter::Linear);
+		wrap(TextureWrap::Repeat, TextureWrap::Repeat);
+		setData(imgData, TextureFormat::RGBA);
+		unbind();
+		stbi_image_free(imgData);
+		return true;
 	}
 
 	void Texture::update(const void* data, TextureFormat format) {
+		unpack(true);
 		glBindTexture(GLenum(m_target), m_id);
 		auto [ifmt, fmt, type, comps] = intern::getTextureFormat(format);
 		switch (m_target) {
 			default: break;
 			case TextureTarget::Texture1D: glTexSubImage1D(GLenum(m_target), 0, 0, m_width, fmt, type, data); break;
 			case TextureTarget::Texture2D: glTexSubImage2D(GLenum(m_target), 0, 0, 0, m_width, m_height, fmt, type, data); break;
-			case TextureTarget::Texture3D: glTexSubImage3D(GLenum(m_target), 0, 0, 0, 0, m_width, m_height, m_depth, fmt, type, data); break;
-		}
-		if (m_min == TextureFilter::LinearMipLinear ||
-			m_min == TextureFilter::LinearMipNearest ||
-			m_min == TextureFilter::NearestMipLinear ||
-			m_min == TextureFilter::NearestMipNearest)
-		{
-			glGenerateMipmap(GLenum(m_target));
+			case TextureTarget::Texture3D:
+			case TextureTarget::Texture2DArray:
+				glTexSubImage3D(GLenum(m_target), 0, 0, 0, 0, m_width, m_height, m_depth, fmt, type, data);
+				break;
 		}
+		m_mipChain.reset();
+		if (data && mipmapped()) generateMips(GLenum(m_target), data, format);
 	}
 
 	void Texture::setCubeMapData(const void* data, TextureFormat format, CubeMapSide side) {
-		glBindTexture(GLenum(m_target), m_id);
-		auto [ifmt, fmt, type, comps] = intern::getTextureFormat(format);
-		glTexImage2D(GLenum(side), 0, ifmt, m_width, m_height, 0, fmt, type, data);
-		if (m_min == TextureFilter::LinearMipLinear ||
-			m_min == TextureFilter::LinearMipNearest ||
-			m_min == TextureFilter::NearestMipLinear ||
-			m_min == TextureFilter::NearestMipNearest)
-		{
-			glGenerateMipmap(GLenum(m_target));
+		// The first side allocates all six.
+		if (hasStorage(format, dataLevels())) {
+			unpack();
+			glBindTexture(GLenum(m_target), m_id);
+		} else {
+			storage(format, dataLevels());
 		}
+		if (!data) return;
+
+		auto [ifmt, fmt, type, comps] = intern::getTextureFormat(format);
+		glTexSubImage2D(GLenum(side), 0, 0, 0, m_width, m_height, fmt, type, data);
+		if (mipmapped()) generateMips(GLenum(side), data, format);
+	}
+
+	bool Texture::readBack(uint32 level, std::vector<uint8>& rgba, uint32& width, uint32& height) {
+		if (m_target != TextureTarget::Texture2D) return false;
+		unpack(true);
+		glBindTexture(GL_TEXTURE_2D, m_id);
+		GLint w = 0, h = 0;
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &w);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_HEIGHT, &h);
+		if (w <= 0 || h <= 0) return false;
+
+		width = uint32(w);
+		height = uint32(h);
+		rgba.resize(size_t(width) * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glGetTexImage(GL_TEXTURE_2D, level, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+		return true;
 	}
 
 	void Texture::target(TextureTarget target) {
@@ -136,6 +332,11 @@ namespace ae {
 	}
 
 	void Texture::wrap(TextureWrap wrapS, TextureWrap wrapT, TextureWrap wrapR) {
+		// Arrays sample with the wrap of their textures, another one needs another array.
+		if (wrapS != m_wrap[0] || wrapT != m_wrap[1]) unpack(true);
+		m_wrap[0] = wrapS;
+		m_wrap[1] = wrapT;
+		m_wrap[2] = wrapR;
 		glTexParameteri(GLenum(m_target), GL_TEXTURE_WRAP_S, int(wrapS));
 		glTexParameteri(GLenum(m_target), GL_TEXTURE_WRAP_T, int(wrapT));
 		if (m_target == TextureTarget::CubeMap || m_target == TextureTarget::Texture3D)
@@ -143,9 +344,11 @@ namespace ae {
 	}
 
 	void Texture::filter(TextureFilter min, TextureFilter mag) {
+		if (min != m_min || mag != m_mag) unpack(true);
 		glTexParameteri(GLenum(m_target), GL_TEXTURE_MIN_FILTER, int(min));
 		glTexParameteri(GLenum(m_target), GL_TEXTURE_MAG_FILTER, int(mag));
 		m_min = min;
+		m_mag = mag;
 	}
 
 }
\ No newline at end of file
@@ -5,16 +5,26 @@
 #include "integer.hpp"
 
 #include "resource_manager.h"
+#include "mipmap.h"
 
+#include <memory>
 #include <tuple>
 #include <vector>
 
+// EXT_texture_compression_s3tc, which glad wasn't generated with. Every desktop GL 4 driver exposes it.
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT 0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+
 namespace ae {
 
 	enum class TextureTarget : GLenum {
 		Texture1D = GL_TEXTURE_1D,
 		Texture2D = GL_TEXTURE_2D,
 		Texture3D = GL_TEXTURE_3D,
+		Texture2DArray = GL_TEXTURE_2D_ARRAY,
 		CubeMap = GL_TEXTURE_CUBE_MAP
 	};
 
@@ -52,15 +62,50 @@ namespace ae {
 		RGBf,
 		RGBAf,
 		Depthf,
-		DepthStencil
+		DepthStencil,
+		// Block compressed, 4x4 texels per 8 (BC1, BC4) or 16 bytes
+		BC1,
+		BC2,
+		BC3,
+		BC4,
+		BC5,
+		BC6H,
+		BC7
+	};
+
+	/// A block compressed image and its mip chain, level 0 first, as DDS and KTX2 files hold them.
+	struct CompressedImage {
+		struct Level {
+			uint32 width, height;
+			size_t offset, size; // Within data
+		};
+
+		TextureFormat format{ TextureFormat::BC1 };
+		std::vector<Level> levels;
+		std::vector<uint8> data;
 	};
 
 	namespace intern {
 		using GLFormat = std::tuple<GLint, GLenum, GLenum, uint8>;
 		GLFormat getTextureFormat(TextureFormat format);
+
+		/// Turns an image upside down in place.
+		void flipRows(uint8* pixels, uint32 rowBytes, uint32 rows);
+
+		/// Levels of a full mip chain down to 1x1(x1).
+		uint32 mipLevels(uint32 width, uint32 height = 1, uint32 depth = 1);
 	}
 
+	/// A layer of one of the TextureArrays.
+	struct ArrayLayer {
+		int32 array{ -1 }, layer{ -1 };
+
+		bool valid() const { return array >= 0; }
+	};
+
 	class Texture : public Resource {
+		friend class TextureLoader;
+		friend class TextureArrays;
 	public:
 		Texture();
 		~Texture();
@@ -68,9 +113,12 @@ namespace ae {
 		void create();
 		void free();
 
+		/// Binds the texture to unit slot. A packed texture takes its storage back from its layer first.
 		void bind(uint32 slot = 0);
 		void unbind();
 
+		/// The GL name. While the texture is packed it names a texture without storage, its texels are in
+		/// arrayLayer() only. bind(), readBack() and uploads take them back.
 		GLuint id() const { return m_id; }
 		uint32 width() const { return m_width; }
 		uint32 height() const { return m_height; }
@@ -83,17 +131,88 @@ namespace ae {
 		void filter(TextureFilter min, TextureFilter mag);
 
 		void setSize(uint32 width, uint32 height = 0, uint32 depth = 0);
+
+		/// Allocates immutable storage (glTexStorage) of levels for the current size. Storage can't be respecified,
+		/// a texture that has some already gets a new id(), framebuffer attachments have to be redone.
+		void storage(TextureFormat format, uint32 levels);
+
+		/// Levels of the storage, 0 before the first upload.
+		uint32 levels() const { return m_levels; }
+
+		/// Allocates storage unless the size, format and level count stay the same, then uploads level 0.
+		/// Mip filters get a full chain.
 		void setData(const void* data, TextureFormat format);
+
+		/// Uploads every level of a 2D image with glCompressedTexSubImage2D, the size is taken from it.
+		void setCompressedData(const CompressedImage& image);
+
+		/// Uploads every level of a chain built by mip::generate() with glTexSubImage2D, the size is taken from it.
+		void setMipChain(const MipChain& chain);
+
+		/// How setData(), update(), setCubeMapData() and the TextureLoader build mips, glGenerateMipmap by default.
+		/// Uploads without data (render targets) and non mip min filters don't build any.
+		const MipOptions& mipOptions() const { return m_mipOptions; }
+		void mipOptions(const MipOptions& options) { m_mipOptions = options; }
+
+		/// The CPU built chain of the last upload if MipOptions::keep asked for it, nullptr otherwise.
+		const MipChain* mipChain() const { return m_mipChain.get(); }
+
+		/// Reads the file and hands it to the TextureLoader, the texture is a placeholder until ready().
+		/// DDS and KTX2 files are uploaded as they are, other images are compressed to format first unless it is
+		/// TextureFormat::RGBA.
 		void fromFile(const std::string& fileName) override;
+		void fromFile(const std::string& fileName, TextureFormat format);
+
+		/// Decodes an image file held in memory (PNG, JPEG, DDS, KTX2, ...) right away. glTF images have their
+		/// first row at the top, files loaded by fromFile() are flipped.
+		bool fromMemory(const uint8* data, size_t size, bool flipVertically = true);
+
+		/// Format of the last upload.
+		TextureFormat format() const { return m_format; }
+
+		/// False while the TextureLoader still decodes or uploads the image.
+		bool ready() const { return m_ready; }
+
+		/// Where TextureArrays::pack() moved the texture, invalid until then and again once the texture changes or is
+		/// bound on its own.
+		const ArrayLayer& arrayLayer() const { return m_layer; }
+
 		void update(const void* data, TextureFormat format);
 		void setCubeMapData(const void* data, TextureFormat format, CubeMapSide side);
 
+		/// RGBA8 copy of mip level of a 2D texture, its size goes to width and height. False if there's no such level.
+		/// A packed texture takes its storage back from the layer first.
+		bool readBack(uint32 level, std::vector<uint8>& rgba, uint32& width, uint32& height);
+
 	private:
 		GLuint m_id{ 0 };
 		TextureTarget m_target{ TextureTarget::Texture2D };
-		TextureFilter m_min{ TextureFilter::Linear };
+		TextureFilter m_min{ TextureFilter::Linear }, m_mag{ TextureFilter::Linear };
+		TextureWrap m_wrap[3]{ TextureWrap::Repeat, TextureWrap::Repeat, TextureWrap::Repeat };
+		MipOptions m_mipOptions{};
+		std::unique_ptr<MipChain> m_mipChain;
 
 		uint32 m_width{ 0 }, m_height{ 0 }, m_depth{ 0 };
+		uint32 m_levels{ 0 }, m_storageSize[3]{ 0, 0, 0 };
+		TextureFormat m_format{ TextureFormat::RGBA };
+		ArrayLayer m_layer{};
+		bool m_inArray{ false }; // The storage went to m_layer, m_id names a texture without any
+		bool m_ready{ true };
+
+		bool mipmapped() const;
+
+		/// Whether the storage matches the current size, format and levels.
+		bool hasStorage(TextureFormat format, uint32 levels) const;
+
+		/// Levels setData() and setCubeMapData() allocate for the current size and filter.
+		uint32 dataLevels() const;
+
+		/// Gives the layer in TextureArrays back, its contents are about to change. With restore the texture gets its
+		/// storage and contents back from the layer first.
+		void unpack(bool restore = false);
+
+		/// Fills levels 1 and up of face (the target, or a cube map side) from the level 0 data just uploaded.
+		void generateMips(GLenum face, const void* data, TextureFormat format);
 	};
 
 }
@@ -0,0 +1,152 @@
+#include "texture_array.h"
+
+#include "log.h"
+
+#include <algorithm>
+
+namespace ae {
+	TextureArrays TextureArrays::s_instance{};
+
+	TextureArrays::~TextureArrays() {
+		// Textures may outlive the arrays at exit, they mustn't try to release their layers.
+		for (auto& array : m_arrays) {
+			for (Texture* owner : array.owners) {
+				if (owner) {
+					owner->m_layer = {};
+					owner->m_inArray = false;
+				}
+			}
+		}
+	}
+
+	ArrayLayer TextureArrays::pack(Texture* texture) {
+		if (texture->m_layer.valid()) return texture->m_layer;
+		if (!texture->ready() || texture->target() != TextureTarget::Texture2D || texture->levels() == 0) return {};
+
+		if (m_maxLayers == 0) {
+			GLint maxLayers = 256;
+			glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+			m_maxLayers = uint32(std::max(maxLayers, 1));
+		}
+
+		const uint32 width = texture->width(), height = texture->height(), levels = texture->levels();
+		const TextureFormat format = texture->format();
+		const TextureFilter min = texture->m_min, mag = texture->m_mag;
+		const TextureWrap wrapS = texture->m_wrap[0], wrapT = texture->m_wrap[1];
+		auto fits = [&](const Array& a) {
+			return a.width == width && a.height == height && a.levels == levels && a.format == format &&
+				a.min == min && a.mag == mag && a.wrapS == wrapS && a.wrapT == wrapT &&
+				(!a.free.empty() || a.owners.size() < m_maxLayers);
+		};
+		auto it = std::find_if(m_arrays.begin(), m_arrays.end(), fits);
+		if (it == m_arrays.end()) {
+			Array array{};
+			array.width = width;
+			array.height = height;
+			array.levels = levels;
+			array.format = format;
+			array.min = min;
+			array.mag = mag;
+			array.wrapS = wrapS;
+			array.wrapT = wrapT;
+			m_arrays.push_back(std::move(array));
+			it = m_arrays.end() - 1;
+		}
+
+		Array& array = *it;
+		uint32 layer;
+		if (!array.free.empty()) {
+			layer = array.free.back();
+			array.free.pop_back();
+		} else {
+			layer = uint32(array.owners.size());
+			if (layer == array.capacity) grow(array, std::min(std::max(array.capacity * 2, InitialLayers), m_maxLayers));
+			array.owners.push_back(nullptr);
+		}
+		array.owners[layer] = texture;
+
+		copyLevels(array, texture->m_id, GL_TEXTURE_2D, 0, array.id, GL_TEXTURE_2D_ARRAY, GLint(layer));
+
+		// The layer holds the only copy from now on, immutable storage goes with its name.
+		glDeleteTextures(1, &texture->m_id);
+		glGenTextures(1, &texture->m_id);
+		texture->m_inArray = true;
+		texture->m_layer = { int32(it - m_arrays.begin()), int32(layer) };
+		return texture->m_layer;
+	}
+
+	void TextureArrays::release(Texture* texture, bool restore) {
+		const ArrayLayer layer = texture->m_layer;
+		if (!layer.valid()) return;
+
+		Array& array = m_arrays[layer.array];
+		array.owners[layer.layer] = nullptr;
+		array.free.push_back(uint32(layer.layer));
+		texture->m_layer = {};
+		if (!texture->m_inArray) return;
+
+		// Storage of the size, format and levels it had, without it the texture is only good for storage().
+		texture->m_inArray = false;
+		if (!restore) return;
+		glBindTexture(GL_TEXTURE_2D, texture->m_id);
+		const GLenum ifmt = GLenum(std::get<0>(intern::getTextureFormat(array.format)));
+		glTexStorage2D(GL_TEXTURE_2D, GLsizei(array.levels), ifmt, array.width, array.height);
+		texture->filter(array.min, array.mag);
+		texture->wrap(array.wrapS, array.wrapT, texture->m_wrap[2]);
+		copyLevels(array, array.id, GL_TEXTURE_2D_ARRAY, GLint(layer.layer), texture->m_id, GL_TEXTURE_2D, 0);
+	}
+
+	void TextureArrays::bind(int32 array, uint32 slot) const {
+		glActiveTexture(GL_TEXTURE0 + slot);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_arrays[array].id);
+	}
+
+	uint32 TextureArrays::packed() const {
+		uint32 count = 0;
+		for (const auto& array : m_arrays) count += uint32(array.owners.size() - array.free.size());
+		return count;
+	}
+
+	void TextureArrays::copyLevels(
+		const Array& array, GLuint src, GLenum srcTarget, GLint srcLayer, GLuint dst, GLenum dstTarget, GLint dstLayer
+	) {
+		// Same internal format on both sides, compressed levels included. Levels smaller than a block are copied whole.
+		for (uint32 level = 0; level < array.levels; level++) {
+			glCopyImageSubData(
+				src, srcTarget, GLint(level), 0, 0, srcLayer, dst, dstTarget, GLint(level), 0, 0, dstLayer,
+				GLsizei(std::max(array.width >> level, 1u)), GLsizei(std::max(array.height >> level, 1u)), 1
+			);
+		}
+	}
+
+	void TextureArrays::grow(Array& array, uint32 capacity) {
+		GLuint id = 0;
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, id);
+		const GLenum ifmt = GLenum(std::get<0>(intern::getTextureFormat(array.format)));
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, GLsizei(array.levels), ifmt, array.width, array.height, GLsizei(capacity));
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GLint(array.min));
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GLint(array.mag));
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GLint(array.wrapS));
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GLint(array.wrapT));
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		const uint32 used = uint32(array.owners.size());
+		if (array.id && used > 0) {
+			for (uint32 level = 0; level < array.levels; level++) {
+				glCopyImageSubData(
+					array.id, GL_TEXTURE_2D_ARRAY, GLint(level), 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, GLint(level), 0, 0, 0,
+					GLsizei(std::max(array.width >> level, 1u)), GLsizei(std::max(array.height >> level, 1u)), GLsizei(used)
+				);
+			}
+		}
+		if (array.id) glDeleteTextures(1, &array.id);
+
+		Log.info(
+			"Texture array " + std::to_string(array.width) + "x" + std::to_string(array.height) + " grew to " +
+			std::to_string(capacity) + " layers."
+		);
+		array.id = id;
+		array.capacity = capacity;
+	}
+}
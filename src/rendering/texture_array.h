@@ -0,0 +1,72 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include "integer.hpp"
+#include "glad.h"
+#include "texture.h"
+
+#include <vector>
+
+namespace ae {
+	/// 2D textures packed into GL_TEXTURE_2D_ARRAYs of immutable storage, one kind of array per size, format, level
+	/// count, filter and wrap. Materials then name an array and a layer per slot, draws whose maps share arrays need
+	/// no rebinding and may be drawn together. Packed textures hand their storage over to the layer, they get it back
+	/// when they leave it with release(texture, true), as Texture::bind() and readBack() do.
+	class TextureArrays {
+	public:
+		static constexpr uint32 InitialLayers = 8;
+
+		TextureArrays() = default;
+		~TextureArrays();
+
+		TextureArrays(const TextureArrays&) = delete;
+		TextureArrays& operator =(const TextureArrays&) = delete;
+
+		/// Where texture is packed, moving it into a free layer first if it isn't yet. Invalid while the texture
+		/// isn't ready, and for anything but 2D textures with storage.
+		ArrayLayer pack(Texture* texture);
+
+		/// Frees the layer of texture for the next pack(). Textures call it whenever their storage or data changes,
+		/// with restore when they keep their contents: they get storage of their own again and the layer is copied
+		/// into it.
+		void release(Texture* texture, bool restore = false);
+
+		/// Binds array to texture unit slot.
+		void bind(int32 array, uint32 slot) const;
+
+		TextureFormat format(int32 array) const { return m_arrays[array].format; }
+		GLuint id(int32 array) const { return m_arrays[array].id; }
+		uint32 count() const { return uint32(m_arrays.size()); }
+
+		/// Layers holding a texture, over all arrays.
+		uint32 packed() const;
+
+		static TextureArrays& ston() { return s_instance; }
+
+	private:
+		struct Array {
+			GLuint id{ 0 };
+			uint32 width, height, levels, capacity{ 0 };
+			TextureFormat format;
+			TextureFilter min, mag;
+			TextureWrap wrapS, wrapT;
+			std::vector<Texture*> owners; // Per layer handed out so far, nullptr once freed
+			std::vector<uint32> free;
+		};
+
+		std::vector<Array> m_arrays;
+		uint32 m_maxLayers{ 0 };
+
+		/// Copies every level of one layer of src to one of dst, layer 0 for 2D textures.
+		static void copyLevels(
+			const Array& array, GLuint src, GLenum srcTarget, GLint srcLayer, GLuint dst, GLenum dstTarget, GLint dstLayer
+		);
+
+		/// Moves array to new storage of capacity layers, the layers handed out so far are copied over.
+		void grow(Array& array, uint32 capacity);
+
+		static TextureArrays s_instance;
+	};
+}
+
+#endif // TEXTURE_ARRAY_H
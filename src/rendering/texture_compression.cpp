@@ -0,0 +1,646 @@
+#include "texture_compression.h"
+
+#include "log.h"
+#include "util.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace ae {
+	namespace {
+		/// Principal axis (power iteration on the covariance) and mean of count points of N components.
+		template <uint32 N>
+		void principalAxis(const float (*p)[N], uint32 count, float mean[N], float axis[N]) {
+			for (uint32 c = 0; c < N; c++) {
+				mean[c] = 0.0f;
+				for (uint32 i = 0; i < count; i++) mean[c] += p[i][c];
+				mean[c] /= float(count);
+			}
+
+			float cov[N][N]{};
+			for (uint32 i = 0; i < count; i++) {
+				for (uint32 a = 0; a < N; a++) {
+					for (uint32 b = 0; b < N; b++) cov[a][b] += (p[i][a] - mean[a]) * (p[i][b] - mean[b]);
+				}
+			}
+
+			// Starting from the widest component's row never starts orthogonal to the axis.
+			uint32 widest = 0;
+			for (uint32 c = 1; c < N; c++) {
+				if (cov[c][c] > cov[widest][widest]) widest = c;
+			}
+			for (uint32 c = 0; c < N; c++) axis[c] = cov[widest][c];
+
+			for (uint32 iteration = 0; iteration < 8; iteration++) {
+				float next[N]{}, length = 0.0f;
+				for (uint32 a = 0; a < N; a++) {
+					for (uint32 b = 0; b < N; b++) next[a] += cov[a][b] * axis[b];
+					length = std::max(length, std::abs(next[a]));
+				}
+				if (length < 1e-12f) break;
+				for (uint32 c = 0; c < N; c++) axis[c] = next[c] / length;
+			}
+
+			float length = 0.0f;
+			for (uint32 c = 0; c < N; c++) length += axis[c] * axis[c];
+			length = std::sqrt(length);
+			for (uint32 c = 0; c < N; c++) axis[c] = length > 1e-12f ? axis[c] / length : (c < 3 ? 0.57735f : 0.0f);
+		}
+
+		/// The points' extremes along the principal axis.
+		template <uint32 N>
+		void fitEndpoints(const float (*p)[N], uint32 count, float lo[N], float hi[N]) {
+			float mean[N], axis[N];
+			principalAxis<N>(p, count, mean, axis);
+			float tMin = 0.0f, tMax = 0.0f;
+			for (uint32 i = 0; i < count; i++) {
+				float t = 0.0f;
+				for (uint32 c = 0; c < N; c++) t += (p[i][c] - mean[c]) * axis[c];
+				tMin = std::min(tMin, t);
+				tMax = std::max(tMax, t);
+			}
+			for (uint32 c = 0; c < N; c++) {
+				lo[c] = std::clamp(mean[c] + axis[c] * tMin, 0.0f, 255.0f);
+				hi[c] = std::clamp(mean[c] + axis[c] * tMax, 0.0f, 255.0f);
+			}
+		}
+
+		/// Endpoints a and b minimizing the squared error of p[i] ~ w[i] * a + (1 - w[i]) * b. False if singular.
+		template <uint32 N>
+		bool leastSquares(const float (*p)[N], const float* w, uint32 count, float a[N], float b[N]) {
+			float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[N]{}, bx[N]{};
+			for (uint32 i = 0; i < count; i++) {
+				const float wa = w[i], wb = 1.0f - w[i];
+				aa += wa * wa;
+				bb += wb * wb;
+				ab += wa * wb;
+				for (uint32 c = 0; c < N; c++) {
+					ax[c] += wa * p[i][c];
+					bx[c] += wb * p[i][c];
+				}
+			}
+			const float det = aa * bb - ab * ab;
+			if (std::abs(det) < 1e-6f) return false;
+			for (uint32 c = 0; c < N; c++) {
+				a[c] = std::clamp((ax[c] * bb - bx[c] * ab) / det, 0.0f, 255.0f);
+				b[c] = std::clamp((bx[c] * aa - ax[c] * ab) / det, 0.0f, 255.0f);
+			}
+			return true;
+		}
+
+		inline uint16 to565(const float c[3]) {
+			const uint32 r = uint32(c[0] * (31.0f / 255.0f) + 0.5f);
+			const uint32 g = uint32(c[1] * (63.0f / 255.0f) + 0.5f);
+			const uint32 b = uint32(c[2] * (31.0f / 255.0f) + 0.5f);
+			return uint16(r << 11 | g << 5 | b);
+		}
+
+		inline void from565(uint16 v, float c[3]) {
+			const uint32 r = v >> 11 & 31, g = v >> 5 & 63, b = v & 31;
+			c[0] = float(r << 3 | r >> 2);
+			c[1] = float(g << 2 | g >> 4);
+			c[2] = float(b << 3 | b >> 2);
+		}
+
+		/// Four colour mode indices of the 16 texels for endpoints c0 and c1, returns the squared error.
+		float bc1Indices(const float (*p)[3], uint16 c0, uint16 c1, uint32& indices) {
+			float palette[4][3];
+			from565(c0, palette[0]);
+			from565(c1, palette[1]);
+			for (uint32 c = 0; c < 3; c++) {
+				palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+				palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+			}
+
+			float total = 0.0f;
+			indices = 0;
+			for (uint32 i = 0; i < 16; i++) {
+				uint32 best = 0;
+				float bestError = 1e30f;
+				for (uint32 k = 0; k < 4; k++) {
+					float e = 0.0f;
+					for (uint32 c = 0; c < 3; c++) e += (p[i][c] - palette[k][c]) * (p[i][c] - palette[k][c]);
+					if (e < bestError) {
+						bestError = e;
+						best = k;
+					}
+				}
+				indices |= best << (i * 2);
+				total += bestError;
+			}
+			return total;
+		}
+
+		// BC7 4 bit index interpolation weights, out of 64.
+		constexpr uint32 Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+		struct Bc7Fit {
+			uint32 q[2][4], pbit[2]; // 7 bit endpoints and their p-bits
+			uint8 indices[16];
+			float error;
+		};
+
+		/// Mode 6 quantization of the lo/hi endpoints with the given p-bits, and the texels' nearest indices.
+		void bc7Quantize(const float (*p)[4], const float lo[4], const float hi[4], uint32 p0, uint32 p1, Bc7Fit& fit) {
+			float e[2][4];
+			fit.pbit[0] = p0;
+			fit.pbit[1] = p1;
+			for (uint32 c = 0; c < 4; c++) {
+				fit.q[0][c] = uint32(std::clamp(std::floor((lo[c] - float(p0)) * 0.5f + 0.5f), 0.0f, 127.0f));
+				fit.q[1][c] = uint32(std::clamp(std::floor((hi[c] - float(p1)) * 0.5f + 0.5f), 0.0f, 127.0f));
+				e[0][c] = float(fit.q[0][c] << 1 | p0);
+				e[1][c] = float(fit.q[1][c] << 1 | p1);
+			}
+
+			float palette[16][4], d[4], dd = 0.0f;
+			for (uint32 k = 0; k < 16; k++) {
+				for (uint32 c = 0; c < 4; c++) {
+					palette[k][c] = float(((64 - Bc7Weights[k]) * uint32(e[0][c]) + Bc7Weights[k] * uint32(e[1][c]) + 32) >> 6);
+				}
+			}
+			for (uint32 c = 0; c < 4; c++) {
+				d[c] = e[1][c] - e[0][c];
+				dd += d[c] * d[c];
+			}
+
+			// The projection on the endpoint line narrows the search down to three neighbouring indices.
+			fit.error = 0.0f;
+			for (uint32 i = 0; i < 16; i++) {
+				float t = 0.0f;
+				for (uint32 c = 0; c < 4; c++) t += (p[i][c] - e[0][c]) * d[c];
+				const int32 guess = dd > 0.0f ? int32(std::clamp(t / dd, 0.0f, 1.0f) * 15.0f + 0.5f) : 0;
+				uint32 best = 0;
+				float bestError = 1e30f;
+				for (int32 k = std::max(guess - 1, 0); k <= std::min(guess + 1, 15); k++) {
+					float err = 0.0f;
+					for (uint32 c = 0; c < 4; c++) err += (p[i][c] - palette[k][c]) * (p[i][c] - palette[k][c]);
+					if (err < bestError) {
+						bestError = err;
+						best = uint32(k);
+					}
+				}
+				fit.indices[i] = uint8(best);
+				fit.error += bestError;
+			}
+		}
+
+		void bc7BestPbits(const float (*p)[4], const float lo[4], const float hi[4], Bc7Fit& best) {
+			best.error = 1e30f;
+			for (uint32 pb = 0; pb < 4; pb++) {
+				Bc7Fit fit;
+				bc7Quantize(p, lo, hi, pb & 1, pb >> 1, fit);
+				if (fit.error < best.error) best = fit;
+			}
+		}
+
+		/// LSB first bit writer for 128 bit blocks.
+		struct BlockWriter {
+			uint8* out;
+			uint32 position{ 0 };
+
+			void put(uint32 value, uint32 bits) {
+				for (uint32 i = 0; i < bits; i++, position++) {
+					if (value >> i & 1) out[position >> 3] |= uint8(1u << (position & 7));
+				}
+			}
+		};
+
+		/// Reverses the first rows of count units of unitBits bits starting at bit first of block.
+		void reverseRows(uint8* block, uint32 first, uint32 unitBits, uint32 rows) {
+			uint64 bits = 0;
+			const uint32 bytes = (first + unitBits * 4 + 7) / 8;
+			std::memcpy(&bits, block, std::min<uint32>(bytes, 8));
+			const uint64 mask = (uint64(1) << unitBits) - 1;
+			uint64 units[4];
+			for (uint32 r = 0; r < 4; r++) units[r] = bits >> (first + r * unitBits) & mask;
+			for (uint32 r = 0; r < rows; r++) {
+				const uint32 shift = first + r * unitBits;
+				bits = (bits & ~(mask << shift)) | (units[rows - 1 - r] << shift);
+			}
+			std::memcpy(block, &bits, std::min<uint32>(bytes, 8));
+		}
+
+		/// Flips the first rows texel rows inside one block.
+		void flipBlock(uint8* block, TextureFormat format, uint32 rows) {
+			switch (format) {
+				case TextureFormat::BC1: reverseRows(block + 4, 0, 8, rows); break;
+				case TextureFormat::BC2: reverseRows(block, 0, 16, rows); reverseRows(block + 8 + 4, 0, 8, rows); break;
+				case TextureFormat::BC3: reverseRows(block, 16, 12, rows); reverseRows(block + 8 + 4, 0, 8, rows); break;
+				case TextureFormat::BC4: reverseRows(block, 16, 12, rows); break;
+				case TextureFormat::BC5: reverseRows(block, 16, 12, rows); reverseRows(block + 8, 16, 12, rows); break;
+				default: break;
+			}
+		}
+
+		inline uint32 read32(const uint8* p) {
+			uint32 v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline uint64 read64(const uint8* p) {
+			uint64 v;
+			std::memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		constexpr uint8 Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+		constexpr uint32 DdsMagic = 0x20534444; // "DDS "
+
+		constexpr uint32 fourCC(char a, char b, char c, char d) {
+			return uint32(uint8(a)) | uint32(uint8(b)) << 8 | uint32(uint8(c)) << 16 | uint32(uint8(d)) << 24;
+		}
+
+		/// Fills the levels of out with tightly packed data from offset on, false if it runs past size.
+		bool packedLevels(CompressedImage& out, uint32 width, uint32 height, uint32 levels, const uint8* data, size_t size) {
+			size_t offset = 0;
+			for (uint32 i = 0; i < levels; i++) {
+				const uint32 w = std::max(width >> i, 1u), h = std::max(height >> i, 1u);
+				const size_t bytes = bc::imageSize(out.format, w, h);
+				if (offset + bytes > size) return false;
+				out.levels.push_back({ w, h, offset, bytes });
+				offset += bytes;
+			}
+			out.data.assign(data, data + offset);
+			return true;
+		}
+
+		bool parseDDS(const uint8* data, size_t size, CompressedImage& out) {
+			if (size < 128) return false;
+			const uint8* header = data + 4;
+			const uint32 flags = read32(header + 4), height = read32(header + 8), width = read32(header + 12);
+			const uint32 mipCount = (flags & 0x20000) ? std::max(read32(header + 24), 1u) : 1;
+			const uint32 pixelFormatFlags = read32(header + 76), code = read32(header + 80);
+			const uint32 caps2 = read32(header + 108);
+			if (!(pixelFormatFlags & 0x4)) {
+				Log.error("DDS: only block compressed images are supported.");
+				return false;
+			}
+			if (caps2 & 0x200) {
+				Log.error("DDS: cube maps aren't supported.");
+				return false;
+			}
+			if (width == 0 || height == 0 || mipCount > intern::mipLevels(width, height)) {
+				Log.error("DDS: the size or mip count is invalid.");
+				return false;
+			}
+
+			size_t offset = 128;
+			switch (code) {
+				case fourCC('D', 'X', 'T', '1'): out.format = TextureFormat::BC1; break;
+				case fourCC('D', 'X', 'T', '3'): out.format = TextureFormat::BC2; break;
+				case fourCC('D', 'X', 'T', '5'): out.format = TextureFormat::BC3; break;
+				case fourCC('A', 'T', 'I', '1'): case fourCC('B', 'C', '4', 'U'): out.format = TextureFormat::BC4; break;
+				case fourCC('A', 'T', 'I', '2'): case fourCC('B', 'C', '5', 'U'): out.format = TextureFormat::BC5; break;
+				case fourCC('D', 'X', '1', '0'): {
+					if (size < 148) return false;
+					const uint32 dxgi = read32(data + 128), dimension = read32(data + 132), arraySize = read32(data + 140);
+					offset = 148;
+					if (dimension != 3 || arraySize > 1) {
+						Log.error("DDS: only single 2D textures are supported.");
+						return false;
+					}
+					switch (dxgi) {
+						case 70: case 71: case 72: out.format = TextureFormat::BC1; break;
+						case 73: case 74: case 75: out.format = TextureFormat::BC2; break;
+						case 76: case 77: case 78: out.format = TextureFormat::BC3; break;
+						case 79: case 80: out.format = TextureFormat::BC4; break;
+						case 82: case 83: out.format = TextureFormat::BC5; break;
+						case 94: case 95: out.format = TextureFormat::BC6H; break;
+						case 97: case 98: case 99: out.format = TextureFormat::BC7; break;
+						default:
+							Log.error("DDS: unsupported DXGI format " + std::to_string(dxgi) + ".");
+							return false;
+					}
+					break;
+				}
+				default:
+					Log.error("DDS: unsupported FourCC.");
+					return false;
+			}
+
+			if (!packedLevels(out, width, height, mipCount, data + offset, size - offset)) {
+				Log.error("DDS: file is truncated.");
+				return false;
+			}
+			return true;
+		}
+
+		bool parseKTX2(const uint8* data, size_t size, CompressedImage& out) {
+			if (size < 80) return false;
+			const uint32 vkFormat = read32(data + 12), width = read32(data + 20), height = read32(data + 24);
+			const uint32 depth = read32(data + 28), layers = read32(data + 32), faces = read32(data + 36);
+			const uint32 levelCount = std::max(read32(data + 40), 1u), supercompression = read32(data + 44);
+			if (depth > 0 || layers > 1 || faces != 1) {
+				Log.error("KTX2: only single 2D textures are supported.");
+				return false;
+			}
+			if (supercompression != 0) {
+				Log.error("KTX2: supercompressed (BasisLZ, Zstandard, ...) files aren't supported.");
+				return false;
+			}
+			if (width == 0 || height == 0 || levelCount > intern::mipLevels(width, height)) {
+				Log.error("KTX2: the size or level count is invalid.");
+				return false;
+			}
+
+			switch (vkFormat) {
+				case 131: case 132: case 133: case 134: out.format = TextureFormat::BC1; break;
+				case 135: case 136: out.format = TextureFormat::BC2; break;
+				case 137: case 138: out.format = TextureFormat::BC3; break;
+				case 139: out.format = TextureFormat::BC4; break;
+				case 141: out.format = TextureFormat::BC5; break;
+				case 143: out.format = TextureFormat::BC6H; break;
+				case 145: case 146: out.format = TextureFormat::BC7; break;
+				default:
+					Log.error("KTX2: unsupported vkFormat " + std::to_string(vkFormat) + ".");
+					return false;
+			}
+			if (80 + size_t(levelCount) * 24 > size) return false;
+
+			// Levels may lie anywhere in the file, they're packed into out.data in level order.
+			for (uint32 i = 0; i < levelCount; i++) {
+				const uint8* entry = data + 80 + size_t(i) * 24;
+				const uint64 offset = read64(entry), length = read64(entry + 8);
+				const uint32 w = std::max(width >> i, 1u), h = std::max(height >> i, 1u);
+				if (offset > size || length > size - offset || length < bc::imageSize(out.format, w, h)) {
+					Log.error("KTX2: level " + std::to_string(i) + " is out of bounds.");
+					return false;
+				}
+				const size_t bytes = bc::imageSize(out.format, w, h);
+				out.levels.push_back({ w, h, out.data.size(), bytes });
+				out.data.insert(out.data.end(), data + offset, data + offset + bytes);
+			}
+			return true;
+		}
+	}
+
+	namespace bc {
+		bool compressed(TextureFormat format) {
+			return blockBytes(format) != 0;
+		}
+
+		uint32 blockBytes(TextureFormat format) {
+			switch (format) {
+				case TextureFormat::BC1: case TextureFormat::BC4: return 8;
+				case TextureFormat::BC2: case TextureFormat::BC3: case TextureFormat::BC5:
+				case TextureFormat::BC6H: case TextureFormat::BC7: return 16;
+				default: return 0;
+			}
+		}
+
+		size_t imageSize(TextureFormat format, uint32 width, uint32 height) {
+			return size_t((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+		}
+
+		void encodeBC1(const uint8 rgba[64], uint8 out[8]) {
+			float p[16][3];
+			for (uint32 i = 0; i < 16; i++) {
+				for (uint32 c = 0; c < 3; c++) p[i][c] = float(rgba[i * 4 + c]);
+			}
+
+			float lo[3], hi[3];
+			fitEndpoints<3>(p, 16, lo, hi);
+			uint16 c0 = to565(hi), c1 = to565(lo);
+			uint32 indices;
+			float error = bc1Indices(p, c0, c1, indices);
+
+			// Refit the endpoints to the chosen indices while it keeps helping.
+			static constexpr float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+			for (uint32 iteration = 0; iteration < 2 && error > 0.0f; iteration++) {
+				float w[16], a[3], b[3];
+				for (uint32 i = 0; i < 16; i++) w[i] = weights[indices >> (i * 2) & 3];
+				if (!leastSquares<3>(p, w, 16, a, b)) break;
+
+				const uint16 n0 = to565(a), n1 = to565(b);
+				uint32 refined;
+				const float refinedError = bc1Indices(p, n0, n1, refined);
+				if (refinedError >= error) break;
+				c0 = n0;
+				c1 = n1;
+				indices = refined;
+				error = refinedError;
+			}
+
+			// c0 > c1 selects the four colour mode, swapping the endpoints swaps indices 0/1 and 2/3.
+			if (c0 < c1) {
+				std::swap(c0, c1);
+				indices ^= 0x55555555u;
+			} else if (c0 == c1) {
+				indices = 0;
+			}
+			std::memcpy(out, &c0, 2);
+			std::memcpy(out + 2, &c1, 2);
+			std::memcpy(out + 4, &indices, 4);
+		}
+
+		void encodeBC4(const uint8 values[16], uint8 out[8]) {
+			const uint8 lo = *std::min_element(values, values + 16), hi = *std::max_element(values, values + 16);
+			out[0] = hi;
+			out[1] = lo;
+
+			// Eight value mode: index 0 is hi, 1 is lo, 2 to 7 step from hi towards lo.
+			uint64 bits = 0;
+			if (hi > lo) {
+				const float scale = 7.0f / float(hi - lo);
+				for (uint32 i = 0; i < 16; i++) {
+					const uint32 k = uint32(float(values[i] - lo) * scale + 0.5f);
+					const uint64 index = k == 7 ? 0 : k == 0 ? 1 : 8 - k;
+					bits |= index << (i * 3);
+				}
+			}
+			for (uint32 i = 0; i < 6; i++) out[2 + i] = uint8(bits >> (i * 8));
+		}
+
+		void encodeBC3(const uint8 rgba[64], uint8 out[16]) {
+			uint8 alpha[16];
+			for (uint32 i = 0; i < 16; i++) alpha[i] = rgba[i * 4 + 3];
+			encodeBC4(alpha, out);
+			encodeBC1(rgba, out + 8);
+		}
+
+		void encodeBC5(const uint8 rgba[64], uint8 out[16]) {
+			uint8 red[16], green[16];
+			for (uint32 i = 0; i < 16; i++) {
+				red[i] = rgba[i * 4];
+				green[i] = rgba[i * 4 + 1];
+			}
+			encodeBC4(red, out);
+			encodeBC4(green, out + 8);
+		}
+
+		void encodeBC7(const uint8 rgba[64], uint8 out[16]) {
+			float p[16][4];
+			for (uint32 i = 0; i < 16; i++) {
+				for (uint32 c = 0; c < 4; c++) p[i][c] = float(rgba[i * 4 + c]);
+			}
+
+			float lo[4], hi[4];
+			fitEndpoints<4>(p, 16, lo, hi);
+			Bc7Fit best;
+			bc7BestPbits(p, lo, hi, best);
+
+			for (uint32 iteration = 0; iteration < 2 && best.error > 0.0f; iteration++) {
+				float w[16], a[4], b[4];
+				for (uint32 i = 0; i < 16; i++) w[i] = 1.0f - float(Bc7Weights[best.indices[i]]) / 64.0f;
+				if (!leastSquares<4>(p, w, 16, a, b)) break;
+
+				Bc7Fit refined;
+				bc7BestPbits(p, a, b, refined);
+				if (refined.error >= best.error) break;
+				best = refined;
+			}
+
+			// The first texel's index has an implicit 0 top bit, swapping the endpoints inverts the indices.
+			if (best.indices[0] >= 8) {
+				for (uint32 c = 0; c < 4; c++) std::swap(best.q[0][c], best.q[1][c]);
+				std::swap(best.pbit[0], best.pbit[1]);
+				for (uint8& index : best.indices) index = uint8(15 - index);
+			}
+
+			std::memset(out, 0, 16);
+			BlockWriter writer{ out };
+			writer.put(1u << 6, 7);
+			for (uint32 c = 0; c < 4; c++) {
+				writer.put(best.q[0][c], 7);
+				writer.put(best.q[1][c], 7);
+			}
+			writer.put(best.pbit[0], 1);
+			writer.put(best.pbit[1], 1);
+			writer.put(best.indices[0], 3);
+			for (uint32 i = 1; i < 16; i++) writer.put(best.indices[i], 4);
+		}
+
+		namespace {
+			using BlockEncoder = void (*)(const uint8*, uint8*);
+
+			BlockEncoder encoderFor(TextureFormat format) {
+				switch (format) {
+					case TextureFormat::BC1: return [](const uint8* in, uint8* o) { encodeBC1(in, o); };
+					case TextureFormat::BC3: return [](const uint8* in, uint8* o) { encodeBC3(in, o); };
+					case TextureFormat::BC5: return [](const uint8* in, uint8* o) { encodeBC5(in, o); };
+					case TextureFormat::BC7: return [](const uint8* in, uint8* o) { encodeBC7(in, o); };
+					case TextureFormat::BC4:
+						return [](const uint8* in, uint8* o) {
+							uint8 red[16];
+							for (uint32 i = 0; i < 16; i++) red[i] = in[i * 4];
+							encodeBC4(red, o);
+						};
+					default:
+						Log.error("There's no encoder for this format.");
+						return nullptr;
+				}
+			}
+
+			/// Appends the blocks of one w x h level to out.
+			void encodeLevel(const uint8* pixels, uint32 w, uint32 h, BlockEncoder encode, CompressedImage& out) {
+				const uint32 bytes = blockBytes(out.format);
+				const uint32 bx = (w + 3) / 4, by = (h + 3) / 4;
+				const size_t offset = out.data.size();
+				out.data.resize(offset + size_t(bx) * by * bytes);
+				uint8* dst = out.data.data() + offset;
+
+				util::parallelFor(by, util::parallelRanges(by, 4), [&](size_t begin, size_t end, size_t) {
+					uint8 block[64];
+					for (size_t y = begin; y < end; y++) {
+						for (uint32 x = 0; x < bx; x++) {
+							// Edge blocks repeat the last row and column.
+							for (uint32 i = 0; i < 16; i++) {
+								const uint32 sx = std::min(x * 4 + i % 4, w - 1), sy = std::min(uint32(y) * 4 + i / 4, h - 1);
+								std::memcpy(block + i * 4, pixels + (size_t(sy) * w + sx) * 4, 4);
+							}
+							encode(block, dst + (y * bx + x) * bytes);
+						}
+					}
+				});
+				out.levels.push_back({ w, h, offset, size_t(bx) * by * bytes });
+			}
+		}
+
+		bool compress(
+			const uint8* rgba, uint32 width, uint32 height, TextureFormat format, bool mipmaps, CompressedImage& out
+		) {
+			const BlockEncoder encode = encoderFor(format);
+			if (!encode) return false;
+
+			out.format = format;
+			out.levels.clear();
+			out.data.clear();
+
+			std::vector<uint8> level, next;
+			const uint8* pixels = rgba;
+			uint32 w = width, h = height;
+			for (;;) {
+				encodeLevel(pixels, w, h, encode, out);
+				if (!mipmaps || (w == 1 && h == 1)) break;
+
+				const uint32 nw = std::max(w / 2, 1u), nh = std::max(h / 2, 1u);
+				next.resize(size_t(nw) * nh * 4);
+				for (uint32 y = 0; y < nh; y++) {
+					const uint32 y0 = std::min(y * 2, h - 1), y1 = std::min(y * 2 + 1, h - 1);
+					for (uint32 x = 0; x < nw; x++) {
+						const uint32 x0 = std::min(x * 2, w - 1), x1 = std::min(x * 2 + 1, w - 1);
+						for (uint32 c = 0; c < 4; c++) {
+							const uint32 sum =
+								pixels[(size_t(y0) * w + x0) * 4 + c] + pixels[(size_t(y0) * w + x1) * 4 + c] +
+								pixels[(size_t(y1) * w + x0) * 4 + c] + pixels[(size_t(y1) * w + x1) * 4 + c];
+							next[(size_t(y) * nw + x) * 4 + c] = uint8((sum + 2) / 4);
+						}
+					}
+				}
+				level.swap(next);
+				pixels = level.data();
+				w = nw;
+				h = nh;
+			}
+			return true;
+		}
+
+		bool compress(const MipChain& chain, TextureFormat format, CompressedImage& out) {
+			const BlockEncoder encode = encoderFor(format);
+			if (!encode) return false;
+
+			out.format = format;
+			out.levels.clear();
+			out.data.clear();
+			for (uint32 l = 0; l < chain.levels.size(); l++) {
+				encodeLevel(chain.level(l), chain.levels[l].width, chain.levels[l].height, encode, out);
+			}
+			return true;
+		}
+
+		bool flipVertically(CompressedImage& image) {
+			if (image.format == TextureFormat::BC6H || image.format == TextureFormat::BC7) return false;
+			for (const auto& level : image.levels) {
+				if (level.height > 4 && level.height % 4 != 0) return false;
+			}
+
+			const uint32 bytes = blockBytes(image.format);
+			std::vector<uint8> row;
+			for (const auto& level : image.levels) {
+				uint8* data = image.data.data() + level.offset;
+				const uint32 bx = (level.width + 3) / 4, by = (level.height + 3) / 4;
+				const size_t rowBytes = size_t(bx) * bytes;
+				for (uint32 y = 0; y < by / 2; y++) {
+					std::swap_ranges(data + y * rowBytes, data + (y + 1) * rowBytes, data + (by - 1 - y) * rowBytes);
+				}
+				const uint32 rows = std::min(level.height, 4u);
+				for (size_t b = 0; b < size_t(bx) * by; b++) flipBlock(data + b * bytes, image.format, rows);
+			}
+			return true;
+		}
+	}
+
+	bool isCompressedContainer(const uint8* data, size_t size) {
+		return (size >= 4 && read32(data) == DdsMagic) || (size >= 12 && std::memcmp(data, Ktx2Identifier, 12) == 0);
+	}
+
+	bool parseCompressedContainer(const uint8* data, size_t size, CompressedImage& out) {
+		out.levels.clear();
+		out.data.clear();
+		if (size >= 4 && read32(data) == DdsMagic) return parseDDS(data, size, out);
+		if (size >= 12 && std::memcmp(data, Ktx2Identifier, 12) == 0) return parseKTX2(data, size, out);
+		return false;
+	}
+}
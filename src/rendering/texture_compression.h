@@ -0,0 +1,51 @@
+#ifndef TEXTURE_COMPRESSION_H
+#define TEXTURE_COMPRESSION_H
+
+#include "integer.hpp"
+#include "texture.h"
+#include "mipmap.h"
+
+#include <cstddef>
+
+namespace ae {
+	namespace bc {
+		/// True for the block compressed formats.
+		bool compressed(TextureFormat format);
+
+		/// Bytes per 4x4 block, 0 for uncompressed formats.
+		uint32 blockBytes(TextureFormat format);
+
+		/// Bytes of a width x height image, partial blocks at the edges count as whole ones.
+		size_t imageSize(TextureFormat format, uint32 width, uint32 height);
+
+		/// Single 4x4 block encoders, rgba holds the 16 texels row by row.
+		void encodeBC1(const uint8 rgba[64], uint8 out[8]);
+		void encodeBC3(const uint8 rgba[64], uint8 out[16]);
+		void encodeBC4(const uint8 values[16], uint8 out[8]);
+		void encodeBC5(const uint8 rgba[64], uint8 out[16]); // Red and green
+		void encodeBC7(const uint8 rgba[64], uint8 out[16]); // Mode 6 only
+
+		/// Compresses RGBA8 pixels to BC1, BC3, BC4 (red), BC5 (red and green) or BC7, spread over the cores.
+		/// With mipmaps the chain down to 1x1 is built from 2x2 averages first.
+		bool compress(
+			const uint8* rgba, uint32 width, uint32 height, TextureFormat format, bool mipmaps, CompressedImage& out
+		);
+
+		/// Compresses every level of a chain built by mip::generate().
+		bool compress(const MipChain& chain, TextureFormat format, CompressedImage& out);
+
+		/// Turns every level upside down by reordering blocks and the rows inside them. BC1 to BC5 only, and only
+		/// for heights that split into whole blocks, false otherwise.
+		bool flipVertically(CompressedImage& image);
+	}
+
+	/// Reads a 2D DDS (DXT1/3/5, ATI1/2 or a DX10 header with a BC format) or KTX2 (BC vkFormat, no
+	/// supercompression) file. sRGB variants load as their UNORM counterparts. False, with a log message, for
+	/// anything else.
+	bool parseCompressedContainer(const uint8* data, size_t size, CompressedImage& out);
+
+	/// Whether data starts like a DDS or KTX2 file.
+	bool isCompressedContainer(const uint8* data, size_t size);
+}
+
+#endif // TEXTURE_COMPRESSION_H
@@ -0,0 +1,295 @@
+#include "texture_loader.h"
+
+#include "stb_image.h"
+#include "texture_compression.h"
+#include "file_system.h"
+#include "util.hpp"
+#include "log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace ae {
+	namespace {
+		// Changes whenever mip::generate() would build different chains from the same options.
+		constexpr uint8 MipCacheVersion = 1;
+
+		/// Identifies the chain built from encoded with options, never 0.
+		uint64 mipCacheKey(const std::vector<uint8>& encoded, const MipOptions& options, bool flip) {
+			const uint8 inputs[] = {
+				MipCacheVersion, uint8(options.filter), uint8(options.srgb), uint8(options.normalMap), uint8(flip)
+			};
+			return util::hash64(encoded.data(), encoded.size(), util::hash64(inputs, sizeof(inputs))) | 1;
+		}
+
+		bool readMipCache(const std::string& path, uint64 key, bool flip, MipChain& out) {
+			FileSystem::MappedFile file(path);
+			if (!file.valid() || mip::cacheKey(file.data(), size_t(file.size())) != key) return false;
+			return mip::readKTX2(file.data(), size_t(file.size()), flip, out);
+		}
+
+		void writeMipCache(const std::string& path, uint64 key, bool flip, const MipOptions& options, const MipChain& chain) {
+			std::vector<uint8> ktx;
+			mip::writeKTX2(chain, options.srgb && !options.normalMap, flip, ktx, key);
+
+			// Replaced in one step, so a load of the same image on another worker never reads half a file.
+			if (!FileSystem::writeNative(path, ktx.data(), ktx.size())) Log.warn("Could not write mip cache " + path);
+		}
+	}
+
+	TextureLoader TextureLoader::s_instance{};
+
+	TextureLoader::~TextureLoader() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+			// Textures may outlive the loader at exit, they mustn't try to cancel with it.
+			for (auto&& [texture, ticket] : m_tickets) texture->m_ready = true;
+		}
+		m_wake.notify_all();
+		for (auto& w : m_workers) w.join();
+	}
+
+	void TextureLoader::load(
+		Texture* texture, std::vector<uint8> encoded, bool flipVertically, TextureFormat format, const std::string& mipCache
+	) {
+		cancel(texture);
+
+		// A grey texel stands in for anything that samples the texture before it's ready.
+		static const uint8 placeholder[4] = { 128, 128, 128, 255 };
+		texture->setSize(1, 1);
+		texture->bind();
+		texture->filter(TextureFilter::Linear, TextureFilter::Linear);
+		texture->setData(placeholder, TextureFormat::RGBA);
+		texture->unbind();
+		texture->m_ready = false;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_workers.empty()) {
+			// One core stays with the GL thread.
+			const uint32 count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+			for (uint32 i = 0; i < count; i++) m_workers.emplace_back([this]() { work(); });
+		}
+
+		const uint64 ticket = m_nextTicket++;
+		m_tickets[texture] = ticket;
+		m_queue.push_back({ texture, ticket, std::move(encoded), flipVertically, format, texture->mipOptions(), mipCache });
+		m_wake.notify_one();
+	}
+
+	void TextureLoader::cancel(Texture* texture) {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_tickets.erase(texture) == 0) return;
+
+		auto ofTexture = [texture](auto& item) { return item.texture == texture; };
+		m_queue.erase(std::remove_if(m_queue.begin(), m_queue.end(), ofTexture), m_queue.end());
+		m_decoded.erase(std::remove_if(m_decoded.begin(), m_decoded.end(), ofTexture), m_decoded.end());
+		m_uploading.erase(std::remove_if(m_uploading.begin(), m_uploading.end(), ofTexture), m_uploading.end());
+		texture->m_ready = true;
+		m_done.notify_all();
+	}
+
+	bool TextureLoader::current(Texture* texture, uint64 ticket) const {
+		auto pos = m_tickets.find(texture);
+		return pos != m_tickets.end() && pos->second == ticket;
+	}
+
+	void TextureLoader::work() {
+		for (;;) {
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+				if (m_stop) return;
+				job = std::move(m_queue.front());
+				m_queue.pop_front();
+				m_decoding++;
+			}
+
+			Image image{ job.texture, job.ticket, { nullptr, stbi_image_free }, 0, 0, 0 };
+			if (mip::isKTX2(job.encoded.data(), job.encoded.size())) {
+				// A chain written by mip::writeKTX2(), uploaded as it is.
+				if (mip::readKTX2(job.encoded.data(), job.encoded.size(), job.flip, image.mips)) {
+					image.width = image.mips.levels[0].width;
+					image.height = image.mips.levels[0].height;
+				}
+			} else if (isCompressedContainer(job.encoded.data(), job.encoded.size())) {
+				if (!parseCompressedContainer(job.encoded.data(), job.encoded.size(), image.compressed)) {
+					image.compressed.levels.clear();
+				} else if (job.flip && !bc::flipVertically(image.compressed)) {
+					Log.warn("This compressed image can't be flipped, it stays as it is.");
+				}
+			} else {
+				const uint64 key = job.mips.cpu && !job.mipCache.empty() ? mipCacheKey(job.encoded, job.mips, job.flip) : 0;
+				if (key != 0 && readMipCache(job.mipCache, key, job.flip, image.mips)) {
+					image.width = image.mips.levels[0].width;
+					image.height = image.mips.levels[0].height;
+				} else {
+					int w = 0, h = 0, comp = 0;
+					image.pixels.reset(
+						stbi_load_from_memory(job.encoded.data(), int(job.encoded.size()), &w, &h, &comp, STBI_rgb_alpha)
+					);
+					image.width = uint32(w);
+					image.height = uint32(h);
+					if (image.pixels && job.flip) intern::flipRows(image.pixels.get(), image.width * 4, image.height);
+					if (image.pixels && job.mips.cpu) {
+						mip::generate(image.pixels.get(), image.width, image.height, job.mips, image.mips);
+						if (key != 0) writeMipCache(job.mipCache, key, job.flip, job.mips, image.mips);
+					}
+				}
+
+				// Compressed with the mips it won't get from glGenerateMipmap.
+				if ((image.pixels || !image.mips.levels.empty()) && bc::compressed(job.format)) {
+					const bool compressed = image.mips.levels.empty()
+						? bc::compress(image.pixels.get(), image.width, image.height, job.format, true, image.compressed)
+						: bc::compress(image.mips, job.format, image.compressed);
+					if (!compressed) image.compressed.levels.clear();
+					image.mips = MipChain();
+				}
+				if (!image.compressed.levels.empty() || !image.mips.levels.empty()) image.pixels.reset();
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_decoding--;
+			if (current(job.texture, job.ticket)) m_decoded.push_back(std::move(image));
+			m_done.notify_all();
+		}
+	}
+
+	void TextureLoader::update() {
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (auto& image : m_decoded) m_uploading.push_back(std::move(image));
+			m_decoded.clear();
+		}
+
+		bool staged = false;
+		uint32 used = 0;
+		while (!m_uploading.empty()) {
+			Image& image = m_uploading.front();
+			if (!image.failed()) {
+				// A region always fits at least a row or level, however small the budget.
+				const uint32 unit = image.compressed.levels.empty() ? image.width * 4 : uint32(image.compressed.levels[0].size);
+				const uint32 limit = std::max(m_budget, unit);
+				if (!staged) {
+					if (m_staging.regionSize() < limit) m_staging.create(limit, 4);
+					m_staging.begin();
+					staged = true;
+				}
+				const uint32 available = std::min(limit, m_staging.regionSize());
+				if (used >= available) break;
+				used += upload(image, used, available - used);
+				if (!image.done) break;
+			} else {
+				Log.warn("A texture failed to decode, it keeps its placeholder.");
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tickets.erase(image.texture);
+			image.texture->m_ready = true;
+			m_uploading.pop_front();
+			m_done.notify_all();
+		}
+	}
+
+	uint32 TextureLoader::upload(Image& image, uint32 offset, uint32 maxBytes) {
+		Texture* texture = image.texture;
+		uint32 used = 0;
+		texture->bind();
+
+		if (!image.compressed.levels.empty()) {
+			// Compressed images go a whole level at a time, smaller levels follow into the rest of the region.
+			const CompressedImage& compressed = image.compressed;
+			const GLenum ifmt = GLenum(std::get<0>(intern::getTextureFormat(compressed.format)));
+			if (image.level == 0 && compressed.levels[0].size <= maxBytes) {
+				texture->setSize(compressed.levels[0].width, compressed.levels[0].height);
+				texture->storage(compressed.format, uint32(compressed.levels.size()));
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging.id());
+			while (!image.done && compressed.levels[image.level].size <= maxBytes - used) {
+				const auto& level = compressed.levels[image.level];
+				std::memcpy(m_staging.data() + offset + used, compressed.data.data() + level.offset, level.size);
+				glCompressedTexSubImage2D(
+					GL_TEXTURE_2D, GLint(image.level), 0, 0, GLsizei(level.width), GLsizei(level.height), ifmt,
+					GLsizei(level.size), (const void*) uintptr_t(m_staging.offset() + offset + used)
+				);
+				used += uint32(level.size);
+				image.done = ++image.level == compressed.levels.size();
+			}
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+			if (image.done) {
+				texture->filter(
+					compressed.levels.size() > 1 ? TextureFilter::LinearMipLinear : TextureFilter::Linear, TextureFilter::Linear
+				);
+				texture->wrap(TextureWrap::Repeat, TextureWrap::Repeat);
+			}
+			texture->unbind();
+			return used;
+		}
+
+		// Row bands, level after level for CPU built chains. Only level 0 comes from pixels otherwise.
+		const MipChain& chain = image.mips;
+		const uint32 levels = chain.levels.empty() ? 1 : uint32(chain.levels.size());
+		while (!image.done) {
+			const uint32 width = chain.levels.empty() ? image.width : chain.levels[image.level].width;
+			const uint32 height = chain.levels.empty() ? image.height : chain.levels[image.level].height;
+			const uint8* pixels = chain.levels.empty() ? image.pixels.get() : chain.level(image.level);
+			const uint32 rowBytes = width * 4;
+			const uint32 rows = std::min(height - image.row, (maxBytes - used) / rowBytes);
+			if (rows == 0) break;
+
+			if (image.row == 0 && image.level == 0) {
+				// The whole chain is allocated up front, mips aren't sampled until the last rows are in.
+				texture->setSize(image.width, image.height);
+				texture->filter(TextureFilter::Linear, TextureFilter::Linear);
+				texture->storage(TextureFormat::RGBA, chain.levels.empty() ? intern::mipLevels(image.width, image.height) : levels);
+			}
+
+			std::memcpy(m_staging.data() + offset + used, pixels + size_t(image.row) * rowBytes, size_t(rows) * rowBytes);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_staging.id());
+			glTexSubImage2D(
+				GL_TEXTURE_2D, GLint(image.level), 0, GLint(image.row), GLsizei(width), GLsizei(rows), GL_RGBA,
+				GL_UNSIGNED_BYTE, (const void*) uintptr_t(m_staging.offset() + offset + used)
+			);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			used += rows * rowBytes;
+			image.row += rows;
+
+			if (image.row == height) {
+				image.row = 0;
+				image.done = ++image.level == levels;
+			}
+		}
+
+		if (image.done) {
+			texture->filter(TextureFilter::LinearMipLinear, TextureFilter::Linear);
+			texture->wrap(TextureWrap::Repeat, TextureWrap::Repeat);
+			if (chain.levels.empty()) {
+				glGenerateMipmap(GL_TEXTURE_2D);
+			} else if (texture->m_mipOptions.keep) {
+				texture->m_mipChain = std::make_unique<MipChain>(std::move(image.mips));
+			}
+		}
+		texture->unbind();
+		return used;
+	}
+
+	void TextureLoader::finish() {
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_done.wait(lock, [this]() {
+					return !m_decoded.empty() || !m_uploading.empty() || (m_queue.empty() && m_decoding == 0);
+				});
+				if (m_decoded.empty() && m_uploading.empty()) return;
+			}
+			update();
+		}
+	}
+
+	uint32 TextureLoader::pending() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return uint32(m_queue.size() + m_decoding + m_decoded.size() + m_uploading.size());
+	}
+}
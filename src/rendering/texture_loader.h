@@ -0,0 +1,102 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include "integer.hpp"
+#include "texture.h"
+#include "stream_buffer.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace ae {
+	/// Decodes image files on worker threads and uploads them on the GL thread through a ring of pixel buffer
+	/// objects, at most budget() bytes per update(). Until then the textures hold a 1x1 placeholder and report
+	/// ready() false, the renderer leaves them out of their materials.
+	class TextureLoader {
+	public:
+		~TextureLoader();
+
+		/// Queues encoded (PNG, JPEG, ...) for decoding into texture. GL thread only, like everything but decoding.
+		/// DDS and KTX2 files keep their own block format and mips, other images are compressed to format on the
+		/// worker unless it is TextureFormat::RGBA. With a native mipCache path, CPU built mip chains are read from
+		/// that KTX2 file when it was made from the same image and MipOptions, and written to it otherwise.
+		void load(
+			Texture* texture, std::vector<uint8> encoded, bool flipVertically = true,
+			TextureFormat format = TextureFormat::RGBA, const std::string& mipCache = ""
+		);
+
+		/// Drops the pending load of texture, if there is one.
+		void cancel(Texture* texture);
+
+		/// Uploads decoded images, large ones spread over several calls. Once per frame, Renderer::render() does.
+		void update();
+
+		/// Blocks until everything queued is decoded and uploaded, regardless of the budget.
+		void finish();
+
+		/// Loads in flight, queued, decoding or uploading.
+		uint32 pending();
+
+		/// Bytes copied into the pixel buffers per update().
+		uint32 budget() const { return m_budget; }
+		void budget(uint32 bytes) { m_budget = bytes; }
+
+		static TextureLoader& ston() { return s_instance; }
+
+	private:
+		struct Job {
+			Texture* texture;
+			uint64 ticket;
+			std::vector<uint8> encoded;
+			bool flip;
+			TextureFormat format;
+			MipOptions mips; // The texture's, as of load()
+			std::string mipCache;
+		};
+
+		struct Image {
+			Texture* texture;
+			uint64 ticket;
+			std::unique_ptr<uint8, void (*)(void*)> pixels{ nullptr, nullptr }; // RGBA8, nullptr if decoding failed
+			uint32 width, height, row; // Of level 0, row: how far the upload of level got
+			uint32 level{ 0 };
+			bool done{ false };
+			CompressedImage compressed{};
+			MipChain mips{}; // CPU built, level 0 included. pixels is freed then
+
+			bool failed() const { return !pixels && compressed.levels.empty() && mips.levels.empty(); }
+		};
+
+		std::mutex m_mutex;
+		std::condition_variable m_wake, m_done;
+		std::vector<std::thread> m_workers;
+		std::deque<Job> m_queue;
+		std::deque<Image> m_decoded;
+		std::deque<Image> m_uploading; // Taken from m_decoded by update()
+		std::unordered_map<Texture*, uint64> m_tickets; // The load each texture waits for
+		uint64 m_nextTicket{ 1 };
+		uint32 m_decoding{ 0 }, m_budget{ 4u << 20 };
+		bool m_stop{ false };
+
+		StreamBuffer m_staging{};
+
+		void work();
+
+		/// Whether ticket is still the load texture waits for. Caller holds m_mutex.
+		bool current(Texture* texture, uint64 ticket) const;
+
+		/// Uploads as many rows (or levels) of image as fit into maxBytes of the staging region from offset.
+		/// Returns the bytes used.
+		uint32 upload(Image& image, uint32 offset, uint32 maxBytes);
+
+		static TextureLoader s_instance;
+	};
+}
+
+#endif // TEXTURE_LOADER_H
@@ -0,0 +1,494 @@
+#include "vertex.h"
+
+#include "simd.h"
+
+#include <cstring>
+
+#if defined(AE_X86)
+#	if defined(_MSC_VER)
+#		include <intrin.h>
+#	else
+#		include <immintrin.h>
+#	endif
+#endif
+
+namespace ae {
+	namespace packing {
+		uint16 toHalf(float v) {
+			uint32 x;
+			std::memcpy(&x, &v, sizeof(x));
+			const uint32 sign = x & 0x80000000u;
+			x ^= sign;
+
+			uint16 o;
+			if (x >= 0x47800000u) { // Too large for a half, or inf/NaN
+				o = x > 0x7F800000u ? 0x7E00 : 0x7C00;
+			} else if (x < 0x38800000u) { // Subnormal half, adding 0.5 lets the FPU do the rounding
+				float f;
+				std::memcpy(&f, &x, sizeof(f));
+				f += 0.5f;
+				std::memcpy(&x, &f, sizeof(x));
+				o = uint16(x - 0x3F000000u);
+			} else {
+				const uint32 mantOdd = (x >> 13) & 1;
+				x += (uint32(15 - 127) << 23) + 0xFFF + mantOdd;
+				o = uint16(x >> 13);
+			}
+			return o | uint16(sign >> 16);
+		}
+
+		float fromHalf(uint16 v) {
+			const uint32 shiftedExp = 0x7C00u << 13;
+			uint32 o = uint32(v & 0x7FFF) << 13;
+			const uint32 exp = o & shiftedExp;
+			o += uint32(127 - 15) << 23;
+
+			if (exp == shiftedExp) { // inf/NaN
+				o += uint32(128 - 16) << 23;
+			} else if (exp == 0) { // Zero/subnormal, renormalize
+				o += 1u << 23;
+				float f;
+				std::memcpy(&f, &o, sizeof(f));
+				f -= 6.103515625e-05f; // 2^-14
+				std::memcpy(&o, &f, sizeof(o));
+			}
+			o |= uint32(v & 0x8000) << 16;
+
+			float ret;
+			std::memcpy(&ret, &o, sizeof(ret));
+			return ret;
+		}
+
+		void octEncode(const Vector3& n, int16 out[2]) {
+			const float l1 = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+			const float inv = l1 > 0.0f ? 1.0f / l1 : 0.0f;
+			float x = n.x * inv, y = n.y * inv;
+			if (n.z < 0.0f) {
+				const float fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+				const float fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+				x = fx;
+				y = fy;
+			}
+			out[0] = int16(std::lrint(std::clamp(x, -1.0f, 1.0f) * 32767.0f));
+			out[1] = int16(std::lrint(std::clamp(y, -1.0f, 1.0f) * 32767.0f));
+		}
+
+		Vector3 octDecode(const int16 in[2]) {
+			Vector3 n(std::max(in[0] / 32767.0f, -1.0f), std::max(in[1] / 32767.0f, -1.0f), 0.0f);
+			n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+			const float t = std::max(-n.z, 0.0f);
+			n.x += n.x >= 0.0f ? -t : t;
+			n.y += n.y >= 0.0f ? -t : t;
+			return n.normalized();
+		}
+
+		SkinVertex packSkin(const uint32* joints, const float* weights, uint32 count) {
+			uint32 order[4]{}, kept = 0;
+			for (uint32 i = 0; i < count; i++) {
+				if (!(weights[i] > 0.0f)) continue;
+
+				// Insertion into the four largest so far.
+				uint32 k = std::min(kept, 3u);
+				if (kept == 4 && weights[i] <= weights[order[3]]) continue;
+				while (k > 0 && weights[order[k - 1]] < weights[i]) {
+					order[k] = order[k - 1];
+					k--;
+				}
+				order[k] = i;
+				kept = std::min(kept + 1, 4u);
+			}
+
+			SkinVertex ret{};
+			float total = 0.0f;
+			for (uint32 k = 0; k < kept; k++) total += weights[order[k]];
+			if (kept == 0) {
+				ret.weights[0] = 255;
+				return ret;
+			}
+
+			// Rounding down, then the remainder goes to the largest fractions.
+			float fraction[4]{};
+			uint32 sum = 0;
+			for (uint32 k = 0; k < kept; k++) {
+				const float w = weights[order[k]] / total * 255.0f;
+				ret.joints[k] = uint8(joints[order[k]]);
+				ret.weights[k] = uint8(w);
+				fraction[k] = w - float(ret.weights[k]);
+				sum += ret.weights[k];
+			}
+			for (; sum < 255; sum++) {
+				uint32 best = 0;
+				for (uint32 k = 1; k < kept; k++) {
+					if (fraction[k] > fraction[best]) best = k;
+				}
+				ret.weights[best]++;
+				fraction[best] -= 1.0f;
+			}
+			return ret;
+		}
+	}
+
+	namespace {
+		// Every PackedVertex field pair is one 32 bit word, the kernels below build/split those words.
+		constexpr size_t WordsPerVertex = sizeof(PackedVertex) / sizeof(uint32);
+		static_assert(sizeof(PackedVertex) == 20, "PackedVertex must stay tightly packed");
+		static_assert(sizeof(Vertex) == 11 * sizeof(float), "Vertex must stay tightly packed");
+
+		struct Quantizer {
+			Vector3 min, scale, invScale;
+
+			explicit Quantizer(const AABB& bounds) : min(bounds.min) {
+				const Vector3 size = bounds.size();
+				scale = Vector3(
+					size.x > 0.0f ? 65535.0f / size.x : 0.0f,
+					size.y > 0.0f ? 65535.0f / size.y : 0.0f,
+					size.z > 0.0f ? 65535.0f / size.z : 0.0f
+				);
+				invScale = size / 65535.0f;
+			}
+		};
+
+		inline uint16 quantizeUnorm16(float v) {
+			return uint16(std::lrint(std::clamp(v, 0.0f, 65535.0f)));
+		}
+
+		void packVerticesScalar(const Vertex* in, PackedVertex* out, size_t count, const Quantizer& q, const float* signs) {
+			for (size_t i = 0; i < count; i++) {
+				const Vertex& v = in[i];
+				PackedVertex& p = out[i];
+				p.position[0] = quantizeUnorm16((v.position.x - q.min.x) * q.scale.x);
+				p.position[1] = quantizeUnorm16((v.position.y - q.min.y) * q.scale.y);
+				p.position[2] = quantizeUnorm16((v.position.z - q.min.z) * q.scale.z);
+				p.position[3] = !signs || signs[i] >= 0.0f ? 0xFFFF : 0;
+				packing::octEncode(v.normal, p.normal);
+				packing::octEncode(v.tangent, p.tangent);
+				p.texCoord[0] = packing::toHalf(v.texCoord.x);
+				p.texCoord[1] = packing::toHalf(v.texCoord.y);
+			}
+		}
+
+		void unpackVerticesScalar(const PackedVertex* in, Vertex* out, size_t count, const Quantizer& q) {
+			for (size_t i = 0; i < count; i++) {
+				const PackedVertex& p = in[i];
+				Vertex& v = out[i];
+				v.position = Vector3(p.position[0], p.position[1], p.position[2]) * q.invScale + q.min;
+				v.normal = packing::octDecode(p.normal);
+				v.tangent = packing::octDecode(p.tangent);
+				v.texCoord = Vector2(packing::fromHalf(p.texCoord[0]), packing::fromHalf(p.texCoord[1]));
+			}
+		}
+
+#if defined(AE_X86)
+		// SSE2, 4 vertices per iteration.
+		// Fields are loaded column-wise from the AoS input, the packed words are written back per vertex.
+		AE_TARGET("sse2") inline __m128i octEncode_SSE2(__m128 x, __m128 y, __m128 z) {
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+			const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f), zero = _mm_setzero_ps();
+
+			const __m128 l1 = _mm_add_ps(_mm_add_ps(_mm_and_ps(x, absMask), _mm_and_ps(y, absMask)), _mm_and_ps(z, absMask));
+			const __m128 inv = _mm_and_ps(_mm_div_ps(one, l1), _mm_cmpgt_ps(l1, zero));
+			__m128 ox = _mm_mul_ps(x, inv), oy = _mm_mul_ps(y, inv);
+
+			const __m128 xPos = _mm_cmpge_ps(ox, zero), yPos = _mm_cmpge_ps(oy, zero);
+			const __m128 sx = _mm_or_ps(_mm_and_ps(xPos, one), _mm_andnot_ps(xPos, minusOne));
+			const __m128 sy = _mm_or_ps(_mm_and_ps(yPos, one), _mm_andnot_ps(yPos, minusOne));
+			const __m128 fx = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(oy, absMask)), sx);
+			const __m128 fy = _mm_mul_ps(_mm_sub_ps(one, _mm_and_ps(ox, absMask)), sy);
+
+			const __m128 negZ = _mm_cmplt_ps(z, zero);
+			ox = _mm_or_ps(_mm_and_ps(negZ, fx), _mm_andnot_ps(negZ, ox));
+			oy = _mm_or_ps(_mm_and_ps(negZ, fy), _mm_andnot_ps(negZ, oy));
+
+			const __m128 s = _mm_set1_ps(32767.0f);
+			const __m128i qx = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(ox, minusOne), one), s));
+			const __m128i qy = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(oy, minusOne), one), s));
+			return _mm_or_si128(_mm_and_si128(qx, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(qy, 16));
+		}
+
+		AE_TARGET("sse2") inline __m128 octDecode_SSE2(__m128i word, __m128& y, __m128& z) {
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+			const __m128 one = _mm_set1_ps(1.0f), minusOne = _mm_set1_ps(-1.0f), zero = _mm_setzero_ps();
+			const __m128 s = _mm_set1_ps(1.0f / 32767.0f);
+
+			__m128 x = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(word, 16), 16)), s), minusOne);
+			y = _mm_max_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(word, 16)), s), minusOne);
+			z = _mm_sub_ps(_mm_sub_ps(one, _mm_and_ps(x, absMask)), _mm_and_ps(y, absMask));
+
+			const __m128 t = _mm_max_ps(_mm_sub_ps(zero, z), zero);
+			const __m128 xPos = _mm_cmpge_ps(x, zero), yPos = _mm_cmpge_ps(y, zero);
+			x = _mm_add_ps(x, _mm_or_ps(_mm_and_ps(xPos, _mm_sub_ps(zero, t)), _mm_andnot_ps(xPos, t)));
+			y = _mm_add_ps(y, _mm_or_ps(_mm_and_ps(yPos, _mm_sub_ps(zero, t)), _mm_andnot_ps(yPos, t)));
+
+			const __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+			y = _mm_div_ps(y, len);
+			z = _mm_div_ps(z, len);
+			return _mm_div_ps(x, len);
+		}
+
+		// Half conversions without F16C (F. Giesen), round-to-nearest-even like packing::toHalf.
+		AE_TARGET("sse2") inline __m128i toHalf_SSE2(__m128 f) {
+			const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(int32(0x80000000u)));
+			const __m128i subnormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+
+			const __m128 justSign = _mm_and_ps(signMask, f);
+			const __m128 absf = _mm_xor_ps(f, justSign);
+			const __m128i absi = _mm_castps_si128(absf);
+
+			const __m128i isRegular = _mm_cmpgt_epi32(_mm_set1_epi32((127 + 16) << 23), absi);
+			const __m128i nanBit = _mm_and_si128(_mm_castps_si128(_mm_cmpunord_ps(absf, absf)), _mm_set1_epi32(0x200));
+			const __m128i infOrNan = _mm_or_si128(nanBit, _mm_set1_epi32(0x7C00));
+
+			const __m128i isSub = _mm_cmpgt_epi32(_mm_set1_epi32((127 - 14) << 23), absi);
+			const __m128i sub = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(subnormMagic))), subnormMagic);
+
+			const __m128i mantOdd = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+			const __m128i rounded = _mm_sub_epi32(_mm_add_epi32(absi, _mm_set1_epi32(0xFFF - ((127 - 15) << 23))), mantOdd);
+			const __m128i normal = _mm_srli_epi32(rounded, 13);
+
+			const __m128i finite = _mm_or_si128(_mm_and_si128(sub, isSub), _mm_andnot_si128(isSub, normal));
+			const __m128i joined = _mm_or_si128(_mm_and_si128(finite, isRegular), _mm_andnot_si128(isRegular, infOrNan));
+			return _mm_and_si128(_mm_or_si128(joined, _mm_srli_epi32(_mm_castps_si128(justSign), 16)), _mm_set1_epi32(0xFFFF));
+		}
+
+		AE_TARGET("sse2") inline __m128 fromHalf_SSE2(__m128i h) {
+			const __m128i expMant = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+			const __m128i sign = _mm_slli_epi32(_mm_xor_si128(h, expMant), 16);
+			const __m128 scaled = _mm_mul_ps(
+				_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)),
+				_mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23))
+			);
+			const __m128i wasInfNan = _mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x7BFF));
+			const __m128 infNanExp = _mm_and_ps(_mm_castsi128_ps(wasInfNan), _mm_castsi128_ps(_mm_set1_epi32(255 << 23)));
+			return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infNanExp));
+		}
+
+		AE_TARGET("sse2") inline __m128 column_SSE2(const float* f, size_t k) {
+			return _mm_setr_ps(f[k], f[k + 11], f[k + 22], f[k + 33]);
+		}
+
+		AE_TARGET("sse2") inline __m128i word_SSE2(const PackedVertex* p, size_t k) {
+			const uint8* src = reinterpret_cast<const uint8*>(p) + k * 4;
+			uint32 w[4];
+			for (size_t j = 0; j < 4; j++) std::memcpy(&w[j], src + j * sizeof(PackedVertex), 4);
+			return _mm_setr_epi32(int32(w[0]), int32(w[1]), int32(w[2]), int32(w[3]));
+		}
+
+		AE_TARGET("sse2") void packVertices_SSE2(const Vertex* in, PackedVertex* out, size_t count, const Quantizer& q, const float* signs) {
+			const __m128 zero = _mm_setzero_ps(), maxQ = _mm_set1_ps(65535.0f);
+			const __m128i signHigh = _mm_set1_epi32(int32(0xFFFF0000u));
+			const __m128 minX = _mm_set1_ps(q.min.x), minY = _mm_set1_ps(q.min.y), minZ = _mm_set1_ps(q.min.z);
+			const __m128 sX = _mm_set1_ps(q.scale.x), sY = _mm_set1_ps(q.scale.y), sZ = _mm_set1_ps(q.scale.z);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const float* f = &in[i].position.x;
+
+				const __m128i px = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(column_SSE2(f, 0), minX), sX), zero), maxQ));
+				const __m128i py = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(column_SSE2(f, 1), minY), sY), zero), maxQ));
+				const __m128i pz = _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(column_SSE2(f, 2), minZ), sZ), zero), maxQ));
+
+				alignas(16) uint32 words[WordsPerVertex][4];
+				_mm_store_si128((__m128i*) words[0], _mm_or_si128(px, _mm_slli_epi32(py, 16)));
+				const __m128i signWord = signs ? _mm_and_si128(_mm_castps_si128(_mm_cmpge_ps(_mm_loadu_ps(signs + i), zero)), signHigh) : signHigh;
+				_mm_store_si128((__m128i*) words[1], _mm_or_si128(pz, signWord));
+
+				_mm_store_si128((__m128i*) words[2], octEncode_SSE2(column_SSE2(f, 3), column_SSE2(f, 4), column_SSE2(f, 5)));
+				_mm_store_si128((__m128i*) words[3], octEncode_SSE2(column_SSE2(f, 6), column_SSE2(f, 7), column_SSE2(f, 8)));
+				_mm_store_si128((__m128i*) words[4], _mm_or_si128(toHalf_SSE2(column_SSE2(f, 9)), _mm_slli_epi32(toHalf_SSE2(column_SSE2(f, 10)), 16)));
+
+				for (size_t j = 0; j < 4; j++) {
+					uint8* dst = reinterpret_cast<uint8*>(out + i + j);
+					for (size_t k = 0; k < WordsPerVertex; k++) std::memcpy(dst + k * 4, &words[k][j], 4);
+				}
+			}
+			packVerticesScalar(in + i, out + i, count - i, q, signs ? signs + i : nullptr);
+		}
+
+		AE_TARGET("sse2") void unpackVertices_SSE2(const PackedVertex* in, Vertex* out, size_t count, const Quantizer& q) {
+			const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+			const __m128 minX = _mm_set1_ps(q.min.x), minY = _mm_set1_ps(q.min.y), minZ = _mm_set1_ps(q.min.z);
+			const __m128 sX = _mm_set1_ps(q.invScale.x), sY = _mm_set1_ps(q.invScale.y), sZ = _mm_set1_ps(q.invScale.z);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4) {
+				const PackedVertex* src = in + i;
+
+				const __m128i pxy = word_SSE2(src, 0), pzw = word_SSE2(src, 1), uv = word_SSE2(src, 4);
+				alignas(16) float cols[11][4];
+				_mm_store_ps(cols[0], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(pxy, lowMask)), sX), minX));
+				_mm_store_ps(cols[1], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(pxy, 16)), sY), minY));
+				_mm_store_ps(cols[2], _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(pzw, lowMask)), sZ), minZ));
+
+				__m128 y, z;
+				_mm_store_ps(cols[3], octDecode_SSE2(word_SSE2(src, 2), y, z));
+				_mm_store_ps(cols[4], y);
+				_mm_store_ps(cols[5], z);
+				_mm_store_ps(cols[6], octDecode_SSE2(word_SSE2(src, 3), y, z));
+				_mm_store_ps(cols[7], y);
+				_mm_store_ps(cols[8], z);
+				_mm_store_ps(cols[9], fromHalf_SSE2(_mm_and_si128(uv, lowMask)));
+				_mm_store_ps(cols[10], fromHalf_SSE2(_mm_srli_epi32(uv, 16)));
+
+				for (size_t j = 0; j < 4; j++) {
+					float* dst = &out[i + j].position.x;
+					for (size_t k = 0; k < 11; k++) dst[k] = cols[k][j];
+				}
+			}
+			unpackVerticesScalar(in + i, out + i, count - i, q);
+		}
+
+		// AVX2, 8 vertices per iteration. Fields are gathered with the struct stride,
+		// texture coordinates go through the F16C conversions.
+		AE_TARGET("avx2,fma,f16c") inline __m256i octEncode_AVX2(__m256 x, __m256 y, __m256 z) {
+			const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+			const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f), zero = _mm256_setzero_ps();
+
+			const __m256 l1 = _mm256_add_ps(_mm256_add_ps(_mm256_and_ps(x, absMask), _mm256_and_ps(y, absMask)), _mm256_and_ps(z, absMask));
+			const __m256 inv = _mm256_and_ps(_mm256_div_ps(one, l1), _mm256_cmp_ps(l1, zero, _CMP_GT_OQ));
+			__m256 ox = _mm256_mul_ps(x, inv), oy = _mm256_mul_ps(y, inv);
+
+			const __m256 sx = _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(ox, zero, _CMP_GE_OQ));
+			const __m256 sy = _mm256_blendv_ps(minusOne, one, _mm256_cmp_ps(oy, zero, _CMP_GE_OQ));
+			const __m256 fx = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_and_ps(oy, absMask)), sx);
+			const __m256 fy = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_and_ps(ox, absMask)), sy);
+
+			const __m256 negZ = _mm256_cmp_ps(z, zero, _CMP_LT_OQ);
+			ox = _mm256_blendv_ps(ox, fx, negZ);
+			oy = _mm256_blendv_ps(oy, fy, negZ);
+
+			const __m256 s = _mm256_set1_ps(32767.0f);
+			const __m256i qx = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(ox, minusOne), one), s));
+			const __m256i qy = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(oy, minusOne), one), s));
+			return _mm256_or_si256(_mm256_and_si256(qx, _mm256_set1_epi32(0xFFFF)), _mm256_slli_epi32(qy, 16));
+		}
+
+		AE_TARGET("avx2,fma,f16c") inline __m256 octDecode_AVX2(__m256i word, __m256& y, __m256& z) {
+			const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+			const __m256 one = _mm256_set1_ps(1.0f), minusOne = _mm256_set1_ps(-1.0f), zero = _mm256_setzero_ps();
+			const __m256 s = _mm256_set1_ps(1.0f / 32767.0f);
+
+			__m256 x = _mm256_max_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(word, 16), 16)), s), minusOne);
+			y = _mm256_max_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srai_epi32(word, 16)), s), minusOne);
+			z = _mm256_sub_ps(_mm256_sub_ps(one, _mm256_and_ps(x, absMask)), _mm256_and_ps(y, absMask));
+
+			const __m256 t = _mm256_max_ps(_mm256_sub_ps(zero, z), zero);
+			const __m256 negT = _mm256_sub_ps(zero, t);
+			x = _mm256_add_ps(x, _mm256_blendv_ps(t, negT, _mm256_cmp_ps(x, zero, _CMP_GE_OQ)));
+			y = _mm256_add_ps(y, _mm256_blendv_ps(t, negT, _mm256_cmp_ps(y, zero, _CMP_GE_OQ)));
+
+			const __m256 len = _mm256_sqrt_ps(_mm256_fmadd_ps(x, x, _mm256_fmadd_ps(y, y, _mm256_mul_ps(z, z))));
+			y = _mm256_div_ps(y, len);
+			z = _mm256_div_ps(z, len);
+			return _mm256_div_ps(x, len);
+		}
+
+		AE_TARGET("avx2,fma,f16c") inline __m256 column_AVX2(const float* f, __m256i idx, size_t k) {
+			return _mm256_i32gather_ps(f + k, idx, 4);
+		}
+
+		AE_TARGET("avx2,fma,f16c") inline __m256i word_AVX2(const int* src, __m256i idx, size_t k) {
+			return _mm256_i32gather_epi32(src + k, idx, 4);
+		}
+
+		AE_TARGET("avx2,fma,f16c") void packVertices_AVX2(const Vertex* in, PackedVertex* out, size_t count, const Quantizer& q, const float* signs) {
+			const __m256 zero = _mm256_setzero_ps(), maxQ = _mm256_set1_ps(65535.0f);
+			const __m256i signHigh = _mm256_set1_epi32(int32(0xFFFF0000u));
+			const __m256 minX = _mm256_set1_ps(q.min.x), minY = _mm256_set1_ps(q.min.y), minZ = _mm256_set1_ps(q.min.z);
+			const __m256 sX = _mm256_set1_ps(q.scale.x), sY = _mm256_set1_ps(q.scale.y), sZ = _mm256_set1_ps(q.scale.z);
+			const __m256i idx = _mm256_setr_epi32(0, 11, 22, 33, 44, 55, 66, 77);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				const float* f = &in[i].position.x;
+
+				const __m256i px = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(column_AVX2(f, idx, 0), minX), sX), zero), maxQ));
+				const __m256i py = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(column_AVX2(f, idx, 1), minY), sY), zero), maxQ));
+				const __m256i pz = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_sub_ps(column_AVX2(f, idx, 2), minZ), sZ), zero), maxQ));
+
+				alignas(32) uint32 words[WordsPerVertex][8];
+				_mm256_store_si256((__m256i*) words[0], _mm256_or_si256(px, _mm256_slli_epi32(py, 16)));
+				const __m256i signWord = signs ? _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(_mm256_loadu_ps(signs + i), zero, _CMP_GE_OQ)), signHigh) : signHigh;
+				_mm256_store_si256((__m256i*) words[1], _mm256_or_si256(pz, signWord));
+				_mm256_store_si256((__m256i*) words[2], octEncode_AVX2(column_AVX2(f, idx, 3), column_AVX2(f, idx, 4), column_AVX2(f, idx, 5)));
+				_mm256_store_si256((__m256i*) words[3], octEncode_AVX2(column_AVX2(f, idx, 6), column_AVX2(f, idx, 7), column_AVX2(f, idx, 8)));
+
+				const __m128i u = _mm256_cvtps_ph(column_AVX2(f, idx, 9), _MM_FROUND_TO_NEAREST_INT);
+				const __m128i v = _mm256_cvtps_ph(column_AVX2(f, idx, 10), _MM_FROUND_TO_NEAREST_INT);
+				_mm_store_si128((__m128i*) &words[4][0], _mm_unpacklo_epi16(u, v));
+				_mm_store_si128((__m128i*) &words[4][4], _mm_unpackhi_epi16(u, v));
+
+				for (size_t j = 0; j < 8; j++) {
+					uint8* dst = reinterpret_cast<uint8*>(out + i + j);
+					for (size_t k = 0; k < WordsPerVertex; k++) std::memcpy(dst + k * 4, &words[k][j], 4);
+				}
+			}
+			packVertices_SSE2(in + i, out + i, count - i, q, signs ? signs + i : nullptr);
+		}
+
+		AE_TARGET("avx2,fma,f16c") void unpackVertices_AVX2(const PackedVertex* in, Vertex* out, size_t count, const Quantizer& q) {
+			const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+			const __m256 minX = _mm256_set1_ps(q.min.x), minY = _mm256_set1_ps(q.min.y), minZ = _mm256_set1_ps(q.min.z);
+			const __m256 sX = _mm256_set1_ps(q.invScale.x), sY = _mm256_set1_ps(q.invScale.y), sZ = _mm256_set1_ps(q.invScale.z);
+			const __m256i idx = _mm256_setr_epi32(0, 5, 10, 15, 20, 25, 30, 35);
+
+			size_t i = 0;
+			for (; i + 8 <= count; i += 8) {
+				const int* src = reinterpret_cast<const int*>(in + i);
+
+				const __m256i pxy = word_AVX2(src, idx, 0), pzw = word_AVX2(src, idx, 1), uv = word_AVX2(src, idx, 4);
+				alignas(32) float cols[9][8];
+				_mm256_store_ps(cols[0], _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_and_si256(pxy, lowMask)), sX, minX));
+				_mm256_store_ps(cols[1], _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(pxy, 16)), sY, minY));
+				_mm256_store_ps(cols[2], _mm256_fmadd_ps(_mm256_cvtepi32_ps(_mm256_and_si256(pzw, lowMask)), sZ, minZ));
+
+				__m256 y, z;
+				_mm256_store_ps(cols[3], octDecode_AVX2(word_AVX2(src, idx, 2), y, z));
+				_mm256_store_ps(cols[4], y);
+				_mm256_store_ps(cols[5], z);
+				_mm256_store_ps(cols[6], octDecode_AVX2(word_AVX2(src, idx, 3), y, z));
+				_mm256_store_ps(cols[7], y);
+				_mm256_store_ps(cols[8], z);
+
+				// The uv words are already (u, v) half pairs, converting them keeps that interleaving.
+				alignas(32) float uvs[16];
+				_mm256_store_ps(uvs, _mm256_cvtph_ps(_mm256_castsi256_si128(uv)));
+				_mm256_store_ps(uvs + 8, _mm256_cvtph_ps(_mm256_extracti128_si256(uv, 1)));
+
+				for (size_t j = 0; j < 8; j++) {
+					float* dst = &out[i + j].position.x;
+					for (size_t k = 0; k < 9; k++) dst[k] = cols[k][j];
+					dst[9] = uvs[j * 2];
+					dst[10] = uvs[j * 2 + 1];
+				}
+			}
+			unpackVertices_SSE2(in + i, out + i, count - i, q);
+		}
+#endif
+	}
+
+	// Gathers dominate these kernels, AVX-512 would not do better than AVX2 and shares its entries.
+#if defined(AE_X86)
+#	define AE_DISPATCH(fn, ...) \
+		switch (simd::level()) { \
+			case SimdLevel::AVX512: \
+			case SimdLevel::AVX2: fn##_AVX2(__VA_ARGS__); return; \
+			case SimdLevel::SSE41: \
+			case SimdLevel::SSE2: fn##_SSE2(__VA_ARGS__); return; \
+			default: fn##Scalar(__VA_ARGS__); return; \
+		}
+#else
+#	define AE_DISPATCH(fn, ...) fn##Scalar(__VA_ARGS__)
+#endif
+
+	void packVertices(const Vertex* in, PackedVertex* out, size_t count, const AABB& bounds, const float* tangentSigns) {
+		const Quantizer q(bounds);
+		AE_DISPATCH(packVertices, in, out, count, q, tangentSigns);
+	}
+
+	void unpackVertices(const PackedVertex* in, Vertex* out, size_t count, const AABB& bounds) {
+		const Quantizer q(bounds);
+		AE_DISPATCH(unpackVertices, in, out, count, q);
+	}
+
+#undef AE_DISPATCH
+}
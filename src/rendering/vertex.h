@@ -0,0 +1,57 @@
+#ifndef VERTEX_H
+#define VERTEX_H
+
+#include "integer.hpp"
+#include "vec_math.hpp"
+
+namespace ae {
+	struct Vertex {
+		Vector3 position, normal, tangent;
+		Vector2 texCoord;
+	};
+
+	/// 20 byte vertex:
+	///  - position: unorm16 relative to the mesh AABB, w holds the tangent sign (0 = -1, 65535 = +1)
+	///  - normal, tangent: octahedral snorm16
+	///  - texCoord: half floats
+	struct PackedVertex {
+		uint16 position[4];
+		int16 normal[2];
+		int16 tangent[2];
+		uint16 texCoord[2];
+	};
+
+	/// Up to four joints moving a vertex, with unorm8 weights that sum to 255. Unused slots have weight 0.
+	struct SkinVertex {
+		uint8 joints[4];
+		uint8 weights[4];
+	};
+
+	enum class VertexFormat : uint8 {
+		Float = 0,
+		Packed
+	};
+
+	namespace packing {
+		/// Round-to-nearest-even float to IEEE half conversion.
+		uint16 toHalf(float v);
+		float fromHalf(uint16 v);
+
+		/// Octahedral mapping of a unit vector to two snorm16 values.
+		void octEncode(const Vector3& n, int16 out[2]);
+		Vector3 octDecode(const int16 in[2]);
+
+		/// Keeps the four largest of count influences and quantizes their weights, renormalized, so that they
+		/// add up to exactly 255. Joints have to be below 256.
+		SkinVertex packSkin(const uint32* joints, const float* weights, uint32 count);
+	}
+
+	/// Quantizes vertices against bounds (usually the mesh AABB). tangentSigns holds one sign per vertex, see
+	/// geometry::tangentSigns(), nullptr packs +1 for all of them.
+	void packVertices(const Vertex* in, PackedVertex* out, size_t count, const AABB& bounds, const float* tangentSigns = nullptr);
+
+	/// Inverse of packVertices(), normals and tangents are renormalized.
+	void unpackVertices(const PackedVertex* in, Vertex* out, size_t count, const AABB& bounds);
+}
+
+#endif // VERTEX_H
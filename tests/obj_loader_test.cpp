@@ -0,0 +1,77 @@
+// obj::parse() on a file large enough to be split, with relative indices that reach back across chunk boundaries.
+// Exits non-zero on the first mismatch.
+
+#include "obj_loader.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace ae;
+
+namespace {
+	bool same(const ObjData::Corner& a, const ObjData::Corner& b) {
+		return a.vertex == b.vertex && a.texCoord == b.texCoord && a.normal == b.normal;
+	}
+
+	bool check(const char* name, const ObjData& data, const std::vector<ObjData::Corner>& expected, size_t vertexCount) {
+		if (data.positions.size() != vertexCount || data.corners.size() != expected.size()) {
+			std::printf("%s: %zu positions, %zu corners, expected %zu and %zu\n",
+				name, data.positions.size(), data.corners.size(), vertexCount, expected.size());
+			return false;
+		}
+		for (size_t i = 0; i < expected.size(); i++) {
+			if (!same(data.corners[i], expected[i])) {
+				std::printf("%s: corner %zu is %u/%u/%u, expected %u/%u/%u\n", name, i,
+					data.corners[i].vertex, data.corners[i].texCoord, data.corners[i].normal,
+					expected[i].vertex, expected[i].texCoord, expected[i].normal);
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+int main() {
+	// Blocks of vertices, each followed by faces whose relative indices span everything read so far, so that
+	// once split most of them point into earlier chunks. Roughly 18 MB, enough for 4 chunks.
+	constexpr uint32 Blocks = 64, VerticesPerBlock = 4000, FacesPerBlock = 2000;
+
+	std::string text;
+	std::vector<ObjData::Corner> expected;
+	uint32 vertices = 0;
+	uint32 seed = 1;
+	for (uint32 b = 0; b < Blocks; b++) {
+		for (uint32 i = 0; i < VerticesPerBlock; i++, vertices++) {
+			text += "v " + std::to_string(vertices) + ".5 1.25 -2\nvt 0.5 0.25\nvn 0 1 0\n";
+		}
+		for (uint32 f = 0; f < FacesPerBlock; f++) {
+			text += "f";
+			for (uint32 k = 0; k < 3; k++) {
+				seed = seed * 1664525u + 1013904223u;
+				const uint32 back = 1 + (seed >> 8) % vertices;
+				const std::string r = "-" + std::to_string(back);
+				text += " " + r + "/" + r + "/" + r;
+
+				const uint32 index = vertices - back;
+				expected.push_back({ index, index, index });
+			}
+			text += "\n";
+		}
+	}
+
+	// Repeated directives in different chunks, the last one counts.
+	text = "weld_epsilon 0.5\n" + text + "weld_epsilon 0.001\n";
+
+	ObjData serial, parallel;
+	obj::parse(text, serial, 1);
+	obj::parse(text, parallel, 4);
+
+	bool ok = check("1 thread", serial, expected, vertices) && check("4 threads", parallel, expected, vertices);
+	if (serial.weldEpsilon != 0.001f || parallel.weldEpsilon != 0.001f) {
+		std::printf("weld_epsilon is %g on 1 thread and %g on 4, expected 0.001\n", serial.weldEpsilon, parallel.weldEpsilon);
+		ok = false;
+	}
+	std::printf("%s: %zu bytes, %zu corners\n", ok ? "passed" : "FAILED", text.size(), expected.size());
+	return ok ? 0 : 1;
+}